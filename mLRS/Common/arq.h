@@ -16,8 +16,653 @@
 #define USE_ARQ_TX_SIM_MISS   4 //9 // 0 = off
 #define USE_ARQ_RX_SIM_MISS   3 //5 //5 // 0 = off
 
+
 #ifdef USE_ARQ
 
+//-------------------------------------------------------
+// Retry Controller
+//-------------------------------------------------------
+// chooses the retry count from the measured link statistics, called for each transmitted frame
+// - the retries of a payload may take at most ARQ_RETRY_LATENCY_MS, so faster modes can afford more
+// - only 1 retry if retransmissions are rarely successful (deep fade), or if the link to us is bad,
+//   since then many retransmissions are for lost acks and not for lost payloads
+// - the link is saturated if there is a backlog of serial data and many frames are retransmissions,
+//   each retry then costs throughput and delays all data behind it, so we do one retry less
+// see tools/linksim, option --arq-retry-auto, for how this was tuned
+// without USE_FEATURE_ARQ_RETRY_AUTO it's 1 retry, the success rate is still tracked for the stats
+
+#define ARQ_RETRY_LATENCY_MS          110
+#define ARQ_RETRY_CNT_MAX             3
+#define ARQ_RETRY_SUCCESS_MIN         300 // of 1000
+#define ARQ_RETRY_LQ_SERIAL_MIN       50
+#define ARQ_RETRY_SATURATED_BACKLOG   500 // of 1000
+#define ARQ_RETRY_SATURATED_FRAME_CNT 600 // of 1000
+
+
+class tArqRetryController
+{
+  public:
+    void Init(void)
+    {
+        success = 500;
+        backlog = 0;
+        retry_cnt = 1;
+    }
+
+    // called when the ack for a retransmitted payload tells if it got through
+    void Outcome(bool ok)
+    {
+        success += ((ok ? 1000 : 0) - success) / 16;
+    }
+
+    // frame_cnt: frames with fresh payload of 1000, stats.GetFrameCnt()
+    // serial_backlog: serial data was left over when the last fresh payload was read
+    uint8_t Update(int32_t frame_cnt, uint8_t LQ_serial, bool serial_backlog, uint16_t frame_rate_ms)
+    {
+        backlog += ((serial_backlog ? 1000 : 0) - backlog) / 16;
+
+#ifndef USE_FEATURE_ARQ_RETRY_AUTO
+        retry_cnt = 1; // what the previous SetRetryCntAuto() always ended with
+#else
+        uint8_t retry_cnt_max = ARQ_RETRY_LATENCY_MS / frame_rate_ms;
+        if (retry_cnt_max > ARQ_RETRY_CNT_MAX) retry_cnt_max = ARQ_RETRY_CNT_MAX;
+        if (retry_cnt_max < 1) retry_cnt_max = 1;
+
+        if (success < ARQ_RETRY_SUCCESS_MIN || LQ_serial < ARQ_RETRY_LQ_SERIAL_MIN) {
+            retry_cnt = 1;
+        } else if (backlog > ARQ_RETRY_SATURATED_BACKLOG && frame_cnt < ARQ_RETRY_SATURATED_FRAME_CNT) {
+            retry_cnt = (retry_cnt_max > 1) ? retry_cnt_max - 1 : 1;
+        } else {
+            retry_cnt = retry_cnt_max;
+        }
+#endif
+
+        return retry_cnt;
+    }
+
+    int16_t success;    // LP filtered success rate of retransmissions, 0..1000
+    int16_t backlog;    // LP filtered rate of fresh payloads with serial backlog, 0..1000
+    uint8_t retry_cnt;
+};
+
+#endif // USE_ARQ
+
+#if defined USE_ARQ && defined USE_FEATURE_ARQ_SELECTIVE_REPEAT
+
+/*
+theory of operation, selective repeat
+- data frame has a seq_no field of 3 bits, and a arq_window field of 2 bits
+  arq_window = seq_no - send window base, this tells the recipient which payloads the sender
+  still has in flight, and which it has given up on
+- response frame has the ack window in the LQ_rc field, which the Tx doesn't use otherwise
+  it holds the receive window base, i.e. the seq_no of the next payload to be passed on, and
+  a bitmap of the payloads after that which were received out of order and are stored
+- a real LQ value can have any bit set, so the response frame marks the ack window with
+  ARQ_SR_ACK_WINDOW_FLAG in its arq_window field, which earlier firmware leaves at 0
+- if the response frame doesn't have it, the recipient doesn't do selective repeat, and we fall
+  back to stop-and-wait, i.e. a window of 1 and the 1 bit ack; the ack field thus carries the
+  seq_no of the last payload passed on, as with stop-and-wait
+- the sender keeps up to ARQ_SR_WINDOW payloads in flight, so a lost response frame doesn't
+  stop it from sending fresh payloads
+- the recipient stores the payloads received out of order, and passes them on in order
+- a response frame reflects all data frames sent before it, since the Tx and Rx frames alternate,
+  so when the sender gets an ack window, all payloads in flight which are not acked are lost
+- seq_no is 3 bits, so the window can be at most 3: the sender's window base can then be up to 3
+  behind the recipient's (acks lost) or up to 3 ahead (payloads given up), which is unambiguous
+- the sender only gives up on a payload if its window base then isn't more than ARQ_SR_WINDOW
+  ahead of the recipient's last acked window base
+- both keep only the payloads and their lengths, not the whole frames, the frame is rebuilt
+  from it; a cmd frame which doesn't fit, i.e. the rx setup data with USE_FEATURE_FEC, is not
+  kept, it's resent as empty frame, and the Tx asks for it again
+*/
+
+#define ARQ_SR_WINDOW               3
+#define ARQ_SR_BUF_NUM              4 // buffers are indexed by seq_no & 0x03
+#define ARQ_SR_ACK_WINDOW_VALID     0x20 // ack window: bits 0-2 = base, bits 3-4 = bitmap, bit 5 = valid
+#define ARQ_SR_ACK_WINDOW_FLAG      0x01 // in the arq_window field of the response frame: LQ_rc holds the ack window
+
+
+typedef struct
+{
+    uint8_t seq_no;
+    uint8_t frame_type;
+    uint8_t len;
+    uint8_t payload[FRAME_RX_SERIAL_LEN];
+} tArqPayload;
+
+
+// returns false if it doesn't fit, it then is kept as an empty frame
+bool arq_payload_store(tArqPayload* buf, tRxFrame* frame)
+{
+    buf->seq_no = frame->status.seq_no;
+    buf->frame_type = frame->status.frame_type;
+    buf->len = frame->status.payload_len;
+    if (buf->len > FRAME_RX_SERIAL_LEN) {
+        buf->frame_type = FRAME_TYPE_RX;
+        buf->len = 0;
+        return false;
+    }
+    memcpy(buf->payload, frame->payload, buf->len);
+    return true;
+}
+
+
+// sets the header fields which describe the payload, the other ones are not touched
+void arq_payload_load(tRxFrame* frame, tArqPayload* buf)
+{
+    frame->status.seq_no = buf->seq_no;
+    frame->status.frame_type = buf->frame_type;
+    frame->status.payload_len = buf->len;
+    memcpy(frame->payload, buf->payload, buf->len);
+    memset(&(frame->payload[buf->len]), 0, FRAME_RX_PAYLOAD_LEN - buf->len);
+}
+
+
+//-------------------------------------------------------
+// Transmit
+//-------------------------------------------------------
+
+class tTransmitArq
+{
+  public:
+    void Init(void);
+
+    typedef enum {
+        ARQ_TX_IDLE = 0,
+        ARQ_TX_FRAME_MISSED,
+        ARQ_TX_RECEIVED,
+    } ARQ_TX_ENUM;
+
+    void Disconnected(void);
+    void FrameMissed(void);
+    void AckReceived(uint8_t ack_seq_no, uint8_t ack_window, uint8_t ack_window_flag);
+
+    bool GetFreshPayload(void);
+    uint8_t SeqNo(void);
+    uint8_t Window(void);
+    void StoreFrame(tRxFrame* frame);
+    void LoadFrame(tRxFrame* frame);
+    void SetRetryCnt(uint8_t retry_cnt);
+
+    void SetRetryCntAuto(int32_t frame_cnt, uint8_t LQ_serial, bool serial_backlog, uint16_t frame_rate_ms);
+    uint8_t RetryCnt(void) { return payload_retry_cnt; }
+    uint16_t RetrySuccess(void) { return retry_ctrl.success; }
+
+    tArqRetryController retry_ctrl;
+    bool retransmitted;           // the last payload sent was a retransmission
+    tArqCnt cnt;                  // first_attempt, retransmitted, retry_exhausted
+
+    uint8_t status;
+    uint8_t received_ack_seq_no;  // the 1 bit ack, only used for stop-and-wait
+    uint8_t received_ack_window;
+    bool selective;               // the recipient does selective repeat, else we do stop-and-wait
+    uint8_t payload_seq_no;       // the seq_no of the payload to be sent
+    uint8_t payload_retry_cnt;    // maximum number of allowed retries for a payload, 0 = off, 255 = infinite
+
+    uint8_t send_base;            // seq_no of the oldest payload in flight
+    uint8_t send_next;            // seq_no for the next fresh payload
+    uint8_t rx_base_known;        // recipient's receive window base, as last acked
+    bool acked[ARQ_SR_BUF_NUM];
+    bool lost[ARQ_SR_BUF_NUM];
+    uint8_t retries[ARQ_SR_BUF_NUM];
+    tArqPayload payload_buf[ARQ_SR_BUF_NUM];
+
+  private:
+    uint8_t in_flight(void) { return (send_next - send_base) & 0x07; }
+    uint8_t window(void) { return (selective) ? ARQ_SR_WINDOW : 1; }
+    void apply_ack(void);
+    void apply_ack_seq_no(void);
+    void slide(void);
+    bool may_give_up(uint8_t seq_no);
+    bool retransmit(uint8_t seq_no);
+    bool fresh(void);
+    bool SimulateMiss(void);
+};
+
+
+void tTransmitArq::Init(void)
+{
+    status = ARQ_TX_IDLE;
+    received_ack_seq_no = 0;
+    received_ack_window = 0;
+    selective = false;
+    payload_seq_no = 0;
+    payload_retry_cnt = UINT8_MAX; // 0 = off, 255 = infinite
+
+    retry_ctrl.Init();
+    retransmitted = false;
+    cnt = {};
+
+    send_base = send_next = rx_base_known = 0;
+    for (uint8_t i = 0; i < ARQ_SR_BUF_NUM; i++) {
+        acked[i] = lost[i] = false;
+        retries[i] = 0;
+    }
+}
+
+
+// methods called upon receive or expected receive (in doPostReceive)
+
+void tTransmitArq::Disconnected(void)
+{
+    status = ARQ_TX_IDLE;
+}
+
+
+void tTransmitArq::FrameMissed(void)
+{
+    status = ARQ_TX_FRAME_MISSED;
+}
+
+
+void tTransmitArq::AckReceived(uint8_t ack_seq_no, uint8_t ack_window, uint8_t ack_window_flag)
+{
+    received_ack_seq_no = ack_seq_no;
+    received_ack_window = ack_window;
+    selective = (ack_window_flag & ARQ_SR_ACK_WINDOW_FLAG);
+    status = ARQ_TX_RECEIVED;
+}
+
+
+// the ack window reflects all frames we have sent, so what's not acked is lost
+void tTransmitArq::apply_ack(void)
+{
+    if (!selective) { apply_ack_seq_no(); return; }
+
+    if (!(received_ack_window & ARQ_SR_ACK_WINDOW_VALID)) return; // recipient is not synced yet
+
+    uint8_t ack_base = received_ack_window & 0x07;
+    uint8_t ack_mask = (received_ack_window >> 3) & 0x03;
+    uint8_t ahead = (ack_base - send_base) & 0x07;
+    uint8_t behind = (send_base - ack_base) & 0x07;
+
+    if (ahead > in_flight() && behind > ARQ_SR_WINDOW) return; // stale or corrupted, ignore
+
+    rx_base_known = ack_base;
+
+    for (uint8_t n = 0; n < in_flight(); n++) {
+        uint8_t seq_no = (send_base + n) & 0x07;
+        uint8_t i = seq_no & 0x03;
+        bool ack = (ahead <= in_flight() && n < ahead); // recipient has passed it on
+        uint8_t d = (seq_no - ack_base - 1) & 0x07;
+        if (d < ARQ_SR_WINDOW - 1 && (ack_mask & (1 << d))) ack = true; // recipient has stored it
+        if (ack && !acked[i] && !retries[i]) cnt.first_attempt++;
+        if (ack) acked[i] = true;
+        if (!acked[i]) lost[i] = true;
+        if (seq_no == payload_seq_no && retransmitted) retry_ctrl.Outcome(acked[i]);
+    }
+}
+
+
+// the recipient does stop-and-wait, so at most one payload is in flight, and the 1 bit ack
+// holds the seq_no of the last payload it got
+void tTransmitArq::apply_ack_seq_no(void)
+{
+    rx_base_known = send_base;
+    if (send_base == send_next) return;
+
+    uint8_t i = send_base & 0x03;
+    if ((received_ack_seq_no & 0x01) == (send_base & 0x01)) {
+        if (!acked[i] && !retries[i]) cnt.first_attempt++;
+        acked[i] = true;
+        rx_base_known = (send_base + 1) & 0x07;
+    } else {
+        lost[i] = true;
+    }
+    if (retransmitted) retry_ctrl.Outcome(acked[i]);
+}
+
+
+void tTransmitArq::slide(void)
+{
+    while (send_base != send_next && acked[send_base & 0x03]) send_base = (send_base + 1) & 0x07;
+}
+
+
+// we may give up on a payload if our window base then isn't too far ahead of the recipient's
+// so with ARQ disabled, i.e. retry_cnt = 0, payloads still may be resent
+bool tTransmitArq::may_give_up(uint8_t seq_no)
+{
+    if (payload_retry_cnt == UINT8_MAX) return false; // infinite retries
+
+    uint8_t i = seq_no & 0x03;
+    if (retries[i] < payload_retry_cnt) return false;
+
+    uint8_t base = send_base;
+    while (base != send_next && (acked[base & 0x03] || base == seq_no)) base = (base + 1) & 0x07;
+    return (((base - rx_base_known) & 0x07) <= ARQ_SR_WINDOW);
+}
+
+
+bool tTransmitArq::retransmit(uint8_t seq_no)
+{
+    uint8_t i = seq_no & 0x03;
+    retries[i]++;
+    lost[i] = false;
+    payload_seq_no = seq_no;
+    retransmitted = true;
+    cnt.retransmitted++;
+    return false;
+}
+
+
+bool tTransmitArq::fresh(void)
+{
+    uint8_t i = send_next & 0x03;
+    acked[i] = lost[i] = false;
+    retries[i] = 0;
+    payload_seq_no = send_next;
+    send_next = (send_next + 1) & 0x07;
+    retransmitted = false;
+    return true;
+}
+
+
+// methods called for transmit
+
+// called at begin of prepare_transmit_frame()
+// return true: send new payload, call StoreFrame() after packing the frame
+//        false: resend a previous payload, call LoadFrame() to get its frame
+bool tTransmitArq::GetFreshPayload(void)
+{
+    if (status == ARQ_TX_IDLE) {
+        // we have no history info, so start afresh
+        send_base = rx_base_known = send_next;
+        return fresh();
+    }
+
+    if (status == ARQ_TX_RECEIVED) apply_ack();
+
+    // resend the oldest lost payload, unless we can give up on it
+    for (uint8_t n = 0; n < in_flight(); n++) {
+        uint8_t seq_no = (send_base + n) & 0x07;
+        uint8_t i = seq_no & 0x03;
+        if (acked[i] || !lost[i]) continue;
+        if (may_give_up(seq_no)) {
+            acked[i] = true;
+            cnt.retry_exhausted++;
+            continue;
+        }
+        slide();
+        return retransmit(seq_no);
+    }
+    slide();
+
+    if (in_flight() < window()) return fresh();
+
+    // window is full and we don't know more, resend the oldest payload, unless we can give up on it
+    if (may_give_up(send_base)) {
+        acked[send_base & 0x03] = true;
+        cnt.retry_exhausted++;
+        slide();
+        return fresh();
+    }
+    return retransmit(send_base);
+}
+
+
+uint8_t tTransmitArq::SeqNo(void)
+{
+    return payload_seq_no; // is 0...7
+}
+
+
+uint8_t tTransmitArq::Window(void)
+{
+    return (payload_seq_no - send_base) & 0x07; // is 0...2
+}
+
+
+void tTransmitArq::StoreFrame(tRxFrame* frame)
+{
+    arq_payload_store(&payload_buf[payload_seq_no & 0x03], frame);
+}
+
+
+// the frame's header needs to be updated afterwards, i.e. with update_rxframe_stats()
+void tTransmitArq::LoadFrame(tRxFrame* frame)
+{
+    arq_payload_load(frame, &payload_buf[payload_seq_no & 0x03]);
+}
+
+
+void tTransmitArq::SetRetryCnt(uint8_t retry_cnt)
+{
+#ifndef USE_ARQ_DBG
+    payload_retry_cnt = retry_cnt;
+#else
+  #if USE_ARQ_RETRY_CNT < 0
+    payload_retry_cnt = retry_cnt;
+  #else
+    payload_retry_cnt = USE_ARQ_RETRY_CNT;
+  #endif
+#endif
+}
+
+
+void tTransmitArq::SetRetryCntAuto(int32_t frame_cnt, uint8_t LQ_serial, bool serial_backlog, uint16_t frame_rate_ms)
+{
+    SetRetryCnt(retry_ctrl.Update(frame_cnt, LQ_serial, serial_backlog, frame_rate_ms));
+}
+
+
+// miscellaneous
+
+bool tTransmitArq::SimulateMiss(void)
+{
+#if defined USE_ARQ_DBG && USE_ARQ_RX_SIM_MISS > 0
+    static uint8_t miss_cnt = 0;
+    DECc(miss_cnt, USE_ARQ_RX_SIM_MISS);
+    if (miss_cnt == 0) return true;
+#endif
+    return false;
+}
+
+
+//-------------------------------------------------------
+// Receive
+//-------------------------------------------------------
+
+class tReceiveArq
+{
+  public:
+    void Init(void);
+
+    typedef enum {
+        ARQ_RX_IDLE = 0,
+        ARQ_RX_FRAME_MISSED,
+        ARQ_RX_RECEIVED,
+    } ARQ_RX_ENUM;
+
+    void Disconnected(void);
+    void FrameMissed(void);
+    void Received(uint8_t seq_no, uint8_t window);
+
+    tRxFrame* GetPayload(tRxFrame* frame);
+    bool FrameLost(void);
+
+    uint8_t AckSeqNo(void);
+    uint8_t AckWindow(void);
+    uint8_t Window(void) { return ARQ_SR_ACK_WINDOW_FLAG; } // tells the sender that LQ_rc holds the ack window
+
+    uint8_t status;
+    uint8_t rx_base;                // seq_no of the next payload to be passed on, all seq_no here are 3 bit, 0..7
+    uint8_t skip_cnt;               // the sender has given up on payloads, so rx_base needs to advance by this
+    uint8_t received_seq_no;
+    bool received_pending;          // received payload is to be passed on or to be stored
+    bool lost;                      // payloads were lost since the last payload passed on
+    bool frame_lost;
+    tArqCnt cnt;                    // duplicates, frame_lost
+    bool stored[ARQ_SR_BUF_NUM];
+    tArqPayload payload_buf[ARQ_SR_BUF_NUM];
+
+  private:
+    void advance(void);
+    void store_received(tRxFrame* frame);
+    bool SimulateMiss(void);
+};
+
+
+void tReceiveArq::Init(void)
+{
+    status = ARQ_RX_IDLE;
+    rx_base = 0;
+    skip_cnt = 0;
+    received_seq_no = 0;
+    received_pending = false;
+    lost = false;
+    frame_lost = false;
+    cnt = {};
+    for (uint8_t i = 0; i < ARQ_SR_BUF_NUM; i++) stored[i] = false;
+}
+
+
+// methods called upon receive or expected receive (in doPreTransmit)
+// the calling sequence is:
+// 1. Received(seq_no, window) or FrameMissed() (in handle_receive() or handle_receive_none())
+// 2. GetPayload() until it returns nullptr, FrameLost() for each payload (in process_received_frame())
+// 3. Disconnected()
+
+void tReceiveArq::Disconnected(void)
+{
+    status = ARQ_RX_IDLE;
+}
+
+
+void tReceiveArq::FrameMissed(void)
+{
+    if (status != ARQ_RX_IDLE) status = ARQ_RX_FRAME_MISSED;
+    received_pending = false;
+    skip_cnt = 0;
+}
+
+
+void tReceiveArq::Received(uint8_t seq_no, uint8_t window)
+{
+    uint8_t send_base = (seq_no - window) & 0x07;
+
+    received_pending = false;
+    skip_cnt = 0;
+
+    if (status == ARQ_RX_IDLE) {
+        // we have no history info, so sync to the sender
+        // let's also indicate that we have had lost frames
+        rx_base = send_base;
+        for (uint8_t i = 0; i < ARQ_SR_BUF_NUM; i++) stored[i] = false;
+        lost = true;
+    }
+    status = ARQ_RX_RECEIVED;
+
+    // the sender is ahead, it has given up on payloads
+    uint8_t d = (send_base - rx_base) & 0x07;
+    if (d >= 1 && d <= ARQ_SR_WINDOW) skip_cnt = d;
+
+    uint8_t e = (seq_no - rx_base - skip_cnt) & 0x07;
+    if (e >= ARQ_SR_WINDOW) { cnt.duplicates++; return; } // an old payload, we had passed it on already
+
+    uint8_t i = seq_no & 0x03;
+    if (stored[i] && payload_buf[i].seq_no == seq_no) { cnt.duplicates++; return; } // we have it stored already
+
+    received_seq_no = seq_no;
+    received_pending = true;
+}
+
+
+void tReceiveArq::advance(void)
+{
+    rx_base = (rx_base + 1) & 0x07;
+    if (skip_cnt) skip_cnt--;
+}
+
+
+// returns the payloads in order, the received frame's and the stored ones, nullptr if none is left
+// the received frame's payload is stored if it came out of order, the stored ones are loaded into the
+// frame, so the frame's payload is valid only until the next call
+tRxFrame* tReceiveArq::GetPayload(tRxFrame* frame)
+{
+    while (1) {
+        uint8_t i = rx_base & 0x03;
+        if (received_pending && received_seq_no == rx_base) {
+            received_pending = false;
+            advance();
+            frame_lost = lost;
+            if (lost) cnt.frame_lost++;
+            lost = false;
+            return frame;
+        }
+        if (stored[i]) {
+            stored[i] = false;
+            advance();
+            frame_lost = lost;
+            if (lost) cnt.frame_lost++;
+            lost = false;
+            tArqPayload payload = payload_buf[i];
+            if (received_pending) store_received(frame); // may go into the same buffer
+            arq_payload_load(frame, &payload);
+            return frame;
+        }
+        if (!skip_cnt) break;
+        advance(); // the sender has given up on this payload
+        lost = true;
+    }
+
+    if (received_pending) store_received(frame);
+
+    return nullptr;
+}
+
+
+// a payload which doesn't fit is not stored, we then don't ack it, see arq_payload_store()
+void tReceiveArq::store_received(tRxFrame* frame)
+{
+    stored[received_seq_no & 0x03] = arq_payload_store(&payload_buf[received_seq_no & 0x03], frame);
+    received_pending = false;
+}
+
+
+// called to check if parsers need to be reset
+// must be called after GetPayload(), but before its payload is passed on
+bool tReceiveArq::FrameLost(void)
+{
+    return frame_lost;
+}
+
+
+// methods called for transmit
+
+uint8_t tReceiveArq::AckSeqNo(void)
+{
+    return (rx_base - 1) & 0x07; // the last payload passed on, as for stop-and-wait, will be converted by 1 bit to 0/1
+}
+
+
+uint8_t tReceiveArq::AckWindow(void)
+{
+    if (status == ARQ_RX_IDLE) return 0;
+
+    uint8_t mask = 0;
+    for (uint8_t d = 0; d < ARQ_SR_WINDOW - 1; d++) {
+        if (stored[(rx_base + 1 + d) & 0x03]) mask |= (1 << d);
+    }
+    return rx_base | (mask << 3) | ARQ_SR_ACK_WINDOW_VALID;
+}
+
+
+// miscellaneous
+
+bool tReceiveArq::SimulateMiss(void)
+{
+#if defined USE_ARQ_DBG && USE_ARQ_TX_SIM_MISS > 0
+    static uint8_t miss_cnt = 0;
+    DECc(miss_cnt, USE_ARQ_TX_SIM_MISS);
+    if (miss_cnt == 0) return true;
+#endif
+    return false;
+}
+
+
+#elif defined USE_ARQ
+
 /*
 theory of operation
 - data frame has a seq_no field of 3 bits
@@ -49,13 +694,22 @@ class tTransmitArq
 
     void Disconnected(void);
     void FrameMissed(void);
-    void AckReceived(uint8_t ack_seq_no);
+    void AckReceived(uint8_t ack_seq_no, uint8_t ack_window, uint8_t ack_window_flag);
 
     bool GetFreshPayload(void);
     uint8_t SeqNo(void);
+    uint8_t Window(void) { return 0; }
+    void StoreFrame(tRxFrame* frame) {} // the previous payload is kept in the frame
+    void LoadFrame(tRxFrame* frame) {}
     void SetRetryCnt(uint8_t retry_cnt);
 
-    void SetRetryCntAuto(int32_t _frame_cnt, uint8_t mode);
+    void SetRetryCntAuto(int32_t frame_cnt, uint8_t LQ_serial, bool serial_backlog, uint16_t frame_rate_ms);
+    uint8_t RetryCnt(void) { return payload_retry_cnt; }
+    uint16_t RetrySuccess(void) { return retry_ctrl.success; }
+
+    tArqRetryController retry_ctrl;
+    bool retransmitted;           // the last payload sent was a retransmission
+    tArqCnt cnt;                  // first_attempt, retransmitted, retry_exhausted
 
     uint8_t status;
     uint8_t received_ack_seq_no;  // attention: is 0/1 only, 0 = even, 1 = odd
@@ -63,6 +717,8 @@ class tTransmitArq
     uint8_t payload_retry_cnt;    // maximum number of allowed retries for this payload, 0 = off, 255 = infinite
     uint8_t payload_retries;      // number of retries for this payload
 
+  private:
+    bool get_fresh_payload(void);
     bool SimulateMiss(void);
 };
 
@@ -74,6 +730,10 @@ void tTransmitArq::Init(void)
     payload_seq_no = 0;
     payload_retry_cnt = UINT8_MAX; // 0 = off, 255 = infinite
     payload_retries = 0;
+
+    retry_ctrl.Init();
+    retransmitted = false;
+    cnt = {};
 }
 
 
@@ -94,7 +754,7 @@ void tTransmitArq::FrameMissed(void)
 }
 
 
-void tTransmitArq::AckReceived(uint8_t ack_seq_no)
+void tTransmitArq::AckReceived(uint8_t ack_seq_no, uint8_t ack_window, uint8_t ack_window_flag)
 {
     received_ack_seq_no = ack_seq_no; // is 0/1
     status = ARQ_TX_RECEIVED;
@@ -107,6 +767,25 @@ void tTransmitArq::AckReceived(uint8_t ack_seq_no)
 // return true: send new payload
 //        false: resend previous payload
 bool tTransmitArq::GetFreshPayload(void)
+{
+    if (status == ARQ_TX_RECEIVED) {
+        // the ack tells if the payload got through
+        bool ok = ((received_ack_seq_no & 0x01) == (payload_seq_no & 0x01));
+        if (retransmitted) {
+            retry_ctrl.Outcome(ok);
+        } else if (ok) {
+            cnt.first_attempt++;
+        }
+    }
+
+    bool fresh = get_fresh_payload();
+    retransmitted = !fresh;
+    if (!fresh) cnt.retransmitted++;
+    return fresh;
+}
+
+
+bool tTransmitArq::get_fresh_payload(void)
 {
     if (payload_retry_cnt == 0) { // ARQ disabled, new payload each time
         payload_seq_no++;
@@ -140,6 +819,7 @@ bool tTransmitArq::GetFreshPayload(void)
                 if (payload_retries <= payload_retry_cnt) { // we still can retry
                     return false;
                 }
+                cnt.retry_exhausted++;
             }
         }
         // recipient acked the previous payload or too many retries, shall send new payload
@@ -157,6 +837,7 @@ bool tTransmitArq::GetFreshPayload(void)
         } else { // ARQ with finite retries
             payload_retries++;
             if (payload_retries > payload_retry_cnt) { // too many retries, send new payload
+                cnt.retry_exhausted++;
                 payload_seq_no++;
                 payload_retries = 0;
                 return true;
@@ -189,26 +870,9 @@ void tTransmitArq::SetRetryCnt(uint8_t retry_cnt)
 }
 
 
-void tTransmitArq::SetRetryCntAuto(int32_t _frame_cnt, uint8_t mode)
+void tTransmitArq::SetRetryCntAuto(int32_t frame_cnt, uint8_t LQ_serial, bool serial_backlog, uint16_t frame_rate_ms)
 {
-    switch (mode) {
-    case MODE_FLRC_111HZ: // 3 -> 2 -> 1
-        if (_frame_cnt >= 800) {
-            SetRetryCnt(3);
-        } else if (_frame_cnt >= 700) {
-            SetRetryCnt(2);
-        } else {
-            SetRetryCnt(1);
-        }
-        break;
-    case MODE_FSK_50HZ: // 2 -> 1
-    case MODE_50HZ:
-    case MODE_31HZ:
-    case MODE_19HZ:
-        SetRetryCnt((_frame_cnt >= 800) ? 2 : 1);
-    }
-
-    SetRetryCnt(1); // should never be called
+    SetRetryCnt(retry_ctrl.Update(frame_cnt, LQ_serial, serial_backlog, frame_rate_ms));
 }
 
 
@@ -243,12 +907,15 @@ class tReceiveArq
 
     void Disconnected(void);
     void FrameMissed(void);
-    void Received(uint8_t seq_no);
+    void Received(uint8_t seq_no, uint8_t window);
 
     bool AcceptPayload(void);
+    tRxFrame* GetPayload(tRxFrame* frame);
     bool FrameLost(void);
 
     uint8_t AckSeqNo(void);
+    uint8_t AckWindow(void) { return UINT8_MAX; } // not used, Tx has no valid LQ_rc value
+    uint8_t Window(void) { return 0; }
 
     uint8_t status;
     uint8_t received_seq_no_last;   // all seq_no here are 3 bit,  0..7
@@ -256,6 +923,7 @@ class tReceiveArq
     uint8_t ack_seq_no;
     bool accept_received_payload;   // maybe a state?
     bool frame_lost;                // maybe a state?
+    tArqCnt cnt;                    // duplicates, frame_lost
 
     void spin(void);
 
@@ -271,13 +939,14 @@ void tReceiveArq::Init(void)
     accept_received_payload = false;
     frame_lost = false;
     ack_seq_no = 0;
+    cnt = {};
 }
 
 
 // methods called upon receive or expected receive (in doPreTransmit)
 // the calling sequence is:
 // 1. Received(seq_no) or FrameMissed() (in handle_receive() or handle_receive_none())
-// 2. AcceptPayload() (in process_received_frame())
+// 2. GetPayload() (in process_received_frame())
 // 3. FrameLost()
 // 4. Disconnected()
 
@@ -306,6 +975,7 @@ void tReceiveArq::spin(void)
         // we got a frame with valid payload
         // if payload's seq_no is different from the last => we got a new payload
         accept_received_payload = (received_seq_no != received_seq_no_last); // new seq no received, so accept it
+        if (!accept_received_payload) cnt.duplicates++;
 
         // the received seq_no is 3 bits
         // we can check if we lost a frame if the received seq no is larger than just +1
@@ -334,7 +1004,7 @@ void tReceiveArq::FrameMissed(void)
 }
 
 
-void tReceiveArq::Received(uint8_t seq_no)
+void tReceiveArq::Received(uint8_t seq_no, uint8_t window)
 {
     received_seq_no = seq_no;
     status = (status == ARQ_RX_IDLE) ? ARQ_RX_RECEIVED_WAS_IDLE : ARQ_RX_RECEIVED;
@@ -348,6 +1018,16 @@ bool tReceiveArq::AcceptPayload(void)
 }
 
 
+// returns the frame once if it has a fresh payload, else nullptr
+tRxFrame* tReceiveArq::GetPayload(tRxFrame* frame)
+{
+    if (!accept_received_payload) return nullptr;
+    accept_received_payload = false;
+    if (frame_lost) cnt.frame_lost++;
+    return frame;
+}
+
+
 // called to check if parsers need to be reset
 // must be called after FrameMissed(), Received(), but before payload is passed on
 bool tReceiveArq::FrameLost(void)
@@ -387,29 +1067,41 @@ class tTransmitArq
 
     void Disconnected(void) {}
     void FrameMissed(void) {}
-    void AckReceived(uint8_t ack_seq_no) {}
+    void AckReceived(uint8_t ack_seq_no, uint8_t ack_window, uint8_t ack_window_flag) {}
 
     bool GetFreshPayload(void) { return true; }
     uint8_t SeqNo(void) { seq_no++; return seq_no; }
+    uint8_t Window(void) { return 0; }
+    void StoreFrame(tRxFrame* frame) {}
+    void LoadFrame(tRxFrame* frame) {}
     void SetRetryCnt(uint8_t retry_cnt) {}
-    void SetRetryCntAuto(int32_t _frame_cnt, uint8_t mode) {}
+    void SetRetryCntAuto(int32_t frame_cnt, uint8_t LQ_serial, bool serial_backlog, uint16_t frame_rate_ms) {}
+    uint8_t RetryCnt(void) { return 0; }
+    uint16_t RetrySuccess(void) { return 0; }
 
     uint8_t seq_no;
+    tArqCnt cnt = {};
 };
 
 
 class tReceiveArq
 {
   public:
-    void Init(void) {}
+    void Init(void) { fresh = false; }
 
     void Disconnected(void) {}
     void FrameMissed(void) {}
-    void Received(uint8_t _seq_no) {}
+    void Received(uint8_t _seq_no, uint8_t _window) { fresh = true; }
     bool AcceptPayload(void) { return true; }
+    tRxFrame* GetPayload(tRxFrame* frame) { if (!fresh) return nullptr; fresh = false; return frame; }
     bool FrameLost(void) { return false; }
 
     uint8_t AckSeqNo(void) { return 1; }
+    uint8_t AckWindow(void) { return UINT8_MAX; }
+    uint8_t Window(void) { return 0; }
+
+    bool fresh;
+    tArqCnt cnt = {};
 };
 
 #undef USE_ARQ_DBG
@@ -26,7 +26,21 @@
 
 
 // Development features. Note: They are offered for testing, but they are not for production
-//currently none
+//#define USE_FEATURE_PROFILER // per-stage profiling of the main loop, see Common/profiler.h
+//#define USE_FEATURE_RC_TRACE // latency tracing of the rc data, see Common/rc_trace.h
+//#define USE_FEATURE_FRAME_CRC_HW // use the hardware crc unit for the frame crc, on G4 and WL only, see Common/frame_crc.h
+//#define USE_FEATURE_ARQ_SELECTIVE_REPEAT // selective repeat ARQ for the Rx->Tx serial data, Tx and Rx should both have it, with a Tx without it the Rx does stop-and-wait, see Common/arq.h
+//#define USE_FEATURE_ARQ_RETRY_AUTO // the Rx chooses the ARQ retry count from the link statistics, else it's 1, see Common/arq.h
+//#define USE_FEATURE_ARQ_STATS // sends the ARQ counters and goodput as MAVLink DEBUG_FLOAT_ARRAY "MLRS_ARQ", and the Rx counts to the Tx once per second, Tx and Rx should both have it, see Common/common_stats.h
+//#define USE_FEATURE_FHSS_ADAPTIVE // swaps bad fhss channels for spare channels, Tx and Rx must both have it, see Common/fhss_adaptive.h
+//#define USE_FEATURE_RX_RESYNC // after a disconnect the rx keeps hopping for a while before it goes to slow listen, see CommonRx/resync.h
+//#define USE_FEATURE_RX_LISTEN_RANK // in listen the rx goes through the fhss slots in the order of their recent quality, see CommonRx/listen_rank.h
+//#define USE_FEATURE_FRAME_VARLEN // frames without payload are send short, shortens the time over air, agreed on at connect, with a Rx without it frames stay full length, not for SX127x, see Common/frames.h
+//#define USE_FEATURE_FEC // Reed-Solomon parity in the frames, repairs a few wrong bytes, costs 8 bytes of payload, Tx and Rx must both have it, see Common/fec.h
+//#define USE_FEATURE_MAVLINK_SCHEDULER // the MAVLink link out sends commands first and coalesces periodic telemetry, this reorders messages, see Common/mavlink_scheduler.h
+//#define USE_FEATURE_SCHED_STATS // sends the coalescing counters of the MAVLink link out scheduler of the rx as MAVLink DEBUG_FLOAT_ARRAY "MLRS_SCHED", see Common/mavlink_scheduler.h
+//#define USE_FEATURE_MAVLINKX_DELTA // MavlinkX sends slowly changing messages as delta to a reference, in 19 Hz mode only, Tx and Rx must both have it, see Common/thirdparty/mavlinkx.h
+//#define USE_FEATURE_MAVLINKX_CONTEXT // MavlinkX sends seq, sysid, compid, msgid of frequent messages as a one byte index, Tx and Rx must both have it, see Common/thirdparty/mavlinkx.h
 
 
 //-------------------------------------------------------
@@ -127,6 +141,12 @@
 
 #define FRAME_TX_RX_LEN                 91 // we currently only support equal len
 
+#ifdef USE_FEATURE_FRAME_VARLEN
+  #define IF_FRAME_VARLEN(x)            x
+#else
+  #define IF_FRAME_VARLEN(x)
+#endif
+
 #define CONNECT_TMO_MS                  1250 // time to disconnect, was 500, then 750 to better handle 19 Hz mode, now 1250
 
 #define CONNECT_SYNC_CNT                5 // number of packets to connect
@@ -29,6 +29,11 @@ void tStats::Init(uint8_t _maverage_period, uint16_t _frame_rate_hz, uint16_t _f
     mav_packets_received.Init(_frame_rate_hz);
 
     frame_cnt.Init(2000, _frame_rate_ms, 500);
+    goodput.Init(4000, 1000, 0); // updated at 1 Hz
+
+    arq_cnt = {};
+    arq_cnt_per_sec = {};
+    arq_cnt_last = {};
 
     Clear();
 
@@ -62,6 +67,8 @@ void tStats::Clear(void) // called then not connected
     received_transmit_antenna = UINT8_MAX;
 
     frame_cnt.Clear();
+    arq_retry_cnt = 0;
+    arq_retry_success = 0;
     transmit_seq_no = 0;
 }
 
@@ -82,6 +89,15 @@ void tStats::Update1Hz(void)
     mav_packets_received.Update1Hz();
 #endif
 
+    goodput.Put(bytes_received.GetBytesPerSec());
+
+    // the ARQ counters only count up, unsigned arithmetic handles the wrap around
+    arq_cnt_per_sec.first_attempt = arq_cnt.first_attempt - arq_cnt_last.first_attempt;
+    arq_cnt_per_sec.retransmitted = arq_cnt.retransmitted - arq_cnt_last.retransmitted;
+    arq_cnt_per_sec.retry_exhausted = arq_cnt.retry_exhausted - arq_cnt_last.retry_exhausted;
+    arq_cnt_per_sec.duplicates = arq_cnt.duplicates - arq_cnt_last.duplicates;
+    arq_cnt_per_sec.frame_lost = arq_cnt.frame_lost - arq_cnt_last.frame_lost;
+    arq_cnt_last = arq_cnt;
 }
 
 
@@ -141,6 +157,13 @@ uint8_t tStats::GetReceiveBandwidthUsage(void)
 }
 
 
+uint16_t tStats::GetGoodput(void)
+{
+    int32_t bps = goodput.Get();
+    return (bps < 0) ? 0 : (bps > UINT16_MAX) ? UINT16_MAX : bps;
+}
+
+
 int8_t tStats::GetLastRssi(void)
 {
     return (last_antenna == ANTENNA_1) ? last_rssi1 : last_rssi2;
@@ -204,3 +227,26 @@ int32_t tStats::GetFrameCnt(void)
     int32_t fn = frame_cnt.Get();
     return (fn < 0) ? 0 : (fn > 1000) ? 1000 : fn; // limit to [0, 1000]
 }
+
+
+// for the MAVLink DEBUG_FLOAT_ARRAY
+uint8_t tStats::GetArqFloatArray(float* data)
+{
+    uint8_t len = 0;
+    data[len++] = GetGoodput();
+    data[len++] = bytes_transmitted.GetBytesPerSec();
+    data[len++] = bytes_received.GetBytesPerSec();
+    data[len++] = arq_cnt_per_sec.first_attempt;
+    data[len++] = arq_cnt_per_sec.retransmitted;
+    data[len++] = arq_cnt_per_sec.retry_exhausted;
+    data[len++] = arq_cnt_per_sec.duplicates;
+    data[len++] = arq_cnt_per_sec.frame_lost;
+    data[len++] = arq_cnt.first_attempt;
+    data[len++] = arq_cnt.retransmitted;
+    data[len++] = arq_cnt.retry_exhausted;
+    data[len++] = arq_cnt.duplicates;
+    data[len++] = arq_cnt.frame_lost;
+    data[len++] = arq_retry_cnt;
+    data[len++] = arq_retry_success;
+    return len;
+}
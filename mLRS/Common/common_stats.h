@@ -21,6 +21,20 @@
 extern bool connected(void);
 
 
+// counters of the ARQ, running totals since its Init()
+// the transmitting side fills first_attempt, retransmitted, retry_exhausted, the receiving side
+// duplicates, frame_lost, so Rx has the first three and Tx the last two
+// with USE_FEATURE_ARQ_STATS the Rx sends its counts once per second with FRAME_CMD_RX_ARQ_STATS, so Tx has all five
+typedef struct
+{
+    uint32_t first_attempt;           // payloads which got through without retransmission
+    uint32_t retransmitted;           // payloads which were sent again
+    uint32_t retry_exhausted;         // payloads which were given up on after the allowed retries
+    uint32_t duplicates;              // payloads received again which had been passed on already, rejected
+    uint32_t frame_lost;              // payloads passed on after lost payloads, the parsers are reset
+} tArqCnt;
+
+
 //-------------------------------------------------------
 // Common stats
 //-------------------------------------------------------
@@ -42,6 +56,7 @@ class tStats
 
     uint8_t GetTransmitBandwidthUsage(void);
     uint8_t GetReceiveBandwidthUsage(void);
+    uint16_t GetGoodput(void);
     int8_t GetLastRssi(void);
     int8_t GetLastSnr(void);
 
@@ -95,6 +110,21 @@ class tStats
     void cntFrameSkipped(void);
     int32_t GetFrameCnt(void);
 
+    // decisions of the ARQ retry controller, on tx as received with FRAME_CMD_RX_ARQ_STATS
+
+    uint8_t arq_retry_cnt;            // retry count in use
+    uint16_t arq_retry_success;       // success rate of retransmissions, 0..1000
+
+    // counters of the ARQ, set before Update1Hz(), and the counts of the last second
+
+    tArqCnt arq_cnt;
+    tArqCnt arq_cnt_per_sec;
+    uint8_t GetArqFloatArray(float* data);
+
+    // goodput, LP filtered bytes/sec of serial data received, retransmissions and duplicates are not counted
+
+    tLpFilter goodput;
+
     // seq no in the last transmitted frame, only tx
 
     uint8_t transmit_seq_no;
@@ -106,6 +136,9 @@ class tStats
     uint8_t fhss_curr_i;
 #endif
 
+  private:
+    tArqCnt arq_cnt_last;
+
     // moving average fields
 
 //    tLqCounterBase LQma_received;
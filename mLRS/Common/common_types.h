@@ -72,6 +72,14 @@ class tSerialBase
     virtual uint16_t bytes_available(void) { return 0; }
     virtual bool has_systemboot(void) { return false; }
 
+    // reads up to len bytes into buf, returns the number of bytes read
+    virtual uint16_t getbuf(uint8_t* buf, uint16_t len)
+    {
+        uint16_t n = 0;
+        while (n < len && available()) buf[n++] = getc();
+        return n;
+    }
+
     void putc(char c) { putbuf((uint8_t*)&c, 1); }
     void puts(const char* s) { putbuf((uint8_t*)s, strlen(s)); }
 };
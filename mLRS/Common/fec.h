@@ -0,0 +1,232 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// FEC
+//*******************************************************
+// Reed-Solomon code over GF(256), for the normal Tx and Rx frames
+// A frame which fails the crc is thrown away, with all its serial data, even if only a byte or two
+// were hit. With the FEC the last FEC_PARITY_LEN bytes of the payload are parity, which allows to
+// repair up to FEC_PARITY_LEN/2 wrong bytes anywhere in the frame, the header included. The crc then
+// tells if the repair was right. The repair is only tried for frames which failed the crc, a wrong sync
+// word or a header which makes no sense are taken as noise or another link, see check_txframe().
+// - the code is the usual one, field polynomial 0x11D, roots alpha^0 ... alpha^(FEC_PARITY_LEN-1),
+//   shortened to the frame length
+// - the tables are generated at compile time and are in flash, 768 bytes
+// - encode is for each frame, decode is only for the frames which failed, so decode can be slower
+// see tools/fec_bench for the check, the timing, and the goodput at the edge of range
+//*******************************************************
+#ifndef FEC_H
+#define FEC_H
+#pragma once
+
+
+#include <stdint.h>
+#include <string.h>
+
+
+#ifndef FEC_PARITY_LEN
+  #define FEC_PARITY_LEN  8 // must be even, corrects up to FEC_PARITY_LEN/2 bytes
+#endif
+
+
+//-------------------------------------------------------
+// GF(256) tables
+//-------------------------------------------------------
+
+struct tFecGfTables
+{
+    uint8_t exp[512]; // doubled, so that exp[log[a] + log[b]] needs no modulo
+    uint8_t log[256]; // log[0] is undefined
+
+    constexpr tFecGfTables() : exp(), log()
+    {
+        uint16_t x = 1;
+        for (uint16_t i = 0; i < 255; i++) {
+            exp[i] = x;
+            exp[i + 255] = x;
+            log[x] = i;
+            x <<= 1;
+            if (x & 0x100) x ^= 0x11D;
+        }
+        exp[510] = exp[0];
+        exp[511] = exp[1];
+    }
+};
+
+constexpr tFecGfTables fec_gf = tFecGfTables();
+
+
+// generator polynomial g(x) = (x - alpha^0) ... (x - alpha^(FEC_PARITY_LEN-1)), highest power first, g[0] = 1
+struct tFecGenerator
+{
+    uint8_t g[FEC_PARITY_LEN + 1];
+
+    constexpr tFecGenerator() : g()
+    {
+        g[0] = 1;
+        for (uint8_t i = 0; i < FEC_PARITY_LEN; i++) {
+            // multiply by (x + alpha^i)
+            for (uint8_t j = i + 1; j > 0; j--) {
+                uint8_t m = (g[j - 1]) ? fec_gf.exp[fec_gf.log[g[j - 1]] + i] : 0;
+                g[j] ^= m;
+            }
+        }
+    }
+};
+
+constexpr tFecGenerator fec_generator = tFecGenerator();
+
+
+#pragma GCC push_options
+#pragma GCC optimize ("O3")
+
+static inline uint8_t fec_gf_mul(uint8_t a, uint8_t b)
+{
+    if (!a || !b) return 0;
+    return fec_gf.exp[fec_gf.log[a] + fec_gf.log[b]];
+}
+
+
+static inline uint8_t fec_gf_div(uint8_t a, uint8_t b) // b must not be 0
+{
+    if (!a) return 0;
+    return fec_gf.exp[fec_gf.log[a] + 255 - fec_gf.log[b]];
+}
+
+
+//-------------------------------------------------------
+// encode, decode
+//-------------------------------------------------------
+
+// the codeword is buf[0 .. len-1], the parity is the last FEC_PARITY_LEN bytes of it
+// len must be <= 255
+void fec_encode(uint8_t* buf, uint8_t len)
+{
+    uint8_t data_len = len - FEC_PARITY_LEN;
+    uint8_t* parity = buf + data_len;
+
+    memset(parity, 0, FEC_PARITY_LEN);
+
+    for (uint8_t k = 0; k < data_len; k++) {
+        uint8_t fb = buf[k] ^ parity[0];
+        if (fb) {
+            uint8_t fb_log = fec_gf.log[fb];
+            for (uint8_t j = 0; j < FEC_PARITY_LEN - 1; j++) {
+                parity[j] = parity[j + 1] ^ ((fec_generator.g[j + 1]) ? fec_gf.exp[fb_log + fec_gf.log[fec_generator.g[j + 1]]] : 0);
+            }
+            parity[FEC_PARITY_LEN - 1] = fec_gf.exp[fb_log + fec_gf.log[fec_generator.g[FEC_PARITY_LEN]]];
+        } else {
+            memmove(parity, parity + 1, FEC_PARITY_LEN - 1);
+            parity[FEC_PARITY_LEN - 1] = 0;
+        }
+    }
+}
+
+
+// repairs buf[0 .. len-1] in place
+// returns false if there are too many errors, buf may then be partially modified
+// returns true if there were no errors or they were repaired, a miscorrection is possible, so check the crc
+bool fec_decode(uint8_t* buf, uint8_t len)
+{
+uint8_t S[FEC_PARITY_LEN];
+
+    // syndromes, S_i = c(alpha^i)
+    bool has_error = false;
+    for (uint8_t i = 0; i < FEC_PARITY_LEN; i++) {
+        uint8_t s = 0;
+        for (uint8_t k = 0; k < len; k++) {
+            s = ((s) ? fec_gf.exp[fec_gf.log[s] + i] : 0) ^ buf[k];
+        }
+        S[i] = s;
+        if (s) has_error = true;
+    }
+    if (!has_error) return true;
+
+    // Berlekamp-Massey, gives the error locator polynomial Lambda, lowest power first
+    uint8_t Lambda[FEC_PARITY_LEN + 1] = {};
+    uint8_t B[FEC_PARITY_LEN + 1] = {};
+    uint8_t T[FEC_PARITY_LEN + 1];
+    Lambda[0] = 1;
+    B[0] = 1;
+    uint8_t L = 0;
+    uint8_t m = 1;
+    uint8_t b = 1;
+
+    for (uint8_t n = 0; n < FEC_PARITY_LEN; n++) {
+        uint8_t d = S[n];
+        for (uint8_t i = 1; i <= L; i++) d ^= fec_gf_mul(Lambda[i], S[n - i]);
+
+        if (d == 0) {
+            m++;
+            continue;
+        }
+
+        uint8_t coef = fec_gf_div(d, b);
+        if (2 * L <= n) {
+            memcpy(T, Lambda, sizeof(T));
+            for (uint8_t i = m; i <= FEC_PARITY_LEN; i++) Lambda[i] ^= fec_gf_mul(coef, B[i - m]);
+            L = n + 1 - L;
+            memcpy(B, T, sizeof(B));
+            b = d;
+            m = 1;
+        } else {
+            for (uint8_t i = m; i <= FEC_PARITY_LEN; i++) Lambda[i] ^= fec_gf_mul(coef, B[i - m]);
+            m++;
+        }
+    }
+
+    if (L > FEC_PARITY_LEN / 2) return false;
+
+    // error evaluator Omega = S * Lambda mod x^FEC_PARITY_LEN, lowest power first
+    uint8_t Omega[FEC_PARITY_LEN] = {};
+    for (uint8_t i = 0; i < FEC_PARITY_LEN; i++) {
+        for (uint8_t j = 0; j <= i && j <= L; j++) Omega[i] ^= fec_gf_mul(Lambda[j], S[i - j]);
+    }
+
+    // Chien search and Forney
+    // byte k has the power p = len-1-k, it is wrong if Lambda(alpha^-p) = 0, the error is
+    // e = alpha^p * Omega(alpha^-p) / Lambda'(alpha^-p)
+    uint8_t pos[FEC_PARITY_LEN / 2];
+    uint8_t val[FEC_PARITY_LEN / 2];
+    uint8_t found = 0;
+
+    for (uint8_t k = 0; k < len; k++) {
+        uint8_t p = len - 1 - k;
+        uint8_t xinv_log = (255 - p) % 255;
+
+        uint8_t lambda = 0, lambda_deriv = 0;
+        for (uint8_t j = 0; j <= L; j++) {
+            if (!Lambda[j]) continue;
+            uint8_t t = fec_gf.exp[(fec_gf.log[Lambda[j]] + (uint16_t)xinv_log * j) % 255];
+            lambda ^= t;
+            if (j & 0x01) lambda_deriv ^= fec_gf.exp[(fec_gf.log[Lambda[j]] + (uint16_t)xinv_log * (j - 1)) % 255];
+        }
+        if (lambda) continue;
+
+        if (found >= L || !lambda_deriv) return false;
+
+        uint8_t omega = 0;
+        for (uint8_t j = 0; j < FEC_PARITY_LEN; j++) {
+            if (!Omega[j]) continue;
+            omega ^= fec_gf.exp[(fec_gf.log[Omega[j]] + (uint16_t)xinv_log * j) % 255];
+        }
+
+        pos[found] = k;
+        val[found] = fec_gf_mul(fec_gf.exp[p], fec_gf_div(omega, lambda_deriv));
+        found++;
+    }
+
+    if (found != L) return false; // the locator has roots outside of the frame, too many errors
+
+    for (uint8_t i = 0; i < found; i++) buf[pos[i]] ^= val[i];
+
+    return true;
+}
+
+#pragma GCC pop_options
+
+
+#endif // FEC_H
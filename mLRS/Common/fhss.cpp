@@ -11,6 +11,7 @@
 #include "fhss.h"
 
 
+// prng, see tFhssPrng in fhss_generator.h
 // https://en.wikipedia.org/wiki/Linear_congruential_generator: Microsoft Visual/Quick C/C++
 // also used by ELRS
 // generates values in range [0, 0x7FFF]
@@ -21,97 +22,72 @@
 // redpine:
 // same prng as spektrum, picks 50 channels, ensures not close and not 0,1
 
-//QUESTION:
 // how many different fhss sequences can be generated with the 32bit seed value ??
+// the seed is Config.FrameSyncWord, so only 16 bits, and there are at most 65536 sequences
+// tools/fhss_analyzer counts them, and gives the channel usage, spacing, and the collisions between links
+// without ortho nearly all 65536 are different, with ortho much less channel sets are possible, e.g.
+// only 91 for 915 MHz FCC
 
-uint16_t tFhssBase::prng(void)
+bool tFhssBase::is_bind_channel(uint8_t ch)
 {
-    const uint32_t a = 214013;
-    const uint32_t c = 2531011;
-    const uint32_t m = 2147483648;
+    for (uint8_t bi = 0; bi < BIND_CHANNEL_LIST_LEN; bi++) {
+        if (ch == fhss_bind_channel_list[bi]) return true;
+    }
+    return false;
+}
 
-    _seed = (a * _seed + c) % m;
 
-    return _seed >> 16;
+// https://en.wikipedia.org/wiki/List_of_WLAN_channels
+bool tFhssBase::is_except_channel(uint8_t ch)
+{
+#ifdef FHSS_HAS_CONFIG_2P4_GHZ
+    uint32_t freq = fhss_freq_list[ch];
+    switch (_except) {
+    case FHSS_EXCEPT_2P4_GHZ_WIFIBAND_1:
+        // #1, 2.412 GHz +- 11 MHz = ]0 , 17[
+        return (SX1280_FREQ_GHZ_TO_REG(2.401) <= freq && freq <= SX1280_FREQ_GHZ_TO_REG(2.423));
+    case FHSS_EXCEPT_2P4_GHZ_WIFIBAND_6:
+        // #6, 2.437 GHz +- 11 MHz = ]20 , 42[
+        return (SX1280_FREQ_GHZ_TO_REG(2.426) <= freq && freq <= SX1280_FREQ_GHZ_TO_REG(2.448));
+    case FHSS_EXCEPT_2P4_GHZ_WIFIBAND_11:
+        // #11, 2.462 GHz +- 11 MHz = ]45 , 67[
+        return (SX1280_FREQ_GHZ_TO_REG(2.451) <= freq && freq <= SX1280_FREQ_GHZ_TO_REG(2.473));
+    case FHSS_EXCEPT_2P4_GHZ_WIFIBAND_13:
+        // #13, 2.472 GHz +- 11 MHz = ]55, 67[
+        return (SX1280_FREQ_GHZ_TO_REG(2.461) <= freq && freq <= SX1280_FREQ_GHZ_TO_REG(2.483));
+    }
+#endif
+    return false;
 }
 
 
+// the sequence is generated by tFhssGenerator, see fhss_generator.h
+// it is the same as that of the earlier rank scan over the used flags, which tools/fhss_bench checks
 void tFhssBase::generate(uint32_t seed)
 {
-    _seed = seed;
     _ortho = FHSS_ORTHO_NONE;
     _except = FHSS_EXCEPT_NONE;
 
-    bool used_flag[FHSS_FREQ_LIST_MAX_LEN];
-    for (uint8_t ch = 0; ch < FHSS_FREQ_LIST_MAX_LEN; ch++) used_flag[ch] = false;
-
-    uint8_t k = 0;
-    while (k < cnt) {
-
-        uint8_t rn = prng() % (FREQ_LIST_LEN - k); // get a random number in the remaining range
-
-        uint8_t i = 0;
-        uint8_t ch;
-        for (ch = 0; ch < FREQ_LIST_LEN; ch++) {
-            if (used_flag[ch]) continue;
-            if (i == rn) break; // ch is our next index
-            i++;
-        }
-
-        if (ch >= FREQ_LIST_LEN) { // argh, must not happen !
-            ch = 0;
-        }
-
-        // do not pick a bind channel
-        bool is_bind_channel = false;
-        for (uint8_t bi = 0; bi < BIND_CHANNEL_LIST_LEN; bi++) {
-            if (ch == fhss_bind_channel_list[bi]) is_bind_channel = true;
-        }
-        if (is_bind_channel) continue;
-
-        // ensure it is not too close to the previous
-        // do only if we have plenty of channels at our disposal
-        bool is_too_close = false;
-        if ((config_i != FHSS_CONFIG_433_MHZ && config_i != FHSS_CONFIG_866_MHZ_IN) && (k > 0)) { // TODO: use smarter method, e.g., cnt < 2/3
-            int8_t last_ch = ch_list[k - 1];
-            if (last_ch == 0) { // special treatment for this case
-                if (ch < 2) is_too_close = true;
-            } else {
-                if ((ch >= last_ch - 1) && (ch <= last_ch + 1)) is_too_close = true;
-            }
-        }
-        if (is_too_close) continue;
-
-        // we got a new ch, so register it
-        ch_list[k] = ch;
-        fhss_list[k] = fhss_freq_list[ch];
-        used_flag[ch] = true;
-
-        k++;
-    }
-
-    // the following is not related to the generation, but does initialization
-    // is done here to allow calling generate separately, at least in principle
+    // ensure it is not too close to the previous
+    // do only if we have plenty of channels at our disposal
+    bool too_close = (config_i != FHSS_CONFIG_433_MHZ && config_i != FHSS_CONFIG_866_MHZ_IN); // TODO: use smarter method, e.g., cnt < 2/3
 
-    // start with first entry
-    curr_i = 0;
+    tFhssGenerator gen(seed, cnt, FREQ_LIST_LEN, 1, 0,
+                       fhss_bind_channel_list, BIND_CHANNEL_LIST_LEN,
+                       nullptr, too_close);
 
-    // mark all channels as equally bad
-    for (uint8_t k = 0; k < cnt; k++) {
-        fhss_last_rssi[k] = INT8_MIN;
-    }
+    take_generated(&gen);
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+    this->too_close = too_close;
+#endif
 }
 
 
 void tFhssBase::generate_ortho_except(uint32_t seed, uint8_t ortho, uint8_t except)
 {
-    _seed = seed;
     _ortho = ortho; // assumes that FHSS_ORTHO & ORTHO enums are aligned!
     _except = except; // assumes that FHSS_EXCEPT & EXCEPT enums are aligned!
 
-    bool used_flag[FHSS_FREQ_LIST_MAX_LEN];
-    for (uint8_t ch = 0; ch < FHSS_FREQ_LIST_MAX_LEN; ch++) used_flag[ch] = false;
-
     uint8_t freq_len = FREQ_LIST_LEN;
     uint8_t ch_ofs = 0;
     uint8_t ch_inc = 1;
@@ -122,88 +98,99 @@ void tFhssBase::generate_ortho_except(uint32_t seed, uint8_t ortho, uint8_t exce
         freq_len = FREQ_LIST_LEN / 3; // we use only 1/3 of the available channels
     }
 
-    uint8_t k = 0;
-    uint8_t last_ch_eff = 0;
-
-    while (k < cnt) {
-
-        uint8_t rn = prng() % (freq_len - k); // get a random number in the remaining range
+    // do not pick a channel in an excepted wifi band
+    bool except_flag[FHSS_FREQ_LIST_MAX_LEN];
+    for (uint8_t ch = 0; ch < FHSS_FREQ_LIST_MAX_LEN; ch++) {
+        except_flag[ch] = (ch < FREQ_LIST_LEN) ? is_except_channel(ch) : false;
+    }
 
-        uint8_t i = 0;
-        uint8_t ch_eff;
-        for (ch_eff = 0; ch_eff < freq_len; ch_eff++) {
-            if (used_flag[ch_eff]) continue;
-            if (i == rn) break; // ch_eff is our next index
-            i++;
-        }
+    tFhssGenerator gen(seed, cnt, freq_len, ch_inc, ch_ofs,
+                       fhss_bind_channel_list, BIND_CHANNEL_LIST_LEN,
+                       except_flag, true);
 
-        if (ch_eff >= freq_len) { // argh, must not happen !
-            ch_eff = freq_len;
-        }
+    take_generated(&gen);
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+    too_close = true;
+#endif
+}
 
-        uint8_t ch = ch_eff * ch_inc + ch_ofs; // that's the true channel
 
-        // do not pick a bind channel
-        bool is_bind_channel = false;
-        for (uint8_t bi = 0; bi < BIND_CHANNEL_LIST_LEN; bi++) {
-            if (ch == fhss_bind_channel_list[bi]) is_bind_channel = true;
-        }
-        if (is_bind_channel) continue;
+void tFhssBase::take_generated(tFhssGenerator* gen)
+{
+    for (uint8_t k = 0; k < cnt; k++) {
+        ch_list[k] = gen->Ch(k);
+        fhss_list[k] = fhss_freq_list[ch_list[k]];
+    }
 
-        // do not pick a channel in an excepted wifi band
-        // https://en.wikipedia.org/wiki/List_of_WLAN_channels
-#ifdef FHSS_HAS_CONFIG_2P4_GHZ
-        uint32_t freq = fhss_freq_list[ch];
-        switch (_except) {
-        case FHSS_EXCEPT_2P4_GHZ_WIFIBAND_1:
-            // #1, 2.412 GHz +- 11 MHz = ]0 , 17[
-            if (SX1280_FREQ_GHZ_TO_REG(2.401) <= freq && freq <= SX1280_FREQ_GHZ_TO_REG(2.423)) continue;
-            break;
-        case FHSS_EXCEPT_2P4_GHZ_WIFIBAND_6:
-            // #6, 2.437 GHz +- 11 MHz = ]20 , 42[
-            if (SX1280_FREQ_GHZ_TO_REG(2.426) <= freq && freq <= SX1280_FREQ_GHZ_TO_REG(2.448)) continue;
-            break;
-        case FHSS_EXCEPT_2P4_GHZ_WIFIBAND_11:
-            // #11, 2.462 GHz +- 11 MHz = ]45 , 67[
-            if (SX1280_FREQ_GHZ_TO_REG(2.451) <= freq && freq <= SX1280_FREQ_GHZ_TO_REG(2.473)) continue;
-            break;
-        case FHSS_EXCEPT_2P4_GHZ_WIFIBAND_13:
-            // #13, 2.472 GHz +- 11 MHz = ]55, 67[
-            if (SX1280_FREQ_GHZ_TO_REG(2.461) <= freq && freq <= SX1280_FREQ_GHZ_TO_REG(2.483)) continue;
-            break;
-        }
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+    // the spare channels continue with the prng
+    prng = gen->Prng();
 #endif
 
-        // ensure it is not too close to the previous
-        bool is_too_close = false;
-        if (k > 0) {
-            if (last_ch_eff == 0) { // special treatment for this case
-                if (ch_eff <= 1) is_too_close = true;
-            } else {
-                if ((ch_eff >= last_ch_eff - 1) && (ch_eff <= last_ch_eff + 1)) is_too_close = true;
-            }
-        }
-        if (is_too_close) continue;
-
-        last_ch_eff = ch_eff;
-
-        // we got a new ch, so register it
-        ch_list[k] = ch;
-        fhss_list[k] = fhss_freq_list[ch];
-        used_flag[ch_eff] = true;
-
-        k++;
-    }
-
     // the following is not related to the generation, but does initialization
     // is done here to allow calling generate separately, at least in principle
 
     // start with first entry
     curr_i = 0;
+}
 
-    // mark all channels as equally bad
-    for (uint8_t k = 0; k < cnt; k++) {
-        fhss_last_rssi[k] = INT8_MIN;
+
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+// picks the spare channels for the adaptive fhss
+// continues with the prng where the generation ended, so Tx and Rx get the same spares
+// takes channels which are not in the fhss list, from the same ortho subset, and not a bind or excepted channel
+// the number of attempts is limited, so there may be less than FHSS_SPARE_MAX spares, e.g. for the small bands
+void tFhssBase::generate_spares(void)
+{
+    for (uint8_t k = 0; k < cnt; k++) base_ch_list[k] = ch_list[k];
+
+    uint8_t freq_len = FREQ_LIST_LEN;
+    uint8_t ch_ofs = 0;
+    uint8_t ch_inc = 1;
+
+    if (_ortho >= FHSS_ORTHO_1_3 && _ortho <= FHSS_ORTHO_3_3) {
+        ch_ofs = _ortho - FHSS_ORTHO_1_3; // 0, 1, 2
+        ch_inc = 3;
+        freq_len = FREQ_LIST_LEN / 3;
+    }
+
+    spare_cnt = 0;
+
+    for (uint8_t attempt = 0; attempt < 8 * FHSS_SPARE_MAX; attempt++) {
+        if (spare_cnt >= FHSS_SPARE_MAX) break;
+
+        uint8_t ch = (prng.Next() % freq_len) * ch_inc + ch_ofs;
+        if (ch >= FREQ_LIST_LEN) continue;
+
+        if (is_bind_channel(ch)) continue;
+        if (is_except_channel(ch)) continue;
+
+        bool is_used = false;
+        for (uint8_t k = 0; k < cnt; k++) if (ch_list[k] == ch) is_used = true;
+        for (uint8_t k = 0; k < spare_cnt; k++) if (spare_ch_list[k] == ch) is_used = true;
+        if (is_used) continue;
+
+        spare_ch_list[spare_cnt++] = ch;
     }
 }
 
+
+// the channel of slot i with the spare channels as in map
+uint8_t tFhssBase::slot_ch(uint8_t i, const uint8_t* map)
+{
+    for (uint8_t k = 0; k < spare_cnt; k++) {
+        if (map[k] == i) return spare_ch_list[k];
+    }
+    return base_ch_list[i];
+}
+
+
+// the check of the generation, it is done on ch_eff, so for ortho channels 3 apart are next to each other
+bool tFhssBase::is_next_to(uint8_t ch, uint8_t ch2)
+{
+    uint8_t ch_inc = (_ortho >= FHSS_ORTHO_1_3 && _ortho <= FHSS_ORTHO_3_3) ? 3 : 1;
+    uint8_t ch_eff = ch / ch_inc; // the ch_ofs doesn't matter, it is the same for all
+    uint8_t ch2_eff = ch2 / ch_inc;
+    return (ch_eff + 1 >= ch2_eff) && (ch_eff <= ch2_eff + 1);
+}
+#endif
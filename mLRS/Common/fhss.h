@@ -16,10 +16,10 @@
 #include "hal/device_conf.h"
 #include "sx-drivers/sx12xx.h"
 #include "setup_types.h"
+#include "fhss_generator.h"
 
 
-#define FHSS_MAX_NUM            32
-#define FHSS_FREQ_LIST_MAX_LEN  86 // 2.4 GHz is 80
+#define FHSS_SPARE_MAX          8 // spare channels for the adaptive fhss, see fhss_adaptive.h
 
 //-------------------------------------------------------
 // Frequency list
@@ -524,6 +524,10 @@ class tFhssBase
             while (1) {} // should not happen, but play it safe
         }
 
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+        generate_spares();
+#endif
+
         is_in_binding = false;
 
         curr_i = 0;
@@ -621,16 +625,44 @@ class tFhssBase
 #endif
     }
 
-    uint32_t bestX(void)
+    // only used by receiver, to go to a specific slot while in listen, see CommonRx/listen_rank.h
+    void HopTo(uint8_t i)
     {
-        uint8_t i_best = 0;
-        for (uint8_t i = 0; i < cnt; i++) {
-          if (fhss_last_rssi[i] > fhss_last_rssi[i_best]) i_best = i;
+        if (i < cnt) curr_i = i;
+    }
+
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+    // spare channels, these are generated after the fhss list and are hence the same on Tx and Rx
+    // map[k] is the slot which is replaced by spare channel k, 0xFF = spare channel not used
+    uint8_t SpareCnt(void) { return spare_cnt; }
+
+    void SetSpareMap(const uint8_t* map)
+    {
+        for (uint8_t k = 0; k < cnt; k++) {
+            ch_list[k] = base_ch_list[k];
+            fhss_list[k] = fhss_freq_list[ch_list[k]];
+        }
+        for (uint8_t k = 0; k < spare_cnt; k++) {
+            if (map[k] >= cnt) continue;
+            ch_list[map[k]] = spare_ch_list[k];
+            fhss_list[map[k]] = fhss_freq_list[spare_ch_list[k]];
         }
+    }
 
-        curr_i = i_best;
-        return fhss_list[curr_i];
+    // the same rule as for the generation, the spare channel k must not be next to the channel it
+    // replaces in slot i, nor to the channels of the neighbouring slots, all as with map
+    bool SpareTooClose(uint8_t k, uint8_t i, const uint8_t* map)
+    {
+        if (!too_close || k >= spare_cnt || i >= cnt) return false;
+
+        uint8_t ch = spare_ch_list[k];
+        if (is_next_to(ch, base_ch_list[i]) || is_next_to(ch, slot_ch(i, map))) return true;
+        if (cnt < 2) return false;
+        if (is_next_to(ch, slot_ch((i + cnt - 1) % cnt, map))) return true;
+        if (is_next_to(ch, slot_ch((i + 1) % cnt, map))) return true;
+        return false;
     }
+#endif
 
     // used by CLI
     uint8_t ChList(uint8_t i) { return ch_list[i]; }
@@ -648,7 +680,6 @@ class tFhssBase
     }
 
   private:
-    uint32_t _seed;
     uint8_t _ortho;
     uint8_t _except;
 
@@ -664,16 +695,29 @@ class tFhssBase
     uint8_t ch_list[FHSS_MAX_NUM]; // that's our list of randomly selected channels
     uint32_t fhss_list[FHSS_MAX_NUM]; // that's our list of randomly selected frequencies
 
-    int8_t fhss_last_rssi[FHSS_MAX_NUM];
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+    tFhssPrng prng; // continues from the generation
+    bool too_close; // as used for the generation
+    uint8_t base_ch_list[FHSS_MAX_NUM]; // the list as generated, ch_list may have spare channels in it
+    uint8_t spare_cnt;
+    uint8_t spare_ch_list[FHSS_SPARE_MAX];
+#endif
 
     bool is_in_binding;
     uint8_t curr_bind_config_i;
     uint16_t bind_listen_cnt;
     uint16_t bind_listen_i;
 
-    uint16_t prng(void);
     void generate(uint32_t seed);
     void generate_ortho_except(uint32_t seed, uint8_t ortho, uint8_t except);
+    void take_generated(tFhssGenerator* gen);
+    bool is_bind_channel(uint8_t ch);
+    bool is_except_channel(uint8_t ch);
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+    void generate_spares(void);
+    uint8_t slot_ch(uint8_t i, const uint8_t* map);
+    bool is_next_to(uint8_t ch, uint8_t ch2);
+#endif
 };
 
 
@@ -734,6 +778,12 @@ class tFhss
         fhss2ndBand.HopToNext();
     }
 
+    void HopTo(uint8_t i)
+    {
+        fhss900MHz.HopTo(i);
+        fhss2ndBand.HopTo(i);
+    }
+
     void SetToBind(uint16_t frame_rate_ms = 1) // preset so it is good for transmitter
     {
         fhss900MHz.SetToBind(frame_rate_ms);
@@ -763,6 +813,21 @@ class tFhss
 #endif
     }
 
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+    uint8_t SpareCnt(void) { return fhss900MHz.SpareCnt(); }
+
+    void SetSpareMap(const uint8_t* map)
+    {
+        fhss900MHz.SetSpareMap(map);
+        fhss2ndBand.SetSpareMap(map);
+    }
+
+    bool SpareTooClose(uint8_t k, uint8_t i, const uint8_t* map)
+    {
+        return fhss900MHz.SpareTooClose(k, i, map) || fhss2ndBand.SpareTooClose(k, i, map);
+    }
+#endif
+
     // only used by tx cli
     uint8_t ChList(uint8_t i) { return fhss900MHz.ChList(i); }
     uint32_t FhssList(uint8_t i) { return fhss900MHz.FhssList(i); }
@@ -0,0 +1,331 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// Adaptive FHSS
+//*******************************************************
+// Tracks the link quality per fhss slot and swaps persistently bad channels for the
+// spare channels of tFhssBase.
+//
+// Both ends put the rx status of each slot into a moving window. The Tx periodically
+// determines a new map from the quality seen by both ends, and both ends switch to it
+// at the same hop, in two phases:
+// - the Tx sends FRAME_CMD_SET_FHSS with the map and the number of hops till the switch,
+//   the Rx takes it as pending and responds with FRAME_CMD_RX_FHSS, which has the pending
+//   map and the Rx' valid counts per slot
+// - when the response comes in time, the Tx confirms, and sends FRAME_CMD_SET_FHSS with
+//   the confirmed flag set until the Rx reports that it has it
+// The hops are counted down on both ends, also for lost frames, so they switch together.
+// The Rx applies the map at the switch hop if it got the confirmation, the Tx only if it
+// got the Rx' report of it, else the map is dropped. So the Tx never switches alone.
+// If the Tx confirmed but the report didn't come before the switch, it can't know if the
+// Rx has switched. It then sends FRAME_CMD_SET_FHSS with 0 hops, which asks for the map in
+// use, and takes the map the Rx responds with. Till then only the swapped slots are affected.
+//*******************************************************
+#ifndef FHSS_ADAPTIVE_H
+#define FHSS_ADAPTIVE_H
+#pragma once
+
+
+#include <stdint.h>
+#include "fhss.h"
+#include "link_types.h"
+
+
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+
+#define IF_FHSS_ADAPTIVE(x)           x
+
+
+#define FHSS_ADAPTIVE_WINDOW          15 // number of visits per slot which are evaluated, must fit into 4 bits
+#define FHSS_ADAPTIVE_BAD_MARGIN      5 // a slot is bad if its valid count is this much below the median
+#define FHSS_ADAPTIVE_SYNC_PERIOD_S   10
+#define FHSS_ADAPTIVE_SWITCH_HOPS     64 // number of hops from the start of a sync to the switch, must fit into 7 bits
+#define FHSS_ADAPTIVE_CONFIRM_HOPS    16 // the Tx confirms only this many hops before the switch, so the Rx can get it
+
+
+class tFhssAdaptive
+{
+  public:
+    void Init(uint8_t _cnt, uint8_t _spare_cnt)
+    {
+        cnt = (_cnt > FHSS_MAX_NUM) ? FHSS_MAX_NUM : _cnt;
+        spare_cnt = (_spare_cnt > FHSS_SPARE_MAX) ? FHSS_SPARE_MAX : _spare_cnt;
+        for (uint8_t k = 0; k < FHSS_SPARE_MAX; k++) map[k] = UINT8_MAX;
+        changed = false;
+        Clear();
+    }
+
+    // called when disconnected, we start with the original fhss list again
+    void Clear(void)
+    {
+        for (uint8_t i = 0; i < cnt; i++) clear_slot(i);
+        for (uint8_t k = 0; k < FHSS_SPARE_MAX; k++) {
+            if (map[k] != UINT8_MAX) changed = true;
+            map[k] = UINT8_MAX;
+            proposed_map[k] = UINT8_MAX;
+        }
+        switch_cnt = 0;
+        confirmed = false;
+        acked = false;
+        query = false;
+        burnt_mask = 0;
+        received_full_mask = 0;
+        sync_tick_s = 2; // sync soon after connect, this also corrects a stale map on the Rx
+    }
+
+    // called with the rx status of the slot, on Tx in doPreTransmit, on Rx in doPostReceive
+    void Put(uint8_t i, uint8_t rx_status)
+    {
+        if (i >= cnt) return;
+        uint16_t mask = (1 << FHSS_ADAPTIVE_WINDOW) - 1;
+        valid[i] = ((valid[i] << 1) | ((rx_status > RX_STATUS_INVALID) ? 1 : 0)) & mask;
+        invalid[i] = ((invalid[i] << 1) | ((rx_status == RX_STATUS_INVALID) ? 1 : 0)) & mask;
+        if (visits[i] < FHSS_ADAPTIVE_WINDOW) visits[i]++;
+    }
+
+    uint8_t ValidCnt(uint8_t i) { return popcount(valid[i]); }
+    uint8_t InvalidCnt(uint8_t i) { return popcount(invalid[i]); }
+    bool WindowFull(uint8_t i) { return (visits[i] >= FHSS_ADAPTIVE_WINDOW); }
+
+    // applies a new map, the quality of changed slots is reset since they are on a new channel now
+    // returns true if the map has changed, the caller then needs to do fhss.SetSpareMap()
+    bool ApplyMap(const uint8_t* new_map)
+    {
+    bool has_changed = false;
+
+        for (uint8_t k = 0; k < spare_cnt; k++) {
+            if (new_map[k] == map[k]) continue;
+            if (map[k] < cnt) clear_slot(map[k]);
+            if (new_map[k] < cnt) clear_slot(new_map[k]);
+            map[k] = new_map[k];
+            has_changed = true;
+        }
+        if (has_changed) changed = true;
+        return has_changed;
+    }
+
+    const uint8_t* Map(void) { return map; }
+
+    // returns true once after the map has changed, for the fhss.SetSpareMap()
+    bool Changed(void)
+    {
+        bool res = changed;
+        changed = false;
+        return res;
+    }
+
+    // called at each hop, on Tx in do_transmit, on Rx in LINK_STATE_RECEIVE
+    // switches to the proposed map when the switch hop is reached, if it is confirmed and acked
+    // the Tx doesn't know the Rx' map if it confirmed but got no ack, it then has to ask for it
+    void Hop(void)
+    {
+        if (!switch_cnt) return;
+        switch_cnt--;
+        if (switch_cnt) return;
+        if (confirmed && acked) {
+            ApplyMap(proposed_map);
+        } else if (confirmed) {
+            query = true;
+        }
+        confirmed = false;
+        acked = false;
+    }
+
+    uint8_t SwitchCnt(void) { return switch_cnt; }
+    bool Confirmed(void) { return confirmed; }
+
+    // only used by tx
+    // returns true when a sync is due, is called at 1 Hz, a pending switch is completed first
+    // a pending query is a sync too
+    bool Tick_1Hz(void)
+    {
+        if (sync_tick_s) sync_tick_s--;
+        if (sync_tick_s || switch_cnt) return false;
+        sync_tick_s = FHSS_ADAPTIVE_SYNC_PERIOD_S;
+        return true;
+    }
+
+    // only used by tx
+    // valid counts as received with FRAME_CMD_RX_FHSS, 4 bits per slot
+    void SetReceivedQuality(const uint8_t* valid_cnt_u4, uint32_t full_mask)
+    {
+        for (uint8_t i = 0; i < cnt; i++) {
+            received_valid_cnt[i] = (i & 1) ? (valid_cnt_u4[i >> 1] >> 4) : (valid_cnt_u4[i >> 1] & 0x0F);
+        }
+        received_full_mask = full_mask;
+    }
+
+    // only used by rx
+    void GetQuality(uint8_t* valid_cnt_u4, uint32_t* full_mask)
+    {
+        *full_mask = 0;
+        for (uint8_t i = 0; i < cnt; i++) {
+            if (!(i & 1)) valid_cnt_u4[i >> 1] = 0;
+            valid_cnt_u4[i >> 1] |= ValidCnt(i) << ((i & 1) ? 4 : 0);
+            if (WindowFull(i)) *full_mask |= ((uint32_t)1 << i);
+        }
+    }
+
+    // only used by tx
+    // handles the response FRAME_CMD_RX_FHSS, returns true when the sync is done
+    // - to a query: we take the Rx' map in use
+    // - else: we confirm the proposed map if the Rx has responded with it, and if there are enough
+    //   hops left for sending the confirmation to the Rx, and take the Rx' report of it as ack
+    bool Response(const uint8_t* rx_map, bool rx_confirmed, bool rx_in_use)
+    {
+        if (query) {
+            if (!rx_in_use) return false;
+            ApplyMap(rx_map);
+            query = false;
+            return true;
+        }
+        if (!switch_cnt || rx_in_use) return false;
+        for (uint8_t k = 0; k < spare_cnt; k++) if (rx_map[k] != proposed_map[k]) return false;
+        if (!confirmed && switch_cnt >= FHSS_ADAPTIVE_CONFIRM_HOPS) confirmed = true;
+        if (confirmed && rx_confirmed) acked = true;
+        return acked;
+    }
+
+    // only used by tx
+    // returns false when the sync is over, i.e. the switch is done or it's too late for confirming
+    // a confirmed switch which didn't get the ack continues with the query
+    bool SyncPending(void)
+    {
+        if (query) return true;
+        return (confirmed) ? (switch_cnt > 0) : (switch_cnt >= FHSS_ADAPTIVE_CONFIRM_HOPS);
+    }
+
+    // only used by tx
+    // the sync didn't complete, an unconfirmed switch is dropped, and we retry soon
+    // a confirmed switch goes on, since the Rx may have the confirmation, as does a query
+    void Cancel(void)
+    {
+        if (!confirmed) switch_cnt = 0;
+        sync_tick_s = 2;
+    }
+
+    // only used by rx
+    // map and hop count as received with FRAME_CMD_SET_FHSS, the map is applied at the switch only if confirmed
+    // 0 hops is the Tx' query, it doesn't change anything
+    void SetProposedMap(const uint8_t* new_map, uint8_t _switch_cnt, bool _confirmed)
+    {
+        if (!_switch_cnt) return;
+        for (uint8_t k = 0; k < FHSS_SPARE_MAX; k++) proposed_map[k] = new_map[k];
+        switch_cnt = _switch_cnt;
+        confirmed = _confirmed;
+        acked = _confirmed; // the Rx got it from the Tx, so it's both
+    }
+
+    // only used by rx
+    // the map for FRAME_CMD_RX_FHSS, the pending map, or the map in use if no switch is pending
+    const uint8_t* ResponseMap(bool* in_use)
+    {
+        *in_use = (switch_cnt == 0);
+        return (*in_use) ? map : proposed_map;
+    }
+
+    // only used by tx
+    // determines the map to be send next, from the quality seen by both ends, and starts the switch
+    // a slot is only evaluated if both windows are full
+    // a bad slot gets a free spare channel, if it is on a spare channel already this spare channel is not used again
+    // a spare channel is not taken if it is too close to the slot's or its neighbours' channels, see tFhssBase
+    // with a pending query it only restarts the query, as we need to know the Rx' map first
+    void Propose(tFhss* fhss)
+    {
+    uint8_t q[FHSS_MAX_NUM];
+    uint8_t hist[FHSS_ADAPTIVE_WINDOW + 1] = {};
+    uint8_t n = 0;
+
+        if (query) return;
+
+        for (uint8_t k = 0; k < FHSS_SPARE_MAX; k++) proposed_map[k] = map[k];
+        switch_cnt = FHSS_ADAPTIVE_SWITCH_HOPS;
+        confirmed = false;
+        acked = false;
+
+        for (uint8_t i = 0; i < cnt; i++) {
+            q[i] = UINT8_MAX;
+            if (!WindowFull(i) || !(received_full_mask & ((uint32_t)1 << i))) continue;
+            q[i] = ValidCnt(i);
+            if (received_valid_cnt[i] < q[i]) q[i] = received_valid_cnt[i];
+            hist[q[i]]++;
+            n++;
+        }
+        if (n < cnt / 2) return; // not enough information
+
+        uint8_t median = 0;
+        uint8_t sum = 0;
+        for (median = 0; median < FHSS_ADAPTIVE_WINDOW; median++) {
+            sum += hist[median];
+            if (2 * sum >= n) break;
+        }
+
+        for (uint8_t i = 0; i < cnt; i++) {
+            if (q[i] == UINT8_MAX || q[i] + FHSS_ADAPTIVE_BAD_MARGIN > median) continue;
+
+            uint8_t k_free = UINT8_MAX;
+            for (uint8_t k = 0; k < spare_cnt; k++) {
+                if (proposed_map[k] != UINT8_MAX || (burnt_mask & (1 << k))) continue;
+                if (fhss->SpareTooClose(k, i, proposed_map)) continue;
+                k_free = k;
+                break;
+            }
+            if (k_free == UINT8_MAX) continue; // no fitting spare left
+
+            for (uint8_t k = 0; k < spare_cnt; k++) {
+                if (proposed_map[k] == i) { proposed_map[k] = UINT8_MAX; burnt_mask |= (1 << k); }
+            }
+            proposed_map[k_free] = i;
+        }
+    }
+
+    const uint8_t* ProposedMap(void) { return proposed_map; }
+
+  private:
+    uint8_t cnt;
+    uint8_t spare_cnt;
+
+    uint16_t valid[FHSS_MAX_NUM]; // shift registers, 1 = valid frame received
+    uint16_t invalid[FHSS_MAX_NUM]; // shift registers, 1 = invalid frame received, no frame received is neither
+    uint8_t visits[FHSS_MAX_NUM];
+
+    uint8_t map[FHSS_SPARE_MAX]; // map[k] is the slot which uses spare channel k, UINT8_MAX = not used
+    uint8_t proposed_map[FHSS_SPARE_MAX]; // the map both ends switch to
+    uint8_t switch_cnt; // hops till the switch, 0 = no switch pending
+    bool confirmed; // the switch is done only if it is confirmed
+    bool acked; // and the Tx got the Rx' report of it
+    bool query; // only tx, the Tx doesn't know if the Rx has switched, and asks for its map
+    uint8_t burnt_mask; // spare channels which turned out to be bad too
+    bool changed;
+
+    uint8_t received_valid_cnt[FHSS_MAX_NUM];
+    uint32_t received_full_mask;
+    uint8_t sync_tick_s;
+
+    void clear_slot(uint8_t i)
+    {
+        valid[i] = 0;
+        invalid[i] = 0;
+        visits[i] = 0;
+        received_full_mask &= ~((uint32_t)1 << i);
+    }
+
+    uint8_t popcount(uint16_t v)
+    {
+        uint8_t n = 0;
+        while (v) { n += (v & 1); v >>= 1; }
+        return n;
+    }
+};
+
+
+#else
+
+#define IF_FHSS_ADAPTIVE(x)
+
+#endif // USE_FEATURE_FHSS_ADAPTIVE
+
+#endif // FHSS_ADAPTIVE_H
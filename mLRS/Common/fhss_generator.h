@@ -0,0 +1,188 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// FHSS sequence generator
+//*******************************************************
+// Generates the fhss channel list, is used by tFhssBase, see fhss.cpp.
+//
+// It is constexpr, so that a sequence can also be generated at compile time, e.g.
+//   constexpr tFhssGenerator gen(fhss_seed_from_bindphrase("mlrs.0"), ...);
+// and it is self-contained, so that it can be checked on host, see tools/fhss_bench.
+//
+// The sequence must not change, otherwise old and new firmware can't connect. It is
+// determined by the picking scheme: the prng gives a rank rn in the range of the remaining
+// channels, the rn-th not yet used channel in ascending order is picked, and if it is
+// rejected (bind channel, excepted, too close to the previous) it is not marked as used.
+// We keep the not yet used channels in a sorted candidate array, so a pick is a lookup,
+// and only an accepted pick needs to remove the channel from the array. A plain
+// Fisher-Yates swap would be cheaper but changes the order of the candidates, and hence
+// the sequence.
+//*******************************************************
+#ifndef FHSS_GENERATOR_H
+#define FHSS_GENERATOR_H
+#pragma once
+
+
+#include <stdint.h>
+
+
+#define FHSS_MAX_NUM            32
+#define FHSS_FREQ_LIST_MAX_LEN  86 // 2.4 GHz is 80
+
+
+// the 2.4 GHz frequency list is 2.401 ... 2.480 GHz in 1 MHz steps, so the excepted
+// wifi bands of fhss.cpp are these channel ranges, for the compile time generation
+// tFhssBase uses the frequencies, tools/fhss_bench checks that both agree
+constexpr uint8_t fhss_except_2p4_ch_lo[5] = { UINT8_MAX,  0, 25, 50, 60 };
+constexpr uint8_t fhss_except_2p4_ch_hi[5] = { 0,         22, 47, 72, 79 };
+
+
+struct tFhssExcept2p4
+{
+    bool flag[FHSS_FREQ_LIST_MAX_LEN];
+
+    constexpr tFhssExcept2p4(uint8_t except) : flag()
+    {
+        if (except >= 5) return;
+        for (uint8_t ch = fhss_except_2p4_ch_lo[except]; ch <= fhss_except_2p4_ch_hi[except]; ch++) flag[ch] = true;
+    }
+};
+
+
+// Config.Fhss.Seed as in setup_configure_config(), u32_from_bindphrase() condensed by fmav_crc_calculate()
+// the bytes of the u32 are taken in little endian order, as on our mcus
+constexpr uint16_t fhss_seed_from_bindphrase(const char* bindphrase)
+{
+    const char chars[] = "abcdefghijklmnopqrstuvwxyz0123456789_#-.";
+    uint64_t v = 0;
+    uint64_t base = 1;
+
+    for (uint8_t i = 0; i < 6; i++) {
+        uint8_t n = 0;
+        for (uint8_t j = 0; j < sizeof(chars) - 1; j++) {
+            if (chars[j] == bindphrase[i]) { n = j; break; }
+        }
+        v += n * base;
+        base *= 40;
+    }
+
+    uint32_t dblword = (uint32_t)v;
+    uint16_t crc = 0xFFFF;
+    for (uint8_t i = 0; i < 4; i++) {
+        uint8_t tmp = (uint8_t)(dblword >> (8 * i)) ^ (uint8_t)(crc & 0xFF);
+        tmp ^= (uint8_t)(tmp << 4);
+        crc = (crc >> 8) ^ ((uint16_t)tmp << 8) ^ ((uint16_t)tmp << 3) ^ (tmp >> 4);
+    }
+    return crc;
+}
+
+
+// https://en.wikipedia.org/wiki/Linear_congruential_generator: Microsoft Visual/Quick C/C++
+// generates values in range [0, 0x7FFF]
+// is the prng of the generation, tFhssBase takes its state to continue with the spare channels
+class tFhssPrng
+{
+  public:
+    constexpr tFhssPrng() : seed(0) {}
+    constexpr tFhssPrng(uint32_t _seed) : seed(_seed) {}
+
+    constexpr uint16_t Next(void)
+    {
+        seed = (214013 * seed + 2531011) % 2147483648;
+        return seed >> 16;
+    }
+
+    constexpr uint32_t Seed(void) const { return seed; }
+
+  private:
+    uint32_t seed;
+};
+
+
+class tFhssGenerator
+{
+  public:
+    constexpr tFhssGenerator() : prng(), cnt(0), ch_list(), cand(), cand_len(0) {}
+
+    // freq_len, ch_inc, ch_ofs select the channels, ch = ch_eff * ch_inc + ch_ofs, for ortho ch_inc = 3
+    // channels with except_flag[ch] set are not picked
+    // too_close enables the check that a channel is not next to the previous, it is done on ch_eff
+    constexpr tFhssGenerator(
+        uint32_t _seed, uint8_t _cnt, uint8_t freq_len, uint8_t ch_inc, uint8_t ch_ofs,
+        const uint8_t* bind_channel_list, uint8_t bind_channel_list_len,
+        const bool* except_flag, bool too_close)
+        : prng(_seed), cnt(_cnt), ch_list(), cand(), cand_len(0)
+    {
+        if (cnt > FHSS_MAX_NUM) cnt = FHSS_MAX_NUM;
+        if (freq_len > FHSS_FREQ_LIST_MAX_LEN) freq_len = FHSS_FREQ_LIST_MAX_LEN;
+        if (cnt > freq_len) cnt = freq_len;
+
+        for (uint8_t ch_eff = 0; ch_eff < freq_len; ch_eff++) cand[ch_eff] = ch_eff;
+        cand_len = freq_len;
+
+        uint8_t k = 0;
+        uint8_t last_ch_eff = 0;
+#ifdef FHSS_GENERATOR_DRAWS_MAX
+        uint32_t draws = 0;
+#endif
+
+        while (k < cnt) {
+#ifdef FHSS_GENERATOR_DRAWS_MAX
+            // only for host tools, for some seeds no channel can be picked anymore, Cnt() then tells
+            if (draws++ >= FHSS_GENERATOR_DRAWS_MAX) { cnt = k; break; }
+#endif
+
+            uint8_t rn = prng.Next() % cand_len; // cand_len = freq_len - k, get a random number in the remaining range
+
+            uint8_t ch_eff = cand[rn];
+            uint8_t ch = ch_eff * ch_inc + ch_ofs; // that's the true channel
+
+            // do not pick a bind channel
+            bool is_bind_channel = false;
+            for (uint8_t bi = 0; bi < bind_channel_list_len; bi++) {
+                if (ch == bind_channel_list[bi]) is_bind_channel = true;
+            }
+            if (is_bind_channel) continue;
+
+            // do not pick a channel in an excepted wifi band
+            if (except_flag != nullptr && except_flag[ch]) continue;
+
+            // ensure it is not too close to the previous
+            if (too_close && (k > 0)) {
+                if (last_ch_eff == 0) { // special treatment for this case
+                    if (ch_eff <= 1) continue;
+                } else {
+                    if ((ch_eff >= last_ch_eff - 1) && (ch_eff <= last_ch_eff + 1)) continue;
+                }
+            }
+
+            last_ch_eff = ch_eff;
+
+            // we got a new ch, so register it, and remove it from the candidates
+            ch_list[k] = ch;
+            for (uint8_t i = rn; i + 1 < cand_len; i++) cand[i] = cand[i + 1];
+            cand_len--;
+
+            k++;
+        }
+    }
+
+    // the prng after the generation, the spare channels continue with it
+    constexpr tFhssPrng Prng(void) const { return prng; }
+    constexpr uint32_t Seed(void) const { return prng.Seed(); }
+    constexpr uint8_t Cnt(void) const { return cnt; }
+    constexpr uint8_t Ch(uint8_t i) const { return ch_list[i]; }
+
+  private:
+    tFhssPrng prng;
+    uint8_t cnt;
+    uint8_t ch_list[FHSS_MAX_NUM];
+    uint8_t cand[FHSS_FREQ_LIST_MAX_LEN];
+    uint8_t cand_len;
+};
+
+
+#endif // FHSS_GENERATOR_H
@@ -43,6 +43,7 @@ typedef struct
     uint8_t LQ_serial;
     uint8_t antenna;
     uint8_t transmit_antenna;
+    uint8_t arq_window;
 } tFrameStats;
 
 
@@ -52,6 +53,19 @@ typedef struct
 #define FRAME_TX_PAYLOAD_LEN    64 // 82 - 10-6(rcdata) - 2(crc) = 64
 #define FRAME_RX_PAYLOAD_LEN    82
 
+// with USE_FEATURE_FEC the normal frames carry the parity at the end of the payload, so the serial data gets less
+#ifdef USE_FEATURE_FEC
+  #define FRAME_FEC_PARITY_LEN  8 // corrects up to 4 wrong bytes, see Common/fec.h
+#else
+  #define FRAME_FEC_PARITY_LEN  0
+#endif
+#define FRAME_TX_SERIAL_LEN     (FRAME_TX_PAYLOAD_LEN - FRAME_FEC_PARITY_LEN)
+#define FRAME_RX_SERIAL_LEN     (FRAME_RX_PAYLOAD_LEN - FRAME_FEC_PARITY_LEN)
+
+// frames without payload, with USE_FEATURE_FRAME_VARLEN, the crc follows directly after the rc data resp. the header
+#define FRAME_TX_SHORT_LEN      (FRAME_TX_RX_LEN - FRAME_TX_PAYLOAD_LEN) // 27
+#define FRAME_RX_SHORT_LEN      (FRAME_TX_RX_LEN - FRAME_RX_PAYLOAD_LEN) // 9
+
 
 PACKED(
 typedef struct
@@ -61,10 +75,10 @@ typedef struct
     uint8_t frame_type : 4;
     uint32_t antenna : 1;
     uint32_t rssi_u7 : 7;
-    uint32_t LQ_rc : 7; // only Rx->Tx frame, not Tx->Rx
+    uint32_t LQ_rc : 7; // only Rx->Tx frame, in Tx->Rx frame the ack window of the selective repeat ARQ
     uint32_t LQ_serial : 7;
     uint32_t transmit_antenna : 1;
-    uint32_t spare : 2;
+    uint32_t arq_window : 2; // with selective repeat ARQ, Rx->Tx frame: window offset, Tx->Rx frame: LQ_rc holds the ack window, else 0
     uint32_t payload_len : 7;
 }) tFrameStatus;
 
@@ -188,6 +202,9 @@ typedef enum {
     FRAME_CMD_SET_RX_PARAMS,            // tx -> rx, set parameters -> response with RX_SETUPDATA
     FRAME_CMD_STORE_RX_PARAMS,          // tx -> rx, store parameters, reboots
     FRAME_CMD_GET_RX_SETUPDATA_WRELOAD, // tx -> rx, reload parameters -> response with RX_SETUPDATA
+    FRAME_CMD_SET_FHSS,                 // tx -> rx, set spare channel map of adaptive fhss -> response with RX_FHSS
+    FRAME_CMD_RX_FHSS,                  // rx -> tx, return pending spare channel map & link quality per slot
+    FRAME_CMD_RX_ARQ_STATS,             // rx -> tx, counts of the transmit ARQ, send once per second, not a response
 } FRAME_CMD_ENUM;
 
 
@@ -221,12 +238,23 @@ typedef struct
 }) tCmdFrameRxParameters; // 24 bytes
 
 
+// send from Tx to do GET_RX_SETUPDATA, GET_RX_SETUPDATA_WRELOAD
+PACKED(
+typedef struct
+{
+    uint8_t cmd;
+    uint8_t frame_varlen : 1; // the Tx wants short frames
+    uint8_t spare : 7;
+}) tTxCmdFrameGetRxSetupData; // 2 bytes
+
+
 // send from Rx as response to GET_RX_SETUPDATA
 PACKED(
 typedef struct
 {
     uint8_t cmd;
-    uint8_t spare;
+    uint8_t frame_varlen : 1; // the Rx agrees to short frames
+    uint8_t spare : 7;
 
     // rx setup meta data 1
     uint16_t firmware_version_u16;
@@ -276,6 +304,48 @@ typedef struct
 }) tTxCmdFrameRxParams; // 64 bytes
 
 
+// send from Tx to do SET_FHSS
+PACKED(
+typedef struct
+{
+    uint8_t cmd;
+    uint8_t switch_cnt : 7; // number of hops till both ends switch to the map, 0 = the Tx asks for the map in use
+    uint8_t confirmed : 1; // the Tx got the map back from the Rx, so the switch is done
+
+    uint8_t spare_map[8]; // FHSS_SPARE_MAX, slot which uses spare channel k, 0xFF = not used
+}) tTxCmdFrameFhss; // 10 bytes
+
+
+// send from Rx as response to SET_FHSS
+PACKED(
+typedef struct
+{
+    uint8_t cmd;
+    uint8_t confirmed : 1; // the Rx got the confirmation, so the Tx can stop sending SET_FHSS
+    uint8_t in_use : 1; // spare_map is the map in use, as response to the Tx' query
+    uint8_t spare : 6;
+
+    uint8_t spare_map[8]; // the pending map, or the map in use
+    uint8_t valid_cnt_u4[16]; // FHSS_MAX_NUM, number of valid frames in the window per slot, 4 bits per slot
+    uint32_t window_full_mask; // slots for which the window is full
+}) tRxCmdFrameFhss; // 30 bytes
+
+
+// send from Rx once per second
+PACKED(
+typedef struct
+{
+    uint8_t cmd;
+    uint8_t spare;
+
+    uint16_t first_attempt; // counts of the transmit ARQ in the last second
+    uint16_t retransmitted;
+    uint16_t retry_exhausted;
+    uint8_t retry_cnt;
+    uint16_t retry_success;
+}) tRxCmdFrameArqStats; // 11 bytes
+
+
 // for type casting to get the header
 PACKED(
 typedef struct
@@ -11,7 +11,13 @@
 #pragma once
 
 
+#include <stddef.h>
 #include "frame_types.h"
+#include "frame_crc.h"
+#ifdef USE_FEATURE_FEC
+  #define FEC_PARITY_LEN  FRAME_FEC_PARITY_LEN
+  #include "fec.h"
+#endif
 
 
 extern SX_DRIVER sx;
@@ -31,13 +37,100 @@ typedef enum {
 } CHECK_ENUM;
 
 
-void _pack_txframe_w_type(tTxFrame* frame, uint8_t type, tFrameStats* frame_stats, tRcData* rc, uint8_t* payload, uint8_t payload_len)
+#ifdef USE_FEATURE_FRAME_VARLEN
+// short frames are agreed on at each connect, until then, and with a peer without the feature, frames are full length
+// the Tx asks for them with GET_RX_SETUPDATA, the Rx agrees in its RX_SETUPDATA, and each end switches the format
+// once the other end has the answer: the Tx after it has send its next frame, the Rx when it receives a frame
+// which isn't GET_RX_SETUPDATA; if a frame is lost just then the link disconnects, and both go back to full frames
+class tFrameVarlen
+{
+  public:
+    void Init(void) { set(false); pending = false; requested = false; }
+    bool Active(void) { return active; }
+
+    // Tx: the Rx agreed
+    void Agreed(bool agreed) { if (agreed && !active) pending = true; }
+
+    // Tx: called after each transmit
+    void Transmitted(void) { if (pending) { pending = false; set(true); } }
+
+    // Rx: the Tx asked
+    void Requested(bool _requested) { requested = _requested; }
+
+    // Rx: called when RX_SETUPDATA is packed, returns the answer
+    bool Agree(void) { if (requested && !active) pending = true; return (active || pending); }
+
+    // Rx: called for each valid frame
+    void Received(tTxFrame* frame)
+    {
+        if (!pending) return;
+        if (frame->status.frame_type == FRAME_TYPE_TX_RX_CMD && frame->payload[0] == FRAME_CMD_GET_RX_SETUPDATA) return;
+        pending = false;
+        set(true);
+    }
+
+  private:
+    bool active;
+    bool pending; // the answer is on its way
+    bool requested;
+
+    void set(bool _active) { active = _active; sx.SetVarlen(active); sx2.SetVarlen(active); }
+};
+
+tFrameVarlen framevarlen;
+#endif
+
+
+// with USE_FEATURE_FRAME_VARLEN normal frames without payload are send short, without the payload
+// field, so the crc moves to the end of the rc data resp. of the header
+// cmd frames are always full length
+uint8_t txframe_len(tTxFrame* frame)
+{
+#ifdef USE_FEATURE_FRAME_VARLEN
+    if (framevarlen.Active() && frame->status.frame_type == FRAME_TYPE_TX && frame->status.payload_len == 0) return FRAME_TX_SHORT_LEN;
+#endif
+    return FRAME_TX_RX_LEN;
+}
+
+
+uint8_t rxframe_len(tRxFrame* frame)
+{
+#ifdef USE_FEATURE_FRAME_VARLEN
+    if (framevarlen.Active() && frame->status.frame_type == FRAME_TYPE_RX && frame->status.payload_len == 0) return FRAME_RX_SHORT_LEN;
+#endif
+    return FRAME_TX_RX_LEN;
+}
+
+
+#ifdef USE_FEATURE_FEC
+// normal frames with full length have the parity at the end of the payload, cmd frames need the full payload
+// the codeword is the frame without the crc
+bool txframe_has_fec(tTxFrame* frame)
+{
+    return (frame->status.frame_type == FRAME_TYPE_TX && txframe_len(frame) == FRAME_TX_RX_LEN);
+}
+
+
+bool rxframe_has_fec(tRxFrame* frame)
+{
+    return (frame->status.frame_type == FRAME_TYPE_RX && rxframe_len(frame) == FRAME_TX_RX_LEN);
+}
+#endif
+
+
+// the payload is expected to be already in frame->payload, only the unused tail is cleared
+// this allows to read the serial data directly into the frame, without copying it around
+void _pack_txframe_w_type_payload_inplace(tTxFrame* frame, uint8_t type, tFrameStats* frame_stats, tRcData* rc, uint8_t payload_len)
 {
 uint16_t crc;
 
     if (payload_len > FRAME_TX_PAYLOAD_LEN) payload_len = FRAME_TX_PAYLOAD_LEN; // should never occur, but play it safe
+#ifdef USE_FEATURE_FEC
+    if (type == FRAME_TYPE_TX && payload_len > FRAME_TX_SERIAL_LEN) payload_len = FRAME_TX_SERIAL_LEN; // the parity needs the room
+#endif
 
-    memset((uint8_t*)frame, 0, sizeof(tTxFrame));
+    memset((uint8_t*)frame, 0, offsetof(tTxFrame, payload)); // header, rc data
+    memset(&(frame->payload[payload_len]), 0, FRAME_TX_PAYLOAD_LEN - payload_len);
 
     // generate header
     frame->sync_word = Config.FrameSyncWord;
@@ -49,6 +142,7 @@ uint16_t crc;
     frame->status.rssi_u7 = rssi_u7_from_i8(frame_stats->rssi);
     frame->status.LQ_rc = frame_stats->LQ_rc;
     frame->status.LQ_serial = frame_stats->LQ_serial;
+    frame->status.arq_window = frame_stats->arq_window;
     frame->status.payload_len = payload_len;
 
     // pack rc data
@@ -73,18 +167,26 @@ uint16_t crc;
     frame->rc2.ch14 = (rc->ch[14] >= 1536) ? 2 : ((rc->ch[14] <= 512) ? 0 : 1);
     frame->rc2.ch15 = (rc->ch[15] >= 1536) ? 2 : ((rc->ch[15] <= 512) ? 0 : 1);
 
-    // pack the payload
-    for (uint8_t i = 0; i < payload_len; i++) {
-        frame->payload[i] = payload[i];
-    }
-
     // finalize, crc
-    fmav_crc_init(&crc);
-    fmav_crc_accumulate_buf(&crc, (uint8_t*)frame, FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN);
+    crc = frame_crc_update(FRAME_CRC_INIT, (uint8_t*)frame, FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN);
     frame->crc1 = crc;
 
-    fmav_crc_accumulate_buf(&crc, (uint8_t*)frame + FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN, FRAME_TX_RX_LEN - FRAME_TX_RX_HEADER_LEN - FRAME_TX_RCDATA1_LEN - 2);
-    frame->crc = crc;
+#ifdef USE_FEATURE_FEC
+    if (txframe_has_fec(frame)) fec_encode((uint8_t*)frame, FRAME_TX_RX_LEN - 2);
+#endif
+
+    uint8_t len = txframe_len(frame);
+    crc = frame_crc_update(crc, (uint8_t*)frame + FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN, len - FRAME_TX_RX_HEADER_LEN - FRAME_TX_RCDATA1_LEN - 2);
+    memcpy((uint8_t*)frame + len - 2, &crc, 2); // is frame->crc for a full frame
+}
+
+
+void _pack_txframe_w_type(tTxFrame* frame, uint8_t type, tFrameStats* frame_stats, tRcData* rc, uint8_t* payload, uint8_t payload_len)
+{
+    if (payload_len > FRAME_TX_PAYLOAD_LEN) payload_len = FRAME_TX_PAYLOAD_LEN; // should never occur, but play it safe
+
+    memcpy(frame->payload, payload, payload_len);
+    _pack_txframe_w_type_payload_inplace(frame, type, frame_stats, rc, payload_len);
 }
 
 
@@ -94,8 +196,15 @@ void pack_txframe(tTxFrame* frame, tFrameStats* frame_stats, tRcData* rc, uint8_
 }
 
 
+// payload_len bytes of payload must have been written into frame->payload before
+void pack_txframe_payload_inplace(tTxFrame* frame, tFrameStats* frame_stats, tRcData* rc, uint8_t payload_len)
+{
+    _pack_txframe_w_type_payload_inplace(frame, FRAME_TYPE_TX, frame_stats, rc, payload_len);
+}
+
+
 // returns 0 if OK !!
-uint8_t check_txframe(tTxFrame* frame)
+uint8_t _check_txframe(tTxFrame* frame)
 {
 uint16_t crc;
 
@@ -107,14 +216,45 @@ uint16_t crc;
 
     if (frame->status.payload_len > FRAME_TX_PAYLOAD_LEN) return CHECK_ERROR_HEADER;
 
-    fmav_crc_init(&crc);
-    fmav_crc_accumulate_buf(&crc, (uint8_t*)frame, FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN);
+    crc = frame_crc_update(FRAME_CRC_INIT, (uint8_t*)frame, FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN);
     if (crc != frame->crc1) return CHECK_ERROR_CRC1;
 
-    fmav_crc_accumulate_buf(&crc, (uint8_t*)frame + FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN, FRAME_TX_RX_LEN - FRAME_TX_RX_HEADER_LEN - FRAME_TX_RCDATA1_LEN - 2);
-    if (crc != frame->crc) return CHECK_ERROR_CRC;
+    // the header is valid now, so we can trust the length
+    uint8_t len = txframe_len(frame);
+    uint16_t frame_crc;
+    memcpy(&frame_crc, (uint8_t*)frame + len - 2, 2);
+
+    crc = frame_crc_update(crc, (uint8_t*)frame + FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN, len - FRAME_TX_RX_HEADER_LEN - FRAME_TX_RCDATA1_LEN - 2);
+    if (crc != frame_crc) return CHECK_ERROR_CRC;
+
+    return CHECK_OK;
+}
+
+
+// returns 0 if OK !!
+// with FEC a bad frame is repaired if possible, this is done on a copy, so that a failed repair leaves the frame as it was
+// a wrong sync word or a header which makes no sense is noise or a frame of another link, and not a frame of ours
+// with a few wrong bytes, so the repair is only tried if the crc failed, it is then only accepted if it gives a
+// normal full frame
+uint8_t check_txframe(tTxFrame* frame)
+{
+    uint8_t res = _check_txframe(frame);
+
+#ifdef USE_FEATURE_FEC
+    if (res != CHECK_ERROR_CRC1 && res != CHECK_ERROR_CRC) return res;
+    // crc1 was ok, so we can trust the header
+    if (res == CHECK_ERROR_CRC && !txframe_has_fec(frame)) return res;
 
+    tTxFrame frame_fec;
+    memcpy(&frame_fec, frame, FRAME_TX_RX_LEN);
+    if (!fec_decode((uint8_t*)&frame_fec, FRAME_TX_RX_LEN - 2)) return res;
+    if (!txframe_has_fec(&frame_fec) || _check_txframe(&frame_fec) != CHECK_OK) return res;
+
+    memcpy(frame, &frame_fec, FRAME_TX_RX_LEN);
     return CHECK_OK;
+#else
+    return res;
+#endif
 }
 
 
@@ -171,21 +311,31 @@ uint16_t crc;
     frame->status.rssi_u7 = rssi_u7_from_i8(frame_stats->rssi);
     frame->status.LQ_rc = frame_stats->LQ_rc;
     frame->status.LQ_serial = frame_stats->LQ_serial;
+    frame->status.arq_window = frame_stats->arq_window;
     // keep !! frame->status.payload_len = payload_len;
 
-    fmav_crc_init(&crc);
-    fmav_crc_accumulate_buf(&crc, (uint8_t*)frame, FRAME_TX_RX_LEN - 2);
-    frame->crc = crc;
+#ifdef USE_FEATURE_FEC
+    if (rxframe_has_fec(frame)) fec_encode((uint8_t*)frame, FRAME_TX_RX_LEN - 2); // the header has changed
+#endif
+
+    uint8_t len = rxframe_len(frame);
+    crc = frame_crc_update(FRAME_CRC_INIT, (uint8_t*)frame, len - 2);
+    memcpy((uint8_t*)frame + len - 2, &crc, 2); // is frame->crc for a full frame
 }
 
 
-void _pack_rxframe_w_type(tRxFrame* frame, uint8_t type, tFrameStats* frame_stats, uint8_t* payload, uint8_t payload_len)
+// the payload is expected to be already in frame->payload, only the unused tail is cleared
+void _pack_rxframe_w_type_payload_inplace(tRxFrame* frame, uint8_t type, tFrameStats* frame_stats, uint8_t payload_len)
 {
 uint16_t crc;
 
     if (payload_len > FRAME_RX_PAYLOAD_LEN) payload_len = FRAME_RX_PAYLOAD_LEN; // should never occur, but play it safe
+#ifdef USE_FEATURE_FEC
+    if (type == FRAME_TYPE_RX && payload_len > FRAME_RX_SERIAL_LEN) payload_len = FRAME_RX_SERIAL_LEN; // the parity needs the room
+#endif
 
-    memset((uint8_t*)frame, 0, sizeof(tRxFrame));
+    memset((uint8_t*)frame, 0, offsetof(tRxFrame, payload)); // header
+    memset(&(frame->payload[payload_len]), 0, FRAME_RX_PAYLOAD_LEN - payload_len);
 
     frame->sync_word = Config.FrameSyncWord;
     frame->status.seq_no = frame_stats->seq_no;
@@ -196,15 +346,25 @@ uint16_t crc;
     frame->status.rssi_u7 = rssi_u7_from_i8(frame_stats->rssi);
     frame->status.LQ_rc = frame_stats->LQ_rc;
     frame->status.LQ_serial = frame_stats->LQ_serial;
+    frame->status.arq_window = frame_stats->arq_window;
     frame->status.payload_len = payload_len;
 
-    for (uint8_t i = 0; i < payload_len; i++) {
-        frame->payload[i] = payload[i];
-    }
+#ifdef USE_FEATURE_FEC
+    if (rxframe_has_fec(frame)) fec_encode((uint8_t*)frame, FRAME_TX_RX_LEN - 2);
+#endif
+
+    uint8_t len = rxframe_len(frame);
+    crc = frame_crc_update(FRAME_CRC_INIT, (uint8_t*)frame, len - 2);
+    memcpy((uint8_t*)frame + len - 2, &crc, 2); // is frame->crc for a full frame
+}
+
+
+void _pack_rxframe_w_type(tRxFrame* frame, uint8_t type, tFrameStats* frame_stats, uint8_t* payload, uint8_t payload_len)
+{
+    if (payload_len > FRAME_RX_PAYLOAD_LEN) payload_len = FRAME_RX_PAYLOAD_LEN; // should never occur, but play it safe
 
-    fmav_crc_init(&crc);
-    fmav_crc_accumulate_buf(&crc, (uint8_t*)frame, FRAME_TX_RX_LEN - 2);
-    frame->crc = crc;
+    memcpy(frame->payload, payload, payload_len);
+    _pack_rxframe_w_type_payload_inplace(frame, type, frame_stats, payload_len);
 }
 
 
@@ -213,8 +373,15 @@ void pack_rxframe(tRxFrame* frame, tFrameStats* frame_stats, uint8_t* payload, u
     _pack_rxframe_w_type(frame, FRAME_TYPE_RX, frame_stats, payload, payload_len);
 }
 
+
+// payload_len bytes of payload must have been written into frame->payload before
+void pack_rxframe_payload_inplace(tRxFrame* frame, tFrameStats* frame_stats, uint8_t payload_len)
+{
+    _pack_rxframe_w_type_payload_inplace(frame, FRAME_TYPE_RX, frame_stats, payload_len);
+}
+
 // returns 0 if OK !!
-uint8_t check_rxframe(tRxFrame* frame)
+uint8_t _check_rxframe(tRxFrame* frame)
 {
 uint16_t crc;
 
@@ -226,14 +393,40 @@ uint16_t crc;
 
     if (frame->status.payload_len > FRAME_RX_PAYLOAD_LEN) return CHECK_ERROR_HEADER;
 
-    fmav_crc_init(&crc);
-    fmav_crc_accumulate_buf(&crc, (uint8_t*)frame, FRAME_TX_RX_LEN - 2);
-    if (crc != frame->crc) return CHECK_ERROR_CRC;
+    // the rx frame has no crc1, so a corrupted header may give a wrong length, but then the crc fails too
+    uint8_t len = rxframe_len(frame);
+    uint16_t frame_crc;
+    memcpy(&frame_crc, (uint8_t*)frame + len - 2, 2);
+
+    crc = frame_crc_update(FRAME_CRC_INIT, (uint8_t*)frame, len - 2);
+    if (crc != frame_crc) return CHECK_ERROR_CRC;
 
     return CHECK_OK;
 }
 
 
+// returns 0 if OK !!
+// with FEC a bad frame is repaired if possible, as for check_txframe()
+uint8_t check_rxframe(tRxFrame* frame)
+{
+    uint8_t res = _check_rxframe(frame);
+
+#ifdef USE_FEATURE_FEC
+    if (res != CHECK_ERROR_CRC) return res;
+
+    tRxFrame frame_fec;
+    memcpy(&frame_fec, frame, FRAME_TX_RX_LEN);
+    if (!fec_decode((uint8_t*)&frame_fec, FRAME_TX_RX_LEN - 2)) return res;
+    if (!rxframe_has_fec(&frame_fec) || _check_rxframe(&frame_fec) != CHECK_OK) return res;
+
+    memcpy(frame, &frame_fec, FRAME_TX_RX_LEN);
+    return CHECK_OK;
+#else
+    return res;
+#endif
+}
+
+
 
 //-------------------------------------------------------
 // Tx/Rx Cmd Frames
@@ -304,6 +497,18 @@ uint8_t payload[1];
 }
 
 
+// Tx: ask for FRAME_CMD_RX_SETUPDATA with FRAME_CMD_GET_RX_SETUPDATA or FRAME_CMD_GET_RX_SETUPDATA_WRELOAD
+void pack_txcmdframe_getrxsetupdata(tTxFrame* frame, tFrameStats* frame_stats, tRcData* rc, uint8_t cmd)
+{
+tTxCmdFrameGetRxSetupData get_rx_setupdata = {};
+
+    get_rx_setupdata.cmd = cmd;
+    IF_FRAME_VARLEN(get_rx_setupdata.frame_varlen = 1;)
+
+    _pack_txframe_w_type(frame, FRAME_TYPE_TX_RX_CMD, frame_stats, rc, (uint8_t*)&get_rx_setupdata, sizeof(get_rx_setupdata));
+}
+
+
 // Tx: handle FRAME_CMD_RX_SETUPDATA from Rx
 void unpack_rxcmdframe_rxsetupdata(tRxFrame* frame)
 {
@@ -316,6 +521,7 @@ tRxCmdFrameRxSetupData* rx_setupdata = (tRxCmdFrameRxSetupData*)frame->payload;
     strstrbufcpy(SetupMetaData.rx_device_name, rx_setupdata->device_name_20, 20);
     SetupMetaData.rx_actual_power_dbm = rx_setupdata->actual_power_dbm;
     SetupMetaData.rx_actual_diversity = rx_setupdata->actual_diversity;
+    SetupMetaData.rx_frame_varlen = rx_setupdata->frame_varlen;
 
     cmdframerxparameters_rxparams_to_rxsetup(&(rx_setupdata->RxParams));
 
@@ -351,6 +557,20 @@ tTxCmdFrameRxParams rx_params = {};
     _pack_txframe_w_type(frame, FRAME_TYPE_TX_RX_CMD, frame_stats, rc, (uint8_t*)&rx_params, sizeof(rx_params));
 }
 
+
+// Tx: send spare channel map of the adaptive fhss with FRAME_CMD_SET_FHSS to Rx, with the hops till the switch
+void pack_txcmdframe_setfhss(tTxFrame* frame, tFrameStats* frame_stats, tRcData* rc, const uint8_t* spare_map, uint8_t switch_cnt, bool confirmed)
+{
+tTxCmdFrameFhss fhss_cmd = {};
+
+    fhss_cmd.cmd = FRAME_CMD_SET_FHSS;
+    fhss_cmd.switch_cnt = switch_cnt;
+    fhss_cmd.confirmed = (confirmed) ? 1 : 0;
+    memcpy(fhss_cmd.spare_map, spare_map, sizeof(fhss_cmd.spare_map));
+
+    _pack_txframe_w_type(frame, FRAME_TYPE_TX_RX_CMD, frame_stats, rc, (uint8_t*)&fhss_cmd, sizeof(fhss_cmd));
+}
+
 #endif
 #ifdef DEVICE_IS_RECEIVER
 
@@ -366,6 +586,7 @@ tRxCmdFrameRxSetupData rx_setupdata = {};
     strbufstrcpy(rx_setupdata.device_name_20, DEVICE_NAME, 20);
     rx_setupdata.actual_power_dbm = sx.RfPower_dbm();
     rx_setupdata.actual_diversity = Config.Diversity;
+    IF_FRAME_VARLEN(rx_setupdata.frame_varlen = (framevarlen.Agree()) ? 1 : 0;)
 
     cmdframerxparameters_rxparams_from_rxsetup(&(rx_setupdata.RxParams));
 
@@ -399,6 +620,40 @@ tTxCmdFrameRxParams* rx_params = (tTxCmdFrameRxParams*)frame->payload;
     cmdframerxparameters_rxparams_to_rxsetup(&(rx_params->RxParams));
 }
 
+
+// Rx: send FRAME_CMD_RX_FHSS to Tx, with the pending or the in use spare channel map and the link quality per slot
+void pack_rxcmdframe_rxfhss(tRxFrame* frame, tFrameStats* frame_stats, const uint8_t* spare_map, bool confirmed, bool in_use, const uint8_t* valid_cnt_u4, uint32_t window_full_mask)
+{
+tRxCmdFrameFhss fhss_cmd = {};
+
+    fhss_cmd.cmd = FRAME_CMD_RX_FHSS;
+    fhss_cmd.confirmed = (confirmed) ? 1 : 0;
+    fhss_cmd.in_use = (in_use) ? 1 : 0;
+    memcpy(fhss_cmd.spare_map, spare_map, sizeof(fhss_cmd.spare_map));
+    memcpy(fhss_cmd.valid_cnt_u4, valid_cnt_u4, sizeof(fhss_cmd.valid_cnt_u4));
+    fhss_cmd.window_full_mask = window_full_mask;
+
+    _pack_rxframe_w_type(frame, FRAME_TYPE_TX_RX_CMD, frame_stats, (uint8_t*)&fhss_cmd, sizeof(fhss_cmd));
+}
+
+
+#ifdef USE_FEATURE_ARQ_STATS
+// Rx: send FRAME_CMD_RX_ARQ_STATS to Tx, with the counts of the transmit ARQ in the last second
+void pack_rxcmdframe_rxarqstats(tRxFrame* frame, tFrameStats* frame_stats, uint32_t first_attempt, uint32_t retransmitted, uint32_t retry_exhausted, uint8_t retry_cnt, uint16_t retry_success)
+{
+tRxCmdFrameArqStats arq_cmd = {};
+
+    arq_cmd.cmd = FRAME_CMD_RX_ARQ_STATS;
+    arq_cmd.first_attempt = (first_attempt > UINT16_MAX) ? UINT16_MAX : first_attempt;
+    arq_cmd.retransmitted = (retransmitted > UINT16_MAX) ? UINT16_MAX : retransmitted;
+    arq_cmd.retry_exhausted = (retry_exhausted > UINT16_MAX) ? UINT16_MAX : retry_exhausted;
+    arq_cmd.retry_cnt = retry_cnt;
+    arq_cmd.retry_success = retry_success;
+
+    _pack_rxframe_w_type(frame, FRAME_TYPE_TX_RX_CMD, frame_stats, (uint8_t*)&arq_cmd, sizeof(arq_cmd));
+}
+#endif
+
 #endif
 
 
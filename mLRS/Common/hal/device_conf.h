@@ -381,6 +381,15 @@ The default selection of frequency bands can be overruled by feature defines.
 #endif
 
 
+//-------------------------------------------------------
+// Host Simulation
+//-------------------------------------------------------
+
+#ifdef HOST_SIM
+#include "host/host-device_conf.h"
+#endif
+
+
 //-------------------------------------------------------
 // MLRS Feature Defines
 //-------------------------------------------------------
@@ -67,7 +67,7 @@ class tRxClock
   public:
     void Init(uint16_t period_ms);
     void SetPeriod(uint16_t period_ms);
-    void Reset(void);
+    void Reset(uint16_t delay_10us = 0);
 
   private:
     bool initialized = false;
@@ -108,7 +108,8 @@ IRAM_ATTR void tRxClock::SetPeriod(uint16_t period_ms)
 }
 
 
-IRAM_ATTR void tRxClock::Reset(void)
+// delay_10us shifts the clock to later, is used for short frames, which are received earlier than full frames
+IRAM_ATTR void tRxClock::Reset(uint16_t delay_10us)
 {
     if (!CLOCK_PERIOD_10US) while (1) {}
 
@@ -117,8 +118,8 @@ IRAM_ATTR void tRxClock::Reset(void)
 #elif defined ESP8266
     noInterrupts();
 #endif
-    CCR1 = CNT_10us + CLOCK_PERIOD_10US;
-    CCR3 = CNT_10us + CLOCK_SHIFT_10US;
+    CCR1 = CNT_10us + delay_10us + CLOCK_PERIOD_10US;
+    CCR3 = CNT_10us + delay_10us + CLOCK_SHIFT_10US;
     MS_C = CNT_10us + CLOCK_CNT_1MS;
 #ifdef ESP32
     taskEXIT_CRITICAL(&esp32_spinlock);
@@ -251,6 +251,15 @@ Note: Some "high-level" features are set for each device in the device_conf.h fi
 #endif
 
 
+//-------------------------------------------------------
+// Host Simulation
+//-------------------------------------------------------
+
+#ifdef HOST_SIM
+#include "host/host-hal.h"
+#endif
+
+
 //-------------------------------------------------------
 // Derived Defines
 //-------------------------------------------------------
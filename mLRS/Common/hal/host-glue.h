@@ -0,0 +1,54 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// Host Glue
+//*******************************************************
+#ifndef HOST_GLUE_H
+#define HOST_GLUE_H
+#pragma once
+
+
+#include <stdint.h>
+#include "../host-lib/host-sim.h"
+
+#define __NOP()
+
+
+#undef IRQHANDLER
+#define IRQHANDLER(__Declaration__)  extern "C" {__Declaration__}
+
+
+void __disable_irq(void) { host_irq_disable(); }
+void __enable_irq(void) { host_irq_enable(); }
+
+
+
+// main() streamlining between host/STM code
+static uint8_t restart_controller = 0;
+void main_loop(void);
+
+int main(int argc, char** argv)
+{
+    host_sim_init(argc, argv);
+    while (1) {
+        main_loop();
+        host_sim_loop_done();
+    }
+}
+
+#define INITCONTROLLER_ONCE \
+    if(restart_controller <= 1){ \
+    if(restart_controller == 0){
+#define RESTARTCONTROLLER \
+    }
+#define INITCONTROLLER_END \
+    restart_controller = UINT8_MAX; \
+    }
+#define GOTO_RESTARTCONTROLLER \
+    restart_controller = 1; \
+    return;
+
+
+#endif // HOST_GLUE_H
@@ -0,0 +1,34 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// Host Powerup Counter
+//********************************************************
+#ifndef HOST_POWERUP_CNT_H
+#define HOST_POWERUP_CNT_H
+#pragma once
+
+// the host simulation is not power cycled
+
+
+#include <inttypes.h>
+
+
+typedef enum {
+    POWERUPCNT_TASK_NONE = 0,
+    POWERUPCNT_TASK_BIND,
+} POWERUPCNT_TASK_ENUM;
+
+
+
+class tPowerupCounter
+{
+  public:
+    void Init(void) {}
+    void Do(void) {}
+    uint8_t Task(void) { return POWERUPCNT_TASK_NONE; }
+};
+
+
+#endif // HOST_POWERUP_CNT_H
@@ -0,0 +1,102 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// Host RxClock
+//********************************************************
+#ifndef HOST_RXCLOCK_H
+#define HOST_RXCLOCK_H
+#pragma once
+
+
+#define CLOCK_SHIFT_10US          100 // 75 // 100 // 1 ms
+#define CLOCK_CNT_1MS             100 // 10us interval 10us x 100 = 1000us
+
+
+volatile bool doPostReceive;
+
+uint16_t CLOCK_PERIOD_10US; // does not change while isr is enabled, so no need for volatile
+
+volatile uint32_t CNT_10us = 0;
+volatile uint32_t CCR1 = CLOCK_PERIOD_10US;
+volatile uint32_t CCR3 = CLOCK_PERIOD_10US;
+volatile uint32_t MS_C = CLOCK_CNT_1MS;
+
+
+//-------------------------------------------------------
+// Clock ISR
+//-------------------------------------------------------
+
+IRQHANDLER(
+void CLOCK_IRQHandler(void)
+{
+    CNT_10us++;
+
+    // call HAL_IncTick every 1 ms
+    if (CNT_10us == MS_C) {
+        MS_C = CNT_10us + CLOCK_CNT_1MS;
+        HAL_IncTick();
+    }
+
+    // this is at about when RX was or was supposed to be received
+    if (CNT_10us == CCR1) {
+        CCR3 = CNT_10us + CLOCK_SHIFT_10US; // next doPostReceive
+        CCR1 = CNT_10us + CLOCK_PERIOD_10US; // next tick
+    }
+
+    // this is 1 ms after RX was or was supposed to be received
+    if (CNT_10us == CCR3) {
+        doPostReceive = true;
+    }
+
+})
+
+
+//-------------------------------------------------------
+// RxClock Class
+//-------------------------------------------------------
+
+class tRxClock
+{
+  public:
+    void Init(uint16_t period_ms);
+    void SetPeriod(uint16_t period_ms);
+    void Reset(uint16_t delay_10us = 0);
+};
+
+
+void tRxClock::Init(uint16_t period_ms)
+{
+    CLOCK_PERIOD_10US = period_ms * 100; // frame rate in units of 10us
+    doPostReceive = false;
+
+    CNT_10us = 0;
+    CCR1 = CLOCK_PERIOD_10US;
+    CCR3 = CLOCK_SHIFT_10US;
+    MS_C = CLOCK_CNT_1MS;
+
+    host_clock_start(10, CLOCK_IRQHandler);
+}
+
+
+void tRxClock::SetPeriod(uint16_t period_ms)
+{
+    CLOCK_PERIOD_10US = period_ms * 100;
+}
+
+
+// delay_10us shifts the clock to later, is used for short frames, which are received earlier than full frames
+void tRxClock::Reset(uint16_t delay_10us)
+{
+    if (!CLOCK_PERIOD_10US) while (1) {}
+
+    __disable_irq();
+    CCR1 = CNT_10us + delay_10us + CLOCK_PERIOD_10US;
+    CCR3 = CNT_10us + delay_10us + CLOCK_SHIFT_10US;
+    MS_C = CNT_10us + CLOCK_CNT_1MS;
+    __enable_irq();
+}
+
+
+#endif // HOST_RXCLOCK_H
@@ -0,0 +1,88 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// Host Timer
+//********************************************************
+#ifndef HOST_TIMER_H
+#define HOST_TIMER_H
+#pragma once
+
+
+//-------------------------------------------------------
+// SysTask & millis32()  functions
+//-------------------------------------------------------
+
+#define SYSTICK_DELAY_MS(x)       (uint16_t)(((uint32_t)(x)*(uint32_t)1000)/SYSTICK_TIMESTEP)
+
+
+volatile uint32_t doSysTask = 0;
+volatile uint32_t uwTick = 0;
+
+
+void HAL_IncTick(void)
+{
+    uwTick += 1;
+    doSysTask++;
+}
+
+
+volatile uint32_t millis32(void)
+{
+    return uwTick;
+}
+
+
+#ifdef DEVICE_IS_TRANSMITTER
+// for receiver it is done in host-rxclock.h, for transmitter it is here
+
+IRQHANDLER(
+void CLOCK_IRQHandler(void)
+{
+    HAL_IncTick();
+})
+
+
+void systick_millis_init(void)
+{
+    host_clock_start(1000, CLOCK_IRQHandler);
+}
+
+#else
+
+void systick_millis_init(void) {}
+
+#endif
+
+
+//-------------------------------------------------------
+// Micros functions
+//-------------------------------------------------------
+// free running timer with 1us time base, runs on the local time
+
+void micros_init(void)
+{
+}
+
+
+uint16_t micros16(void)
+{
+    return (uint16_t)host_local_us(host_time_us);
+}
+
+
+//-------------------------------------------------------
+// Init function
+//-------------------------------------------------------
+
+void timer_init(void)
+{
+    doSysTask = 0;
+    uwTick = 0;
+    systick_millis_init();
+    micros_init();
+}
+
+
+#endif // HOST_TIMER_H
@@ -0,0 +1,42 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// device configuration splicer for the host simulation
+//*******************************************************
+
+//-------------------------------------------------------
+// Host Simulation
+//-------------------------------------------------------
+// the Tx and Rx main loops built as Linux processes, see Common/host-lib/host-sim.h and tools/linksim
+
+#ifdef TX_HOST_SIM_2400
+  #define DEVICE_NAME "HOST SIM 2400"
+  #define DEVICE_IS_TRANSMITTER
+  #define DEVICE_HAS_SX128x
+  #define FREQUENCY_BAND_2P4_GHZ
+#endif
+
+#ifdef RX_HOST_SIM_2400
+  #define DEVICE_NAME "HOST SIM 2400"
+  #define DEVICE_IS_RECEIVER
+  #define DEVICE_HAS_SX128x
+  #define FREQUENCY_BAND_2P4_GHZ
+#endif
+
+#ifdef TX_HOST_SIM_900
+  #define DEVICE_NAME "HOST SIM 900"
+  #define DEVICE_IS_TRANSMITTER
+  #define DEVICE_HAS_SX126x
+  #define FREQUENCY_BAND_868_MHZ
+  #define FREQUENCY_BAND_915_MHZ_FCC
+#endif
+
+#ifdef RX_HOST_SIM_900
+  #define DEVICE_NAME "HOST SIM 900"
+  #define DEVICE_IS_RECEIVER
+  #define DEVICE_HAS_SX126x
+  #define FREQUENCY_BAND_868_MHZ
+  #define FREQUENCY_BAND_915_MHZ_FCC
+#endif
@@ -0,0 +1,19 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// hal splicer for the host simulation
+//*******************************************************
+
+//-------------------------------------------------------
+// Host Simulation
+//-------------------------------------------------------
+
+#if defined TX_HOST_SIM_2400 || defined TX_HOST_SIM_900
+#include "tx-hal-host-sim.h"
+#endif
+
+#if defined RX_HOST_SIM_2400 || defined RX_HOST_SIM_900
+#include "rx-hal-host-sim.h"
+#endif
@@ -0,0 +1,109 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// hal
+//********************************************************
+
+//-------------------------------------------------------
+// Host Simulation TX, 2.4 GHz with SX128x or 868/915 MHz with SX126x
+//-------------------------------------------------------
+
+#define DEVICE_HAS_NO_DEBUG
+
+
+//-- UARTS
+// UARTB = serial port
+// UARTC = COM (CLI)
+
+#define UARTB_USE_SERIAL // serial port
+#define UARTB_BAUD                TX_SERIAL_BAUDRATE
+#define UARTB_TXBUFSIZE           TX_SERIAL_TXBUFSIZE
+#define UARTB_RXBUFSIZE           TX_SERIAL_RXBUFSIZE
+
+#define UARTC_USE_SERIAL // COM (CLI)
+#define UARTC_BAUD                TX_COM_BAUDRATE
+#define UARTC_TXBUFSIZE           TX_COM_TXBUFSIZE
+#define UARTC_RXBUFSIZE           TX_COM_RXBUFSIZE
+
+
+//-- SX1: SX12xx & SPI
+
+#define SX_BUSY                   IO_P0
+#define SX_DIO1                   IO_P1
+#define SX_RESET                  IO_P2
+
+IRQHANDLER(void SX_DIO_EXTI_IRQHandler(void);)
+
+void sx_init_gpio(void)
+{
+    gpio_init(SX_DIO1, IO_MODE_INPUT_ANALOG);
+    gpio_init(SX_BUSY, IO_MODE_INPUT_ANALOG); // reads as low, the chip models are never busy
+    gpio_init(SX_RESET, IO_MODE_OUTPUT_PP_HIGH);
+}
+
+bool sx_busy_read(void)
+{
+    return (gpio_read_activehigh(SX_BUSY)) ? true : false;
+}
+
+void sx_amp_transmit(void) {}
+void sx_amp_receive(void) {}
+
+void sx_dio_init_exti_isroff(void)
+{
+    host_irq_attach(HOST_IRQ_SX_DIO, nullptr);
+}
+
+void sx_dio_enable_exti_isr(void)
+{
+    host_irq_attach(HOST_IRQ_SX_DIO, SX_DIO_EXTI_IRQHandler);
+}
+
+void sx_dio_exti_isr_clearflag(void) {}
+
+
+//-- Button
+
+#define BUTTON                    IO_P3
+
+void button_init(void)
+{
+    gpio_init(BUTTON, IO_MODE_INPUT_PU);
+}
+
+bool button_pressed(void)
+{
+    return gpio_read_activelow(BUTTON) ? true : false;
+}
+
+
+//-- LEDs
+
+#define LED_GREEN                 IO_P4
+#define LED_RED                   IO_P5
+
+void leds_init(void)
+{
+    gpio_init(LED_GREEN, IO_MODE_OUTPUT_PP_LOW);
+    gpio_init(LED_RED, IO_MODE_OUTPUT_PP_LOW);
+}
+
+void led_green_off(void) { gpio_low(LED_GREEN); }
+void led_green_on(void) { gpio_high(LED_GREEN); }
+void led_green_toggle(void) { gpio_toggle(LED_GREEN); }
+
+void led_red_off(void) { gpio_low(LED_RED); }
+void led_red_on(void) { gpio_high(LED_RED); }
+void led_red_toggle(void) { gpio_toggle(LED_RED); }
+
+
+//-- POWER
+
+#ifdef DEVICE_HAS_SX126x
+  #define POWER_PA_NONE_SX126X
+#else
+  #define POWER_PA_NONE_SX128X
+#endif
+#include "../hal-power-pa.h"
@@ -0,0 +1,42 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// Host Delay
+//********************************************************
+// Delays advance the virtual time, so interrupts which fall into them are run, as on the mcu.
+//********************************************************
+#ifndef HOSTLIB_DELAY_H
+#define HOSTLIB_DELAY_H
+#pragma once
+
+
+static inline void delay_ns(uint32_t ns)
+{
+    // called only in SPI functions, the host chip models do not need it
+}
+
+
+void delay_us(uint32_t us)
+{
+    host_advance_us(us);
+}
+
+
+void delay_ms(uint32_t ms)
+{
+    host_advance_us((uint64_t)ms * 1000);
+}
+
+
+//-------------------------------------------------------
+// INIT routines
+//-------------------------------------------------------
+
+void delay_init(void)
+{
+}
+
+
+#endif // HOSTLIB_DELAY_H
@@ -0,0 +1,68 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// Host Emulated EEPROM
+//*******************************************************
+// Is kept in memory only and is erased at each start, so the setup comes up with its defaults,
+// see the HOST_SIM overrides in setup.h.
+//*******************************************************
+#ifndef HOSTLIB_EEPROM_H
+#define HOSTLIB_EEPROM_H
+
+
+typedef enum {
+    EE_STATUS_FLASH_FAIL = 0, // indicates failure in hal functions
+    EE_STATUS_PAGE_UNDEF,
+    EE_STATUS_PAGE_EMPTY,
+    EE_STATUS_PAGE_FULL,
+    EE_STATUS_OK
+} EE_STATUS_ENUM;
+
+
+#define EE_PAGE_SIZE  0x0800 // Page size = 2 KByte
+
+
+uint8_t host_ee_page[EE_PAGE_SIZE];
+
+
+//-------------------------------------------------------
+// API
+//-------------------------------------------------------
+
+EE_STATUS_ENUM ee_readdata(void* data, uint16_t datalen)
+{
+    if (datalen > EE_PAGE_SIZE) return EE_STATUS_PAGE_FULL;
+    memcpy(data, host_ee_page, datalen);
+    return EE_STATUS_OK;
+}
+
+
+EE_STATUS_ENUM ee_writedata(void* data, uint16_t datalen)
+{
+    if (datalen > EE_PAGE_SIZE) return EE_STATUS_PAGE_FULL;
+    memcpy(host_ee_page, data, datalen);
+    return EE_STATUS_OK;
+}
+
+
+EE_STATUS_ENUM ee_format(void)
+{
+    memset(host_ee_page, 0xff, EE_PAGE_SIZE);
+    return EE_STATUS_OK;
+}
+
+
+EE_STATUS_ENUM ee_init(void)
+{
+    static bool initialized = false;
+
+    if (!initialized) ee_format(); // is called again with a restart of the controller, keep what was stored
+    initialized = true;
+    return EE_STATUS_OK;
+}
+
+
+//-------------------------------------------------------
+#endif // HOSTLIB_EEPROM_H
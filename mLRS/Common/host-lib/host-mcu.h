@@ -0,0 +1,18 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// Host MCU
+//********************************************************
+#ifndef HOSTLIB_MCU_H
+#define HOSTLIB_MCU_H
+
+
+void BootLoaderInit(void)
+{
+    // the host simulation has no system bootloader to jump to
+};
+
+
+#endif // HOSTLIB_MCU_H
@@ -0,0 +1,99 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// Host Peripherals
+//********************************************************
+// The pins of the host simulation are just levels in memory. Inputs read as what had been
+// written last, so e.g. a button defined as active low with pull up reads as not pressed.
+//********************************************************
+#ifndef HOSTLIB_PERIPHERALS_H
+#define HOSTLIB_PERIPHERALS_H
+
+
+#define GPIO_INLINE_FORCED  inline
+
+#define IO_P0       0
+#define IO_P1       1
+#define IO_P2       2
+#define IO_P3       3
+#define IO_P4       4
+#define IO_P5       5
+#define IO_P6       6
+#define IO_P7       7
+#define IO_P8       8
+#define IO_P9       9
+#define IO_P10      10
+#define IO_P11      11
+#define IO_P12      12
+#define IO_P13      13
+#define IO_P14      14
+#define IO_P15      15
+
+#define HOST_GPIO_NUM  16
+
+
+typedef enum {
+    IO_MODE_Z = 0,
+    IO_MODE_INPUT_ANALOG,
+    IO_MODE_INPUT_PU,
+    IO_MODE_OUTPUT_PP,
+    IO_MODE_OUTPUT_PP_LOW,
+    IO_MODE_OUTPUT_PP_HIGH,
+} IOMODEENUM;
+
+
+uint8_t host_gpio[HOST_GPIO_NUM];
+
+
+void gpio_init(uint8_t GPIO_Pin, IOMODEENUM mode)
+{
+    switch (mode) {
+    case IO_MODE_INPUT_PU:
+    case IO_MODE_OUTPUT_PP_HIGH:
+        host_gpio[GPIO_Pin] = 1;
+        break;
+    default:
+        host_gpio[GPIO_Pin] = 0;
+    }
+}
+
+
+GPIO_INLINE_FORCED void gpio_low(uint8_t GPIO_Pin)
+{
+    host_gpio[GPIO_Pin] = 0;
+}
+
+
+GPIO_INLINE_FORCED void gpio_high(uint8_t GPIO_Pin)
+{
+    host_gpio[GPIO_Pin] = 1;
+}
+
+
+GPIO_INLINE_FORCED void gpio_toggle(uint8_t GPIO_Pin)
+{
+    host_gpio[GPIO_Pin] ^= 1;
+}
+
+
+GPIO_INLINE_FORCED uint16_t gpio_read_activehigh(uint8_t GPIO_Pin)
+{
+    return (host_gpio[GPIO_Pin]) ? 1 : 0;
+}
+
+
+GPIO_INLINE_FORCED uint16_t gpio_read_activelow(uint8_t GPIO_Pin)
+{
+    return (host_gpio[GPIO_Pin]) ? 0 : 1;
+}
+
+
+GPIO_INLINE_FORCED uint16_t gpio_readoutput(uint8_t GPIO_Pin)
+{
+    return (host_gpio[GPIO_Pin]) ? 1 : 0;
+}
+
+
+#endif // HOSTLIB_PERIPHERALS_H
@@ -0,0 +1,614 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// Host Simulation
+//********************************************************
+// Runs the Tx or Rx firmware as a Linux process, for tools/linksim.
+// The time is virtual. It only advances in the delays, once per main loop, and when the process
+// waits for the controller. The clock isr, the sx dio isr and the uart bytes are events, which are
+// processed when the time gets to them.
+//
+// The controller, tools/linksim/linksim.py, talks to the process via stdin/stdout, one line per
+// message, times are in us, hex is the data as hex string:
+//   controller -> node
+//     G t_us                                       run until t_us, then report D
+//     F t_start t_end freq_hz key rssi snr hex     a frame of the other node, after the channel
+//     S port t_us hex                              bytes into the uart port, from t_us on
+//     Q                                            quit, the node reports E for each uart
+//   node -> controller
+//     T t_start t_end freq_hz key hex              a frame was transmitted
+//     S port t_us hex                              bytes out of the uart port, the first was done at t_us
+//     C t_us connect_state                         the connect state changed
+//     D t_us                                       done, waits for the next G
+//     E port rx_dropped tx_dropped                 the bytes the uart dropped
+// The key stands for the modulation, a frame is received only when the radio is in rx with the same
+// key on the same frequency for the whole time over air. So that this can be decided, a run must not
+// be longer than the shortest time over air, the controller takes care of this.
+//********************************************************
+#ifndef HOSTLIB_SIM_H
+#define HOSTLIB_SIM_H
+#pragma once
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <vector>
+
+
+//-------------------------------------------------------
+// Setup
+//-------------------------------------------------------
+// the setup parameters the controller can set, they replace the defaults of common_conf.h, see setup.h
+
+typedef struct
+{
+    char BindPhrase[6+1];
+    uint8_t FrequencyBand;
+    uint8_t Mode;
+    uint8_t Ortho;
+    uint8_t SerialLinkMode;
+    uint8_t TxSerialBaudrate;
+    uint8_t RxSerialBaudrate;
+    double ppm; // error of the crystal, the local time runs faster by this
+    uint32_t loop_us; // time a main loop takes
+} tHostSetup;
+
+
+tHostSetup host_setup = {
+    .BindPhrase = "mlrs.0",
+    .FrequencyBand = 0, // 2.4 GHz
+    .Mode = 0, // 50 Hz
+    .Ortho = 0, // off
+    .SerialLinkMode = 0, // transparent
+    .TxSerialBaudrate = 4, // 115200
+    .RxSerialBaudrate = 3, // 57600
+    .ppm = 0.0,
+    .loop_us = 20,
+};
+
+
+//-------------------------------------------------------
+// Time
+//-------------------------------------------------------
+
+#define HOST_TIME_NEVER  UINT64_MAX
+
+uint64_t host_time_us = 0; // true time, as of the controller
+uint64_t host_run_until_us = 0;
+
+void host_advance_us(uint64_t us);
+
+
+uint64_t host_local_us(uint64_t t_us)
+{
+    return t_us + (int64_t)llround((double)t_us * host_setup.ppm * 1.0E-6);
+}
+
+
+// the first true time at which the local time is at least local_us
+uint64_t host_true_us(uint64_t local_us)
+{
+    uint64_t t_us = (uint64_t)floor((double)local_us / (1.0 + host_setup.ppm * 1.0E-6));
+    while (host_local_us(t_us) < local_us) t_us++;
+    return t_us;
+}
+
+
+//-------------------------------------------------------
+// Interrupts
+//-------------------------------------------------------
+// an isr which is raised while irqs are disabled, or while in an isr, is pending and is called
+// when possible, as on the mcu it is called only once however often it was raised
+
+typedef enum {
+    HOST_IRQ_CLOCK = 0,
+    HOST_IRQ_SX_DIO,
+    HOST_IRQ_NUM,
+} HOST_IRQ_ENUM;
+
+
+void (*host_isr[HOST_IRQ_NUM])(void);
+bool host_irq_pending[HOST_IRQ_NUM];
+bool host_irq_disabled = false;
+bool host_in_isr = false;
+
+
+void host_irq_do_pending(void)
+{
+    for (uint8_t irq = 0; irq < HOST_IRQ_NUM; irq++) {
+        if (host_irq_disabled || host_in_isr) return;
+        if (!host_irq_pending[irq]) continue;
+        host_irq_pending[irq] = false;
+        host_in_isr = true;
+        host_isr[irq]();
+        host_in_isr = false;
+    }
+}
+
+
+void host_irq_raise(uint8_t irq)
+{
+    if (!host_isr[irq]) return;
+    host_irq_pending[irq] = true;
+    host_irq_do_pending();
+}
+
+
+void host_irq_attach(uint8_t irq, void (*isr)(void))
+{
+    host_isr[irq] = isr;
+    host_irq_pending[irq] = false;
+}
+
+
+void host_irq_disable(void)
+{
+    host_irq_disabled = true;
+}
+
+
+void host_irq_enable(void)
+{
+    host_irq_disabled = false;
+    host_irq_do_pending();
+}
+
+
+//-------------------------------------------------------
+// Clock
+//-------------------------------------------------------
+// periodic isr, runs on the local time
+
+uint32_t host_clock_period_us = 0;
+uint64_t host_clock_next_local_us;
+
+
+void host_clock_start(uint32_t period_us, void (*isr)(void))
+{
+    host_clock_period_us = period_us;
+    host_clock_next_local_us = host_local_us(host_time_us) + period_us;
+    host_irq_attach(HOST_IRQ_CLOCK, isr);
+}
+
+
+uint64_t host_clock_next_us(void)
+{
+    if (!host_clock_period_us) return HOST_TIME_NEVER;
+    return host_true_us(host_clock_next_local_us);
+}
+
+
+void host_clock_do(void)
+{
+    if (!host_clock_period_us) return;
+    uint64_t tnow_local_us = host_local_us(host_time_us);
+    while (tnow_local_us >= host_clock_next_local_us) {
+        host_clock_next_local_us += host_clock_period_us;
+        host_irq_raise(HOST_IRQ_CLOCK);
+    }
+}
+
+
+//-------------------------------------------------------
+// Helper
+//-------------------------------------------------------
+
+void host_puthex(uint8_t* buf, uint16_t len)
+{
+    static const char hex[] = "0123456789abcdef";
+    for (uint16_t i = 0; i < len; i++) {
+        putchar(hex[buf[i] >> 4]);
+        putchar(hex[buf[i] & 0x0F]);
+    }
+}
+
+
+uint16_t host_gethex(const char* s, uint8_t* buf, uint16_t len_max)
+{
+    uint16_t len = 0;
+    while (len < len_max) {
+        unsigned int c;
+        if (sscanf(s, "%2x", &c) != 1) break;
+        buf[len++] = c;
+        s += 2;
+    }
+    return len;
+}
+
+
+// FNV-1a, the chip models condense their modulation settings into the key with it
+uint32_t host_hash(uint32_t h, uint32_t v)
+{
+    for (uint8_t i = 0; i < 4; i++) {
+        h ^= (v & 0xFF);
+        h *= 16777619;
+        v >>= 8;
+    }
+    return h;
+}
+
+#define HOST_HASH_INIT  2166136261
+
+
+//-------------------------------------------------------
+// Radio
+//-------------------------------------------------------
+// the sx chip as seen from the antenna, is driven by the chip models host-sx128x.h, host-sx126x.h
+
+typedef enum {
+    HOST_RADIO_STATE_STANDBY = 0,
+    HOST_RADIO_STATE_FS,
+    HOST_RADIO_STATE_TX,
+    HOST_RADIO_STATE_RX,
+} HOST_RADIO_STATE_ENUM;
+
+typedef enum {
+    HOST_RADIO_IRQ_TX_DONE = 0x01,
+    HOST_RADIO_IRQ_RX_DONE = 0x02,
+    HOST_RADIO_IRQ_TIMEOUT = 0x04,
+} HOST_RADIO_IRQ_ENUM;
+
+
+typedef struct
+{
+    uint64_t t_start_us;
+    uint64_t t_end_us;
+    uint32_t freq_hz;
+    uint32_t key;
+    int16_t rssi;
+    int8_t snr;
+    uint8_t len;
+    uint8_t data[256];
+} tHostFrame;
+
+
+class tHostRadio
+{
+  public:
+    void Init(void)
+    {
+        state = HOST_RADIO_STATE_STANDBY;
+        freq_hz = 0;
+        key = 0;
+        irq = 0;
+        dio_mask = 0;
+        frames.clear();
+    }
+
+    //-- chip side
+
+    void SetStandby(void) { set_state(HOST_RADIO_STATE_STANDBY); }
+    void SetFs(void) { set_state(HOST_RADIO_STATE_FS); }
+
+    // the rx is interrupted by a change of the frequency or of the modulation
+    void SetFrequency(uint32_t _freq_hz)
+    {
+        if (_freq_hz == freq_hz) return;
+        freq_hz = _freq_hz;
+        t_rx_since_us = host_time_us;
+    }
+
+    void SetKey(uint32_t _key)
+    {
+        if (_key == key) return;
+        key = _key;
+        t_rx_since_us = host_time_us;
+    }
+
+    // in variable length mode len is the max length
+    void SetPayloadLength(uint8_t _len, bool _varlen) { payload_len = _len; varlen = _varlen; }
+
+    void SetTx(uint32_t toa_us, uint32_t tmo_us)
+    {
+        set_state(HOST_RADIO_STATE_TX);
+        t_tx_end_us = host_time_us + toa_us;
+        if (tmo_us && tmo_us < toa_us) { // is cut off, nobody gets it
+            t_tx_end_us = host_time_us + tmo_us;
+            tx_timeout = true;
+            return;
+        }
+        tx_timeout = false;
+        printf("T %llu %llu %u %u ", (unsigned long long)host_time_us, (unsigned long long)t_tx_end_us, freq_hz, key);
+        host_puthex(buf, payload_len);
+        putchar('\n');
+    }
+
+    void SetRx(uint32_t tmo_us)
+    {
+        set_state(HOST_RADIO_STATE_RX);
+        t_rx_since_us = host_time_us;
+        t_rx_tmo_us = (tmo_us) ? host_time_us + tmo_us : HOST_TIME_NEVER;
+    }
+
+    void SetDioMask(uint8_t mask) { dio_mask = mask; }
+
+    uint8_t GetIrq(void) { return irq; }
+    void ClearIrq(uint8_t mask) { irq &= ~mask; }
+
+    uint8_t buf[256];
+    uint8_t rx_len; // 0 for fixed length
+    int16_t rssi;
+    int8_t snr;
+
+    //-- simulation side
+
+    void Receive(tHostFrame* frame) { frames.push_back(*frame); }
+
+    uint64_t NextEvent_us(void)
+    {
+        uint64_t t_us = HOST_TIME_NEVER;
+        if (state == HOST_RADIO_STATE_TX) t_us = t_tx_end_us;
+        if (state == HOST_RADIO_STATE_RX && t_rx_tmo_us < t_us) t_us = t_rx_tmo_us;
+        for (auto& f : frames) if (f.t_end_us < t_us) t_us = f.t_end_us;
+        return t_us;
+    }
+
+    void Do(void)
+    {
+        if (state == HOST_RADIO_STATE_TX && host_time_us >= t_tx_end_us) {
+            set_state(HOST_RADIO_STATE_FS); // SetAutoFs(true)
+            raise((tx_timeout) ? HOST_RADIO_IRQ_TIMEOUT : HOST_RADIO_IRQ_TX_DONE);
+        }
+
+        for (uint16_t i = 0; i < frames.size(); ) {
+            if (frames[i].t_end_us > host_time_us) { i++; continue; }
+            if (frames[i].t_end_us < host_time_us) {
+                fprintf(stderr, "host sim: frame came too late, is dropped\n");
+            } else {
+                receive(&frames[i]);
+            }
+            frames.erase(frames.begin() + i);
+        }
+
+        if (state == HOST_RADIO_STATE_RX && host_time_us >= t_rx_tmo_us) {
+            set_state(HOST_RADIO_STATE_FS);
+            raise(HOST_RADIO_IRQ_TIMEOUT);
+        }
+    }
+
+  private:
+    uint8_t state;
+    uint32_t freq_hz;
+    uint32_t key;
+    uint8_t payload_len;
+    bool varlen;
+    uint8_t irq;
+    uint8_t dio_mask;
+    uint64_t t_tx_end_us;
+    bool tx_timeout;
+    uint64_t t_rx_since_us;
+    uint64_t t_rx_tmo_us;
+    std::vector<tHostFrame> frames;
+
+    void set_state(uint8_t _state)
+    {
+        state = _state;
+        t_rx_since_us = host_time_us;
+    }
+
+    // the dio isr is triggered by the rising edge
+    void raise(uint8_t irq_bit)
+    {
+        bool dio = (irq & dio_mask);
+        irq |= irq_bit;
+        if (!dio && (irq & dio_mask)) host_irq_raise(HOST_IRQ_SX_DIO);
+    }
+
+    void receive(tHostFrame* frame)
+    {
+        if (state != HOST_RADIO_STATE_RX || t_rx_since_us > frame->t_start_us) return;
+        if (frame->freq_hz != freq_hz || frame->key != key) return;
+        if (varlen && frame->len > payload_len) return;
+        if (!varlen && frame->len != payload_len) return;
+
+        memcpy(buf, frame->data, frame->len);
+        rx_len = (varlen) ? frame->len : 0;
+        rssi = frame->rssi;
+        snr = frame->snr;
+        set_state(HOST_RADIO_STATE_FS);
+        raise(HOST_RADIO_IRQ_RX_DONE);
+    }
+};
+
+
+tHostRadio host_radio;
+
+
+//-------------------------------------------------------
+// Ports
+//-------------------------------------------------------
+// the uarts, see host-uart.h
+
+class tHostPort
+{
+  public:
+    virtual char Port(void) = 0;
+    virtual uint64_t NextEvent_us(void) = 0;
+    virtual void Do(void) = 0;
+    virtual void Input(uint64_t t_us, uint8_t* buf, uint16_t len) = 0;
+    virtual void Output(void) = 0; // reports the bytes which went out
+    virtual void Report(void) = 0; // reports the dropped bytes
+};
+
+
+#define HOST_PORTS_NUM  4
+
+tHostPort* host_ports[HOST_PORTS_NUM];
+uint8_t host_ports_num = 0;
+
+
+void host_port_register(tHostPort* port)
+{
+    if (host_ports_num >= HOST_PORTS_NUM) { fprintf(stderr, "host sim: too many ports\n"); exit(1); }
+    host_ports[host_ports_num++] = port;
+}
+
+
+//-------------------------------------------------------
+// Controller
+//-------------------------------------------------------
+
+void host_quit(void)
+{
+    for (uint8_t n = 0; n < host_ports_num; n++) host_ports[n]->Output();
+    for (uint8_t n = 0; n < host_ports_num; n++) host_ports[n]->Report();
+    fflush(stdout);
+    exit(0);
+}
+
+
+void host_frame_input(const char* line)
+{
+tHostFrame frame;
+unsigned long long t_start_us, t_end_us;
+int rssi, snr, n;
+
+    if (sscanf(line, "F %llu %llu %u %u %d %d %n", &t_start_us, &t_end_us, &frame.freq_hz, &frame.key, &rssi, &snr, &n) < 6) return;
+    frame.t_start_us = t_start_us;
+    frame.t_end_us = t_end_us;
+    frame.rssi = rssi;
+    frame.snr = snr;
+    frame.len = host_gethex(line + n, frame.data, sizeof(frame.data));
+    host_radio.Receive(&frame);
+}
+
+
+void host_port_input(const char* line)
+{
+static uint8_t buf[4096];
+unsigned long long t_us;
+char port;
+int n;
+
+    if (sscanf(line, "S %c %llu %n", &port, &t_us, &n) < 2) return;
+    for (uint8_t i = 0; i < host_ports_num; i++) {
+        if (host_ports[i]->Port() != port) continue;
+        const char* s = line + n;
+        while (*s && *s != '\n') {
+            uint16_t len = host_gethex(s, buf, sizeof(buf));
+            if (!len) break;
+            host_ports[i]->Input(t_us, buf, len);
+            s += 2 * len;
+        }
+    }
+}
+
+
+// reports D, and takes the input of the controller until it says how far to run
+void host_sync(void)
+{
+static char* line = NULL;
+static size_t line_size = 0;
+
+    for (uint8_t n = 0; n < host_ports_num; n++) host_ports[n]->Output();
+    printf("D %llu\n", (unsigned long long)host_time_us);
+    fflush(stdout);
+
+    while (getline(&line, &line_size, stdin) > 0) {
+        switch (line[0]) {
+        case 'G': host_run_until_us = strtoull(line + 2, NULL, 10); return;
+        case 'F': host_frame_input(line); break;
+        case 'S': host_port_input(line); break;
+        case 'Q': host_quit(); break;
+        }
+    }
+    host_quit(); // the controller is gone
+}
+
+
+//-------------------------------------------------------
+// Event loop
+//-------------------------------------------------------
+
+void host_do_events(void)
+{
+    host_clock_do();
+    host_radio.Do();
+    for (uint8_t n = 0; n < host_ports_num; n++) host_ports[n]->Do();
+}
+
+
+uint64_t host_next_event_us(void)
+{
+    uint64_t t_us = host_clock_next_us();
+    uint64_t t = host_radio.NextEvent_us();
+    if (t < t_us) t_us = t;
+    for (uint8_t n = 0; n < host_ports_num; n++) {
+        t = host_ports[n]->NextEvent_us();
+        if (t < t_us) t_us = t;
+    }
+    return t_us;
+}
+
+
+// the delays are taken as true time, the crystal error matters only for the clock
+void host_advance_us(uint64_t us)
+{
+    uint64_t t_target_us = host_time_us + us;
+
+    while (1) {
+        host_do_events();
+        if (host_time_us >= host_run_until_us) { host_sync(); continue; }
+        if (host_time_us >= t_target_us) return;
+
+        uint64_t t_next_us = host_next_event_us();
+        if (t_next_us > t_target_us) t_next_us = t_target_us;
+        if (t_next_us > host_run_until_us) t_next_us = host_run_until_us;
+        if (t_next_us <= host_time_us) t_next_us = host_time_us + 1; // play it safe
+        host_time_us = t_next_us;
+    }
+}
+
+
+//-------------------------------------------------------
+// Init
+//-------------------------------------------------------
+
+void host_sim_init(int argc, char** argv)
+{
+    for (int i = 1; i < argc - 1; i += 2) {
+        const char* arg = argv[i];
+        const char* val = argv[i + 1];
+        if (!strcmp(arg, "--bindphrase")) { strncpy(host_setup.BindPhrase, val, 6); host_setup.BindPhrase[6] = '\0'; } else
+        if (!strcmp(arg, "--band")) { host_setup.FrequencyBand = atoi(val); } else
+        if (!strcmp(arg, "--mode")) { host_setup.Mode = atoi(val); } else
+        if (!strcmp(arg, "--ortho")) { host_setup.Ortho = atoi(val); } else
+        if (!strcmp(arg, "--serial-link-mode")) { host_setup.SerialLinkMode = atoi(val); } else
+        if (!strcmp(arg, "--tx-baud")) { host_setup.TxSerialBaudrate = atoi(val); } else
+        if (!strcmp(arg, "--rx-baud")) { host_setup.RxSerialBaudrate = atoi(val); } else
+        if (!strcmp(arg, "--ppm")) { host_setup.ppm = atof(val); } else
+        if (!strcmp(arg, "--loop-us")) { host_setup.loop_us = atoi(val); } else
+        {
+            fprintf(stderr, "host sim: unknown option %s\n", arg);
+            exit(1);
+        }
+    }
+
+    static char stdout_buf[1 << 16];
+    setvbuf(stdout, stdout_buf, _IOFBF, sizeof(stdout_buf));
+
+    host_radio.Init();
+}
+
+
+extern uint8_t connect_state;
+
+// is called after each main loop
+void host_sim_loop_done(void)
+{
+static uint8_t connect_state_last = UINT8_MAX;
+
+    if (connect_state != connect_state_last) {
+        connect_state_last = connect_state;
+        printf("C %llu %u\n", (unsigned long long)host_time_us, connect_state);
+    }
+
+    host_advance_us(host_setup.loop_us);
+}
+
+
+#endif // HOSTLIB_SIM_H
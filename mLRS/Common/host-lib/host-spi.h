@@ -0,0 +1,32 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// Host SPI Interface
+//********************************************************
+// The host chip models, host-sx128x.h and host-sx126x.h, work on the level of the sx commands
+// and not of the spi bytes, so these are just stubs.
+//********************************************************
+#ifndef HOSTLIB_SPI_H
+#define HOSTLIB_SPI_H
+
+
+void spi_select(void) {}
+void spi_deselect(void) {}
+
+void spi_transfer(const uint8_t* dataout, uint8_t* datain, const uint8_t len) {}
+void spi_read(uint8_t* datain, const uint8_t len) {}
+void spi_write(const uint8_t* dataout, uint8_t len) {}
+
+
+//-------------------------------------------------------
+// INIT routines
+//-------------------------------------------------------
+
+void spi_setnop(uint8_t nop) {}
+
+void spi_init(void) {}
+
+
+#endif // HOSTLIB_SPI_H
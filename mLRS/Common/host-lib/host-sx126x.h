@@ -0,0 +1,405 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// Host SX126x
+//********************************************************
+// Model of the SX1262 for the host simulation. It replaces the Sx126xDriverBase class of the
+// sx12xx-lib, so Common/sx-drivers/sx126x_driver.h runs unchanged on top of it. It works on the
+// level of the commands and not of the spi bytes, and hands the frames to host_radio.
+// The time over air is that of the formulas of tools/airtime, which reproduce the TimeOverAir of
+// the configurations.
+// Only the commands and settings the drivers use are covered.
+//********************************************************
+#ifndef HOSTLIB_SX126X_H
+#define HOSTLIB_SX126X_H
+#pragma once
+
+
+//-------------------------------------------------------
+// Defines
+//-------------------------------------------------------
+
+#define SX126X_FREQ_MHZ_TO_REG(f_mhz)  (uint32_t)((double)(f_mhz) * 1.0E6 / ((double)32000000 / (double)(1 << 25)))
+
+typedef enum {
+    SX126X_STDBY_CONFIG_STDBY_RC = 0x00,
+    SX126X_STDBY_CONFIG_STDBY_XOSC = 0x01,
+} SX126X_STDBY_CONFIG_ENUM;
+
+typedef enum {
+    SX126X_PACKET_TYPE_GFSK = 0x00,
+    SX126X_PACKET_TYPE_LORA = 0x01,
+} SX126X_PACKET_TYPE_ENUM;
+
+typedef enum {
+    SX126X_RAMPTIME_10_US = 0x00,
+    SX126X_RAMPTIME_20_US = 0x01,
+    SX126X_RAMPTIME_40_US = 0x02,
+} SX126X_RAMPTIME_ENUM;
+
+typedef enum {
+    SX126X_REGULATOR_MODE_LDO = 0x00,
+    SX126X_REGULATOR_MODE_DCDC = 0x01,
+} SX126X_REGULATOR_MODE_ENUM;
+
+typedef enum {
+    SX126X_IRQ_NONE = 0x0000,
+    SX126X_IRQ_TX_DONE = 0x0001,
+    SX126X_IRQ_RX_DONE = 0x0002,
+    SX126X_IRQ_PREAMBLE_DETECTED = 0x0004,
+    SX126X_IRQ_SYNCWORD_VALID = 0x0008,
+    SX126X_IRQ_HEADER_VALID = 0x0010,
+    SX126X_IRQ_HEADER_ERROR = 0x0020,
+    SX126X_IRQ_CRC_ERROR = 0x0040,
+    SX126X_IRQ_CAD_DONE = 0x0080,
+    SX126X_IRQ_CAD_DETECTED = 0x0100,
+    SX126X_IRQ_RX_TX_TIMEOUT = 0x0200,
+    SX126X_IRQ_ALL = 0x03FF,
+} SX126X_IRQ_ENUM;
+
+typedef enum {
+    SX126X_DIO3_OUTPUT_1_6 = 0x00,
+    SX126X_DIO3_OUTPUT_1_7 = 0x01,
+    SX126X_DIO3_OUTPUT_1_8 = 0x02,
+    SX126X_DIO3_OUTPUT_2_2 = 0x03,
+    SX126X_DIO3_OUTPUT_2_4 = 0x04,
+    SX126X_DIO3_OUTPUT_2_7 = 0x05,
+    SX126X_DIO3_OUTPUT_3_0 = 0x06,
+    SX126X_DIO3_OUTPUT_3_3 = 0x07,
+} SX126X_DIO3_OUTPUT_ENUM;
+
+typedef enum {
+    SX126X_CAL_IMG_430_MHZ_1 = 0x6B,
+    SX126X_CAL_IMG_430_MHZ_2 = 0x6F,
+    SX126X_CAL_IMG_863_MHZ_1 = 0xD7,
+    SX126X_CAL_IMG_863_MHZ_2 = 0xDB,
+    SX126X_CAL_IMG_902_MHZ_1 = 0xE1,
+    SX126X_CAL_IMG_902_MHZ_2 = 0xE9,
+} SX126X_CAL_IMG_ENUM;
+
+#define SX126X_DIO2_AS_RF_SWITCH              0x01
+#define SX126X_REG_TX_CLAMP_CONFIG            0x08D8
+#define SX126X_OCP_CONFIGURATION_140_MA       0x38
+#define SX126X_RX_GAIN_BOOSTED_GAIN           0x96
+
+// LoRa
+
+typedef enum {
+    SX126X_LORA_SF5 = 0x05,
+    SX126X_LORA_SF6 = 0x06,
+    SX126X_LORA_SF7 = 0x07,
+    SX126X_LORA_SF8 = 0x08,
+    SX126X_LORA_SF9 = 0x09,
+    SX126X_LORA_SF10 = 0x0A,
+    SX126X_LORA_SF11 = 0x0B,
+    SX126X_LORA_SF12 = 0x0C,
+} SX126X_LORA_SF_ENUM;
+
+typedef enum {
+    SX126X_LORA_BW_125 = 0x04,
+    SX126X_LORA_BW_250 = 0x05,
+    SX126X_LORA_BW_500 = 0x06,
+} SX126X_LORA_BW_ENUM;
+
+typedef enum {
+    SX126X_LORA_CR_4_5 = 0x01,
+    SX126X_LORA_CR_4_6 = 0x02,
+    SX126X_LORA_CR_4_7 = 0x03,
+    SX126X_LORA_CR_4_8 = 0x04,
+} SX126X_LORA_CR_ENUM;
+
+typedef enum {
+    SX126X_LORA_HEADER_ENABLE = 0x00, // variable length, explicit header
+    SX126X_LORA_HEADER_DISABLE = 0x01, // fixed length, implicit header
+} SX126X_LORA_HEADER_ENUM;
+
+typedef enum {
+    SX126X_LORA_CRC_DISABLE = 0x00,
+    SX126X_LORA_CRC_ENABLE = 0x01,
+} SX126X_LORA_CRC_ENUM;
+
+typedef enum {
+    SX126X_LORA_IQ_NORMAL = 0x00,
+    SX126X_LORA_IQ_INVERTED = 0x01,
+} SX126X_LORA_IQ_ENUM;
+
+// GFSK
+
+typedef enum {
+    SX126X_GFSK_PULSESHAPE_OFF = 0x00,
+    SX126X_GFSK_PULSESHAPE_BT_03 = 0x08,
+    SX126X_GFSK_PULSESHAPE_BT_05 = 0x09,
+    SX126X_GFSK_PULSESHAPE_BT_07 = 0x0A,
+    SX126X_GFSK_PULSESHAPE_BT_1 = 0x0B,
+} SX126X_GFSK_PULSESHAPE_ENUM;
+
+typedef enum {
+    SX126X_GFSK_BW_234300 = 0x0A,
+    SX126X_GFSK_BW_312000 = 0x19,
+    SX126X_GFSK_BW_373600 = 0x11,
+    SX126X_GFSK_BW_467000 = 0x09,
+} SX126X_GFSK_BW_ENUM;
+
+typedef enum {
+    SX126X_GFSK_PREAMBLE_DETECTOR_OFF = 0x00,
+    SX126X_GFSK_PREAMBLE_DETECTOR_LENGTH_8BITS = 0x04,
+    SX126X_GFSK_PREAMBLE_DETECTOR_LENGTH_16BITS = 0x05,
+} SX126X_GFSK_PREAMBLE_DETECTOR_ENUM;
+
+typedef enum {
+    SX126X_GFSK_ADDRESS_FILTERING_DISABLE = 0x00,
+} SX126X_GFSK_ADDRESS_FILTERING_ENUM;
+
+typedef enum {
+    SX126X_GFSK_PKT_FIX_LEN = 0x00,
+    SX126X_GFSK_PKT_VAR_LEN = 0x01,
+} SX126X_GFSK_PKT_ENUM;
+
+typedef enum {
+    SX126X_GFSK_CRC_OFF = 0x01,
+    SX126X_GFSK_CRC_1_BYTE = 0x00,
+    SX126X_GFSK_CRC_2_BYTE = 0x02,
+} SX126X_GFSK_CRC_ENUM;
+
+typedef enum {
+    SX126X_GFSK_WHITENING_DISABLE = 0x00,
+    SX126X_GFSK_WHITENING_ENABLE = 0x01,
+} SX126X_GFSK_WHITENING_ENUM;
+
+// power
+
+#define SX126X_POWER_MIN          -9 // dBm
+#define SX126X_POWER_MAX          22 // dBm
+
+
+//-------------------------------------------------------
+// SX126x Driver Base
+//-------------------------------------------------------
+// the chip model is needed only in the translation unit of the main loop, which has host-sim.h,
+// the other translation units only get the defines
+#ifdef HOSTLIB_SIM_H
+
+class Sx126xDriverBase
+{
+  public:
+    Sx126xDriverBase() {}
+
+    // the derived drivers fill these in, the model does not need them
+    virtual void WaitOnBusy(void) {}
+    virtual void SpiSelect(void) {}
+    virtual void SpiDeselect(void) {}
+    virtual void SpiTransfer(uint8_t* dataout, uint8_t* datain, uint8_t len) {}
+    virtual void SpiRead(uint8_t* datain, uint8_t len) {}
+    virtual void SpiWrite(uint8_t* dataout, uint8_t len) {}
+
+    //-- chip commands
+
+    uint16_t GetFirmwareRev(void) { return 0x1262; }
+
+    void SetStandby(uint8_t StandbyConfig) { host_radio.SetStandby(); }
+    void SetFs(void) { host_radio.SetFs(); }
+    void SetRegulatorMode(uint8_t RegulatorMode) {}
+    void SetAutoFs(bool flag) {} // the model always falls back to FS
+    void SetTxParams(uint8_t Power, uint8_t RampTime) {}
+    void SetBufferBaseAddress(uint8_t txBaseAddress, uint8_t rxBaseAddress) {}
+    void ClearDeviceError(void) {}
+    void SetDio3AsTcxoControl(uint8_t OutputVoltage, uint32_t delay_us) {}
+    void CalibrateImage(uint8_t f1, uint8_t f2) {}
+    void SetRxGain(uint8_t RxGain) {}
+    void SetOverCurrentProtection(uint8_t OverCurrentProtection) {}
+    void SetPaConfig_22dbm(void) {}
+    void SetSymbNumTimeout(uint8_t SymbNum) {}
+
+    uint8_t ReadRegister(uint16_t address) { return 0; }
+    void WriteRegister(uint16_t address, uint8_t data) {}
+
+    void SetPacketType(uint8_t PacketType)
+    {
+        packet_type = PacketType;
+        update();
+    }
+
+    void SetRfFrequency(uint32_t RfFrequency)
+    {
+        host_radio.SetFrequency((uint32_t)(((uint64_t)RfFrequency * 32000000 + (1 << 24)) >> 25));
+    }
+
+    void SetModulationParams(uint8_t SpreadingFactor, uint8_t Bandwidth, uint8_t CodingRate)
+    {
+        sf = SpreadingFactor;
+        bw = Bandwidth;
+        cr = CodingRate;
+        update();
+    }
+
+    void SetPacketParams(uint16_t PreambleLength, uint8_t HeaderType, uint8_t PayloadLength, uint8_t Crc, uint8_t InvertIQ)
+    {
+        preamble = PreambleLength;
+        varlen = (HeaderType == SX126X_LORA_HEADER_ENABLE);
+        payload_len = PayloadLength;
+        iq = InvertIQ;
+        update();
+    }
+
+    void SetModulationParamsGFSK(uint32_t br_bps, uint8_t PulseShape, uint8_t Bandwidth, uint32_t Fdev_hz)
+    {
+        gfsk_br_bps = br_bps;
+        bw = Bandwidth;
+        gfsk_fdev_hz = Fdev_hz;
+        update();
+    }
+
+    void SetPacketParamsGFSK(uint16_t PreambleLength, uint8_t PreambleDetectorLength, uint8_t SyncWordLength,
+                             uint8_t AddrComp, uint8_t PacketType, uint8_t PayloadLength, uint8_t CRCType, uint8_t Whitening)
+    {
+        preamble = PreambleLength; // in bits
+        syncword_bits = SyncWordLength;
+        varlen = (PacketType == SX126X_GFSK_PKT_VAR_LEN);
+        payload_len = PayloadLength;
+        update();
+    }
+
+    void SetSyncWordGFSK(uint16_t SyncWord)
+    {
+        gfsk_sync_word = SyncWord;
+        update();
+    }
+
+    void SetDioIrqParams(uint16_t IrqMask, uint16_t Dio1Mask, uint16_t Dio2Mask, uint16_t Dio3Mask)
+    {
+        host_radio.SetDioMask(to_host_irq(IrqMask & Dio1Mask));
+    }
+
+    uint16_t GetIrqStatus(void)
+    {
+        return from_host_irq(host_radio.GetIrq());
+    }
+
+    void ClearIrqStatus(uint16_t IrqMask)
+    {
+        host_radio.ClearIrq(to_host_irq(IrqMask));
+    }
+
+    uint16_t GetAndClearIrqStatus(uint16_t IrqMask)
+    {
+        uint16_t irq_status = GetIrqStatus();
+        ClearIrqStatus(IrqMask);
+        return irq_status;
+    }
+
+    // tmo is in units of 15.625 us
+    void SetTx(uint32_t tmo)
+    {
+        host_radio.SetTx(toa_us(payload_len), ((uint64_t)tmo * 15625) / 1000);
+    }
+
+    void SetRx(uint32_t tmo)
+    {
+        host_radio.SetRx(((uint64_t)tmo * 15625) / 1000);
+    }
+
+    void WriteBuffer(uint8_t offset, uint8_t* data, uint8_t len)
+    {
+        memcpy(host_radio.buf + offset, data, len);
+    }
+
+    void ReadBuffer(uint8_t offset, uint8_t* data, uint8_t len)
+    {
+        memcpy(data, host_radio.buf + offset, len);
+    }
+
+    void GetRxBufferStatus(uint8_t* rxPayloadLength, uint8_t* rxStartBufferPointer)
+    {
+        *rxPayloadLength = host_radio.rx_len;
+        *rxStartBufferPointer = 0;
+    }
+
+    void GetPacketStatus(int16_t* RssiSync, int8_t* Snr)
+    {
+        *RssiSync = host_radio.rssi;
+        *Snr = host_radio.snr;
+    }
+
+    void GetPacketStatusGFSK(int16_t* RssiSync)
+    {
+        *RssiSync = host_radio.rssi;
+    }
+
+  private:
+    uint8_t packet_type;
+    uint8_t sf;
+    uint8_t bw;
+    uint8_t cr;
+    uint16_t preamble; // LoRa in symbols, GFSK in bits
+    uint8_t syncword_bits;
+    uint8_t iq;
+    bool varlen;
+    uint8_t payload_len;
+    uint32_t gfsk_br_bps;
+    uint32_t gfsk_fdev_hz;
+    uint16_t gfsk_sync_word = 0;
+
+    // frames are received only with the same packet type, modulation, length format and sync word
+    void update(void)
+    {
+        uint32_t key = host_hash(HOST_HASH_INIT, 0x1262);
+        key = host_hash(key, packet_type);
+        key = host_hash(key, bw);
+        key = host_hash(key, varlen);
+        if (packet_type == SX126X_PACKET_TYPE_LORA) {
+            key = host_hash(key, sf);
+            key = host_hash(key, cr);
+            key = host_hash(key, iq);
+        } else {
+            key = host_hash(key, gfsk_br_bps);
+            key = host_hash(key, gfsk_fdev_hz);
+            key = host_hash(key, gfsk_sync_word);
+        }
+        host_radio.SetKey(key);
+        host_radio.SetPayloadLength(payload_len, varlen);
+    }
+
+    uint16_t to_host_irq(uint16_t irq)
+    {
+        return ((irq & SX126X_IRQ_TX_DONE) ? HOST_RADIO_IRQ_TX_DONE : 0) |
+               ((irq & SX126X_IRQ_RX_DONE) ? HOST_RADIO_IRQ_RX_DONE : 0) |
+               ((irq & SX126X_IRQ_RX_TX_TIMEOUT) ? HOST_RADIO_IRQ_TIMEOUT : 0);
+    }
+
+    uint16_t from_host_irq(uint16_t irq)
+    {
+        return ((irq & HOST_RADIO_IRQ_TX_DONE) ? SX126X_IRQ_TX_DONE : 0) |
+               ((irq & HOST_RADIO_IRQ_RX_DONE) ? SX126X_IRQ_RX_DONE : 0) |
+               ((irq & HOST_RADIO_IRQ_TIMEOUT) ? SX126X_IRQ_RX_TX_TIMEOUT : 0);
+    }
+
+    // see tools/airtime
+    uint32_t toa_us(uint8_t len)
+    {
+        double toa;
+        if (packet_type == SX126X_PACKET_TYPE_GFSK) {
+            toa = (preamble + syncword_bits + (varlen ? 8 : 0) + 8.0 * len) * 1.0E6 / gfsk_br_bps;
+        } else {
+            uint32_t bw_hz = (bw == SX126X_LORA_BW_125) ? 125000 : (bw == SX126X_LORA_BW_250) ? 250000 : 500000;
+            int32_t bits = 8 * (int32_t)len - 4 * sf + (varlen ? 20 : 0);
+            double n_pre;
+            if (sf <= 6) {
+                n_pre = preamble + 6.25 + 8;
+            } else {
+                n_pre = preamble + 4.25 + 8;
+                bits += 8;
+            }
+            if (bits < 0) bits = 0;
+            int32_t blocks = (bits + 4 * sf - 1) / (4 * sf);
+            toa = (n_pre + blocks * (cr + 4)) * (double)(1 << sf) * 1.0E6 / bw_hz;
+        }
+        return (uint32_t)lround(toa);
+    }
+};
+
+#endif // HOSTLIB_SIM_H
+
+
+#endif // HOSTLIB_SX126X_H
@@ -0,0 +1,460 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// Host SX128x
+//********************************************************
+// Model of the SX1280 for the host simulation. It replaces the Sx128xDriverBase class of the
+// sx12xx-lib, so Common/sx-drivers/sx128x_driver.h runs unchanged on top of it. It works on the
+// level of the commands and not of the spi bytes, and hands the frames to host_radio.
+// The time over air is that of the formulas of tools/airtime, scaled to the TimeOverAir of the
+// configurations as there.
+// Only the commands and settings the drivers use are covered.
+//********************************************************
+#ifndef HOSTLIB_SX128X_H
+#define HOSTLIB_SX128X_H
+#pragma once
+
+
+//-------------------------------------------------------
+// Defines
+//-------------------------------------------------------
+
+#define SX1280_FREQ_GHZ_TO_REG(f_ghz)  (uint32_t)((double)(f_ghz) * 1.0E9 / ((double)52000000 / (double)(1 << 18)))
+
+typedef enum {
+    SX1280_STDBY_CONFIG_STDBY_RC = 0x00,
+    SX1280_STDBY_CONFIG_STDBY_XOSC = 0x01,
+} SX1280_STDBY_CONFIG_ENUM;
+
+typedef enum {
+    SX1280_PACKET_TYPE_GFSK = 0x00,
+    SX1280_PACKET_TYPE_LORA = 0x01,
+    SX1280_PACKET_TYPE_RANGING = 0x02,
+    SX1280_PACKET_TYPE_FLRC = 0x03,
+    SX1280_PACKET_TYPE_BLE = 0x04,
+} SX1280_PACKET_TYPE_ENUM;
+
+typedef enum {
+    SX1280_PERIODBASE_15p625_US = 0x00,
+    SX1280_PERIODBASE_62p5_US = 0x01,
+    SX1280_PERIODBASE_1_MS = 0x02,
+    SX1280_PERIODBASE_4_MS = 0x03,
+} SX1280_PERIODBASE_ENUM;
+
+typedef enum {
+    SX1280_RAMPTIME_02_US = 0x00,
+    SX1280_RAMPTIME_04_US = 0x20,
+    SX1280_RAMPTIME_20_US = 0xE0,
+} SX1280_RAMPTIME_ENUM;
+
+typedef enum {
+    SX1280_LNAGAIN_MODE_LOW_POWER = 0x00,
+    SX1280_LNAGAIN_MODE_HIGH_SENSITIVITY = 0x01,
+} SX1280_LNAGAIN_MODE_ENUM;
+
+typedef enum {
+    SX1280_REGULATOR_MODE_LDO = 0x00,
+    SX1280_REGULATOR_MODE_DCDC = 0x01,
+} SX1280_REGULATOR_MODE_ENUM;
+
+typedef enum {
+    SX1280_IRQ_NONE = 0x0000,
+    SX1280_IRQ_TX_DONE = 0x0001,
+    SX1280_IRQ_RX_DONE = 0x0002,
+    SX1280_IRQ_SYNCWORD_VALID = 0x0004,
+    SX1280_IRQ_SYNCWORD_ERROR = 0x0008,
+    SX1280_IRQ_HEADER_VALID = 0x0010,
+    SX1280_IRQ_HEADER_ERROR = 0x0020,
+    SX1280_IRQ_CRC_ERROR = 0x0040,
+    SX1280_IRQ_RX_TX_TIMEOUT = 0x4000,
+    SX1280_IRQ_ALL = 0xFFFF,
+} SX1280_IRQ_ENUM;
+
+// LoRa
+
+typedef enum {
+    SX1280_LORA_SF5 = 0x50,
+    SX1280_LORA_SF6 = 0x60,
+    SX1280_LORA_SF7 = 0x70,
+    SX1280_LORA_SF8 = 0x80,
+    SX1280_LORA_SF9 = 0x90,
+    SX1280_LORA_SF10 = 0xA0,
+    SX1280_LORA_SF11 = 0xB0,
+    SX1280_LORA_SF12 = 0xC0,
+} SX1280_LORA_SF_ENUM;
+
+typedef enum {
+    SX1280_LORA_BW_200 = 0x34,
+    SX1280_LORA_BW_400 = 0x26,
+    SX1280_LORA_BW_800 = 0x18,
+    SX1280_LORA_BW_1600 = 0x0A,
+} SX1280_LORA_BW_ENUM;
+
+typedef enum {
+    SX1280_LORA_CR_4_5 = 0x01,
+    SX1280_LORA_CR_4_6 = 0x02,
+    SX1280_LORA_CR_4_7 = 0x03,
+    SX1280_LORA_CR_4_8 = 0x04,
+    SX1280_LORA_CR_LI_4_5 = 0x05,
+    SX1280_LORA_CR_LI_4_6 = 0x06,
+    SX1280_LORA_CR_LI_4_8 = 0x07,
+} SX1280_LORA_CR_ENUM;
+
+typedef enum {
+    SX1280_LORA_HEADER_ENABLE = 0x00, // variable length, explicit header
+    SX1280_LORA_HEADER_DISABLE = 0x80, // fixed length, implicit header
+} SX1280_LORA_HEADER_ENUM;
+
+typedef enum {
+    SX1280_LORA_CRC_DISABLE = 0x00,
+    SX1280_LORA_CRC_ENABLE = 0x20,
+} SX1280_LORA_CRC_ENUM;
+
+typedef enum {
+    SX1280_LORA_IQ_NORMAL = 0x40,
+    SX1280_LORA_IQ_INVERTED = 0x00,
+} SX1280_LORA_IQ_ENUM;
+
+// FLRC
+
+typedef enum {
+    SX1280_FLRC_BR_1_300_BW_1_2 = 0x45,
+    SX1280_FLRC_BR_1_000_BW_1_2 = 0x69,
+    SX1280_FLRC_BR_0_650_BW_0_6 = 0x86,
+    SX1280_FLRC_BR_0_520_BW_0_6 = 0xAA,
+    SX1280_FLRC_BR_0_325_BW_0_3 = 0xC7,
+    SX1280_FLRC_BR_0_260_BW_0_3 = 0xEB,
+} SX1280_FLRC_BR_ENUM;
+
+typedef enum {
+    SX1280_FLRC_CR_1_2 = 0x00,
+    SX1280_FLRC_CR_3_4 = 0x02,
+    SX1280_FLRC_CR_1_0 = 0x04,
+} SX1280_FLRC_CR_ENUM;
+
+typedef enum {
+    SX1280_FLRC_BT_DIS = 0x00,
+    SX1280_FLRC_BT_1 = 0x10,
+    SX1280_FLRC_BT_0_5 = 0x20,
+} SX1280_FLRC_BT_ENUM;
+
+typedef enum {
+    SX1280_FLRC_PREAMBLE_LENGTH_8_BITS = 0x10,
+    SX1280_FLRC_PREAMBLE_LENGTH_12_BITS = 0x20,
+    SX1280_FLRC_PREAMBLE_LENGTH_16_BITS = 0x30,
+    SX1280_FLRC_PREAMBLE_LENGTH_20_BITS = 0x40,
+    SX1280_FLRC_PREAMBLE_LENGTH_24_BITS = 0x50,
+    SX1280_FLRC_PREAMBLE_LENGTH_28_BITS = 0x60,
+    SX1280_FLRC_PREAMBLE_LENGTH_32_BITS = 0x70,
+} SX1280_FLRC_PREAMBLE_LENGTH_ENUM;
+
+typedef enum {
+    SX1280_FLRC_SYNCWORD_LEN_NONE = 0x00,
+    SX1280_FLRC_SYNCWORD_LEN_P32S = 0x04,
+} SX1280_FLRC_SYNCWORD_LEN_ENUM;
+
+typedef enum {
+    SX1280_FLRC_SYNCWORD_MATCH_DISABLE = 0x00,
+    SX1280_FLRC_SYNCWORD_MATCH_1 = 0x10,
+} SX1280_FLRC_SYNCWORD_MATCH_ENUM;
+
+typedef enum {
+    SX1280_FLRC_PACKET_TYPE_FIXED_LENGTH = 0x00,
+    SX1280_FLRC_PACKET_TYPE_VARIABLE_LENGTH = 0x20,
+} SX1280_FLRC_PACKET_TYPE_ENUM;
+
+typedef enum {
+    SX1280_FLRC_CRC_DISABLE = 0x00,
+    SX1280_FLRC_CRC_1_BYTE = 0x10,
+    SX1280_FLRC_CRC_2_BYTE = 0x20,
+    SX1280_FLRC_CRC_3_BYTE = 0x30,
+} SX1280_FLRC_CRC_ENUM;
+
+// power
+
+#define SX1280_POWER_MIN          0 // -18 dBm
+#define SX1280_POWER_MAX          31 // 13 dBm
+
+#define SX1280_POWER_m18_DBM      0
+#define SX1280_POWER_0_DBM        18
+#define SX1280_POWER_3_DBM        21
+#define SX1280_POWER_6_DBM        24
+#define SX1280_POWER_10_DBM       28
+#define SX1280_POWER_12p5_DBM     31
+
+
+//-------------------------------------------------------
+// Time over air
+//-------------------------------------------------------
+
+// copies of the TimeOverAir of the configurations, to which the formulas are scaled
+typedef struct {
+    uint8_t PacketType;
+    uint8_t SpreadingFactor;
+    uint32_t TimeOverAir;
+} tHostSx128xToa;
+
+const tHostSx128xToa host_sx128x_toa_list[] = {
+    { SX1280_PACKET_TYPE_LORA, SX1280_LORA_SF5, 7892 },
+    { SX1280_PACKET_TYPE_LORA, SX1280_LORA_SF6, 13418 },
+    { SX1280_PACKET_TYPE_LORA, SX1280_LORA_SF7, 23527 },
+    { SX1280_PACKET_TYPE_FLRC, 0, 2383 },
+};
+
+
+//-------------------------------------------------------
+// SX128x Driver Base
+//-------------------------------------------------------
+// the chip model is needed only in the translation unit of the main loop, which has host-sim.h,
+// the other translation units only get the defines
+#ifdef HOSTLIB_SIM_H
+
+class Sx128xDriverBase
+{
+  public:
+    Sx128xDriverBase() {}
+
+    // the derived drivers fill these in, the model does not need them
+    virtual void WaitOnBusy(void) {}
+    virtual void SpiSelect(void) {}
+    virtual void SpiDeselect(void) {}
+    virtual void SpiTransfer(uint8_t* dataout, uint8_t* datain, uint8_t len) {}
+    virtual void SpiRead(uint8_t* datain, uint8_t len) {}
+    virtual void SpiWrite(uint8_t* dataout, uint8_t len) {}
+
+    //-- chip commands
+
+    uint16_t GetFirmwareRev(void) { return 0xA9B5; }
+
+    void SetStandby(uint8_t StandbyConfig) { host_radio.SetStandby(); }
+    void SetFs(void) { host_radio.SetFs(); }
+    void SetRegulatorMode(uint8_t RegulatorMode) {}
+    void SetAutoFs(bool flag) {} // the model always falls back to FS
+    void SetLnaGainMode(uint8_t LnaGainMode) {}
+    void SetTxParams(uint8_t Power, uint8_t RampTime) {}
+    void SetBufferBaseAddress(uint8_t txBaseAddress, uint8_t rxBaseAddress) {}
+
+    void SetPacketType(uint8_t PacketType)
+    {
+        packet_type = PacketType;
+        update();
+    }
+
+    void SetRfFrequency(uint32_t RfFrequency)
+    {
+        host_radio.SetFrequency((uint32_t)(((uint64_t)RfFrequency * 52000000 + (1 << 17)) >> 18));
+    }
+
+    void SetModulationParams(uint8_t SpreadingFactor, uint8_t Bandwidth, uint8_t CodingRate)
+    {
+        sf = SpreadingFactor;
+        bw = Bandwidth;
+        cr = CodingRate;
+        update();
+    }
+
+    void SetPacketParams(uint8_t PreambleLength, uint8_t HeaderType, uint8_t PayloadLength, uint8_t Crc, uint8_t InvertIQ)
+    {
+        preamble = PreambleLength;
+        varlen = (HeaderType == SX1280_LORA_HEADER_ENABLE);
+        payload_len = PayloadLength;
+        iq = InvertIQ;
+        update();
+    }
+
+    void SetSyncWord(uint8_t SyncWord)
+    {
+        lora_sync_word = SyncWord;
+        update();
+    }
+
+    void SetModulationParamsFLRC(uint8_t Bandwidth, uint8_t CodingRate, uint8_t Bt)
+    {
+        bw = Bandwidth;
+        cr = CodingRate;
+        update();
+    }
+
+    void SetPacketParamsFLRC(uint8_t AGCPreambleLength, uint8_t SyncWordLength, uint8_t SyncWordMatch,
+                             uint8_t PacketType, uint8_t PayloadLength, uint8_t CrcLength, uint16_t CrcSeed)
+    {
+        preamble = ((AGCPreambleLength >> 4) + 1) * 4; // in bits
+        syncword_bits = (SyncWordLength == SX1280_FLRC_SYNCWORD_LEN_P32S) ? 32 : 0;
+        varlen = (PacketType == SX1280_FLRC_PACKET_TYPE_VARIABLE_LENGTH);
+        payload_len = PayloadLength;
+        update();
+    }
+
+    void SetSyncWordFLRC(uint32_t SyncWord, uint8_t CodingRate)
+    {
+        flrc_sync_word = SyncWord;
+        update();
+    }
+
+    void SetDioIrqParams(uint16_t IrqMask, uint16_t Dio1Mask, uint16_t Dio2Mask, uint16_t Dio3Mask)
+    {
+        host_radio.SetDioMask(to_host_irq(IrqMask & Dio1Mask));
+    }
+
+    uint16_t GetIrqStatus(void)
+    {
+        return from_host_irq(host_radio.GetIrq());
+    }
+
+    void ClearIrqStatus(uint16_t IrqMask)
+    {
+        host_radio.ClearIrq(to_host_irq(IrqMask));
+    }
+
+    uint16_t GetAndClearIrqStatus(uint16_t IrqMask)
+    {
+        uint16_t irq_status = GetIrqStatus();
+        ClearIrqStatus(IrqMask);
+        return irq_status;
+    }
+
+    void SetTx(uint8_t PeriodBase, uint16_t PeriodBaseCount)
+    {
+        host_radio.SetTx(toa_us(payload_len), tmo_us(PeriodBase, PeriodBaseCount));
+    }
+
+    void SetRx(uint8_t PeriodBase, uint16_t PeriodBaseCount)
+    {
+        host_radio.SetRx(tmo_us(PeriodBase, PeriodBaseCount));
+    }
+
+    void WriteBuffer(uint8_t offset, uint8_t* data, uint8_t len)
+    {
+        memcpy(host_radio.buf + offset, data, len);
+    }
+
+    void ReadBuffer(uint8_t offset, uint8_t* data, uint8_t len)
+    {
+        memcpy(data, host_radio.buf + offset, len);
+    }
+
+    void GetRxBufferStatus(uint8_t* rxPayloadLength, uint8_t* rxStartBufferPointer)
+    {
+        *rxPayloadLength = host_radio.rx_len;
+        *rxStartBufferPointer = 0;
+    }
+
+    void GetPacketStatus(int16_t* RssiSync, int8_t* Snr)
+    {
+        *RssiSync = host_radio.rssi;
+        *Snr = host_radio.snr;
+    }
+
+    void GetPacketStatusFLRC(int16_t* RssiSync)
+    {
+        *RssiSync = host_radio.rssi;
+    }
+
+  private:
+    uint8_t packet_type;
+    uint8_t sf;
+    uint8_t bw;
+    uint8_t cr;
+    uint8_t preamble; // LoRa in symbols, FLRC in bits
+    uint8_t syncword_bits;
+    uint8_t iq;
+    bool varlen;
+    uint8_t payload_len;
+    uint8_t lora_sync_word = 0x12;
+    uint32_t flrc_sync_word = 0;
+
+    // frames are received only with the same packet type, modulation, length format and sync word
+    void update(void)
+    {
+        uint32_t key = host_hash(HOST_HASH_INIT, 0x1280);
+        key = host_hash(key, packet_type);
+        key = host_hash(key, bw);
+        key = host_hash(key, cr);
+        key = host_hash(key, varlen);
+        if (packet_type == SX1280_PACKET_TYPE_LORA) {
+            key = host_hash(key, sf);
+            key = host_hash(key, iq);
+            key = host_hash(key, lora_sync_word);
+        } else {
+            key = host_hash(key, flrc_sync_word);
+        }
+        host_radio.SetKey(key);
+        host_radio.SetPayloadLength(payload_len, varlen);
+    }
+
+    uint16_t to_host_irq(uint16_t irq)
+    {
+        return ((irq & SX1280_IRQ_TX_DONE) ? HOST_RADIO_IRQ_TX_DONE : 0) |
+               ((irq & SX1280_IRQ_RX_DONE) ? HOST_RADIO_IRQ_RX_DONE : 0) |
+               ((irq & SX1280_IRQ_RX_TX_TIMEOUT) ? HOST_RADIO_IRQ_TIMEOUT : 0);
+    }
+
+    uint16_t from_host_irq(uint16_t irq)
+    {
+        return ((irq & HOST_RADIO_IRQ_TX_DONE) ? SX1280_IRQ_TX_DONE : 0) |
+               ((irq & HOST_RADIO_IRQ_RX_DONE) ? SX1280_IRQ_RX_DONE : 0) |
+               ((irq & HOST_RADIO_IRQ_TIMEOUT) ? SX1280_IRQ_RX_TX_TIMEOUT : 0);
+    }
+
+    uint32_t tmo_us(uint8_t PeriodBase, uint16_t PeriodBaseCount)
+    {
+        const uint32_t periodbase_ns[4] = { 15625, 62500, 1000000, 4000000 };
+        return ((uint64_t)PeriodBaseCount * periodbase_ns[PeriodBase & 0x03]) / 1000;
+    }
+
+    // see tools/airtime, the long interleaving coding rates are taken as the normal rates
+    double toa_formula_us(uint8_t len, bool _varlen)
+    {
+        if (packet_type == SX1280_PACKET_TYPE_FLRC) {
+            uint32_t br_bps = 650000;
+            switch (bw) {
+                case SX1280_FLRC_BR_1_300_BW_1_2: br_bps = 1300000; break;
+                case SX1280_FLRC_BR_1_000_BW_1_2: br_bps = 1000000; break;
+                case SX1280_FLRC_BR_0_520_BW_0_6: br_bps = 520000; break;
+                case SX1280_FLRC_BR_0_325_BW_0_3: br_bps = 325000; break;
+                case SX1280_FLRC_BR_0_260_BW_0_3: br_bps = 260000; break;
+            }
+            return (preamble + syncword_bits + (_varlen ? 16 : 0) + 2.0 * (8.0 * len + 6)) * 1.0E6 / br_bps;
+        }
+
+        uint8_t SF = sf >> 4;
+        uint32_t bw_hz = 812500;
+        switch (bw) {
+            case SX1280_LORA_BW_200: bw_hz = 203125; break;
+            case SX1280_LORA_BW_400: bw_hz = 406250; break;
+            case SX1280_LORA_BW_1600: bw_hz = 1625000; break;
+        }
+        uint8_t CR = (cr == SX1280_LORA_CR_LI_4_8) ? 4 : (cr == SX1280_LORA_CR_LI_4_6) ? 2 : (cr & 0x03) ? (cr & 0x03) : 4;
+        int32_t bits = 8 * (int32_t)len - 4 * SF + (_varlen ? 20 : 0);
+        double n_pre;
+        if (SF <= 6) {
+            n_pre = preamble + 6.25 + 8;
+        } else {
+            n_pre = preamble + 4.25 + 8;
+            bits += 8;
+        }
+        if (bits < 0) bits = 0;
+        int32_t blocks = (bits + 4 * SF - 1) / (4 * SF);
+        return (n_pre + blocks * (CR + 4)) * (double)(1 << SF) * 1.0E6 / bw_hz;
+    }
+
+    uint32_t toa_us(uint8_t len)
+    {
+        double toa = toa_formula_us(len, varlen);
+        for (uint8_t i = 0; i < sizeof(host_sx128x_toa_list)/sizeof(host_sx128x_toa_list[0]); i++) {
+            const tHostSx128xToa* t = &host_sx128x_toa_list[i];
+            if (t->PacketType != packet_type) continue;
+            if (packet_type == SX1280_PACKET_TYPE_LORA && t->SpreadingFactor != sf) continue;
+            toa *= t->TimeOverAir / toa_formula_us(FRAME_TX_RX_LEN, false);
+            break;
+        }
+        return (uint32_t)lround(toa);
+    }
+};
+
+#endif // HOSTLIB_SIM_H
+
+
+#endif // HOSTLIB_SX128X_H
@@ -0,0 +1,198 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// Host UART
+//********************************************************
+// The uarts of the host simulation. The bytes go in and out at the baudrate, with 10 bits per
+// byte. Bytes which don't fit into the fifos are dropped and counted.
+// host-uartb.h, host-uartc.h give the uartx_xxx() functions of the firmware.
+//********************************************************
+#ifndef HOSTLIB_UART_H
+#define HOSTLIB_UART_H
+
+
+#include <deque>
+
+
+//-------------------------------------------------------
+// Enums
+//-------------------------------------------------------
+#ifndef HOSTLIB_UART_ENUMS
+#define HOSTLIB_UART_ENUMS
+
+typedef enum {
+    XUART_PARITY_NO = 0,
+    XUART_PARITY_EVEN,
+    XUART_PARITY_ODD,
+} UARTPARITYENUM;
+
+typedef enum {
+    UART_STOPBIT_1 = 0,
+    UART_STOPBIT_2,
+} UARTSTOPBITENUM;
+
+#endif
+
+
+//-------------------------------------------------------
+// UART class
+//-------------------------------------------------------
+
+typedef struct
+{
+    uint64_t t_us; // when the byte is received
+    uint8_t c;
+} tHostUartByte;
+
+
+class tHostUart : public tHostPort
+{
+  public:
+    tHostUart(char _port, uint16_t _txbufsize, uint16_t _rxbufsize)
+    {
+        port = _port;
+        txbufsize = _txbufsize;
+        rxbufsize = _rxbufsize;
+        baud = 0;
+        rx_dropped = tx_dropped = 0;
+        host_port_register(this);
+    }
+
+    void Init(uint32_t _baud)
+    {
+        SetBaudrate(_baud);
+        tx_flush();
+        rx_flush();
+    }
+
+    void SetBaudrate(uint32_t _baud)
+    {
+        baud = _baud;
+        tx_frac = rx_frac = 0;
+    }
+
+    //-- firmware side
+
+    void putbuf(uint8_t* buf, uint16_t len)
+    {
+        for (uint16_t i = 0; i < len; i++) {
+            if (tx_fifo.size() >= txbufsize) { tx_dropped++; continue; }
+            if (tx_fifo.empty()) { // line was idle
+                if (!out.empty() && host_time_us > tx_t_us) Output();
+                tx_frac = 0;
+                tx_t_us = next_byte_us(host_time_us, &tx_frac);
+            }
+            tx_fifo.push_back(buf[i]);
+        }
+    }
+
+    void tx_flush(void)
+    {
+        tx_fifo.clear();
+    }
+
+    char getc(void)
+    {
+        if (rx_fifo.empty()) return 0;
+        char c = rx_fifo.front();
+        rx_fifo.pop_front();
+        return c;
+    }
+
+    void rx_flush(void)
+    {
+        rx_fifo.clear();
+    }
+
+    uint16_t rx_bytesavailable(void)
+    {
+        return rx_fifo.size();
+    }
+
+    //-- simulation side
+
+    char Port(void) override { return port; }
+
+    uint64_t NextEvent_us(void) override
+    {
+        uint64_t t_us = HOST_TIME_NEVER;
+        if (!tx_fifo.empty()) t_us = tx_t_us;
+        if (!rx_line.empty() && rx_line.front().t_us < t_us) t_us = rx_line.front().t_us;
+        return t_us;
+    }
+
+    void Do(void) override
+    {
+        while (!tx_fifo.empty() && tx_t_us <= host_time_us) {
+            if (out.empty()) out_t_us = tx_t_us;
+            out.push_back(tx_fifo.front());
+            tx_fifo.pop_front();
+            if (!tx_fifo.empty()) tx_t_us = next_byte_us(tx_t_us, &tx_frac);
+        }
+
+        while (!rx_line.empty() && rx_line.front().t_us <= host_time_us) {
+            if (rx_fifo.size() < rxbufsize) {
+                rx_fifo.push_back(rx_line.front().c);
+            } else {
+                rx_dropped++;
+            }
+            rx_line.pop_front();
+        }
+    }
+
+    // the bytes follow each other at the baudrate, the first starts at t_us, or after the last one
+    void Input(uint64_t t_us, uint8_t* buf, uint16_t len) override
+    {
+        for (uint16_t i = 0; i < len; i++) {
+            if (t_us > rx_t_us) { rx_t_us = t_us; rx_frac = 0; }
+            rx_t_us = next_byte_us(rx_t_us, &rx_frac);
+            rx_line.push_back({ .t_us = rx_t_us, .c = buf[i] });
+        }
+    }
+
+    void Output(void) override
+    {
+        if (out.empty()) return;
+        printf("S %c %llu ", port, (unsigned long long)out_t_us);
+        host_puthex(out.data(), out.size());
+        putchar('\n');
+        out.clear();
+    }
+
+    void Report(void) override
+    {
+        printf("E %c %u %u\n", port, rx_dropped, tx_dropped);
+    }
+
+  private:
+    char port;
+    uint32_t baud;
+    uint16_t txbufsize;
+    uint16_t rxbufsize;
+    std::deque<uint8_t> tx_fifo;
+    std::deque<uint8_t> rx_fifo;
+    std::deque<tHostUartByte> rx_line; // bytes on the wire
+    uint64_t tx_t_us; // when the byte at the front of the tx fifo is done
+    uint32_t tx_frac;
+    uint64_t rx_t_us = 0; // when the last byte on the wire is received
+    uint32_t rx_frac;
+    std::vector<uint8_t> out; // the bytes which went out since the last Output()
+    uint64_t out_t_us;
+    uint32_t rx_dropped;
+    uint32_t tx_dropped;
+
+    // 10 bits per byte, frac keeps the remainder so that the rate is exact
+    uint64_t next_byte_us(uint64_t t_us, uint32_t* frac)
+    {
+        if (!baud) return t_us;
+        *frac += 10000000;
+        t_us += *frac / baud;
+        *frac %= baud;
+        return t_us;
+    }
+};
+
+
+#endif // HOSTLIB_UART_H
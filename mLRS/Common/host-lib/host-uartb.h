@@ -0,0 +1,112 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// Host UARTB
+//********************************************************
+#ifndef HOSTLIB_UARTB_H
+#define HOSTLIB_UARTB_H
+
+
+#include "host-uart.h"
+
+
+//-------------------------------------------------------
+// Defines
+//-------------------------------------------------------
+
+#ifndef UARTB_TXBUFSIZE
+  #define UARTB_TXBUFSIZE       256
+#endif
+#ifndef UARTB_RXBUFSIZE
+  #define UARTB_RXBUFSIZE       256
+#endif
+
+
+tHostUart host_uartb('b', UARTB_TXBUFSIZE, UARTB_RXBUFSIZE);
+
+
+//-------------------------------------------------------
+// TX routines
+//-------------------------------------------------------
+
+void uartb_putbuf(uint8_t* buf, uint16_t len)
+{
+    host_uartb.putbuf(buf, len);
+}
+
+
+void uartb_tx_flush(void)
+{
+    host_uartb.tx_flush();
+}
+
+
+//-------------------------------------------------------
+// RX routines
+//-------------------------------------------------------
+
+char uartb_getc(void)
+{
+    return host_uartb.getc();
+}
+
+
+void uartb_rx_flush(void)
+{
+    host_uartb.rx_flush();
+}
+
+
+uint16_t uartb_rx_bytesavailable(void)
+{
+    return host_uartb.rx_bytesavailable();
+}
+
+
+uint16_t uartb_rx_available(void)
+{
+    return (host_uartb.rx_bytesavailable() > 0) ? 1 : 0;
+}
+
+
+//-------------------------------------------------------
+// INIT routines
+//-------------------------------------------------------
+
+void uartb_setbaudrate(uint32_t baud)
+{
+    host_uartb.SetBaudrate(baud);
+}
+
+
+void uartb_setprotocol(uint32_t baud, UARTPARITYENUM parity, UARTSTOPBITENUM stopbits)
+{
+    host_uartb.SetBaudrate(baud);
+}
+
+
+void uartb_init_isroff(void)
+{
+    host_uartb.Init(UARTB_BAUD);
+}
+
+
+void uartb_init(void)
+{
+    uartb_init_isroff();
+}
+
+
+//-------------------------------------------------------
+// System bootloader
+//-------------------------------------------------------
+
+uint8_t uartb_has_systemboot(void)
+{
+    return 0;
+}
+
+
+#endif // HOSTLIB_UARTB_H
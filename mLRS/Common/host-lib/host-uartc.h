@@ -0,0 +1,112 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+//*******************************************************
+// Host UARTC
+//********************************************************
+#ifndef HOSTLIB_UARTC_H
+#define HOSTLIB_UARTC_H
+
+
+#include "host-uart.h"
+
+
+//-------------------------------------------------------
+// Defines
+//-------------------------------------------------------
+
+#ifndef UARTC_TXBUFSIZE
+  #define UARTC_TXBUFSIZE       256
+#endif
+#ifndef UARTC_RXBUFSIZE
+  #define UARTC_RXBUFSIZE       256
+#endif
+
+
+tHostUart host_uartc('c', UARTC_TXBUFSIZE, UARTC_RXBUFSIZE);
+
+
+//-------------------------------------------------------
+// TX routines
+//-------------------------------------------------------
+
+void uartc_putbuf(uint8_t* buf, uint16_t len)
+{
+    host_uartc.putbuf(buf, len);
+}
+
+
+void uartc_tx_flush(void)
+{
+    host_uartc.tx_flush();
+}
+
+
+//-------------------------------------------------------
+// RX routines
+//-------------------------------------------------------
+
+char uartc_getc(void)
+{
+    return host_uartc.getc();
+}
+
+
+void uartc_rx_flush(void)
+{
+    host_uartc.rx_flush();
+}
+
+
+uint16_t uartc_rx_bytesavailable(void)
+{
+    return host_uartc.rx_bytesavailable();
+}
+
+
+uint16_t uartc_rx_available(void)
+{
+    return (host_uartc.rx_bytesavailable() > 0) ? 1 : 0;
+}
+
+
+//-------------------------------------------------------
+// INIT routines
+//-------------------------------------------------------
+
+void uartc_setbaudrate(uint32_t baud)
+{
+    host_uartc.SetBaudrate(baud);
+}
+
+
+void uartc_setprotocol(uint32_t baud, UARTPARITYENUM parity, UARTSTOPBITENUM stopbits)
+{
+    host_uartc.SetBaudrate(baud);
+}
+
+
+void uartc_init_isroff(void)
+{
+    host_uartc.Init(UARTC_BAUD);
+}
+
+
+void uartc_init(void)
+{
+    uartc_init_isroff();
+}
+
+
+//-------------------------------------------------------
+// System bootloader
+//-------------------------------------------------------
+
+uint8_t uartc_has_systemboot(void)
+{
+    return 0;
+}
+
+
+#endif // HOSTLIB_UARTC_H
@@ -6,16 +6,40 @@
 //*******************************************************
 // FIFO
 //********************************************************
+// FIFO_SIZE must be 2^N, the fifo can hold FIFO_SIZE - 1 elements
+//
+// single-producer/single-consumer:
+// the producer only writes writepos, the consumer only writes readpos, so one side can be in
+// an isr and the other in the main loop, or on another core, without disabling interrupts
+// the data is written before writepos is published (release), and writepos is read before the
+// data (acquire), likewise for readpos, so neither side can see stale data
+// producer side: Put(), PutBuf(), HasSpace(), Free(), WriteSpan(), CommitWrite()
+// consumer side: Get(), GetBuf(), Peek(), Skip(), Available(), ReadSpan(), CommitRead()
+// Init() and Flush() touch both positions and must not be called while the other side is active
+//
+// spans:
+// ReadSpan()/WriteSpan() give direct access to the largest contiguous block of the buffer,
+// the data is then processed in place and committed with CommitRead()/CommitWrite()
+// when the block wraps around the end of the buffer, a second call gives the rest
+//********************************************************
 #ifndef FIFO_H
 #define FIFO_H
 #pragma once
 
 
 #include <inttypes.h>
+#include <string.h>
+
+
+#define FIFO_LOAD_ACQUIRE(x)        __atomic_load_n(&(x), __ATOMIC_ACQUIRE)
+#define FIFO_STORE_RELEASE(x,v)     __atomic_store_n(&(x), (v), __ATOMIC_RELEASE)
+
 
 template <class T, uint16_t FIFO_SIZE>
 class tFifo
 {
+    static_assert((FIFO_SIZE >= 2) && !(FIFO_SIZE & (FIFO_SIZE - 1)), "FIFO_SIZE must be 2^N");
+
   public:
     tFifo() // constructor
     {
@@ -25,45 +49,130 @@ class tFifo
     void Init(void)
     {
         writepos = readpos = 0;
-        SIZEMASK = FIFO_SIZE - 1;
     }
 
+    //-- producer side
+
     bool Put(T c)
     {
-        uint16_t next = (writepos + 1) & (SIZEMASK);
-        if (next != readpos) { // fifo not full
-            buf[writepos] = c;
-            writepos = next;
-            return true;
-        }
-        return false;
+        uint16_t wpos = writepos;
+        uint16_t next = (wpos + 1) & SIZEMASK;
+        if (next == FIFO_LOAD_ACQUIRE(readpos)) return false; // fifo full
+        buf[wpos] = c;
+        FIFO_STORE_RELEASE(writepos, next);
+        return true;
     }
 
-    void PutBuf(void* buf, uint16_t len)
+    // puts as many elements as fit, returns the number of elements put
+    // use HasSpace() before if the data must not be split
+    uint16_t PutBuf(const void* data, uint16_t len)
     {
-        for (uint16_t i = 0; i < len; i++) Put(((T*)buf)[i]);
+        uint16_t wpos = writepos;
+        uint16_t free = (FIFO_LOAD_ACQUIRE(readpos) - wpos - 1) & SIZEMASK;
+        if (len > free) len = free;
+        uint16_t len1 = FIFO_SIZE - wpos; // contiguous to end of buffer
+        if (len1 > len) len1 = len;
+        memcpy(&buf[wpos], data, len1 * sizeof(T));
+        if (len > len1) memcpy(&buf[0], (const T*)data + len1, (len - len1) * sizeof(T));
+        FIFO_STORE_RELEASE(writepos, (uint16_t)((wpos + len) & SIZEMASK));
+        return len;
     }
 
-    uint16_t Available(void)
+    uint16_t Free(void)
     {
-        int16_t d = (int16_t)writepos - (int16_t)readpos;
-        if (d < 0) return d + (SIZEMASK + 1);
-        return d;
+        return (FIFO_LOAD_ACQUIRE(readpos) - writepos - 1) & SIZEMASK;
     }
 
     bool HasSpace(uint16_t space)
     {
-        return (Available() < (FIFO_SIZE - space));
+        return (Free() >= space);
+    }
+
+    // returns the number of elements which can be written contiguously at *ptr
+    uint16_t WriteSpan(T** ptr)
+    {
+        uint16_t wpos = writepos;
+        uint16_t rpos = FIFO_LOAD_ACQUIRE(readpos);
+        *ptr = &buf[wpos];
+        if (wpos >= rpos) return FIFO_SIZE - wpos - ((rpos == 0) ? 1 : 0);
+        return rpos - wpos - 1;
     }
 
+    // len must not be larger than what WriteSpan() returned
+    void CommitWrite(uint16_t len)
+    {
+        FIFO_STORE_RELEASE(writepos, (uint16_t)((writepos + len) & SIZEMASK));
+    }
+
+    //-- consumer side
+
+    uint16_t Available(void)
+    {
+        return (FIFO_LOAD_ACQUIRE(writepos) - readpos) & SIZEMASK;
+    }
+
+    // returns 0 if fifo is empty, use Get(T*) or Available() to tell this apart from data
     T Get(void)
     {
-        if (writepos != readpos) { // fifo not empty
-            T c = buf[readpos];
-            readpos = (readpos + 1) & (SIZEMASK);
-            return c;
-        }
-        return 0;
+        T c;
+        if (!Get(&c)) return 0;
+        return c;
+    }
+
+    bool Get(T* c)
+    {
+        uint16_t rpos = readpos;
+        if (rpos == FIFO_LOAD_ACQUIRE(writepos)) return false; // fifo empty
+        *c = buf[rpos];
+        FIFO_STORE_RELEASE(readpos, (uint16_t)((rpos + 1) & SIZEMASK));
+        return true;
+    }
+
+    // gets up to len elements, returns the number of elements got
+    uint16_t GetBuf(void* data, uint16_t len)
+    {
+        uint16_t rpos = readpos;
+        uint16_t avail = (FIFO_LOAD_ACQUIRE(writepos) - rpos) & SIZEMASK;
+        if (len > avail) len = avail;
+        uint16_t len1 = FIFO_SIZE - rpos; // contiguous to end of buffer
+        if (len1 > len) len1 = len;
+        memcpy(data, &buf[rpos], len1 * sizeof(T));
+        if (len > len1) memcpy((T*)data + len1, &buf[0], (len - len1) * sizeof(T));
+        FIFO_STORE_RELEASE(readpos, (uint16_t)((rpos + len) & SIZEMASK));
+        return len;
+    }
+
+    // returns the element at offset without removing it, false if there is none
+    bool Peek(T* c, uint16_t offset = 0)
+    {
+        if (offset >= Available()) return false;
+        *c = buf[(readpos + offset) & SIZEMASK];
+        return true;
+    }
+
+    // removes up to len elements, returns the number of elements removed
+    uint16_t Skip(uint16_t len)
+    {
+        uint16_t avail = Available();
+        if (len > avail) len = avail;
+        FIFO_STORE_RELEASE(readpos, (uint16_t)((readpos + len) & SIZEMASK));
+        return len;
+    }
+
+    // returns the number of elements which can be read contiguously at *ptr
+    uint16_t ReadSpan(T** ptr)
+    {
+        uint16_t rpos = readpos;
+        uint16_t wpos = FIFO_LOAD_ACQUIRE(writepos);
+        *ptr = &buf[rpos];
+        if (wpos >= rpos) return wpos - rpos;
+        return FIFO_SIZE - rpos;
+    }
+
+    // len must not be larger than what ReadSpan() returned
+    void CommitRead(uint16_t len)
+    {
+        FIFO_STORE_RELEASE(readpos, (uint16_t)((readpos + len) & SIZEMASK));
     }
 
     void Flush(void)
@@ -72,9 +181,10 @@ class tFifo
     }
 
   private:
-    uint16_t writepos; // pos at which the next byte will be stored
-    uint16_t readpos; // pos at which the oldest byte is fetched
-    uint16_t SIZEMASK;
+    static const uint16_t SIZEMASK = FIFO_SIZE - 1;
+
+    uint16_t writepos; // pos at which the next element will be stored
+    uint16_t readpos; // pos at which the oldest element is fetched
     T buf[FIFO_SIZE];
 };
 
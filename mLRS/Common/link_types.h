@@ -76,10 +76,13 @@ typedef enum {
     LINK_TASK_TX_SET_RX_PARAMS,
     LINK_TASK_TX_STORE_RX_PARAMS,
     LINK_TASK_TX_GET_RX_SETUPDATA_WRELOAD,
+    LINK_TASK_TX_FHSS_SYNC,
 #endif
 
 #ifdef DEVICE_IS_RECEIVER
     LINK_TASK_RX_SEND_RX_SETUPDATA,
+    LINK_TASK_RX_SEND_RX_FHSS,
+    LINK_TASK_RX_SEND_RX_ARQ_STATS,
 #endif
 } LINK_TASK_ENUM;
 
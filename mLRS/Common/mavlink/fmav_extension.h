@@ -31,6 +31,41 @@ void fmav_msg_recalculate_crc(fmav_message_t* msg)
 }
 
 
+// helpers to work directly on a frame_buf, which has been checked by the parser
+// this avoids the copy into a fmav_message_t
+
+uint8_t fmav_frame_buf_header_len(const uint8_t* buf)
+{
+    return (buf[0] == FASTMAVLINK_MAGIC_V1) ? FASTMAVLINK_HEADER_V1_LEN : FASTMAVLINK_HEADER_V2_LEN;
+}
+
+
+void fmav_frame_buf_recalculate_crc(uint8_t* buf, fmav_result_t* result)
+{
+    uint8_t header_len = fmav_frame_buf_header_len(buf);
+    uint8_t len = buf[1];
+
+    uint16_t crc = fmav_crc_calculate(&(buf[1]), header_len - 1 + len);
+    fmav_crc_accumulate(&crc, result->crc_extra);
+    buf[header_len + len] = (uint8_t)crc;
+    buf[header_len + len + 1] = (uint8_t)(crc >> 8);
+}
+
+
+// as fmav_msg_xxx_decode(), the truncated zeros are filled in
+void fmav_frame_buf_decode_payload(void* payload, uint16_t payload_size, const uint8_t* buf)
+{
+    uint8_t len = buf[1];
+
+    if (len < payload_size) {
+        memcpy(payload, &(buf[fmav_frame_buf_header_len(buf)]), len);
+        memset((uint8_t*)payload + len, 0, payload_size - len);
+    } else {
+        memcpy(payload, &(buf[fmav_frame_buf_header_len(buf)]), payload_size);
+    }
+}
+
+
 //-------------------------------------------------------
 // Component List Class
 //-------------------------------------------------------
@@ -0,0 +1,128 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// MAVLink Debug
+//*******************************************************
+// The DEBUG_FLOAT_ARRAY messages of the development features USE_FEATURE_PROFILER, USE_FEATURE_RC_TRACE,
+// USE_FEATURE_ARQ_STATS, USE_FEATURE_SCHED_STATS. One timer starts a round each second, and each call of
+// Generate() gives the next one of the round, so the MAVLink interfaces send at most one per loop.
+// The Tx sends them to the GCS on its serial, the Rx puts them into its link out, so they reach the GCS
+// too and not the autopilot, this needs USE_FEATURE_MAVLINKX on the Rx.
+//*******************************************************
+#ifndef MAVLINK_DEBUG_H
+#define MAVLINK_DEBUG_H
+#pragma once
+
+
+#if defined USE_FEATURE_PROFILER || defined USE_FEATURE_RC_TRACE || defined USE_FEATURE_ARQ_STATS || \
+    (defined USE_FEATURE_SCHED_STATS && defined USE_FEATURE_MAVLINKX)
+  #define USE_MAVLINK_DEBUG
+#endif
+
+
+#ifdef USE_MAVLINK_DEBUG
+
+extern volatile uint32_t millis32(void);
+
+
+typedef enum {
+    MAVLINK_DEBUG_PROFILER = 0,
+    MAVLINK_DEBUG_RC_TRACE,
+    MAVLINK_DEBUG_ARQ_STATS,
+    MAVLINK_DEBUG_SCHED_STATS,
+    MAVLINK_DEBUG_NUM,
+} MAVLINK_DEBUG_ENUM;
+
+
+class tMavlinkDebug
+{
+  public:
+    // the array_id tells the Tx' and Rx' messages apart
+    void Init(uint16_t _array_id)
+    {
+        array_id = _array_id;
+        status = {};
+        tlast_ms = millis32();
+        idx = MAVLINK_DEBUG_NUM; // the first round starts in a second
+#if defined USE_FEATURE_SCHED_STATS && defined USE_FEATURE_MAVLINKX
+        sched = nullptr;
+#endif
+    }
+
+#if defined USE_FEATURE_SCHED_STATS && defined USE_FEATURE_MAVLINKX
+    void SetScheduler(tMavlinkScheduler* _sched) { sched = _sched; }
+#endif
+
+    // packs the next message of the round into msg, returns false if none is due
+    bool Generate(fmav_message_t* msg, uint8_t sysid, uint32_t tnow_ms)
+    {
+    float data[58] = {}; // DEBUG_FLOAT_ARRAY data field
+    const char* name;
+
+        if (idx >= MAVLINK_DEBUG_NUM) {
+            if ((tnow_ms - tlast_ms) < 1000) return false;
+            tlast_ms = tnow_ms;
+            idx = 0;
+        }
+
+        if (!get_next(data, &name)) return false;
+
+        fmav_msg_debug_float_array_pack(
+            msg,
+            sysid, MAV_COMP_ID_TELEMETRY_RADIO,
+            (uint64_t)tnow_ms * 1000, name, array_id, data,
+            //uint64_t time_usec, const char* name, uint16_t array_id, const float* data,
+            &status);
+        return true;
+    }
+
+  private:
+    uint16_t array_id;
+    fmav_status_t status;
+    uint32_t tlast_ms;
+    uint8_t idx; // next of the round, MAVLINK_DEBUG_NUM = round is done
+#if defined USE_FEATURE_SCHED_STATS && defined USE_FEATURE_MAVLINKX
+    tMavlinkScheduler* sched;
+#endif
+
+    bool get_next(float* data, const char** name)
+    {
+        while (idx < MAVLINK_DEBUG_NUM) {
+            switch (idx++) {
+#ifdef USE_FEATURE_PROFILER
+            case MAVLINK_DEBUG_PROFILER:
+                profiler.GetFloatArray(data);
+                *name = "MLRS_PROF";
+                return true;
+#endif
+#ifdef USE_FEATURE_RC_TRACE
+            case MAVLINK_DEBUG_RC_TRACE:
+                rctrace.GetFloatArray(data);
+                *name = "MLRS_RCTR";
+                return true;
+#endif
+#ifdef USE_FEATURE_ARQ_STATS
+            case MAVLINK_DEBUG_ARQ_STATS:
+                stats.GetArqFloatArray(data);
+                *name = "MLRS_ARQ";
+                return true;
+#endif
+#if defined USE_FEATURE_SCHED_STATS && defined USE_FEATURE_MAVLINKX
+            case MAVLINK_DEBUG_SCHED_STATS:
+                if (!sched) break;
+                sched->GetFloatArray(data);
+                *name = "MLRS_SCHED";
+                return true;
+#endif
+            }
+        }
+        return false;
+    }
+};
+
+#endif // USE_MAVLINK_DEBUG
+
+#endif // MAVLINK_DEBUG_H
@@ -0,0 +1,458 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// MAVLink Scheduler
+//*******************************************************
+// Replaces the fifo_link_out of the MAVLink interfaces. With a plain fifo a PARAM_VALUE or
+// LOG_DATA burst fills the fifo, and a COMMAND_ACK or HEARTBEAT has to wait behind it, for
+// seconds in 19 Hz mode. The scheduler keeps whole messages, in three priority classes:
+// - control: commands, acks, heartbeat, mission handshake, statustext, always go first
+// - nav: periodic telemetry, like ATTITUDE, GLOBAL_POSITION_INT, VFR_HUD; with coalescing a newer message
+//   replaces the newest queued one of its msgid, sysid, compid, keeping its place in the line
+// - bulk: everything else, in order
+// The class of a msgid is given by the policy table mavlink_sched_policy[], msgids not in it are bulk.
+// Coalescing is on by default. The Rx switches it on only when the link is saturated, i.e. in txbuf
+// state BURST, BURST_HIGH, so that otherwise the GCS sees each message. The airtime saved by it goes
+// to the bulk, i.e. to mission and parameter traffic.
+// A message which is being sent is always completed, so the link sees whole messages.
+// A message put with SCHED_MSG_KEEP is never replaced, this is for MavlinkX delta references and context
+// definitions, which the following messages depend on. A MavlinkX message which replaces a queued one must
+// go with the full header, WillReplace() tells it before the conversion.
+// A signed message goes with the bulk, whatever its class. The receiver of a signed message rejects it if
+// its timestamp is not newer than that of the last one of the sysid, compid, so signed messages must not
+// overtake each other.
+// So that a telemetry flood can't stall a parameter download, after SCHED_BULK_MAX_SKIP nav
+// messages a waiting bulk message goes first.
+// A message which doesn't fit into its class goes with the bulk. The parser is gated by
+// HasSpace() of the bulk, so, as before, a message is never cut.
+// The messages of one msgid, sysid, compid are never reordered, MavlinkX delta and context index frames
+// depend on the reference or definition before them. When a control or nav message had to go with the
+// bulk, the later ones of its msgid, sysid, compid go with the bulk too, as long as it is queued, and a
+// bulk message doesn't go first when an earlier nav message of its msgid, sysid, compid is queued. For
+// this the bulk messages of control and nav class are tracked in diverted[]. If that is full, all control
+// and nav messages go with the bulk, until the untracked ones are sent.
+// Put and Get must be called from the same context, i.e. both from the main loop.
+// The reordering is only done with USE_FEATURE_MAVLINK_SCHEDULER, else all messages are bulk, and the
+// scheduler is a plain fifo of whole messages, as fifo_link_out was.
+// tools/linksim runs it in the host nodes, and gives the latency per class, e.g. --traffic mixed --link-out sched.
+//*******************************************************
+#ifndef MAVLINK_SCHEDULER_H
+#define MAVLINK_SCHEDULER_H
+#pragma once
+
+
+#include <stdint.h>
+#include <string.h>
+#include "libs/fifo.h"
+
+
+#define SCHED_CONTROL_FIFO_SIZE     256
+#define SCHED_BULK_FIFO_SIZE        512 // as fifo_link_out, needs to be at least 82 + 280
+#define SCHED_NAV_SLOT_NUM          8
+#define SCHED_NAV_SLOT_LEN          64 // GPS_RAW_INT fits, also as MAVLink frame
+#define SCHED_BULK_MAX_SKIP         4
+#define SCHED_DIVERTED_NUM          8 // control and nav msgid, sysid, compid which can be in the bulk at the same time
+
+#define SCHED_NONE                  UINT8_MAX
+
+// flags for PutMsg()
+#define SCHED_MSG_KEEP              0x01 // must not be replaced
+#define SCHED_MSG_SIGNED            0x02 // is signed, must stay in order with the other signed messages
+
+// the messages in the fifos are preceded by two bytes, the length and a tag, len must be < 512
+// tag = 0: not tracked, 1 ... SCHED_DIVERTED_NUM: diverted[tag - 1], SCHED_TAG_ALL: not tracked, diverted_all_cnt
+#define SCHED_TAG_ALL               0x7F
+
+
+typedef enum {
+    SCHED_CLASS_CONTROL = 0,
+    SCHED_CLASS_NAV,
+    SCHED_CLASS_BULK,
+    SCHED_CLASS_NUM,
+} SCHED_CLASS_ENUM;
+
+
+typedef struct {
+    uint32_t msgid;
+    uint8_t sched_class;
+} tMavlinkSchedPolicy;
+
+
+// edit to change the class of a message, order does not matter
+const tMavlinkSchedPolicy mavlink_sched_policy[] = {
+    { FASTMAVLINK_MSG_ID_HEARTBEAT, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_PING, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_SET_MODE, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_PARAM_SET, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_COMMAND_INT, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_COMMAND_LONG, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_COMMAND_ACK, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_COMMAND_CANCEL, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_MANUAL_CONTROL, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_RC_CHANNELS_OVERRIDE, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_SET_ATTITUDE_TARGET, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_SET_POSITION_TARGET_LOCAL_NED, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_SET_POSITION_TARGET_GLOBAL_INT, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_MISSION_COUNT, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_MISSION_REQUEST, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_MISSION_REQUEST_INT, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_MISSION_SET_CURRENT, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_MISSION_ACK, SCHED_CLASS_CONTROL },
+    { FASTMAVLINK_MSG_ID_STATUSTEXT, SCHED_CLASS_CONTROL },
+
+    { FASTMAVLINK_MSG_ID_SYS_STATUS, SCHED_CLASS_NAV },
+    { FASTMAVLINK_MSG_ID_GPS_RAW_INT, SCHED_CLASS_NAV },
+    { FASTMAVLINK_MSG_ID_ATTITUDE, SCHED_CLASS_NAV },
+    { FASTMAVLINK_MSG_ID_ATTITUDE_QUATERNION, SCHED_CLASS_NAV },
+    { FASTMAVLINK_MSG_ID_LOCAL_POSITION_NED, SCHED_CLASS_NAV },
+    { FASTMAVLINK_MSG_ID_GLOBAL_POSITION_INT, SCHED_CLASS_NAV },
+    { FASTMAVLINK_MSG_ID_NAV_CONTROLLER_OUTPUT, SCHED_CLASS_NAV },
+    { FASTMAVLINK_MSG_ID_RC_CHANNELS, SCHED_CLASS_NAV },
+    { FASTMAVLINK_MSG_ID_VFR_HUD, SCHED_CLASS_NAV },
+    { FASTMAVLINK_MSG_ID_ALTITUDE, SCHED_CLASS_NAV },
+    { FASTMAVLINK_MSG_ID_VIBRATION, SCHED_CLASS_NAV },
+    { FASTMAVLINK_MSG_ID_EXTENDED_SYS_STATE, SCHED_CLASS_NAV },
+};
+
+
+uint8_t mavlink_sched_class(uint32_t msgid)
+{
+    for (uint8_t i = 0; i < sizeof(mavlink_sched_policy)/sizeof(tMavlinkSchedPolicy); i++) {
+        if (mavlink_sched_policy[i].msgid == msgid) return mavlink_sched_policy[i].sched_class;
+    }
+    return SCHED_CLASS_BULK;
+}
+
+
+class tMavlinkScheduler
+{
+  public:
+    void Init(void)
+    {
+        Flush();
+        coalescing = true;
+        coalesced_cnt = 0;
+        coalesced_bytes = 0;
+        for (uint8_t c = 0; c < SCHED_CLASS_NUM; c++) bytes_sent[c] = 0;
+    }
+
+    void Flush(void)
+    {
+        fifo_control.Init();
+        fifo_bulk.Init();
+        for (uint8_t i = 0; i < SCHED_NAV_SLOT_NUM; i++) nav[i].len = 0;
+        nav_stamp = 0;
+        cur_class = SCHED_NONE;
+        cur_remaining = 0;
+        bulk_skip_cnt = 0;
+        bytes_queued = 0;
+        for (uint8_t i = 0; i < SCHED_DIVERTED_NUM; i++) diverted[i].cnt = 0;
+        diverted_all_cnt = 0;
+    }
+
+    void SetCoalescing(bool flag) { coalescing = flag; }
+
+    // for gating the parser, a message always fits into the bulk
+    bool HasSpace(uint16_t len) { return fifo_bulk.HasSpace(len + 2); }
+
+    // tells if the message would replace a queued one, which then never reaches the other side
+    // call it before converting the message, a MavlinkX context index must then not be used
+    bool WillReplace(uint32_t msgid, uint8_t sysid, uint8_t compid, uint8_t flags = 0)
+    {
+        if (put_class(msgid, sysid, compid, flags) != SCHED_CLASS_NAV) return false;
+        return (find_nav_to_replace(msgid, sysid, compid) != SCHED_NONE);
+    }
+
+    // buf holds the message as it goes to the link, i.e. MAVLink or MavlinkX frame
+    void PutMsg(const uint8_t* buf, uint16_t len, uint32_t msgid, uint8_t sysid, uint8_t compid, uint8_t flags = 0)
+    {
+        uint8_t c = put_class(msgid, sysid, compid, flags);
+
+        if (c == SCHED_CLASS_NAV && len <= SCHED_NAV_SLOT_LEN) {
+            if (put_nav(buf, len, msgid, sysid, compid, (flags & SCHED_MSG_KEEP))) return;
+        }
+        if (c == SCHED_CLASS_CONTROL) {
+            if (put_fifo(&fifo_control, buf, len, 0)) return;
+        }
+
+        if (!fifo_bulk.HasSpace(len + 2)) return; // the message is lost, should not happen since the parser is gated
+        uint8_t tag = 0;
+#ifdef USE_FEATURE_MAVLINK_SCHEDULER
+        if (mavlink_sched_class(msgid) != SCHED_CLASS_BULK) tag = add_diverted(msgid, sysid, compid);
+#endif
+        put_fifo(&fifo_bulk, buf, len, tag);
+    }
+
+    uint16_t Available(void) { return bytes_queued; }
+
+    char Get(void)
+    {
+        char c = 0;
+        GetBuf(&c, 1);
+        return c;
+    }
+
+    uint16_t GetBuf(void* buf, uint16_t len)
+    {
+        uint8_t* p = (uint8_t*)buf;
+        uint16_t n_total = 0;
+
+        while (len) {
+            if (!cur_remaining && !select_next()) break;
+
+            uint16_t n = (len < cur_remaining) ? len : cur_remaining;
+            switch (cur_class) {
+            case SCHED_CLASS_CONTROL: fifo_control.GetBuf(p, n); break;
+            case SCHED_CLASS_BULK: fifo_bulk.GetBuf(p, n); break;
+            default: // SCHED_CLASS_NAV
+                memcpy(p, &(nav[cur_slot].buf[nav[cur_slot].len - cur_remaining]), n);
+            }
+
+            p += n;
+            len -= n;
+            n_total += n;
+            cur_remaining -= n;
+            bytes_queued -= n;
+            bytes_sent[cur_class] += n;
+
+            if (!cur_remaining) {
+                if (cur_class == SCHED_CLASS_NAV) nav[cur_slot].len = 0; // slot is free again
+                cur_class = SCHED_NONE;
+            }
+        }
+
+        return n_total;
+    }
+
+    // counters, for stats
+    uint32_t coalesced_cnt; // nav messages which were replaced by a newer one, and hence never sent
+    uint32_t coalesced_bytes; // their bytes, i.e. the saved bytes
+    uint32_t bytes_sent[SCHED_CLASS_NUM];
+
+    // for the MAVLink DEBUG_FLOAT_ARRAY, totals since Init, the rates can be had from the differences
+    void GetFloatArray(float* data)
+    {
+        data[0] = coalesced_cnt;
+        data[1] = coalesced_bytes;
+        data[2] = bytes_sent[SCHED_CLASS_CONTROL];
+        data[3] = bytes_sent[SCHED_CLASS_NAV];
+        data[4] = bytes_sent[SCHED_CLASS_BULK];
+        data[5] = (coalescing) ? 1 : 0;
+    }
+
+  private:
+    tFifo<char,SCHED_CONTROL_FIFO_SIZE> fifo_control;
+    tFifo<char,SCHED_BULK_FIFO_SIZE> fifo_bulk;
+
+    struct {
+        uint8_t buf[SCHED_NAV_SLOT_LEN];
+        uint8_t len; // 0 = free
+        uint16_t stamp; // order of arrival
+        uint32_t msgid;
+        uint8_t sysid;
+        uint8_t compid;
+        bool keep; // must not be replaced
+    } nav[SCHED_NAV_SLOT_NUM];
+    uint16_t nav_stamp;
+
+    uint8_t cur_class; // class of the message which is being sent, SCHED_NONE if none
+    uint8_t cur_slot;
+    uint16_t cur_remaining; // bytes of it still to be sent
+    uint8_t bulk_skip_cnt;
+    uint16_t bytes_queued;
+    bool coalescing;
+
+    struct {
+        uint32_t msgid;
+        uint8_t sysid;
+        uint8_t compid;
+        uint8_t cnt; // its messages in the bulk, 0 = free
+    } diverted[SCHED_DIVERTED_NUM];
+    uint8_t diverted_all_cnt;
+
+    uint8_t put_class(uint32_t msgid, uint8_t sysid, uint8_t compid, uint8_t flags)
+    {
+#ifdef USE_FEATURE_MAVLINK_SCHEDULER
+        uint8_t c = mavlink_sched_class(msgid);
+        if (c == SCHED_CLASS_BULK) return c;
+        if (flags & SCHED_MSG_SIGNED) return SCHED_CLASS_BULK; // in order, in a single class
+        if (diverted_all_cnt || find_diverted(msgid, sysid, compid) != SCHED_NONE) {
+            return SCHED_CLASS_BULK; // an earlier message of it is in the bulk, so it must follow
+        }
+        return c;
+#else
+        return SCHED_CLASS_BULK; // no reordering
+#endif
+    }
+
+    uint8_t find_diverted(uint32_t msgid, uint8_t sysid, uint8_t compid)
+    {
+        for (uint8_t i = 0; i < SCHED_DIVERTED_NUM; i++) {
+            if (!diverted[i].cnt) continue;
+            if (diverted[i].msgid == msgid && diverted[i].sysid == sysid && diverted[i].compid == compid) return i;
+        }
+        return SCHED_NONE;
+    }
+
+    // returns the tag
+    uint8_t add_diverted(uint32_t msgid, uint8_t sysid, uint8_t compid)
+    {
+        uint8_t i = find_diverted(msgid, sysid, compid);
+        if (i == SCHED_NONE) {
+            for (i = 0; i < SCHED_DIVERTED_NUM; i++) if (!diverted[i].cnt) break;
+            if (i >= SCHED_DIVERTED_NUM) {
+                diverted_all_cnt++;
+                return SCHED_TAG_ALL;
+            }
+            diverted[i].msgid = msgid;
+            diverted[i].sysid = sysid;
+            diverted[i].compid = compid;
+        }
+        diverted[i].cnt++;
+        return i + 1;
+    }
+
+    void remove_diverted(uint8_t tag)
+    {
+        if (tag == SCHED_TAG_ALL) {
+            diverted_all_cnt--;
+        } else
+        if (tag) {
+            diverted[tag - 1].cnt--;
+        }
+    }
+
+    // tells if the bulk message which is next may go before the queued nav messages
+    bool bulk_may_go_first(void)
+    {
+        uint8_t tag_byte;
+        if (!fifo_bulk.Peek((char*)&tag_byte, 1)) return true;
+        uint8_t tag = tag_byte >> 1;
+        if (!tag) return true;
+        if (tag == SCHED_TAG_ALL) return false; // we don't know of which it is
+        for (uint8_t i = 0; i < SCHED_NAV_SLOT_NUM; i++) {
+            if (!nav[i].len) continue;
+            if (nav[i].msgid == diverted[tag - 1].msgid &&
+                nav[i].sysid == diverted[tag - 1].sysid && nav[i].compid == diverted[tag - 1].compid) return false;
+        }
+        return true;
+    }
+
+    template <class F> bool put_fifo(F* fifo, const uint8_t* buf, uint16_t len, uint8_t tag)
+    {
+        if (!fifo->HasSpace(len + 2)) return false;
+        fifo->Put(len & 0xFF);
+        fifo->Put(((len >> 8) & 0x01) | (tag << 1));
+        fifo->PutBuf(buf, len);
+        bytes_queued += len;
+        return true;
+    }
+
+    // returns the slot which a new message of this msgid, sysid, compid would replace, or SCHED_NONE
+    // only the newest can be replaced, else the new message would go before a kept one
+    uint8_t find_nav_to_replace(uint32_t msgid, uint8_t sysid, uint8_t compid)
+    {
+        if (!coalescing) return SCHED_NONE;
+
+        uint8_t i_last = SCHED_NONE; // newest queued message of this msgid, sysid, compid
+        for (uint8_t i = 0; i < SCHED_NAV_SLOT_NUM; i++) {
+            if (cur_class == SCHED_CLASS_NAV && cur_slot == i) continue; // is being sent, can't be touched
+            if (!nav[i].len) continue;
+            if (nav[i].msgid == msgid && nav[i].sysid == sysid && nav[i].compid == compid) {
+                if (i_last == SCHED_NONE || (int16_t)(nav[i].stamp - nav[i_last].stamp) > 0) i_last = i;
+            }
+        }
+
+        if (i_last == SCHED_NONE || nav[i_last].keep) return SCHED_NONE;
+        return i_last;
+    }
+
+    bool put_nav(const uint8_t* buf, uint16_t len, uint32_t msgid, uint8_t sysid, uint8_t compid, bool keep)
+    {
+        uint8_t i_last = find_nav_to_replace(msgid, sysid, compid);
+
+        // latest value wins, keeps its stamp
+        if (i_last != SCHED_NONE) {
+            coalesced_cnt++;
+            coalesced_bytes += nav[i_last].len;
+            bytes_queued += len - nav[i_last].len;
+            memcpy(nav[i_last].buf, buf, len);
+            nav[i_last].len = len;
+            nav[i_last].keep = keep;
+            return true;
+        }
+
+        uint8_t i_free = SCHED_NONE;
+        for (uint8_t i = 0; i < SCHED_NAV_SLOT_NUM; i++) {
+            if (!nav[i].len) { i_free = i; break; }
+        }
+        if (i_free == SCHED_NONE) return false;
+
+        memcpy(nav[i_free].buf, buf, len);
+        nav[i_free].len = len;
+        nav[i_free].stamp = nav_stamp++;
+        nav[i_free].msgid = msgid;
+        nav[i_free].sysid = sysid;
+        nav[i_free].compid = compid;
+        nav[i_free].keep = keep;
+        bytes_queued += len;
+        return true;
+    }
+
+    uint8_t oldest_nav(void)
+    {
+        uint8_t i_oldest = SCHED_NONE;
+        for (uint8_t i = 0; i < SCHED_NAV_SLOT_NUM; i++) {
+            if (!nav[i].len) continue;
+            if (i_oldest == SCHED_NONE || (int16_t)(nav[i].stamp - nav[i_oldest].stamp) < 0) i_oldest = i;
+        }
+        return i_oldest;
+    }
+
+    template <class F> uint16_t get_fifo_len(F* fifo, uint8_t* tag)
+    {
+        uint16_t len = (uint8_t)fifo->Get();
+        uint8_t b = fifo->Get();
+        *tag = b >> 1;
+        return len | ((uint16_t)(b & 0x01) << 8);
+    }
+
+    bool select_next(void)
+    {
+        uint8_t tag;
+
+        if (fifo_control.Available()) {
+            cur_class = SCHED_CLASS_CONTROL;
+            cur_remaining = get_fifo_len(&fifo_control, &tag);
+            return true;
+        }
+
+        uint8_t i_nav = oldest_nav();
+        bool bulk_waiting = (fifo_bulk.Available() > 0);
+
+        if (i_nav != SCHED_NONE &&
+            !(bulk_waiting && bulk_skip_cnt >= SCHED_BULK_MAX_SKIP && bulk_may_go_first())) {
+            if (bulk_waiting && bulk_skip_cnt < SCHED_BULK_MAX_SKIP) bulk_skip_cnt++;
+            cur_class = SCHED_CLASS_NAV;
+            cur_slot = i_nav;
+            cur_remaining = nav[i_nav].len;
+            return true;
+        }
+
+        if (bulk_waiting) {
+            bulk_skip_cnt = 0;
+            cur_class = SCHED_CLASS_BULK;
+            cur_remaining = get_fifo_len(&fifo_bulk, &tag);
+            remove_diverted(tag);
+            return true;
+        }
+
+        return false;
+    }
+};
+
+
+#endif // MAVLINK_SCHEDULER_H
@@ -0,0 +1,244 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// Profiler
+//*******************************************************
+// per-stage profiling of the main loop
+// records min/avg/max cycles of each stage, and the number of missed SysTicks, over 1 sec
+// cycles are counted with DWT->CYCCNT on the STM32, with the cycle count on the ESP, and with
+// a monotonic clock in ns on host
+// the mcus without DWT (Cortex-M0) fall back to micros16(), i.e. 1 us resolution
+//*******************************************************
+#ifndef PROFILER_H
+#define PROFILER_H
+#pragma once
+
+
+#ifdef USE_FEATURE_PROFILER
+
+#define PROFILER_START(stage)       profiler.Start(stage)
+#define PROFILER_STOP(stage)        profiler.Stop(stage)
+#define IF_PROFILER(x)              x
+
+
+typedef enum {
+    PROFILER_STAGE_SYSTASK = 0,
+    PROFILER_STAGE_DO_TRANSMIT,
+    PROFILER_STAGE_DO_RECEIVE,
+    PROFILER_STAGE_LINK, // doPreTransmit block on Tx, doPostReceive block on Rx
+    PROFILER_STAGE_MAVLINK_DO,
+    PROFILER_STAGE_DISP_DRAW, // Tx only
+    PROFILER_STAGE_CLI_DO, // Tx only
+    PROFILER_STAGE_PACK, // prepare_transmit_frame(), serial read and frame packing, is part of do_transmit
+    PROFILER_STAGE_NUM,
+} PROFILER_STAGE_ENUM;
+
+
+const char* profiler_stage_name[PROFILER_STAGE_NUM] = {
+    "systask",
+    "do_transmit",
+    "do_receive",
+#ifdef DEVICE_IS_TRANSMITTER
+    "pretransmit",
+#else
+    "postreceive",
+#endif
+    "mavlink.Do",
+    "disp.Draw",
+    "cli.Do",
+    "pack",
+};
+
+
+typedef struct
+{
+    uint32_t cnt;
+    uint32_t min;
+    uint32_t max;
+    uint32_t sum;
+} tProfilerStats;
+
+
+class tProfiler
+{
+  public:
+    void Init(void);
+    void Start(uint8_t stage) { tstart[stage] = cycles(); }
+    void Stop(uint8_t stage);
+    void SysTickMissed(uint32_t missed) { systick_missed += missed; }
+    void Update1Hz(void);
+
+    // values of the last second, in us
+    uint32_t Cnt(uint8_t stage) { return last[stage].cnt; }
+    float Min_us(uint8_t stage) { return (last[stage].cnt) ? (float)last[stage].min / cycles_per_us : 0.0f; }
+    float Max_us(uint8_t stage) { return (float)last[stage].max / cycles_per_us; }
+    float Avg_us(uint8_t stage);
+    uint32_t SysTickMissed(void) { return systick_missed_last; }
+    uint8_t GetFloatArray(float* data);
+
+  private:
+    uint32_t cycles(void);
+    void clear(tProfilerStats* s);
+
+    tProfilerStats cur[PROFILER_STAGE_NUM];
+    tProfilerStats last[PROFILER_STAGE_NUM];
+    uint32_t tstart[PROFILER_STAGE_NUM];
+    uint32_t systick_missed;
+    uint32_t systick_missed_last;
+    uint32_t cycles_per_us;
+};
+
+
+//-------------------------------------------------------
+// cycle counter
+//-------------------------------------------------------
+
+#if defined ESP8266 || defined ESP32
+
+#define PROFILER_CYCLES_MASK        UINT32_MAX
+#define PROFILER_CYCLES_PER_US      (ESP.getCpuFreqMHz())
+
+uint32_t tProfiler::cycles(void)
+{
+    return ESP.getCycleCount();
+}
+
+#elif defined __arm__
+
+#ifdef DWT_CTRL_CYCCNTENA_Msk
+
+#define PROFILER_CYCLES_MASK        UINT32_MAX
+#define PROFILER_CYCLES_PER_US      (SystemCoreClock / 1000000)
+
+void profiler_cycles_init(void)
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk; // may already be enabled by DELAY_USE_DWT
+}
+
+uint32_t tProfiler::cycles(void)
+{
+    return DWT->CYCCNT;
+}
+
+#else
+
+#define PROFILER_CYCLES_MASK        UINT16_MAX
+#define PROFILER_CYCLES_PER_US      1
+
+uint32_t tProfiler::cycles(void)
+{
+    return micros16();
+}
+
+#endif
+
+#else
+
+#include <time.h>
+
+#define PROFILER_CYCLES_MASK        UINT32_MAX
+#define PROFILER_CYCLES_PER_US      1000
+
+uint32_t tProfiler::cycles(void)
+{
+struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)ts.tv_sec * 1000000000 + (uint32_t)ts.tv_nsec;
+}
+
+#endif
+
+
+//-------------------------------------------------------
+// Profiler
+//-------------------------------------------------------
+
+void tProfiler::clear(tProfilerStats* s)
+{
+    s->cnt = 0;
+    s->min = UINT32_MAX;
+    s->max = 0;
+    s->sum = 0;
+}
+
+
+void tProfiler::Init(void)
+{
+#if defined __arm__ && defined DWT_CTRL_CYCCNTENA_Msk
+    profiler_cycles_init();
+#endif
+
+    for (uint8_t n = 0; n < PROFILER_STAGE_NUM; n++) {
+        clear(&cur[n]);
+        clear(&last[n]);
+        tstart[n] = 0;
+    }
+    systick_missed = 0;
+    systick_missed_last = 0;
+
+    cycles_per_us = PROFILER_CYCLES_PER_US;
+    if (!cycles_per_us) cycles_per_us = 1; // play it safe
+}
+
+
+void tProfiler::Stop(uint8_t stage)
+{
+    uint32_t dt = (cycles() - tstart[stage]) & PROFILER_CYCLES_MASK;
+
+    tProfilerStats* s = &cur[stage];
+    s->cnt++;
+    if (dt < s->min) s->min = dt;
+    if (dt > s->max) s->max = dt;
+    s->sum += dt;
+}
+
+
+// call at 1 Hz, latches the values of the last second
+void tProfiler::Update1Hz(void)
+{
+    for (uint8_t n = 0; n < PROFILER_STAGE_NUM; n++) {
+        last[n] = cur[n];
+        clear(&cur[n]);
+    }
+    systick_missed_last = systick_missed;
+    systick_missed = 0;
+}
+
+
+float tProfiler::Avg_us(uint8_t stage)
+{
+    if (!last[stage].cnt) return 0.0f;
+    return ((float)last[stage].sum / last[stage].cnt) / cycles_per_us;
+}
+
+
+// fills the array for the DEBUG_FLOAT_ARRAY message, which has 58 floats
+// data[0] = missed SysTicks, followed by cnt, min, avg, max in us for each stage
+uint8_t tProfiler::GetFloatArray(float* data)
+{
+    uint8_t len = 0;
+    data[len++] = systick_missed_last;
+    for (uint8_t n = 0; n < PROFILER_STAGE_NUM; n++) {
+        data[len++] = Cnt(n);
+        data[len++] = Min_us(n);
+        data[len++] = Avg_us(n);
+        data[len++] = Max_us(n);
+    }
+    return len;
+}
+
+
+#else
+
+#define PROFILER_START(stage)
+#define PROFILER_STOP(stage)
+#define IF_PROFILER(x)
+
+#endif // USE_FEATURE_PROFILER
+
+#endif // PROFILER_H
@@ -155,8 +155,9 @@ typedef struct
 
     uint8_t rssi_instantaneous_percent; // was rssi1_filtered; // not used at all, appears pretty useless, so deprecate
 
-    int8_t spare1; // was rssi2_filtered;
-    int8_t spare2; // was snr_filtered;
+    // the arq_ fields are the ARQ counts of the last second, only valid if arq_stats is set
+    uint8_t arq_first_attempt; // Rx' ARQ payloads which got through without retransmission, saturates at 255, was spare1, rssi2_filtered
+    uint8_t arq_retransmitted; // Rx' ARQ payloads which were sent again, saturates at 255, was spare2, snr_filtered
 
     // receiver side of things
 
@@ -173,7 +174,7 @@ typedef struct
     uint8_t transmit_antenna : 1;
     uint8_t receiver_receive_antenna : 1;
     uint8_t receiver_transmit_antenna : 1;
-    uint8_t spare3 : 1; // was diversity, pretty useless, so deprecate
+    uint8_t arq_stats : 1; // 1 = the arq_ fields are valid, 0 for firmware which doesn't have them, was spare3, diversity
     uint8_t spare4 : 1; // was receiver_diversity, pretty useless, so deprecate
     uint8_t rx1_valid : 1;
     uint8_t rx2_valid : 1;
@@ -201,11 +202,12 @@ typedef struct
     uint8_t fhss_cnt;
 
     uint8_t vehicle_state : 2; // 0 = disarmed, 1 = armed 2 = flying, 3 = invalid/unknown
-    uint8_t spare5 : 6;
+    uint8_t arq_retry_exhausted : 3; // Rx' ARQ payloads given up on, saturates at 7, was spare5
+    uint8_t arq_frame_lost : 3; // ARQ payloads passed on after lost payloads, saturates at 7, was spare5
 
     uint8_t link_state_connected : 1;
     uint8_t link_state_binding : 1;
-    uint8_t spare6 : 6;
+    uint8_t arq_duplicates : 6; // ARQ duplicate payloads rejected, saturates at 63, was spare6
 }) tMBridgeLinkStats; // 22 bytes
 
 
@@ -0,0 +1,205 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// RC Trace
+//*******************************************************
+// latency tracing of the rc data along its path
+// Tx: channels updated (crsf, mbridge, in) -> pack_txframe_payload_inplace()
+// Rx: frame read from sx -> check_txframe() -> rcdata_from_txframe() -> out.SendRcData()
+// the Tx and Rx clocks are not in sync, so each side traces its segments, the on-air time is
+// known from sx.TimeOverAir_us(), stick-to-output is the sum of the Tx total, the on-air time,
+// and the Rx total
+// a sample is followed through the points in order, a point which is hit out of order is ignored,
+// point 0 starts a new sample, so on the Tx the most recent channels update is traced
+// times are taken with micros16(), each segment thus must be shorter than 65 ms
+// the distribution of the total is recorded in a histogram, with 1 ms bins
+//*******************************************************
+#ifndef RC_TRACE_H
+#define RC_TRACE_H
+#pragma once
+
+
+#ifdef USE_FEATURE_RC_TRACE
+
+#define RC_TRACE(point)             rctrace.Mark(point)
+#define IF_RC_TRACE(x)              x
+
+#define RC_TRACE_HIST_NUM           64 // 1 ms bins, the last bin collects all larger values
+
+
+typedef enum {
+#ifdef DEVICE_IS_TRANSMITTER
+    RC_TRACE_INPUT = 0, // crsf.ChannelsUpdated(), mbridge.ChannelsUpdated(), in.Update()
+    RC_TRACE_PACK, // pack_txframe_payload_inplace()
+#else
+    RC_TRACE_RECEIVE = 0, // frame read from sx in do_receive()
+    RC_TRACE_CHECK, // check_txframe() passed
+    RC_TRACE_RCDATA, // rcdata_from_txframe()
+    RC_TRACE_OUT, // out.SendRcData(), SBUS/CRSF bytes are put into the uart
+#endif
+    RC_TRACE_POINT_NUM,
+} RC_TRACE_POINT_ENUM;
+
+
+const char* rc_trace_point_name[RC_TRACE_POINT_NUM] = {
+#ifdef DEVICE_IS_TRANSMITTER
+    "input",
+    "pack",
+#else
+    "receive",
+    "check",
+    "rcdata",
+    "out",
+#endif
+};
+
+
+typedef struct
+{
+    uint32_t cnt;
+    uint16_t min;
+    uint16_t max;
+    uint32_t sum;
+} tRcTraceStats;
+
+
+class tRcTrace
+{
+  public:
+    void Init(void);
+    void Mark(uint8_t point);
+    void Update1Hz(void);
+
+    // values of the last second, in us, segment n is from point n-1 to point n, segment 0 is the total
+    uint32_t Cnt(uint8_t seg) { return last[seg].cnt; }
+    uint16_t Min_us(uint8_t seg) { return (last[seg].cnt) ? last[seg].min : 0; }
+    uint16_t Max_us(uint8_t seg) { return last[seg].max; }
+    uint16_t Avg_us(uint8_t seg) { return (last[seg].cnt) ? last[seg].sum / last[seg].cnt : 0; }
+    uint16_t Percentile_ms(uint8_t p); // of the total, since Init()
+    uint8_t GetFloatArray(float* data);
+
+  private:
+    void clear(tRcTraceStats* s);
+    void add(tRcTraceStats* s, uint16_t dt);
+
+    tRcTraceStats cur[RC_TRACE_POINT_NUM];
+    tRcTraceStats last[RC_TRACE_POINT_NUM];
+    uint16_t tmark_us[RC_TRACE_POINT_NUM];
+    int8_t point_last; // -1 = no sample in trace
+    uint32_t hist[RC_TRACE_HIST_NUM];
+    uint32_t hist_cnt;
+};
+
+
+void tRcTrace::clear(tRcTraceStats* s)
+{
+    s->cnt = 0;
+    s->min = UINT16_MAX;
+    s->max = 0;
+    s->sum = 0;
+}
+
+
+void tRcTrace::add(tRcTraceStats* s, uint16_t dt)
+{
+    s->cnt++;
+    if (dt < s->min) s->min = dt;
+    if (dt > s->max) s->max = dt;
+    s->sum += dt;
+}
+
+
+void tRcTrace::Init(void)
+{
+    for (uint8_t n = 0; n < RC_TRACE_POINT_NUM; n++) {
+        clear(&cur[n]);
+        clear(&last[n]);
+        tmark_us[n] = 0;
+    }
+    point_last = -1;
+    for (uint8_t n = 0; n < RC_TRACE_HIST_NUM; n++) hist[n] = 0;
+    hist_cnt = 0;
+}
+
+
+void tRcTrace::Mark(uint8_t point)
+{
+    uint16_t tnow_us = micros16();
+
+    if (point == 0) { // start of a new sample
+        tmark_us[0] = tnow_us;
+        point_last = 0;
+        return;
+    }
+
+    if (point_last != point - 1) return; // out of order, not the sample we trace
+
+    tmark_us[point] = tnow_us;
+    point_last = point;
+    add(&cur[point], tmark_us[point] - tmark_us[point - 1]);
+
+    if (point < RC_TRACE_POINT_NUM - 1) return;
+
+    // sample has reached the last point
+    uint16_t dt = tnow_us - tmark_us[0];
+    add(&cur[0], dt);
+    uint8_t bin = dt / 1000;
+    if (bin >= RC_TRACE_HIST_NUM) bin = RC_TRACE_HIST_NUM - 1;
+    hist[bin]++;
+    hist_cnt++;
+    point_last = -1;
+}
+
+
+// call at 1 Hz, latches the values of the last second
+void tRcTrace::Update1Hz(void)
+{
+    for (uint8_t n = 0; n < RC_TRACE_POINT_NUM; n++) {
+        last[n] = cur[n];
+        clear(&cur[n]);
+    }
+}
+
+
+// upper edge of the bin, so it's an upper bound
+uint16_t tRcTrace::Percentile_ms(uint8_t p)
+{
+    if (!hist_cnt) return 0;
+
+    uint32_t cnt = 0;
+    for (uint8_t n = 0; n < RC_TRACE_HIST_NUM; n++) {
+        cnt += hist[n];
+        if (cnt * 100 >= hist_cnt * p) return n + 1;
+    }
+    return RC_TRACE_HIST_NUM;
+}
+
+
+// fills the array for the DEBUG_FLOAT_ARRAY message, which has 58 floats
+// data[0] = p50, data[1] = p99 of the total in ms, followed by cnt, min, avg, max in us for the total and each segment
+uint8_t tRcTrace::GetFloatArray(float* data)
+{
+    uint8_t len = 0;
+    data[len++] = Percentile_ms(50);
+    data[len++] = Percentile_ms(99);
+    for (uint8_t n = 0; n < RC_TRACE_POINT_NUM; n++) {
+        data[len++] = Cnt(n);
+        data[len++] = Min_us(n);
+        data[len++] = Avg_us(n);
+        data[len++] = Max_us(n);
+    }
+    return len;
+}
+
+
+#else
+
+#define RC_TRACE(point)
+#define IF_RC_TRACE(x)
+
+#endif // USE_FEATURE_RC_TRACE
+
+#endif // RC_TRACE_H
@@ -15,6 +15,28 @@
 #include "hal/hal.h"
 
 
+#ifdef HOST_SIM
+// the host simulation starts with an empty EEPROM, so it comes up with the defaults, which are
+// taken from the command line, see Common/host-lib/host-sim.h
+  #undef BIND_PHRASE
+  #undef SETUP_RF_BAND
+  #undef SETUP_MODE
+  #undef SETUP_RF_ORTHO
+  #undef SETUP_RX_SERIAL_LINK_MODE
+  #undef SETUP_TX_SERIAL_BAUDRATE
+  #undef SETUP_RX_SERIAL_BAUDRATE
+  #undef SETUP_TX_CHANNELS_SOURCE
+  #define BIND_PHRASE                     host_setup.BindPhrase
+  #define SETUP_RF_BAND                   host_setup.FrequencyBand
+  #define SETUP_MODE                      host_setup.Mode
+  #define SETUP_RF_ORTHO                  host_setup.Ortho
+  #define SETUP_RX_SERIAL_LINK_MODE       host_setup.SerialLinkMode
+  #define SETUP_TX_SERIAL_BAUDRATE        host_setup.TxSerialBaudrate
+  #define SETUP_RX_SERIAL_BAUDRATE        host_setup.RxSerialBaudrate
+  #define SETUP_TX_CHANNELS_SOURCE        0 // none
+#endif
+
+
 tSetupMetaData SetupMetaData;
 tSetup Setup;
 tGlobalConfig Config;
@@ -170,6 +192,7 @@ void setup_configure_metadata(void)
     strcpy(SetupMetaData.rx_device_name, "");
     SetupMetaData.rx_actual_power_dbm = INT8_MAX;
     SetupMetaData.rx_actual_diversity = DIVERSITY_NUM;
+    SetupMetaData.rx_frame_varlen = false;
 }
 
 
@@ -383,6 +383,7 @@ typedef struct
     char rx_device_name[20+1];
     int8_t rx_actual_power_dbm;
     uint8_t rx_actual_diversity;
+    bool rx_frame_varlen;
 } tSetupMetaData;
 
 
@@ -41,6 +41,8 @@ typedef struct
     uint8_t Whitening;
     uint32_t TimeOverAir; // in us
     int16_t ReceiverSensitivity;
+    uint32_t TimeOverAirVarlen; // in us, with USE_FEATURE_FRAME_VARLEN, full frame with length byte, see tools/airtime
+    uint32_t TimeOverAirShort; // in us, with USE_FEATURE_FRAME_VARLEN, short Tx frame
 } tSxGfskConfiguration;
 
 
@@ -55,6 +57,8 @@ const tSxLoraConfiguration Sx126xLoraConfiguration[] = {
       .InvertIQ = SX126X_LORA_IQ_NORMAL,
       .TimeOverAir = 13200,
       .ReceiverSensitivity = -111,
+      .TimeOverAirVarlen = 13520,
+      .TimeOverAirShort = 5200,
     },
     { .SpreadingFactor = SX126X_LORA_SF6,
       .Bandwidth = SX126X_LORA_BW_500,
@@ -66,6 +70,8 @@ const tSxLoraConfiguration Sx126xLoraConfiguration[] = {
       .InvertIQ = SX126X_LORA_IQ_NORMAL,
       .TimeOverAir = 22560,
       .ReceiverSensitivity = -112, // Q: SF5 with CR4/8 would be -111 dBm, 20.1 ms, better option??
+      .TimeOverAirVarlen = 23200,
+      .TimeOverAirShort = 9120,
     }
 };
 
@@ -84,7 +90,9 @@ const tSxGfskConfiguration Sx126xGfskConfiguration[] = {
       .CRCType = SX126X_GFSK_CRC_OFF,
       .Whitening = SX126X_GFSK_WHITENING_ENABLE,
       .TimeOverAir = 7600,
-      .ReceiverSensitivity = -106  // This is a guess, data sheet is vague here
+      .ReceiverSensitivity = -106, // This is a guess, data sheet is vague here
+      .TimeOverAirVarlen = 7680,
+      .TimeOverAirShort = 2560,
     }
 };
 
@@ -126,6 +134,7 @@ class Sx126xDriverCommon : public Sx126xDriverBase
         osc_configuration = SX12xx_OSCILLATOR_CONFIG_TCXO_1P8_V;
         lora_configuration = nullptr;
         gfsk_configuration = nullptr;
+        IF_FRAME_VARLEN(varlen = false;)
     }
 
     //-- high level API functions
@@ -151,6 +160,8 @@ class Sx126xDriverCommon : public Sx126xDriverBase
         // set LoRaSymbNumTimeout for false detection of preamble
         // must come in this order, datasheet 14.5 Issuing Commands in the Right Order, p.103
         SetSymbNumTimeout((config->PreambleLength * 3) >> 2);
+
+        IF_FRAME_VARLEN(payload_length = (varlen) ? 0 : config->PayloadLength;) // 0 enforces to set the format in set_payload_length()
     }
 
     void SetLoraConfigurationByIndex(uint8_t index)
@@ -183,6 +194,8 @@ class Sx126xDriverCommon : public Sx126xDriverBase
                             config->Whitening);
 
         SetSyncWordGFSK(sync_word);
+
+        IF_FRAME_VARLEN(payload_length = (varlen) ? 0 : config->PayloadLength;) // 0 enforces to set the format in set_payload_length()
     }
 
     void SetGfskConfigurationByIndex(uint8_t index, uint16_t sync_word)
@@ -276,11 +289,13 @@ class Sx126xDriverCommon : public Sx126xDriverBase
         uint8_t rxPayloadLength;
 
         GetRxBufferStatus(&rxPayloadLength, &rxStartBufferPointer);
+        IF_FRAME_VARLEN(if (varlen && rxPayloadLength && rxPayloadLength < len) len = rxPayloadLength;)
         ReadBuffer(rxStartBufferPointer, data, len);
     }
 
     void SendFrame(uint8_t* data, uint8_t len, uint16_t tmo_ms)
     {
+        IF_FRAME_VARLEN(set_payload_length(len);)
         WriteBuffer(0, data, len);
         ClearIrqStatus(SX126X_IRQ_ALL);
         SetTx(tmo_ms * 64); // 0 = no timeout. TimeOut period inn ms. sx1262 have static 15p625 period base, so for 1 ms needs 64 tmo value
@@ -288,10 +303,22 @@ class Sx126xDriverCommon : public Sx126xDriverBase
 
     void SetToRx(uint16_t tmo_ms)
     {
+        IF_FRAME_VARLEN(set_payload_length(FRAME_TX_RX_LEN);) // in rx it's the max length
         ClearIrqStatus(SX126X_IRQ_ALL);
         SetRx(tmo_ms * 64); // 0 = no timeout
     }
 
+#ifdef USE_FEATURE_FRAME_VARLEN
+    // short frames need header resp. variable length packets, they are agreed on at connect, see frames.h
+    // becomes effective with the next SendFrame() or SetToRx()
+    void SetVarlen(bool _varlen)
+    {
+        if (_varlen == varlen) return;
+        varlen = _varlen;
+        payload_length = 0; // enforces to set the format
+    }
+#endif
+
     void SetToIdle(void)
     {
         SetFs();
@@ -341,9 +368,19 @@ class Sx126xDriverCommon : public Sx126xDriverBase
     {
         if (lora_configuration == nullptr && gfsk_configuration == nullptr) config_calc(); // ensure it is set
 
+#ifdef USE_FEATURE_FRAME_VARLEN
+        if (varlen) return (gconfig->modeIsLora()) ? lora_configuration->TimeOverAirVarlen : gfsk_configuration->TimeOverAirVarlen;
+#endif
         return (gconfig->modeIsLora()) ? lora_configuration->TimeOverAir : gfsk_configuration->TimeOverAir;
     }
 
+    uint32_t TimeOverAirShort_us(void)
+    {
+        if (lora_configuration == nullptr && gfsk_configuration == nullptr) config_calc(); // ensure it is set
+
+        return (gconfig->modeIsLora()) ? lora_configuration->TimeOverAirShort : gfsk_configuration->TimeOverAirShort;
+    }
+
     int16_t ReceiverSensitivity_dbm(void)
     {
         if (lora_configuration == nullptr && gfsk_configuration == nullptr) config_calc(); // ensure it is set
@@ -367,6 +404,38 @@ class Sx126xDriverCommon : public Sx126xDriverBase
     const tSxGfskConfiguration* gfsk_configuration;
     uint8_t sx_power;
     int8_t actual_power_dbm;
+
+#ifdef USE_FEATURE_FRAME_VARLEN
+    bool varlen;
+    uint8_t payload_length;
+
+    // with header resp. variable length packets the length must be set for each tx frame, in rx it is the max length
+    // without, the configuration's fixed length format is restored
+    void set_payload_length(uint8_t len)
+    {
+        if (!varlen) len = FRAME_TX_RX_LEN;
+        if (len == payload_length) return;
+        payload_length = len;
+
+        if (gconfig->modeIsLora()) {
+            SetPacketParams(lora_configuration->PreambleLength,
+                            (varlen) ? SX126X_LORA_HEADER_ENABLE : lora_configuration->HeaderType,
+                            len,
+                            lora_configuration->CrcEnabled,
+                            lora_configuration->InvertIQ);
+            SetSymbNumTimeout((lora_configuration->PreambleLength * 3) >> 2); // must come after SetPacketParams
+        } else {
+            SetPacketParamsGFSK(gfsk_configuration->PreambleLength,
+                                gfsk_configuration->PreambleDetectorLength,
+                                gfsk_configuration->SyncWordLength,
+                                gfsk_configuration->AddrComp,
+                                (varlen) ? SX126X_GFSK_PKT_VAR_LEN : gfsk_configuration->PacketType,
+                                len,
+                                gfsk_configuration->CRCType,
+                                gfsk_configuration->Whitening);
+        }
+    }
+#endif
 };
 
 
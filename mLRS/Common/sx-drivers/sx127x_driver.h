@@ -17,6 +17,11 @@
 #pragma once
 
 
+#ifdef USE_FEATURE_FRAME_VARLEN
+  #error USE_FEATURE_FRAME_VARLEN not supported by SX127x, SF6 is implicit header only !
+#endif
+
+
 /* on syncword
 https://forum.arduino.cc/t/what-is-sync-word-lora/629624/5:
 The default private syncwords are 0x12 for SX127x devices and 0x1424 for SX126x devices.
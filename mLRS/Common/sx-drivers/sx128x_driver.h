@@ -35,6 +35,8 @@ typedef struct
     uint16_t CrcSeed;
     uint32_t TimeOverAir; // in us
     int16_t ReceiverSensitivity;
+    uint32_t TimeOverAirVarlen; // in us, with USE_FEATURE_FRAME_VARLEN, full frame with header, see tools/airtime
+    uint32_t TimeOverAirShort; // in us, with USE_FEATURE_FRAME_VARLEN, short Tx frame
 } tSxFlrcConfiguration;
 
 
@@ -49,6 +51,8 @@ const tSxLoraConfiguration Sx128xLoraConfiguration[] = {
       .InvertIQ = SX1280_LORA_IQ_NORMAL,
       .TimeOverAir = 7892,
       .ReceiverSensitivity = -105,
+      .TimeOverAirVarlen = 8083,
+      .TimeOverAirShort = 3109,
     },
     { .SpreadingFactor = SX1280_LORA_SF6,
       .Bandwidth = SX1280_LORA_BW_800,
@@ -60,6 +64,8 @@ const tSxLoraConfiguration Sx128xLoraConfiguration[] = {
       .InvertIQ = SX1280_LORA_IQ_NORMAL,
       .TimeOverAir = 13418,
       .ReceiverSensitivity = -108,
+      .TimeOverAirVarlen = 13799,
+      .TimeOverAirShort = 5424,
     },
     { .SpreadingFactor = SX1280_LORA_SF7,
       .Bandwidth = SX1280_LORA_BW_800,
@@ -71,6 +77,8 @@ const tSxLoraConfiguration Sx128xLoraConfiguration[] = {
       .InvertIQ = SX1280_LORA_IQ_NORMAL,
       .TimeOverAir = 23527,
       .ReceiverSensitivity = -112,
+      .TimeOverAirVarlen = 23527,
+      .TimeOverAirShort = 9800,
     }
 };
 
@@ -88,6 +96,8 @@ const tSxFlrcConfiguration Sx128xFlrcConfiguration[] = {
       .CrcSeed = 27368, // CrcSeed is 'j', 'p'. Not used.
       .TimeOverAir = 2383,
       .ReceiverSensitivity = -104,
+      .TimeOverAirVarlen = 2408,
+      .TimeOverAirShort = 815,
     }
 };
 
@@ -114,6 +124,7 @@ class Sx128xDriverCommon : public Sx128xDriverBase
     {
         lora_configuration = nullptr;
         flrc_configuration = nullptr;
+        IF_FRAME_VARLEN(varlen = false;)
     }
 
     //-- high level API functions
@@ -135,6 +146,8 @@ class Sx128xDriverCommon : public Sx128xDriverBase
                         config->PayloadLength,
                         config->CrcEnabled,
                         config->InvertIQ);
+
+        IF_FRAME_VARLEN(payload_length = (varlen) ? 0 : config->PayloadLength;) // 0 enforces to set the format in set_payload_length()
     }
 
     void SetLoraConfigurationByIndex(uint8_t index)
@@ -168,6 +181,8 @@ class Sx128xDriverCommon : public Sx128xDriverBase
                             config->CrcSeed);
 
         SetSyncWordFLRC(sync_word, config->CodingRate);
+
+        IF_FRAME_VARLEN(payload_length = (varlen) ? 0 : config->PayloadLength;) // 0 enforces to set the format in set_payload_length()
     }
 
     void SetFlrcConfigurationByIndex(uint8_t index, uint32_t sync_word)
@@ -232,11 +247,13 @@ class Sx128xDriverCommon : public Sx128xDriverBase
         GetRxBufferStatus(&rxPayloadLength, &rxStartBufferPointer);
         // if one wants it, it could be obtained from what had been set
         // rxPayloadLength = ReadRegister(SX1280_REG_PayloadLength);
+        IF_FRAME_VARLEN(if (varlen && rxPayloadLength && rxPayloadLength < len) len = rxPayloadLength;)
         ReadBuffer(rxStartBufferPointer, data, len);
     }
 
     void SendFrame(uint8_t* data, uint8_t len, uint16_t tmo_ms)
     {
+        IF_FRAME_VARLEN(set_payload_length(len);)
         WriteBuffer(0, data, len);
         ClearIrqStatus(SX1280_IRQ_ALL);
         SetTx(SX1280_PERIODBASE_62p5_US, tmo_ms*16); // 0 = no timeout, if a Tx timeout occurs we have a serious problem
@@ -244,10 +261,22 @@ class Sx128xDriverCommon : public Sx128xDriverBase
 
     void SetToRx(uint16_t tmo_ms)
     {
+        IF_FRAME_VARLEN(set_payload_length(FRAME_TX_RX_LEN);) // in rx it's the max length
         ClearIrqStatus(SX1280_IRQ_ALL);
         SetRx(SX1280_PERIODBASE_62p5_US, tmo_ms*16); // 0 = no timeout
     }
 
+#ifdef USE_FEATURE_FRAME_VARLEN
+    // short frames need header resp. variable length packets, they are agreed on at connect, see frames.h
+    // becomes effective with the next SendFrame() or SetToRx()
+    void SetVarlen(bool _varlen)
+    {
+        if (_varlen == varlen) return;
+        varlen = _varlen;
+        payload_length = 0; // enforces to set the format
+    }
+#endif
+
     void SetToIdle(void)
     {
         SetFs();
@@ -299,9 +328,19 @@ class Sx128xDriverCommon : public Sx128xDriverBase
     {
         if (lora_configuration == nullptr && flrc_configuration == nullptr) config_calc(); // ensure it is set
 
+#ifdef USE_FEATURE_FRAME_VARLEN
+        if (varlen) return (gconfig->modeIsLora()) ? lora_configuration->TimeOverAirVarlen : flrc_configuration->TimeOverAirVarlen;
+#endif
         return (gconfig->modeIsLora()) ? lora_configuration->TimeOverAir : flrc_configuration->TimeOverAir;
     }
 
+    uint32_t TimeOverAirShort_us(void)
+    {
+        if (lora_configuration == nullptr && flrc_configuration == nullptr) config_calc(); // ensure it is set
+
+        return (gconfig->modeIsLora()) ? lora_configuration->TimeOverAirShort : flrc_configuration->TimeOverAirShort;
+    }
+
     int16_t ReceiverSensitivity_dbm(void)
     {
         if (lora_configuration == nullptr && flrc_configuration == nullptr) config_calc(); // ensure it is set
@@ -322,6 +361,36 @@ class Sx128xDriverCommon : public Sx128xDriverBase
     tSxGlobalConfig* gconfig;
     uint8_t sx_power;
     int8_t actual_power_dbm;
+
+#ifdef USE_FEATURE_FRAME_VARLEN
+    bool varlen;
+    uint8_t payload_length;
+
+    // with header resp. variable length packets the length must be set for each tx frame, in rx it is the max length
+    // without, the configuration's fixed length format is restored
+    void set_payload_length(uint8_t len)
+    {
+        if (!varlen) len = FRAME_TX_RX_LEN;
+        if (len == payload_length) return;
+        payload_length = len;
+
+        if (gconfig->modeIsLora()) {
+            SetPacketParams(lora_configuration->PreambleLength,
+                            (varlen) ? SX1280_LORA_HEADER_ENABLE : lora_configuration->HeaderType,
+                            len,
+                            lora_configuration->CrcEnabled,
+                            lora_configuration->InvertIQ);
+        } else {
+            SetPacketParamsFLRC(flrc_configuration->AGCPreambleLength,
+                                flrc_configuration->SyncWordLength,
+                                flrc_configuration->SyncWordMatch,
+                                (varlen) ? SX1280_FLRC_PACKET_TYPE_VARIABLE_LENGTH : flrc_configuration->PacketType,
+                                len,
+                                flrc_configuration->CrcLength,
+                                flrc_configuration->CrcSeed);
+        }
+    }
+#endif
 };
 
 
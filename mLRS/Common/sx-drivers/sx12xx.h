@@ -16,7 +16,14 @@
 #include "../hal/device_conf.h"
 
 
-#if defined DEVICE_HAS_SX126x || defined DEVICE_HAS_DUAL_SX126x_SX126x
+#ifdef HOST_SIM
+  // chip models of the host simulation, they replace the sx12xx-lib
+  #if defined DEVICE_HAS_SX126x
+    #include "../host-lib/host-sx126x.h"
+  #else
+    #include "../host-lib/host-sx128x.h"
+  #endif
+#elif defined DEVICE_HAS_SX126x || defined DEVICE_HAS_DUAL_SX126x_SX126x
   #include "../../modules/sx12xx-lib/src/sx126x.h"
 #elif defined DEVICE_HAS_DUAL_SX126x_SX128x
   #include "../../modules/sx12xx-lib/src/sx126x.h"
@@ -77,6 +77,8 @@ typedef struct
     uint8_t InvertIQ;
     uint32_t TimeOverAir; // in us
     int16_t ReceiverSensitivity;
+    uint32_t TimeOverAirVarlen; // in us, with USE_FEATURE_FRAME_VARLEN, full frame with header, see tools/airtime
+    uint32_t TimeOverAirShort; // in us, with USE_FEATURE_FRAME_VARLEN, short Tx frame
 } tSxLoraConfiguration;
 
 
@@ -93,6 +95,9 @@ class SxDriverDummy
     void ReadFrame(uint8_t* data, uint8_t len) {}
     void SetToRx(uint16_t tmo_ms) {}
     void SetToIdle(void) {}
+    void SetVarlen(bool _varlen) {}
+    uint32_t TimeOverAir_us(void) { return 0; }
+    uint32_t TimeOverAirShort_us(void) { return 0; }
 
     void ResetToLoraConfiguration() {}
     void SetRfPower_dbm(int8_t power_dbm) {}
@@ -19,6 +19,13 @@
 #define MAVLINKX_CRC8_LOOKUP_TABLE
 #define MAVLINKX_COMPRESSION // compression with O3 costs ca 8 kB flash
 #define MAVLINKX_O3
+//#define MAVLINKX_DELTA // stateful delta compression, needs MAVLINKX_COMPRESSION, costs ca 1.2 kB RAM
+//#define MAVLINKX_CONTEXT // header context dictionary, costs ca 0.4 kB RAM
+
+
+#if defined MAVLINKX_DELTA && !defined MAVLINKX_COMPRESSION
+  #error MAVLINKX_DELTA needs MAVLINKX_COMPRESSION
+#endif
 
 
 //-------------------------------------------------------
@@ -55,7 +62,23 @@
 // msgid1
 //   msgid2
 //   msgid3
+//   context
 //   crcextra
+//   delta
+// crc8
+//
+// with a context index the seq, sysid, compid, msgid fields are replaced by the context field
+//
+// STX1
+// STX2
+// flags
+//   flagsext
+// len
+// context
+//   tsysid
+//   tcompid
+//   crcextra
+//   delta
 // crc8
 
 // TODO: do we really need two STX bytes?
@@ -78,15 +101,17 @@
 
 #define MAVLINKX_MAGIC_1              0x6F // 'o'
 #define MAVLINKX_MAGIC_2              0x77 // 'w'
-#define MAVLINKX_HEADER_LEN_MAX       17 // can be 9 to 17
-#define MAVLINKX_FRAME_LEN_MAX        287 // =  HEADER_LEN_MAX + PAYLOAD_LEN_MAX + CHECKSUM_LEN + SIGNATURE_LEN
+#define MAVLINKX_HEADER_LEN_MAX       19 // can be 6 to 19
+#define MAVLINKX_FRAME_LEN_MAX        289 // =  HEADER_LEN_MAX + PAYLOAD_LEN_MAX + CHECKSUM_LEN + SIGNATURE_LEN
 
 
 typedef enum {
     MAVLINKX_FLAGS_IS_V1              = 0x01,
     MAVLINKX_FLAGS_HAS_MSGID16        = 0x02,
+    MAVLINKX_FLAGS_HAS_CONTEXT        = 0x04, // has the context field, see header context
     MAVLINKX_FLAGS_HAS_TARGETS        = 0x08,
     MAVLINKX_FLAGS_HAS_CRC_EXTRA      = 0x10, // not yet used, indicates the possibility
+    MAVLINKX_FLAGS_HAS_DELTA          = 0x20, // has the delta field, see delta compression
     MAVLINKX_FLAGS_IS_COMPRESSED      = 0x40,
     MAVLINKX_FLAGS_HAS_EXTENSION      = 0x80,
 } fmavx_flags_e;
@@ -96,6 +121,7 @@ typedef enum {
     MAVLINKX_FLAGS_EXT_HAS_SIGNATURE  = 0x01,
     MAVLINKX_FLAGS_EXT_HAS_MSGID24    = 0x02,
     MAVLINKX_FLAGS_EXT_HAS_SYSID16    = 0x04, // not yet used, indicates the possibility
+    MAVLINKX_FLAGS_EXT_DEFINES_CONTEXT = 0x08, // the context field defines a context index, the header is complete
 } fmavx_flags_ext_e;
 
 
@@ -105,7 +131,9 @@ typedef enum { // extend fastMavlink's FASTMAVLINK_PARSE_STATE enum
     FASTMAVLINK_PARSE_STATE_FLAGS_EXTENSION,
     FASTMAVLINK_PARSE_STATE_TARGET_SYSID,
     FASTMAVLINK_PARSE_STATE_TARGET_COMPID,
+    FASTMAVLINK_PARSE_STATE_CONTEXT,
     FASTMAVLINK_PARSE_STATE_CRC_EXTRA,
+    FASTMAVLINK_PARSE_STATE_DELTA,
     FASTMAVLINK_PARSE_STATE_CRC8,
 } fmavx_parse_state_e;
 
@@ -120,6 +148,8 @@ typedef struct
     uint8_t target_sysid;
     uint8_t target_compid;
     uint8_t crc_extra;
+    uint8_t delta;
+    uint8_t context;
     uint8_t rx_payload_len;
 
     // for compression
@@ -140,6 +170,8 @@ void fmavX_status_reset(fmavx_status_t* const xstatus)
 typedef struct
 {
     uint8_t compression_enabled;
+    uint8_t delta_enabled;
+    uint8_t context_enabled;
 } fmavx_config_t;
 
 static fmavx_config_t fmavx_config_g = {}; // we use a global here
@@ -151,14 +183,86 @@ void fmavX_config_compression(uint8_t compression_flag)
 }
 
 
+// both sides must have it enabled
+void fmavX_config_delta(uint8_t delta_flag)
+{
+    fmavx_config_g.delta_enabled = (delta_flag) ? 1 : 0;
+}
+
+
+// both sides must have it enabled
+void fmavX_config_context(uint8_t context_flag)
+{
+    fmavx_config_g.context_enabled = (context_flag) ? 1 : 0;
+}
+
+
 // TODO: shouldn't be global
 fmavx_status_t fmavx_status = {};
 
 
+// what the converter needs to know of a frame, so that it can work from a fmav_message_t as well as from a frame_buf
+typedef struct
+{
+    uint8_t magic;
+    uint8_t len;
+    uint8_t incompat_flags;
+    uint8_t seq;
+    uint8_t sysid;
+    uint8_t compid;
+    uint32_t msgid;
+    uint8_t target_sysid;
+    uint8_t target_compid;
+    uint8_t crc_extra;
+    const uint8_t* payload;
+    uint16_t checksum;
+    const uint8_t* signature_a;
+} fmavx_frame_t;
+
+
 #ifdef MAVLINKX_COMPRESSION
 uint8_t _fmavX_payload_compress(uint8_t* const payload_out, uint8_t* const len_out, const uint8_t* const payload, uint8_t len);
 void _fmavX_payload_decompress(uint8_t* const payload_out, uint8_t* const len_out, uint8_t len);
 #endif
+#ifdef MAVLINKX_DELTA
+#define MAVLINKX_DELTA_REF_NUM              8
+#define MAVLINKX_DELTA_PAYLOAD_LEN_MAX      64 // covers SYS_STATUS, GPS_RAW_INT, BATTERY_STATUS
+#define MAVLINKX_DELTA_REFERENCE_INTERVAL   8 // a new reference after so many messages
+#define MAVLINKX_DELTA_IS_REFERENCE         0x80 // in the delta field, the lower 7 bits are the epoch
+
+typedef enum {
+    MAVLINKX_DELTA_RES_NONE = 0, // send as usual
+    MAVLINKX_DELTA_RES_REFERENCE, // send as usual, but with delta field, it becomes the new reference
+    MAVLINKX_DELTA_RES_DELTA, // payload is the compressed delta to the reference
+} fmavx_delta_res_e;
+
+void fmavX_delta_reset(void);
+uint8_t _fmavX_delta_encode(uint8_t* const payload_out, uint8_t* const len_out, uint8_t* const delta, const fmavx_frame_t* const msg);
+uint8_t _fmavX_delta_is_reference_due(const fmavx_frame_t* const msg);
+uint8_t _fmavX_delta_decode(uint8_t* const buf, uint8_t len);
+void _fmavX_delta_store_reference(const uint8_t* const buf);
+#endif
+#ifdef MAVLINKX_CONTEXT
+#define MAVLINKX_CONTEXT_NUM                16 // the index is 4 bits
+#define MAVLINKX_CONTEXT_REFRESH_INTERVAL   16 // the index is defined again after so many uses
+#define MAVLINKX_CONTEXT_SEQ_GAP_MAX        8 // so that a lost message doesn't break the implicit seq
+#define MAVLINKX_CONTEXT_AGE_MIN            64 // an index is taken for another tuple only if it was unused for so many messages
+
+typedef enum {
+    MAVLINKX_CONTEXT_RES_NONE = 0, // send as usual
+    MAVLINKX_CONTEXT_RES_DEFINE, // send as usual, but with context field, which defines the index
+    MAVLINKX_CONTEXT_RES_INDEX, // send with the context field instead of seq, sysid, compid, msgid
+} fmavx_context_res_e;
+
+void fmavX_context_reset(void);
+uint8_t _fmavX_context_encode(uint8_t* const context, const fmavx_frame_t* const msg, uint8_t no_index);
+uint8_t _fmavX_context_decode(uint8_t* const buf, fmav_status_t* const status, uint8_t c);
+void _fmavX_context_update(const uint8_t* const buf);
+uint8_t _fmavX_context_take_next_replaces(void);
+#endif
+void fmavX_state_reset(void);
+uint8_t fmavX_last_is_reference(void);
+void fmavX_next_replaces(void);
 
 
 //-------------------------------------------------------
@@ -171,6 +275,10 @@ FASTMAVLINK_FUNCTION_DECORATOR void fmavX_init(void)
     memset((uint8_t*)&fmavx_status, 0, sizeof(fmavx_status));
 
     fmavx_config_g.compression_enabled = 0; // disable it per default
+    fmavx_config_g.delta_enabled = 0;
+    fmavx_config_g.context_enabled = 0;
+
+    fmavX_state_reset();
 }
 
 
@@ -312,10 +420,12 @@ FASTMAVLINK_FUNCTION_DECORATOR void fmavX_crc8_init(uint8_t* crc)
 //-------------------------------------------------------
 // Converter
 //-------------------------------------------------------
-// convert fmav msg structure into fmavX packet
+// convert fmav msg structure, or fmav frame_buf, into fmavX packet
 // fmav_message_t has all info on the packet which we need, so it's quite straightforward to do
+// the frame_buf has it too, together with the result of the parser, and going from it saves the
+// copy into fmav_message_t, and the fmav_message_t
 
-FASTMAVLINK_FUNCTION_DECORATOR uint16_t fmavX_msg_to_frame_bufX(uint8_t* const buf, const fmav_message_t* const msg)
+FASTMAVLINK_FUNCTION_DECORATOR uint16_t _fmavX_frame_to_frame_bufX(uint8_t* const buf, const fmavx_frame_t* const msg)
 {
     uint16_t pos = 0;
     uint8_t flags_ext = 0;
@@ -351,6 +461,31 @@ FASTMAVLINK_FUNCTION_DECORATOR uint16_t fmavX_msg_to_frame_bufX(uint8_t* const b
     // we should do it based on whether we know the message, but we don't currently have that info easily available in msg
     // if (known) buf[2] |= MAVLINKX_FLAGS_HAS_CRC_EXTRA;
 
+#ifdef MAVLINKX_CONTEXT
+    uint8_t context;
+    uint8_t context_res = MAVLINKX_CONTEXT_RES_NONE;
+    uint8_t replaces = _fmavX_context_take_next_replaces();
+    if (fmavx_config_g.context_enabled) {
+        // the receiver doesn't see the replaced frame, so couldn't follow the seq
+        uint8_t no_index = replaces;
+#ifdef MAVLINKX_DELTA
+        // a delta reference goes with full header, so that it doesn't depend on the context
+        if (fmavx_config_g.delta_enabled && _fmavX_delta_is_reference_due(msg)) no_index = 1;
+#endif
+        context_res = _fmavX_context_encode(&context, msg, no_index);
+    }
+    if (context_res == MAVLINKX_CONTEXT_RES_DEFINE) {
+        buf[2] |= MAVLINKX_FLAGS_HAS_CONTEXT | MAVLINKX_FLAGS_HAS_EXTENSION;
+        flags_ext |= MAVLINKX_FLAGS_EXT_DEFINES_CONTEXT;
+    }
+    if (context_res == MAVLINKX_CONTEXT_RES_INDEX) {
+        buf[2] |= MAVLINKX_FLAGS_HAS_CONTEXT;
+        buf[2] &=~ MAVLINKX_FLAGS_HAS_MSGID16; // there is no msgid field
+        flags_ext &=~ MAVLINKX_FLAGS_EXT_HAS_MSGID24;
+        if (!flags_ext) buf[2] &=~ MAVLINKX_FLAGS_HAS_EXTENSION;
+    }
+#endif
+
     pos = 3;
 
     // flags extension
@@ -363,6 +498,16 @@ FASTMAVLINK_FUNCTION_DECORATOR uint16_t fmavX_msg_to_frame_bufX(uint8_t* const b
     uint8_t pos_of_len = pos;
 #endif
     buf[pos++] = msg->len;
+#ifdef MAVLINKX_CONTEXT
+    if (context_res == MAVLINKX_CONTEXT_RES_INDEX) {
+        buf[pos++] = context; // replaces seq, sysid, compid, msgid
+
+        if (buf[2] & MAVLINKX_FLAGS_HAS_TARGETS) {
+            buf[pos++] = msg->target_sysid;
+            buf[pos++] = msg->target_compid;
+        }
+    } else {
+#endif
     buf[pos++] = msg->seq;
     buf[pos++] = msg->sysid;
     buf[pos++] = msg->compid;
@@ -375,12 +520,18 @@ FASTMAVLINK_FUNCTION_DECORATOR uint16_t fmavX_msg_to_frame_bufX(uint8_t* const b
 
     // msgid
     buf[pos++] = (uint8_t)msg->msgid;
-    if (buf[2] & MAVLINKX_FLAGS_HAS_MSGID16) {
+    if ((buf[2] & MAVLINKX_FLAGS_HAS_MSGID16) || (flags_ext & MAVLINKX_FLAGS_EXT_HAS_MSGID24)) { // a 24 bit msgid has msgid2 too
         buf[pos++] = (uint8_t)((msg->msgid) >> 8);
     }
     if (flags_ext & MAVLINKX_FLAGS_EXT_HAS_MSGID24) {
         buf[pos++] = (uint8_t)((msg->msgid) >> 16);
     }
+#ifdef MAVLINKX_CONTEXT
+    }
+    if (context_res == MAVLINKX_CONTEXT_RES_DEFINE) {
+        buf[pos++] = context;
+    }
+#endif
 
     // extra crc
     if (buf[2] & MAVLINKX_FLAGS_HAS_CRC_EXTRA) {
@@ -397,6 +548,21 @@ FASTMAVLINK_FUNCTION_DECORATOR uint16_t fmavX_msg_to_frame_bufX(uint8_t* const b
     // we should want to remove the targets if there are any, for the moment we just don't
     // do compression, but do not advance pos since we need to do crc8
     uint8_t len;
+#ifdef MAVLINKX_DELTA
+    uint8_t delta;
+    uint8_t res = MAVLINKX_DELTA_RES_NONE;
+    if (fmavx_config_g.delta_enabled) {
+        res = _fmavX_delta_encode(&(buf[pos + 2]), &len, &delta, msg);
+    }
+    if (res != MAVLINKX_DELTA_RES_NONE) {
+        buf[2] |= MAVLINKX_FLAGS_HAS_DELTA;
+        buf[pos++] = delta; // the delta field, payload was placed behind it
+    }
+    if (res == MAVLINKX_DELTA_RES_DELTA) {
+        buf[2] |= MAVLINKX_FLAGS_IS_COMPRESSED; // the delta is always compressed
+        buf[pos_of_len] = len;
+    } else
+#endif
     if (fmavx_config_g.compression_enabled &&
         _fmavX_payload_compress(&(buf[pos + 1]), &len, msg->payload, msg->len)) {
         buf[2] |= MAVLINKX_FLAGS_IS_COMPRESSED;
@@ -435,12 +601,97 @@ FASTMAVLINK_FUNCTION_DECORATOR uint16_t fmavX_msg_to_frame_bufX(uint8_t* const b
 }
 
 
+FASTMAVLINK_FUNCTION_DECORATOR uint16_t fmavX_msg_to_frame_bufX(uint8_t* const buf, const fmav_message_t* const msg)
+{
+fmavx_frame_t frame;
+
+    frame.magic = msg->magic;
+    frame.len = msg->len;
+    frame.incompat_flags = msg->incompat_flags;
+    frame.seq = msg->seq;
+    frame.sysid = msg->sysid;
+    frame.compid = msg->compid;
+    frame.msgid = msg->msgid;
+    frame.target_sysid = msg->target_sysid;
+    frame.target_compid = msg->target_compid;
+    frame.crc_extra = msg->crc_extra;
+    frame.payload = msg->payload;
+    frame.checksum = msg->checksum;
+    frame.signature_a = msg->signature_a;
+
+    return _fmavX_frame_to_frame_bufX(buf, &frame);
+}
+
+
+// frame_buf must have been checked by the parser, as for fmav_frame_buf_to_msg()
+// buf and frame_buf must not be the same
+FASTMAVLINK_FUNCTION_DECORATOR uint16_t fmavX_frame_buf_to_frame_bufX(uint8_t* const buf, const uint8_t* const frame_buf, const fmav_result_t* const result)
+{
+fmavx_frame_t frame;
+uint8_t header_len;
+
+    frame.magic = frame_buf[0];
+    frame.len = frame_buf[1];
+    if (frame.magic == FASTMAVLINK_MAGIC_V1) {
+        header_len = FASTMAVLINK_HEADER_V1_LEN;
+        frame.incompat_flags = 0;
+        frame.seq = frame_buf[2];
+        frame.sysid = frame_buf[3];
+        frame.compid = frame_buf[4];
+        frame.msgid = frame_buf[5];
+    } else {
+        header_len = FASTMAVLINK_HEADER_V2_LEN;
+        frame.incompat_flags = frame_buf[2];
+        frame.seq = frame_buf[4];
+        frame.sysid = frame_buf[5];
+        frame.compid = frame_buf[6];
+        frame.msgid = (uint32_t)frame_buf[7] + ((uint32_t)frame_buf[8] << 8) + ((uint32_t)frame_buf[9] << 16);
+    }
+    frame.target_sysid = result->target_sysid;
+    frame.target_compid = result->target_compid;
+    frame.crc_extra = result->crc_extra;
+    frame.payload = &(frame_buf[header_len]);
+    frame.checksum = (uint16_t)frame_buf[header_len + frame.len] + ((uint16_t)frame_buf[header_len + frame.len + 1] << 8);
+    frame.signature_a = &(frame_buf[header_len + frame.len + FASTMAVLINK_CHECKSUM_LEN]);
+
+    return _fmavX_frame_to_frame_bufX(buf, &frame);
+}
+
+
 //-------------------------------------------------------
 // Parser
 //-------------------------------------------------------
 // parse the fmavX stream into regular fmav frame_buf
 // returns NONE, HAS_HEADER, or OK
 
+FASTMAVLINK_FUNCTION_DECORATOR uint8_t _fmavX_parse_state_delta_or_crc8(void)
+{
+    return (fmavx_status.flags & MAVLINKX_FLAGS_HAS_DELTA) ? FASTMAVLINK_PARSE_STATE_DELTA : FASTMAVLINK_PARSE_STATE_CRC8;
+}
+
+
+FASTMAVLINK_FUNCTION_DECORATOR uint8_t _fmavX_parse_state_crc_extra_or_later(void)
+{
+    if (fmavx_status.flags & MAVLINKX_FLAGS_HAS_CRC_EXTRA) return FASTMAVLINK_PARSE_STATE_CRC_EXTRA;
+    return _fmavX_parse_state_delta_or_crc8();
+}
+
+
+FASTMAVLINK_FUNCTION_DECORATOR uint8_t _fmavX_parse_state_after_msgid(void)
+{
+    // a context definition has the context field behind the msgid
+    if (fmavx_status.flags_ext & MAVLINKX_FLAGS_EXT_DEFINES_CONTEXT) return FASTMAVLINK_PARSE_STATE_CONTEXT;
+    return _fmavX_parse_state_crc_extra_or_later();
+}
+
+
+FASTMAVLINK_FUNCTION_DECORATOR uint8_t _fmavX_parse_has_context_index(void)
+{
+    return (fmavx_status.flags & MAVLINKX_FLAGS_HAS_CONTEXT) &&
+           !(fmavx_status.flags_ext & MAVLINKX_FLAGS_EXT_DEFINES_CONTEXT);
+}
+
+
 FASTMAVLINK_FUNCTION_DECORATOR void _fmavX_parse_headerX_to_frame_buf(uint8_t* const buf, fmav_status_t* const status, uint8_t c)
 {
     fmavx_status.header[fmavx_status.pos++] = c; // memorize
@@ -497,6 +748,11 @@ FASTMAVLINK_FUNCTION_DECORATOR void _fmavX_parse_headerX_to_frame_buf(uint8_t* c
             }
         }
 
+        if (_fmavX_parse_has_context_index()) {
+            status->rx_state = FASTMAVLINK_PARSE_STATE_CONTEXT;
+            return;
+        }
+
         status->rx_state = FASTMAVLINK_PARSE_STATE_SEQ;
         return;
 
@@ -527,6 +783,12 @@ FASTMAVLINK_FUNCTION_DECORATOR void _fmavX_parse_headerX_to_frame_buf(uint8_t* c
     case FASTMAVLINK_PARSE_STATE_TARGET_COMPID:
         // we don't do anything with it currently
         fmavx_status.target_compid = c;
+
+        if (_fmavX_parse_has_context_index()) { // seq, sysid, compid, msgid are already done
+            status->rx_state = _fmavX_parse_state_crc_extra_or_later();
+            return;
+        }
+
         status->rx_state = FASTMAVLINK_PARSE_STATE_MSGID_1;
         return;
 
@@ -539,12 +801,7 @@ FASTMAVLINK_FUNCTION_DECORATOR void _fmavX_parse_headerX_to_frame_buf(uint8_t* c
             buf[status->rx_cnt++] = 0; // 8: msgid2
             buf[status->rx_cnt++] = 0; // 9: msgid3
 
-            if (fmavx_status.flags & MAVLINKX_FLAGS_HAS_CRC_EXTRA) { // has crcextra
-                status->rx_state = FASTMAVLINK_PARSE_STATE_CRC_EXTRA;
-                return;
-            }
-
-            status->rx_state = FASTMAVLINK_PARSE_STATE_CRC8;
+            status->rx_state = _fmavX_parse_state_after_msgid();
             return;
         }
 
@@ -558,12 +815,7 @@ FASTMAVLINK_FUNCTION_DECORATOR void _fmavX_parse_headerX_to_frame_buf(uint8_t* c
 
             buf[status->rx_cnt++] = 0; // 9: msgid3
 
-            if (fmavx_status.flags & MAVLINKX_FLAGS_HAS_CRC_EXTRA) { // has crcextra
-                status->rx_state = FASTMAVLINK_PARSE_STATE_CRC_EXTRA;
-                return;
-            }
-
-            status->rx_state = FASTMAVLINK_PARSE_STATE_CRC8;
+            status->rx_state = _fmavX_parse_state_after_msgid();
             return;
         }
 
@@ -573,17 +825,39 @@ FASTMAVLINK_FUNCTION_DECORATOR void _fmavX_parse_headerX_to_frame_buf(uint8_t* c
     case FASTMAVLINK_PARSE_STATE_MSGID_3:
         buf[status->rx_cnt++] = c; // 9: msgid3
 
-        if (fmavx_status.flags & MAVLINKX_FLAGS_HAS_CRC_EXTRA) { // has crcextra
-            status->rx_state = FASTMAVLINK_PARSE_STATE_CRC_EXTRA;
+        status->rx_state = _fmavX_parse_state_after_msgid();
+        return;
+
+    case FASTMAVLINK_PARSE_STATE_CONTEXT:
+        fmavx_status.context = c;
+
+        if (_fmavX_parse_has_context_index()) {
+#ifdef MAVLINKX_CONTEXT
+            if (!_fmavX_context_decode(buf, status, c)) { // 4: seq, 5: sysid, 6: compid, 7-9: msgid
+                fmav_parse_reset(status); // we don't know the index
+                return;
+            }
+#else
+            fmav_parse_reset(status); // we can't do it
             return;
+#endif
+            if (fmavx_status.flags & MAVLINKX_FLAGS_HAS_TARGETS) { // has targets
+                status->rx_state = FASTMAVLINK_PARSE_STATE_TARGET_SYSID;
+                return;
+            }
         }
 
-        status->rx_state = FASTMAVLINK_PARSE_STATE_CRC8;
+        status->rx_state = _fmavX_parse_state_crc_extra_or_later();
         return;
 
     case FASTMAVLINK_PARSE_STATE_CRC_EXTRA:
         // we don't do anything with it currently
         fmavx_status.crc_extra = c;
+        status->rx_state = _fmavX_parse_state_delta_or_crc8();
+        return;
+
+    case FASTMAVLINK_PARSE_STATE_DELTA:
+        fmavx_status.delta = c;
         status->rx_state = FASTMAVLINK_PARSE_STATE_CRC8;
         return;
     }
@@ -619,7 +893,9 @@ FASTMAVLINK_FUNCTION_DECORATOR uint8_t fmavX_parseX_to_frame_buf(fmav_result_t*
     case FASTMAVLINK_PARSE_STATE_MSGID_1:
     case FASTMAVLINK_PARSE_STATE_MSGID_2:
     case FASTMAVLINK_PARSE_STATE_MSGID_3:
+    case FASTMAVLINK_PARSE_STATE_CONTEXT:
     case FASTMAVLINK_PARSE_STATE_CRC_EXTRA:
+    case FASTMAVLINK_PARSE_STATE_DELTA:
         _fmavX_parse_headerX_to_frame_buf(buf, status, c);
         result->res = FASTMAVLINK_PARSE_RESULT_NONE;
         return FASTMAVLINK_PARSE_RESULT_NONE;
@@ -641,7 +917,7 @@ FASTMAVLINK_FUNCTION_DECORATOR uint8_t fmavX_parseX_to_frame_buf(fmav_result_t*
                 fmavx_status.header[fmavx_status.pos++] = c; // memorize also crc8
 
                 uint8_t len = fmavx_status.pos;
-                uint8_t head[16];
+                uint8_t head[MAVLINKX_HEADER_LEN_MAX + 2];
                 memcpy(head, fmavx_status.header, len);
 
                 fmavX_status_reset(&fmavx_status);
@@ -676,6 +952,15 @@ FASTMAVLINK_FUNCTION_DECORATOR uint8_t fmavX_parseX_to_frame_buf(fmav_result_t*
                 buf[fmavx_status.pos_of_len] = len;
             }
 #endif
+#ifdef MAVLINKX_DELTA
+            if (fmavx_status.flags & MAVLINKX_FLAGS_HAS_DELTA) {
+                if (!_fmavX_delta_decode(buf, fmavx_status.rx_payload_len)) { // we don't have the reference
+                    fmav_parse_reset(status);
+                    result->res = FASTMAVLINK_PARSE_RESULT_NONE;
+                    return FASTMAVLINK_PARSE_RESULT_NONE;
+                }
+            }
+#endif
 
             status->rx_state = FASTMAVLINK_FASTPARSE_STATE_FRAME;
         }
@@ -713,6 +998,19 @@ uint8_t res;
 
     res = fmav_check_frame_buf(result, buf);
     // result can be MSGID_UNKNOWN, LENGTH_ERROR, CRC_ERROR, SIGNATURE_ERROR, or OK
+#ifdef MAVLINKX_DELTA
+    // a reference is taken only if the crc confirms it, or if we can't check it, as the message is passed on anyhow
+    if ((res == FASTMAVLINK_PARSE_RESULT_OK || res == FASTMAVLINK_PARSE_RESULT_MSGID_UNKNOWN) &&
+        (fmavx_status.flags & MAVLINKX_FLAGS_HAS_DELTA)) {
+        _fmavX_delta_store_reference(buf);
+    }
+#endif
+#ifdef MAVLINKX_CONTEXT
+    // same for a context definition, and the seq
+    if (res == FASTMAVLINK_PARSE_RESULT_OK || res == FASTMAVLINK_PARSE_RESULT_MSGID_UNKNOWN) {
+        _fmavX_context_update(buf);
+    }
+#endif
     if (res == FASTMAVLINK_PARSE_RESULT_MSGID_UNKNOWN || res == FASTMAVLINK_PARSE_RESULT_OK) {
         return 1;
     }
@@ -1010,6 +1308,428 @@ void _fmavX_payload_decompress(uint8_t* const payload_out, uint8_t* const len_ou
 #endif // MAVLINKX_COMPRESSION
 
 
+//-------------------------------------------------------
+// Delta compression
+//-------------------------------------------------------
+/*
+The compression above works on each payload alone, and can't do much better than ca 15%. Many messages
+however change only slowly, like SYS_STATUS, GPS_RAW_INT, BATTERY_STATUS, so that the payload is mostly
+the same as that of the previous message. With delta compression both sides keep a reference payload
+per sysid, compid, msgid, and the payload is send as the XOR to the reference, compressed as above. The
+many zeros are then nearly for free, an unchanged payload takes 2 bytes.
+
+The reference is a normal message with the delta field set to IS_REFERENCE | epoch. The other messages
+with delta field have the epoch of the reference they are the delta to. The receiver takes a reference
+only after it passed the crc16, and a delta only if it has the reference with this epoch, else the
+message is dropped, as a corrupted message would be. So the receiver never needs to know about
+FrameLost() and parser resets, there are no resets which both sides would have to agree on. In addition
+the crc16 is over the original frame, so even a wrong reference cannot produce a wrong message.
+
+A lost reference costs at most the next MAVLINKX_DELTA_REFERENCE_INTERVAL messages of this kind, since a
+new reference is send after so many messages. For the same reason HEARTBEAT is never done as delta.
+A delta is used only if it is shorter than the message compressed normally, so messages which change a
+lot cost one byte per interval.
+
+The delta field is behind the msgid and crc extra fields, and is covered by the crc8.
+*/
+#ifdef MAVLINKX_DELTA
+
+typedef struct
+{
+    uint8_t len; // 0 = free
+    uint8_t sysid;
+    uint8_t compid;
+    uint32_t msgid;
+    uint8_t epoch;
+    uint8_t cnt; // messages since the reference, only for out
+    uint8_t payload[MAVLINKX_DELTA_PAYLOAD_LEN_MAX];
+} fmavx_delta_ref_t;
+
+
+typedef struct
+{
+    fmavx_delta_ref_t ref[MAVLINKX_DELTA_REF_NUM];
+    uint8_t next; // slot to take next, round robin
+    uint8_t epoch_next; // only for out, is not reset, so that an old reference of the receiver doesn't fit
+    uint8_t last_is_reference; // only for out
+} fmavx_delta_store_t;
+
+
+// TODO: shouldn't be global
+fmavx_delta_store_t fmavx_delta_out; // references of the messages we send
+fmavx_delta_store_t fmavx_delta_in; // references of the messages we receive
+
+
+// call it when the link was lost, the other side does not need to know
+void fmavX_delta_reset(void)
+{
+    for (uint8_t i = 0; i < MAVLINKX_DELTA_REF_NUM; i++) {
+        fmavx_delta_out.ref[i].len = 0;
+        fmavx_delta_in.ref[i].len = 0;
+    }
+    fmavx_delta_out.next = fmavx_delta_in.next = 0;
+    fmavx_delta_out.last_is_reference = 0;
+}
+
+
+fmavx_delta_ref_t* _fmavX_delta_find(fmavx_delta_store_t* const store, uint8_t sysid, uint8_t compid, uint32_t msgid)
+{
+    for (uint8_t i = 0; i < MAVLINKX_DELTA_REF_NUM; i++) {
+        fmavx_delta_ref_t* ref = &(store->ref[i]);
+        if (ref->len && ref->msgid == msgid && ref->sysid == sysid && ref->compid == compid) return ref;
+    }
+    return NULL;
+}
+
+
+fmavx_delta_ref_t* _fmavX_delta_take(fmavx_delta_store_t* const store, uint8_t sysid, uint8_t compid, uint32_t msgid)
+{
+    fmavx_delta_ref_t* ref = _fmavX_delta_find(store, sysid, compid, msgid);
+    if (ref) return ref;
+
+    ref = &(store->ref[store->next]);
+    store->next++;
+    if (store->next >= MAVLINKX_DELTA_REF_NUM) store->next = 0;
+
+    ref->sysid = sysid;
+    ref->compid = compid;
+    ref->msgid = msgid;
+    return ref;
+}
+
+
+uint8_t _fmavX_delta_is_possible(const fmavx_frame_t* const msg)
+{
+    return (msg->magic != FASTMAVLINK_MAGIC_V1 &&
+            msg->msgid != FASTMAVLINK_MSG_ID_HEARTBEAT &&
+            msg->len <= MAVLINKX_DELTA_PAYLOAD_LEN_MAX);
+}
+
+
+// tells if _fmavX_delta_encode() will make it a reference
+uint8_t _fmavX_delta_is_reference_due(const fmavx_frame_t* const msg)
+{
+    if (!_fmavX_delta_is_possible(msg)) return 0;
+
+    fmavx_delta_ref_t* ref = _fmavX_delta_find(&fmavx_delta_out, msg->sysid, msg->compid, msg->msgid);
+    return (!ref || ref->cnt >= MAVLINKX_DELTA_REFERENCE_INTERVAL);
+}
+
+
+// payload_out must have space for MAVLINKX_DELTA_PAYLOAD_LEN_MAX + 1 bytes
+uint8_t _fmavX_delta_encode(uint8_t* const payload_out, uint8_t* const len_out, uint8_t* const delta, const fmavx_frame_t* const msg)
+{
+    fmavx_delta_out.last_is_reference = 0;
+
+    if (!_fmavX_delta_is_possible(msg)) return MAVLINKX_DELTA_RES_NONE;
+
+    fmavx_delta_ref_t* ref = _fmavX_delta_find(&fmavx_delta_out, msg->sysid, msg->compid, msg->msgid);
+
+    if (ref && ref->cnt < MAVLINKX_DELTA_REFERENCE_INTERVAL) {
+        ref->cnt++;
+
+        uint8_t x[MAVLINKX_DELTA_PAYLOAD_LEN_MAX];
+        for (uint8_t n = 0; n < msg->len; n++) {
+            x[n] = msg->payload[n] ^ ((n < ref->len) ? ref->payload[n] : 0);
+        }
+        if (!_fmavX_payload_compress(payload_out, len_out, x, msg->len)) return MAVLINKX_DELTA_RES_NONE;
+
+        // is it worth it, the delta field costs a byte
+        uint8_t len = msg->len;
+        if (fmavx_config_g.compression_enabled) {
+            uint8_t tmp[MAVLINKX_DELTA_PAYLOAD_LEN_MAX + 1];
+            if (_fmavX_payload_compress(tmp, &len, msg->payload, msg->len) == 0) len = msg->len;
+        }
+        if (*len_out + 1 >= len) return MAVLINKX_DELTA_RES_NONE;
+
+        *delta = ref->epoch;
+        return MAVLINKX_DELTA_RES_DELTA;
+    }
+
+    // new reference
+    if (!ref) ref = _fmavX_delta_take(&fmavx_delta_out, msg->sysid, msg->compid, msg->msgid);
+    ref->len = (msg->len) ? msg->len : 1; // an all zero payload is truncated to len 0, but 0 means free
+    memcpy(ref->payload, msg->payload, msg->len);
+    if (!msg->len) ref->payload[0] = 0;
+    ref->epoch = (fmavx_delta_out.epoch_next++) & 0x7F;
+    ref->cnt = 0;
+
+    fmavx_delta_out.last_is_reference = 1;
+    *delta = MAVLINKX_DELTA_IS_REFERENCE | ref->epoch;
+    return MAVLINKX_DELTA_RES_REFERENCE;
+}
+
+
+// buf is the frame_buf, with the payload decompressed, len is the payload len
+// returns 0 if we don't have the reference
+uint8_t _fmavX_delta_decode(uint8_t* const buf, uint8_t len)
+{
+    if (fmavx_status.flags & MAVLINKX_FLAGS_IS_V1) return 0; // can't happen
+
+    if (fmavx_status.delta & MAVLINKX_DELTA_IS_REFERENCE) return 1; // is taken once it passed the crc16
+
+    uint32_t msgid = (uint32_t)buf[7] + ((uint32_t)buf[8] << 8) + ((uint32_t)buf[9] << 16);
+    fmavx_delta_ref_t* ref = _fmavX_delta_find(&fmavx_delta_in, buf[5], buf[6], msgid);
+
+    if (!ref || ref->epoch != (fmavx_status.delta & 0x7F)) return 0;
+
+    uint8_t* payload = &(buf[FASTMAVLINK_HEADER_V2_LEN]);
+    for (uint8_t n = 0; n < len && n < ref->len; n++) {
+        payload[n] ^= ref->payload[n];
+    }
+    return 1;
+}
+
+
+// buf is the frame_buf, which passed the crc16
+void _fmavX_delta_store_reference(const uint8_t* const buf)
+{
+    if (!(fmavx_status.delta & MAVLINKX_DELTA_IS_REFERENCE)) return;
+
+    uint8_t len = buf[1];
+    if (len > MAVLINKX_DELTA_PAYLOAD_LEN_MAX) return; // can't happen
+
+    uint32_t msgid = (uint32_t)buf[7] + ((uint32_t)buf[8] << 8) + ((uint32_t)buf[9] << 16);
+    fmavx_delta_ref_t* ref = _fmavX_delta_take(&fmavx_delta_in, buf[5], buf[6], msgid);
+
+    ref->len = (len) ? len : 1; // same as for out
+    memcpy(ref->payload, &(buf[FASTMAVLINK_HEADER_V2_LEN]), len);
+    if (!len) ref->payload[0] = 0;
+    ref->epoch = fmavx_status.delta & 0x7F;
+}
+
+#endif // MAVLINKX_DELTA
+
+
+//-------------------------------------------------------
+// Header context
+//-------------------------------------------------------
+/*
+For the small high rate messages, like ATTITUDE, the header is a good part of the frame. Both sides keep
+a dictionary of up to 16 (sysid, compid, msgid) tuples, and a message of a tuple in the dictionary has the
+one byte context field in place of seq, sysid, compid, msgid. The low nibble is the index, the high nibble
+the low 4 bits of seq. The receiver takes the seq as the next one after the seq of the last message of this
+tuple which has these low bits, i.e. the seq may advance by 1 to 16. The sender uses the index only if seq
+advanced by at most MAVLINKX_CONTEXT_SEQ_GAP_MAX, so that a lost message in between doesn't matter. The seq
+is per tuple, and not per component, as the link out scheduler may reorder messages of different msgid.
+This saves 3 bytes per message, so ca 10% for a 20 bytes payload.
+
+An index is defined by a normal message with context field and the DEFINES_CONTEXT extension flag. The
+receiver takes the definition only if the message passed the crc16. The definition is repeated after
+MAVLINKX_CONTEXT_REFRESH_INTERVAL uses, so a lost definition costs at most that many messages. Any normal
+message of the tuple also brings the seq in sync again. A message with an index the receiver doesn't know
+is dropped, and since the crc16 is over the original frame a stale index or a wrong seq only make the
+message drop, as a corrupted message would. As for delta compression, FrameLost() and parser resets don't
+matter.
+
+A tuple gets an index if one is free, or one was unused for MAVLINKX_CONTEXT_AGE_MIN messages, so that the
+slow messages can't push out the fast ones.
+
+The link out scheduler may replace a queued message by a newer one of its tuple. The receiver then never
+sees the replaced one, and with more replacements in a row the seq could go beyond the 16 the receiver can
+follow. So a message which replaces one goes with the full header, see fmavX_next_replaces().
+*/
+#ifdef MAVLINKX_CONTEXT
+
+typedef struct
+{
+    uint8_t valid;
+    uint8_t sysid;
+    uint8_t compid;
+    uint32_t msgid;
+    uint8_t seq_last;
+    uint8_t cnt; // uses since the definition, only for out
+    uint16_t stamp; // message count of the last use, only for out
+} fmavx_context_entry_t;
+
+
+typedef struct
+{
+    fmavx_context_entry_t entry[MAVLINKX_CONTEXT_NUM];
+    uint16_t stamp; // only for out
+    uint8_t last_is_define; // only for out
+    uint8_t next_replaces; // only for out
+} fmavx_context_store_t;
+
+
+// TODO: shouldn't be global
+fmavx_context_store_t fmavx_context_out; // dictionary of the messages we send
+fmavx_context_store_t fmavx_context_in; // dictionary of the messages we receive
+
+
+// call it when the link was lost, the other side does not need to know
+void fmavX_context_reset(void)
+{
+    for (uint8_t i = 0; i < MAVLINKX_CONTEXT_NUM; i++) {
+        fmavx_context_out.entry[i].valid = 0;
+        fmavx_context_in.entry[i].valid = 0;
+    }
+    fmavx_context_out.last_is_define = 0;
+    fmavx_context_out.next_replaces = 0;
+}
+
+
+uint8_t _fmavX_context_find(fmavx_context_store_t* const store, uint8_t sysid, uint8_t compid, uint32_t msgid)
+{
+    for (uint8_t i = 0; i < MAVLINKX_CONTEXT_NUM; i++) {
+        fmavx_context_entry_t* e = &(store->entry[i]);
+        if (e->valid && e->msgid == msgid && e->sysid == sysid && e->compid == compid) return i;
+    }
+    return MAVLINKX_CONTEXT_NUM;
+}
+
+
+// no_index: the message must go with the full header
+uint8_t _fmavX_context_encode(uint8_t* const context, const fmavx_frame_t* const msg, uint8_t no_index)
+{
+    fmavx_context_out.last_is_define = 0;
+    fmavx_context_out.stamp++;
+
+    if (msg->magic == FASTMAVLINK_MAGIC_V1) return MAVLINKX_CONTEXT_RES_NONE;
+
+    uint8_t i = _fmavX_context_find(&fmavx_context_out, msg->sysid, msg->compid, msg->msgid);
+    fmavx_context_entry_t* e;
+
+    if (i < MAVLINKX_CONTEXT_NUM) {
+        e = &(fmavx_context_out.entry[i]);
+        uint8_t gap = msg->seq - e->seq_last;
+        e->seq_last = msg->seq;
+
+        if (e->cnt < MAVLINKX_CONTEXT_REFRESH_INTERVAL) {
+            if (no_index || !gap || gap > MAVLINKX_CONTEXT_SEQ_GAP_MAX) return MAVLINKX_CONTEXT_RES_NONE; // also syncs seq on the other side
+            e->cnt++;
+            e->stamp = fmavx_context_out.stamp;
+            *context = i | ((msg->seq & 0x0F) << 4);
+            return MAVLINKX_CONTEXT_RES_INDEX;
+        }
+        // else define it again
+    } else {
+        // take a free one, or the one unused for the longest time
+        i = 0;
+        for (uint8_t n = 0; n < MAVLINKX_CONTEXT_NUM; n++) {
+            fmavx_context_entry_t* en = &(fmavx_context_out.entry[n]);
+            if (!en->valid) { i = n; break; }
+            if ((int16_t)(en->stamp - fmavx_context_out.entry[i].stamp) < 0) i = n;
+        }
+        e = &(fmavx_context_out.entry[i]);
+        if (e->valid && (uint16_t)(fmavx_context_out.stamp - e->stamp) < MAVLINKX_CONTEXT_AGE_MIN) {
+            return MAVLINKX_CONTEXT_RES_NONE;
+        }
+
+        e->sysid = msg->sysid;
+        e->compid = msg->compid;
+        e->msgid = msg->msgid;
+        e->seq_last = msg->seq;
+    }
+
+    e->valid = 1;
+    e->cnt = 0;
+    e->stamp = fmavx_context_out.stamp;
+
+    fmavx_context_out.last_is_define = 1;
+    *context = i;
+    return MAVLINKX_CONTEXT_RES_DEFINE;
+}
+
+
+// returns if fmavX_next_replaces() was called for this frame, and clears it
+uint8_t _fmavX_context_take_next_replaces(void)
+{
+    uint8_t replaces = fmavx_context_out.next_replaces;
+    fmavx_context_out.next_replaces = 0;
+    return replaces;
+}
+
+
+// c is the context field, fills in seq, sysid, compid, msgid
+// returns 0 if we don't know the index
+uint8_t _fmavX_context_decode(uint8_t* const buf, fmav_status_t* const status, uint8_t c)
+{
+    fmavx_context_entry_t* e = &(fmavx_context_in.entry[c & 0x0F]);
+
+    if (!e->valid) return 0;
+
+    uint8_t seq = e->seq_last + 1 + (((c >> 4) - e->seq_last - 1) & 0x0F); // advances by 1 .. 16
+
+    buf[status->rx_cnt++] = seq; // 4: seq
+    buf[status->rx_cnt++] = e->sysid; // 5: sysid
+    buf[status->rx_cnt++] = e->compid; // 6: compid
+    buf[status->rx_cnt++] = (uint8_t)(e->msgid); // 7: msgid1
+    buf[status->rx_cnt++] = (uint8_t)(e->msgid >> 8); // 8: msgid2
+    buf[status->rx_cnt++] = (uint8_t)(e->msgid >> 16); // 9: msgid3
+    return 1;
+}
+
+
+// buf is the frame_buf, which passed the crc16
+void _fmavX_context_update(const uint8_t* const buf)
+{
+    if (fmavx_status.flags & MAVLINKX_FLAGS_IS_V1) return;
+
+    uint32_t msgid = (uint32_t)buf[7] + ((uint32_t)buf[8] << 8) + ((uint32_t)buf[9] << 16);
+
+    if (fmavx_status.flags_ext & MAVLINKX_FLAGS_EXT_DEFINES_CONTEXT) {
+        // the tuple may still be in the dictionary under its old index
+        uint8_t i = _fmavX_context_find(&fmavx_context_in, buf[5], buf[6], msgid);
+        if (i < MAVLINKX_CONTEXT_NUM) fmavx_context_in.entry[i].valid = 0;
+
+        fmavx_context_entry_t* e = &(fmavx_context_in.entry[fmavx_status.context & 0x0F]);
+        e->valid = 1;
+        e->sysid = buf[5];
+        e->compid = buf[6];
+        e->msgid = msgid;
+        e->seq_last = buf[4];
+        return;
+    }
+
+    uint8_t i = _fmavX_context_find(&fmavx_context_in, buf[5], buf[6], msgid);
+    if (i < MAVLINKX_CONTEXT_NUM) fmavx_context_in.entry[i].seq_last = buf[4];
+}
+
+#endif // MAVLINKX_CONTEXT
+
+
+//-------------------------------------------------------
+// State
+//-------------------------------------------------------
+
+// resets the states of delta compression and header context
+// call it when the link was lost, the other side does not need to know
+void fmavX_state_reset(void)
+{
+#ifdef MAVLINKX_DELTA
+    fmavX_delta_reset();
+#endif
+#ifdef MAVLINKX_CONTEXT
+    fmavX_context_reset();
+#endif
+}
+
+
+// tells if the last frame of fmavX_msg_to_frame_bufX() is a delta reference or context definition, which
+// the following frames depend on, so it must not be dropped
+uint8_t fmavX_last_is_reference(void)
+{
+#ifdef MAVLINKX_DELTA
+    if (fmavx_delta_out.last_is_reference) return 1;
+#endif
+#ifdef MAVLINKX_CONTEXT
+    if (fmavx_context_out.last_is_define) return 1;
+#endif
+    return 0;
+}
+
+
+// tells that the next frame replaces a queued frame of its tuple, e.g. by coalescing in the link out scheduler
+// it then goes without context index
+void fmavX_next_replaces(void)
+{
+#ifdef MAVLINKX_CONTEXT
+    fmavx_context_out.next_replaces = 1;
+#endif
+}
+
+
 #ifdef MAVLINKX_O3
   #ifdef __GNUC__
     #pragma GCC pop_options
@@ -46,7 +46,7 @@ The 3 MAIN topics TODO:
 
 1) Link
 - AFC
-- reconnect by choosing frequency based on rssi map
+- reconnect by choosing frequency based on rssi map, first step is USE_FEATURE_RX_LISTEN_RANK
 
 2) Parameters, usability
 - firmware update: via connection to USB on tx module, for receiver ota-passthrough
@@ -0,0 +1,124 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// Rx Listen Rank
+//*******************************************************
+// In listen the rx parks on one slot for CONNECT_LISTEN_HOP_CNT frames, which is long enough
+// for the tx to come by once, and then goes to the next slot. If that slot happens to be a bad
+// one, e.g. hit by wifi, the dwell is wasted. We therefore keep a history per slot, and in listen
+// go through the slots in the order of their rank, the best first.
+// The history is the valid frames and the invalid frames of the last visits. The sx drivers
+// don't give us an instantaneous rssi, so we take the invalid frames as the measure of the noise,
+// it's what the interference does to our frames. The rssi of the last valid frame breaks ties.
+// While connected each frame is a visit, in listen a dwell which didn't get us a valid frame
+// counts as a visit with nothing received.
+// Without history, e.g. after power up, all slots rank the same, and it's the linear order.
+//*******************************************************
+#ifndef LISTEN_RANK_H
+#define LISTEN_RANK_H
+#pragma once
+
+
+#include <stdint.h>
+
+
+#ifdef USE_FEATURE_RX_LISTEN_RANK
+
+#define IF_RX_LISTEN_RANK(x)          x
+
+
+#define RX_LISTEN_RANK_WINDOW         16 // number of visits per slot which are evaluated
+
+
+class tRxListenRank
+{
+  public:
+    void Init(uint8_t _cnt)
+    {
+        cnt = (_cnt > FHSS_MAX_NUM) ? FHSS_MAX_NUM : _cnt;
+        for (uint8_t i = 0; i < FHSS_MAX_NUM; i++) {
+            valid[i] = 0;
+            invalid[i] = 0;
+            rssi[i] = INT8_MIN;
+        }
+        tried_mask = 0;
+        restarted = false;
+    }
+
+    // called with the rx status of the slot, while connected each frame, in listen when something was received
+    void Put(uint8_t i, uint8_t rx_status, int8_t _rssi)
+    {
+        if (i >= cnt) return;
+        valid[i] = (valid[i] << 1) | ((rx_status > RX_STATUS_INVALID) ? 1 : 0);
+        invalid[i] = (invalid[i] << 1) | ((rx_status == RX_STATUS_INVALID) ? 1 : 0);
+        if (rx_status > RX_STATUS_INVALID) rssi[i] = _rssi;
+    }
+
+    // called when the connection is lost, the next Next() then doesn't count the current slot as a failed dwell
+    void Restart(void)
+    {
+        tried_mask = 0;
+        restarted = true;
+    }
+
+    // called when the listen dwell on slot curr_i is over
+    // returns the best slot which was not tried yet in this round, for equal rank the next in linear order
+    uint8_t Next(uint8_t curr_i)
+    {
+        if (!restarted && curr_i < cnt) {
+            Put(curr_i, RX_STATUS_NONE, 0); // the dwell didn't get us a valid frame
+            tried_mask |= ((uint32_t)1 << curr_i);
+        }
+        restarted = false;
+
+        uint32_t all_mask = (cnt >= 32) ? UINT32_MAX : ((uint32_t)1 << cnt) - 1;
+        if ((tried_mask & all_mask) == all_mask) tried_mask = 0; // all tried, start a new round
+
+        uint8_t i_best = UINT8_MAX;
+        for (uint8_t n = 1; n <= cnt; n++) {
+            uint8_t i = (curr_i + n) % cnt;
+            if (tried_mask & ((uint32_t)1 << i)) continue;
+            if (i_best == UINT8_MAX || is_better(i, i_best)) i_best = i;
+        }
+
+        return (i_best < cnt) ? i_best : 0;
+    }
+
+  private:
+    uint8_t cnt;
+    uint16_t valid[FHSS_MAX_NUM]; // one bit per visit, must fit RX_LISTEN_RANK_WINDOW
+    uint16_t invalid[FHSS_MAX_NUM];
+    int8_t rssi[FHSS_MAX_NUM]; // of the last valid frame
+    uint32_t tried_mask;
+    bool restarted;
+
+    int8_t score(uint8_t i)
+    {
+        return (int8_t)popcount(valid[i]) - (int8_t)popcount(invalid[i]);
+    }
+
+    bool is_better(uint8_t i, uint8_t j)
+    {
+        if (score(i) != score(j)) return (score(i) > score(j));
+        return (rssi[i] > rssi[j]);
+    }
+
+    uint8_t popcount(uint16_t v)
+    {
+        uint8_t n = 0;
+        while (v) { n += (v & 1); v >>= 1; }
+        return n;
+    }
+};
+
+
+#else
+
+#define IF_RX_LISTEN_RANK(x)
+
+#endif // USE_FEATURE_RX_LISTEN_RANK
+
+#endif // LISTEN_RANK_H
@@ -14,9 +14,16 @@
 #include "../Common/mavlink/fmav_extension.h"
 #include "../Common/libs/filters.h"
 #ifdef USE_FEATURE_MAVLINKX
+#ifdef USE_FEATURE_MAVLINKX_DELTA
+  #define MAVLINKX_DELTA
+#endif
+#ifdef USE_FEATURE_MAVLINKX_CONTEXT
+  #define MAVLINKX_CONTEXT
+#endif
 #include "../Common/thirdparty/mavlinkx.h"
-#include "../Common/libs/fifo.h"
+#include "../Common/mavlink_scheduler.h"
 #endif
+#include "../Common/mavlink_debug.h"
 
 
 extern volatile uint32_t millis32(void);
@@ -49,6 +56,7 @@ class tRxMavlink
     void putc(char c);
     bool available(void);
     uint8_t getc(void);
+    uint16_t getbuf(uint8_t* buf, uint16_t len);
     void flush(void);
 
   private:
@@ -59,6 +67,11 @@ class tRxMavlink
     void generate_radio_link_stats(void);
     void generate_radio_link_information(void);
     void generate_radio_link_flow_control(void);
+#ifdef USE_MAVLINK_DEBUG
+    void send_msg_link_out(fmav_message_t* msg);
+    tMavlinkDebug debug;
+    fmav_message_t msg_buf; // temporary working buffer, to not burden stack
+#endif
 
     uint16_t serial_in_available(void);
     bool handle_txbuf_ardupilot(uint32_t tnow_ms);
@@ -68,14 +81,12 @@ class tRxMavlink
     fmav_status_t status_link_in;
     uint8_t buf_link_in[MAVLINK_BUF_SIZE]; // buffer for link in parser
     fmav_status_t status_serial_out; // not needed, status_link_in could be used, but clearer so
-    fmav_message_t msg_serial_out; // could be avoided by more efficient coding, is used only momentarily/locally
 
     // fields for serial in -> parser -> link out
 #ifdef USE_FEATURE_MAVLINKX
     fmav_status_t status_serial_in;
     uint8_t buf_serial_in[MAVLINK_BUF_SIZE]; // buffer for serial in parser
-    fmav_message_t msg_link_out; // could be avoided by more efficient coding, is used only momentarily/locally
-    tFifo<char,512> fifo_link_out; // needs to be at least 82 + 280
+    tMavlinkScheduler link_out; // bulk needs to be at least 82 + 280
     uint32_t bytes_parser_in; // bytes in the parser
 #endif
 
@@ -113,10 +124,11 @@ class tRxMavlink
         uint32_t texe_ms;
     } cmd_ack;
 
-    void handle_msg(fmav_message_t* msg);
+    void handle_msg(uint8_t* buf, fmav_result_t* result);
     void generate_cmd_ack(void);
 
     uint8_t _buf[MAVLINK_BUF_SIZE]; // temporary working buffer, to not burden stack
+    uint16_t _buf_len; // length of the frame the generate functions put into _buf
 };
 
 
@@ -126,18 +138,31 @@ void tRxMavlink::Init(void)
 
     status_link_in = {};
     status_serial_out = {};
+    _buf_len = 0;
 
 #ifdef USE_FEATURE_MAVLINKX
     fmavX_init();
     fmavX_config_compression((Config.Mode == MODE_19HZ) ? 1 : 0); // use compression only in 19 Hz mode
+#ifdef USE_FEATURE_MAVLINKX_DELTA
+    fmavX_config_delta((Config.Mode == MODE_19HZ) ? 1 : 0);
+#endif
+#ifdef USE_FEATURE_MAVLINKX_CONTEXT
+    fmavX_config_context(1);
+#endif
 
     status_serial_in = {};
-    fifo_link_out.Init();
+    link_out.Init();
     bytes_parser_in = 0;
 #endif
 
     radio_status_tlast_ms = millis32() + 1000;
     radio_status_txbuf = 0;
+#ifdef USE_MAVLINK_DEBUG
+    debug.Init(1);
+#if defined USE_FEATURE_SCHED_STATS && defined USE_FEATURE_MAVLINKX
+    debug.SetScheduler(&link_out);
+#endif
+#endif
     txbuf_state = TXBUF_STATE_NORMAL;
 
     bytes_link_out = 0;
@@ -202,7 +227,8 @@ void tRxMavlink::Do(void)
         //Init();
         //radio_status_tlast_ms = tnow_ms + 1000;
 #ifdef USE_FEATURE_MAVLINKX
-        fifo_link_out.Flush();
+        link_out.Flush();
+        fmavX_state_reset(); // the references may be gone on the other side too
 #endif
     }
 
@@ -210,30 +236,36 @@ void tRxMavlink::Do(void)
 
     // parse serial in -> link out
 #ifdef USE_FEATURE_MAVLINKX
+    // coalesce periodic telemetry only when the link is saturated
+    link_out.SetCoalescing(txbuf_state == TXBUF_STATE_BURST || txbuf_state == TXBUF_STATE_BURST_HIGH);
+
     fmav_result_t result;
-    if (fifo_link_out.HasSpace(290)) { // we have space for a full MAVLink message, so can safely parse
+    if (link_out.HasSpace(290)) { // we have space for a full MAVLink message, so can safely parse
         while (serial.available()) {
             char c = serial.getc();
             bytes_parser_in++; // memorize it is still in processing
             fmav_parse_and_check_to_frame_buf(&result, buf_serial_in, &status_serial_in, c);
             if (result.res == FASTMAVLINK_PARSE_RESULT_OK) {
-
-                // TODO: this could be be done more efficiently by not going via msg_link_out
-                // but by directly going buf_serial_in -> _buf
-
-                fmav_frame_buf_to_msg(&msg_link_out, &result, buf_serial_in); // requires RESULT_OK
-
-                uint16_t len;
+                // we work directly on the frame in buf_serial_in, no copy into a fmav_message_t
+                // for MAVLink it is passed on as is, for MAVLinkX only the header is transformed
+                // and the payload is compressed into _buf
+                uint8_t flags = 0;
+                if (buf_serial_in[0] == FASTMAVLINK_MAGIC_V2 && (buf_serial_in[2] & FASTMAVLINK_INCOMPAT_FLAGS_SIGNED)) {
+                    flags |= SCHED_MSG_SIGNED; // must not be reordered
+                }
                 if (Setup.Rx.SerialLinkMode == SERIAL_LINK_MODE_MAVLINK_X) {
-                    len = fmavX_msg_to_frame_bufX(_buf, &msg_link_out); // X frame now in _buf
+                    if (link_out.WillReplace(result.msgid, result.sysid, result.compid, flags)) {
+                        fmavX_next_replaces(); // the replaced one never reaches the other side
+                    }
+                    uint16_t len = fmavX_frame_buf_to_frame_bufX(_buf, buf_serial_in, &result); // requires RESULT_OK
+                    if (fmavX_last_is_reference()) flags |= SCHED_MSG_KEEP; // must not be coalesced away
+                    link_out.PutMsg(_buf, len, result.msgid, result.sysid, result.compid, flags);
                 } else {
-                    len = fmav_msg_to_frame_buf(_buf, &msg_link_out);
+                    link_out.PutMsg(buf_serial_in, result.frame_len, result.msgid, result.sysid, result.compid, flags);
                 }
-
-                fifo_link_out.PutBuf(_buf, len);
                 bytes_parser_in = 0;
 
-                handle_msg(&msg_link_out);
+                handle_msg(buf_serial_in, &result);
 
                 break; // give the loop a chance before handling a further message
             }
@@ -305,6 +337,12 @@ void tRxMavlink::Do(void)
         send_msg_serial_out();
     }
 
+#ifdef USE_MAVLINK_DEBUG
+    if (connected() && debug.Generate(&msg_buf, RADIO_LINK_SYSTEM_ID, tnow_ms)) {
+        send_msg_link_out(&msg_buf);
+    }
+#endif
+
     if (cmd_ack.state == 2 && (tnow_ms - cmd_ack.texe_ms) > 1000) {
         switch (cmd_ack.command) {
         case MAV_CMD_PREFLIGHT_REBOOT_SHUTDOWN:
@@ -348,7 +386,7 @@ void tRxMavlink::putc(char c)
     fmav_parse_and_check_to_frame_buf(&result, buf_link_in, &status_link_in, c);
 #endif
     if (result.res == FASTMAVLINK_PARSE_RESULT_OK) {
-        fmav_frame_buf_to_msg(&msg_serial_out, &result, buf_link_in); // requires RESULT_OK
+        // the frame in buf_link_in is sent out as is, no copy into a fmav_message_t
 
 #if MAVLINK_OPT_FAKE_PARAMFTP > 0
 #if MAVLINK_OPT_FAKE_PARAMFTP > 1
@@ -365,21 +403,23 @@ void tRxMavlink::putc(char c)
         // if it's a mavftp call to @PARAM/param.pck we fake the url
         // this will make ArduPilot to response with a NACK:FileNotFound
         // which will make MissionPlanner (any GCS?) to fallback to normal parameter upload
-        if (msg_serial_out.msgid == FASTMAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL) {
-            uint8_t target_component = msg_serial_out.payload[2];
-            uint8_t opcode = msg_serial_out.payload[6];
-            char* url = (char*)(msg_serial_out.payload + 15);
+        // the payload in the frame can be truncated, so check the length, the url must be complete
+        if (result.msgid == FASTMAVLINK_MSG_ID_FILE_TRANSFER_PROTOCOL && buf_link_in[1] >= 15 + 16) {
+            uint8_t* payload = &(buf_link_in[fmav_frame_buf_header_len(buf_link_in)]);
+            uint8_t target_component = payload[2];
+            uint8_t opcode = payload[6];
+            char* url = (char*)(payload + 15);
             if (((target_component == MAV_COMP_ID_AUTOPILOT1) || (target_component == MAV_COMP_ID_ALL)) &&
                 (opcode == MAVFTP_OPCODE_OpenFileRO)) {
                 if (!strncmp(url, "@PARAM/param.pck", 16)) {
                     url[1] = url[7] = url[13] = 'x'; // now fake it to "@xARAM/xaram.xck"
-                    fmav_msg_recalculate_crc(&msg_serial_out); // we need to recalculate CRC, requires RESULT_OK
+                    fmav_frame_buf_recalculate_crc(buf_link_in, &result); // we need to recalculate CRC, requires RESULT_OK
                 }
             }
         }
 #endif
 
-        send_msg_serial_out();
+        serial.putbuf(buf_link_in, result.frame_len);
     }
 }
 
@@ -387,7 +427,7 @@ void tRxMavlink::putc(char c)
 bool tRxMavlink::available(void)
 {
 #ifdef USE_FEATURE_MAVLINKX
-    return fifo_link_out.Available();
+    return link_out.Available();
 #else
     return serial.available();
 #endif
@@ -400,17 +440,31 @@ uint8_t tRxMavlink::getc(void)
     bytes_link_out_cnt++;
 
 #ifdef USE_FEATURE_MAVLINKX
-    return fifo_link_out.Get();
+    return link_out.Get();
 #else
     return serial.getc();
 #endif
 }
 
 
+uint16_t tRxMavlink::getbuf(uint8_t* buf, uint16_t len)
+{
+#ifdef USE_FEATURE_MAVLINKX
+    uint16_t n = link_out.GetBuf(buf, len);
+#else
+    uint16_t n = serial.getbuf(buf, len);
+#endif
+
+    bytes_link_out += n;
+    bytes_link_out_cnt += n;
+    return n;
+}
+
+
 void tRxMavlink::flush(void)
 {
 #ifdef USE_FEATURE_MAVLINKX
-    fifo_link_out.Flush();
+    link_out.Flush();
 #endif
     serial.flush();
 }
@@ -418,10 +472,33 @@ void tRxMavlink::flush(void)
 
 void tRxMavlink::send_msg_serial_out(void)
 {
-    uint16_t len = fmav_msg_to_frame_buf(_buf, &msg_serial_out);
+    serial.putbuf(_buf, _buf_len);
+}
+
+
+#ifdef USE_MAVLINK_DEBUG
+// our own messages to the GCS, these go into the link out as the messages from the serial
+// there is no link out without USE_FEATURE_MAVLINKX, so these are then dropped
+void tRxMavlink::send_msg_link_out(fmav_message_t* msg)
+{
+#ifdef USE_FEATURE_MAVLINKX
+    uint16_t len;
+    uint8_t flags = 0;
+    if (!link_out.HasSpace(290)) return; // it is only debug, so we rather drop it
+    if (Setup.Rx.SerialLinkMode == SERIAL_LINK_MODE_MAVLINK_X) {
+        if (link_out.WillReplace(msg->msgid, msg->sysid, msg->compid, flags)) {
+            fmavX_next_replaces(); // the replaced one never reaches the other side
+        }
+        len = fmavX_msg_to_frame_bufX(_buf, msg);
+        if (fmavX_last_is_reference()) flags |= SCHED_MSG_KEEP; // must not be coalesced away
+    } else {
+        len = fmav_msg_to_frame_buf(_buf, msg);
+    }
 
-    serial.putbuf(_buf, len);
+    link_out.PutMsg(_buf, len, msg->msgid, msg->sysid, msg->compid, flags);
+#endif
 }
+#endif
 
 
 //-------------------------------------------------------
@@ -433,7 +510,7 @@ uint16_t tRxMavlink::serial_in_available(void)
 {
 #ifdef USE_FEATURE_MAVLINKX
     // count all bytes still in processing
-    return fifo_link_out.Available() + serial.bytes_available() + bytes_parser_in;
+    return link_out.Available() + serial.bytes_available() + bytes_parser_in;
 #else
     return serial.bytes_available();
 #endif
@@ -500,7 +577,7 @@ bool tRxMavlink::handle_txbuf_ardupilot(uint32_t tnow_ms)
         hysteresis--;
     }
     if (frame_cnt < 500) frame_cnt = 500;
-    uint32_t rate_max = (frame_cnt * FRAME_RX_PAYLOAD_LEN) / Config.frame_rate_ms; // theoretical rate, bytes per sec
+    uint32_t rate_max = (frame_cnt * FRAME_RX_SERIAL_LEN) / Config.frame_rate_ms; // theoretical rate, bytes per sec
     uint32_t rate_percentage = (bytes_link_out * 100) / rate_max;
 #if 0 // debug
 dbg.puts("\nMa: ");dbg.puts(u16toBCD_s(frame_cnt_filtered));dbg.puts(" , ");dbg.puts(u16toBCD_s(frame_cnt));
@@ -613,7 +690,7 @@ bool tRxMavlink::handle_txbuf_method_b(uint32_t tnow_ms)
 
     // method C, with improvements
     // assumes 1 sec delta time
-    uint32_t rate_max = ((uint32_t)1000 * FRAME_RX_PAYLOAD_LEN) / Config.frame_rate_ms; // theoretical rate, bytes per sec
+    uint32_t rate_max = ((uint32_t)1000 * FRAME_RX_SERIAL_LEN) / Config.frame_rate_ms; // theoretical rate, bytes per sec
     uint32_t rate_percentage = (bytes_link_out * 100) / rate_max;
 
     // https://github.com/ArduPilot/ardupilot/blob/fa6441544639bd5dc84c3e6e3d2f7bfd2aecf96d/libraries/GCS_MAVLink/GCS_Common.cpp#L782-L801
@@ -706,8 +783,8 @@ uint8_t rssi, remrssi, txbuf, noise;
 
     txbuf = radio_status_txbuf;
 
-    fmav_msg_radio_status_pack(
-        &msg_serial_out,
+    _buf_len = fmav_msg_radio_status_pack_to_frame_buf(
+        _buf,
         RADIO_LINK_SYSTEM_ID, MAV_COMP_ID_TELEMETRY_RADIO, // SiK uses 51, 68
         rssi, remrssi, txbuf, noise, UINT8_MAX, 0, 0,
         //uint8_t rssi, uint8_t remrssi, uint8_t txbuf, uint8_t noise, uint8_t remnoise, uint16_t rxerrors, uint16_t fixed,
@@ -717,8 +794,8 @@ uint8_t rssi, remrssi, txbuf, noise;
 
 void tRxMavlink::generate_rc_channels_override(void)
 {
-    fmav_msg_rc_channels_override_pack(
-        &msg_serial_out,
+    _buf_len = fmav_msg_rc_channels_override_pack_to_frame_buf(
+        _buf,
         GCS_SYSTEM_ID, MAV_COMP_ID_TELEMETRY_RADIO, // ArduPilot accepts it only if it comes from its GCS sysid
         0, 0, // we do not know the sysid, compid of the flight controller
         rc_chan[0], rc_chan[1], rc_chan[2], rc_chan[3], rc_chan[4], rc_chan[5], rc_chan[6], rc_chan[7],
@@ -743,8 +820,8 @@ int16_t channels[32]; // FASTMAVLINK_MSG_RADIO_RC_CHANNELS_FIELD_CHANNELS_NUM =
     if (rc_failsafe) flags |= RADIO_RC_CHANNELS_FLAGS_FAILSAFE;
     if (!rc_channels_uptodate) flags |= RADIO_RC_CHANNELS_FLAGS_OUTDATED;
 
-    fmav_msg_radio_rc_channels_pack(
-        &msg_serial_out,
+    _buf_len = fmav_msg_radio_rc_channels_pack_to_frame_buf(
+        _buf,
         RADIO_LINK_SYSTEM_ID, MAV_COMP_ID_TELEMETRY_RADIO,
         0, 0, // targets
         rc_channels_tupdated_ms, flags,
@@ -786,11 +863,11 @@ int8_t rx_snr1, rx_snr2;
     float freq1 = fhss.GetCurrFreq_Hz();
     float freq2 = fhss.GetCurrFreq2_Hz();
 
-    fmav_msg_radio_link_stats_mlrs_pack(
+    _buf_len = fmav_msg_radio_link_stats_mlrs_pack_to_frame_buf(
 #else
-    fmav_msg_radio_link_stats_dev_pack(
+    _buf_len = fmav_msg_radio_link_stats_dev_pack_to_frame_buf(
 #endif
-        &msg_serial_out,
+        _buf,
         RADIO_LINK_SYSTEM_ID, MAV_COMP_ID_TELEMETRY_RADIO,
         0, 0, // targets
 
@@ -856,8 +933,8 @@ void tRxMavlink::generate_radio_link_information(void)
         break;
     }
 
-    fmav_msg_radio_link_information_dev_pack(
-        &msg_serial_out,
+    _buf_len = fmav_msg_radio_link_information_dev_pack_to_frame_buf(
+        _buf,
         RADIO_LINK_SYSTEM_ID, MAV_COMP_ID_TELEMETRY_RADIO,
         0, 0, // targets
 
@@ -885,8 +962,8 @@ void tRxMavlink::generate_cmd_ack(void)
         if (!serial.has_systemboot()) result = MAV_RESULT_DENIED;
     }
 
-    fmav_msg_command_ack_pack(
-        &msg_serial_out,
+    _buf_len = fmav_msg_command_ack_pack_to_frame_buf(
+        _buf,
         RADIO_LINK_SYSTEM_ID, MAV_COMP_ID_TELEMETRY_RADIO,
         cmd_ack.command,
         result, // result
@@ -900,14 +977,14 @@ void tRxMavlink::generate_cmd_ack(void)
 }
 
 
-void tRxMavlink::handle_msg(fmav_message_t* msg)
+void tRxMavlink::handle_msg(uint8_t* buf, fmav_result_t* result)
 {
 #ifdef USE_FEATURE_MAVLINKX
 fmav_command_long_t payload;
 
-    if (msg->msgid != FASTMAVLINK_MSG_ID_COMMAND_LONG) return;
+    if (result->msgid != FASTMAVLINK_MSG_ID_COMMAND_LONG) return;
 
-    fmav_msg_command_long_decode(&payload, msg);
+    fmav_frame_buf_decode_payload(&payload, sizeof(fmav_command_long_t), buf);
 
     // check if it is for us, only allow targeted commands
     if (payload.target_system != RADIO_LINK_SYSTEM_ID) return;
@@ -925,8 +1002,8 @@ fmav_command_long_t payload;
 
     inject_cmd_ack = true;
     cmd_ack.command = payload.command;
-    cmd_ack.cmd_src_sysid = msg->sysid;
-    cmd_ack.cmd_src_compid = msg->compid;
+    cmd_ack.cmd_src_sysid = result->sysid;
+    cmd_ack.cmd_src_compid = result->compid;
 
     bool cmd_valid = false;
     switch (payload.command) {
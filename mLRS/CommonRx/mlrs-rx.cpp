@@ -52,6 +52,24 @@
 #include "../Common/hal/esp-powerup.h"
 #include "../Common/hal/esp-rxclock.h"
 
+#elif defined HOST_SIM
+
+#include "../Common/hal/host-glue.h"
+#include "../modules/stm32ll-lib/src/stdstm32.h"
+#include "../Common/host-lib/host-peripherals.h"
+#include "../Common/host-lib/host-mcu.h"
+#include "../Common/host-lib/host-stack.h"
+#include "../Common/hal/hal.h"
+#include "../Common/host-lib/host-delay.h" // these are dependent on hal
+#include "../Common/host-lib/host-eeprom.h"
+#include "../Common/host-lib/host-spi.h"
+#ifdef USE_SERIAL
+#include "../Common/host-lib/host-uartb.h"
+#endif
+#include "../Common/hal/host-timer.h"
+#include "../Common/hal/host-powerup.h"
+#include "../Common/hal/host-rxclock.h"
+
 #else
 
 #include "../Common/hal/glue.h"
@@ -95,6 +113,11 @@
 #include "../Common/common.h"
 #include "../Common/diversity.h"
 #include "../Common/arq.h"
+#include "../Common/profiler.h"
+#include "../Common/rc_trace.h"
+#include "../Common/fhss_adaptive.h"
+#include "resync.h"
+#include "listen_rank.h"
 //#include "../Common/test.h" // un-comment if you want to compile for board test
 
 #include "out_interface.h" // this includes uart.h, out.h, declares tOut out
@@ -105,6 +128,21 @@ tPowerupCounter powerup;
 tRDiversity rdiversity;
 tTDiversity tdiversity;
 tTransmitArq tarq;
+#ifdef USE_FEATURE_PROFILER
+tProfiler profiler;
+#endif
+#ifdef USE_FEATURE_RC_TRACE
+tRcTrace rctrace;
+#endif
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+tFhssAdaptive fhssadaptive;
+#endif
+#ifdef USE_FEATURE_RX_RESYNC
+tRxResync resync;
+#endif
+#ifdef USE_FEATURE_RX_LISTEN_RANK
+tRxListenRank listenrank;
+#endif
 
 
 // is required in bind.h
@@ -207,6 +245,9 @@ uint8_t link_rx2_status;
 uint8_t link_task;
 uint8_t transmit_frame_type;
 bool doParamsStore;
+#ifdef USE_FEATURE_ARQ_STATS
+bool doArqStatsSend;
+#endif
 
 
 void link_task_init(void)
@@ -215,6 +256,9 @@ void link_task_init(void)
     transmit_frame_type = TRANSMIT_FRAME_TYPE_NORMAL;
 
     doParamsStore = false;
+#ifdef USE_FEATURE_ARQ_STATS
+    doArqStatsSend = false;
+#endif
 }
 
 
@@ -241,6 +285,7 @@ tCmdFrameHeader* head = (tCmdFrameHeader*)(frame->payload);
     switch (head->cmd) {
     case FRAME_CMD_GET_RX_SETUPDATA:
         // request to send setup data, trigger sending RX_SETUPDATA in next transmission
+        IF_FRAME_VARLEN(framevarlen.Requested(((tTxCmdFrameGetRxSetupData*)frame->payload)->frame_varlen);)
         link_task_set(LINK_TASK_RX_SEND_RX_SETUPDATA);
         break;
     case FRAME_CMD_SET_RX_PARAMS:
@@ -257,6 +302,15 @@ tCmdFrameHeader* head = (tCmdFrameHeader*)(frame->payload);
         // request to send setup data, trigger sending RX_SETUPDATA in next transmission
         link_task_set(LINK_TASK_RX_SEND_RX_SETUPDATA);
         break;
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+    case FRAME_CMD_SET_FHSS: {
+        // received spare channel map, it's applied at the switch hop if the Tx confirmed it, or the Tx' query
+        // trigger sending RX_FHSS in next transmission
+        tTxCmdFrameFhss* fhss_cmd = (tTxCmdFrameFhss*)frame->payload;
+        fhssadaptive.SetProposedMap(fhss_cmd->spare_map, fhss_cmd->switch_cnt, fhss_cmd->confirmed);
+        link_task_set(LINK_TASK_RX_SEND_RX_FHSS);
+        break; }
+#endif
     }
 }
 
@@ -268,6 +322,26 @@ void pack_rxcmdframe(tRxFrame* frame, tFrameStats* frame_stats)
         // send rx setup data
         pack_rxcmdframe_rxsetupdata(frame, frame_stats);
         break;
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+    case LINK_TASK_RX_SEND_RX_FHSS: {
+        // send pending spare channel map, or the one in use if asked for, and link quality per slot
+        uint8_t valid_cnt_u4[FHSS_MAX_NUM / 2];
+        uint32_t window_full_mask;
+        bool in_use;
+        const uint8_t* spare_map = fhssadaptive.ResponseMap(&in_use);
+        fhssadaptive.GetQuality(valid_cnt_u4, &window_full_mask);
+        pack_rxcmdframe_rxfhss(frame, frame_stats, spare_map, fhssadaptive.Confirmed(), in_use, valid_cnt_u4, window_full_mask);
+        break; }
+#endif
+#ifdef USE_FEATURE_ARQ_STATS
+    case LINK_TASK_RX_SEND_RX_ARQ_STATS:
+        // send the counts of the transmit ARQ, it's not a response, so we are done
+        pack_rxcmdframe_rxarqstats(frame, frame_stats,
+            stats.arq_cnt_per_sec.first_attempt, stats.arq_cnt_per_sec.retransmitted, stats.arq_cnt_per_sec.retry_exhausted,
+            stats.arq_retry_cnt, stats.arq_retry_success);
+        link_task_reset();
+        break;
+#endif
     }
 }
 
@@ -285,20 +359,28 @@ void pack_rxcmdframe(tRxFrame* frame, tFrameStats* frame_stats)
 
 void prepare_transmit_frame(uint8_t antenna)
 {
-uint8_t payload[FRAME_RX_PAYLOAD_LEN];
 uint8_t payload_len = 0;
 
+    PROFILER_START(PROFILER_STAGE_PACK);
+
     bool get_fresh_payload = tarq.GetFreshPayload();
+    static bool serial_backlog = false;
+
+#ifdef USE_FEATURE_ARQ_STATS
+    // the arq stats take a fresh frame, if no other cmd frame is pending
+    if (get_fresh_payload && doArqStatsSend && transmit_frame_type == TRANSMIT_FRAME_TYPE_NORMAL) {
+        doArqStatsSend = false;
+        link_task_set(LINK_TASK_RX_SEND_RX_ARQ_STATS);
+    }
+#endif
 
     if (get_fresh_payload) {
         if (transmit_frame_type == TRANSMIT_FRAME_TYPE_NORMAL) {
-            // read data from serial
+            // read data from serial, directly into the frame
+            // only for fresh payload, else the frame holds the payload to be retransmitted
             if (connected()) {
-                for (uint8_t i = 0; i < FRAME_RX_PAYLOAD_LEN; i++) {
-                    if (!sx_serial.available()) break;
-                    uint8_t c = sx_serial.getc();
-                    payload[payload_len++] = c;
-                }
+                payload_len = sx_serial.getbuf(rxFrame.payload, FRAME_RX_SERIAL_LEN);
+                serial_backlog = sx_serial.available(); // for the ARQ retry controller
 
                 stats.bytes_transmitted.Add(payload_len);
                 stats.serial_data_transmitted.Inc();
@@ -318,29 +400,36 @@ uint8_t payload_len = 0;
     frame_stats.rssi = stats.GetLastRssi();
     frame_stats.LQ_rc = stats.GetLQ_rc();
     frame_stats.LQ_serial = stats.GetLQ_serial();
+    frame_stats.arq_window = tarq.Window();
 
     static bool rxFrame_valid = false; // just for now
     if (get_fresh_payload) {
         if (transmit_frame_type == TRANSMIT_FRAME_TYPE_NORMAL) {
-            pack_rxframe(&rxFrame, &frame_stats, payload, payload_len);
+            pack_rxframe_payload_inplace(&rxFrame, &frame_stats, payload_len);
         } else {
             pack_rxcmdframe(&rxFrame, &frame_stats);
         }
+        tarq.StoreFrame(&rxFrame); // the selective repeat ARQ keeps the payloads in flight
         rxFrame_valid = true;
 
         stats.cntFrameTransmitted();
-        tarq.SetRetryCntAuto(stats.GetFrameCnt(), Config.Mode);
 
     } else {
         // rxFrame should still hold the previous data
         if (!rxFrame_valid) while(1){} // should not happen
 
+        tarq.LoadFrame(&rxFrame); // the selective repeat ARQ may resend an older payload
         update_rxframe_stats(&rxFrame, &frame_stats);
         rxFrame_valid = true;
 
         stats.cntFrameSkipped();
-        tarq.SetRetryCntAuto(stats.GetFrameCnt(), Config.Mode);
     }
+
+    tarq.SetRetryCntAuto(stats.GetFrameCnt(), stats.GetLQ_serial(), serial_backlog, Config.frame_rate_ms);
+    stats.arq_retry_cnt = tarq.RetryCnt();
+    stats.arq_retry_success = tarq.RetrySuccess();
+
+    PROFILER_STOP(PROFILER_STAGE_PACK);
 }
 
 
@@ -360,6 +449,10 @@ void process_received_frame(bool do_payload, tTxFrame* frame)
     }
 
     rcdata_from_txframe(&rcData, frame);
+    RC_TRACE(RC_TRACE_RCDATA);
+
+    // short frames start when the Tx has our answer
+    IF_FRAME_VARLEN(framevarlen.Received(frame);)
 
     // handle cmd frame
     if (frame->status.frame_type == FRAME_TYPE_TX_RX_CMD) {
@@ -407,7 +500,7 @@ tTxFrame* frame;
 
     // handle transmit ARQ
     if (rx_status > RX_STATUS_INVALID) { // RX_STATUS_CRC1_VALID, RX_STATUS_VALID: we have valid information on ack
-        tarq.AckReceived(frame->status.ack);
+        tarq.AckReceived(frame->status.ack, frame->status.LQ_rc, frame->status.arq_window);
     } else {
         tarq.FrameMissed();
     }
@@ -448,7 +541,22 @@ void do_transmit(uint8_t antenna) // we send a frame to transmitter
     prepare_transmit_frame(antenna);
 
     // to test asymmetric connection, fake rxFrame, to no send doesn't work as it blocks the sx
-    sxSendFrame(antenna, &rxFrame, FRAME_TX_RX_LEN, SEND_FRAME_TMO_MS); // 10ms tmo
+    sxSendFrame(antenna, &rxFrame, rxframe_len(&rxFrame), SEND_FRAME_TMO_MS); // 10ms tmo
+}
+
+
+// a short frame is received earlier than a full frame would have been, by the difference in time over air
+// the rxclock is shifted by this, so that the timing is the same for all frames
+uint16_t short_frame_delay_10us(uint8_t antenna)
+{
+#ifdef USE_FEATURE_FRAME_VARLEN
+    tTxFrame* frame = (antenna == ANTENNA_1) ? &txFrame : &txFrame2;
+    if (txframe_len(frame) == FRAME_TX_RX_LEN) return 0;
+    if (antenna == ANTENNA_1) return (sx.TimeOverAir_us() - sx.TimeOverAirShort_us()) / 10;
+    return (sx2.TimeOverAir_us() - sx2.TimeOverAirShort_us()) / 10;
+#else
+    return 0;
+#endif
 }
 
 
@@ -463,8 +571,10 @@ uint8_t rx_status = RX_STATUS_INVALID; // this also signals that a frame was rec
 
     // we don't need to read sx.GetRxBufferStatus(), but hey
     // we could save 2 byte's time by not reading sync_word again, but hey
+    RC_TRACE(RC_TRACE_RECEIVE);
     sxReadFrame(antenna, &txFrame, &txFrame2, FRAME_TX_RX_LEN);
     res = (antenna == ANTENNA_1) ? check_txframe(&txFrame) : check_txframe(&txFrame2);
+    IF_RC_TRACE(if (res == CHECK_OK) rctrace.Mark(RC_TRACE_CHECK);)
 
     if (res) {
         DBG_MAIN(dbg.puts("fail ");dbg.putc('\n');)
@@ -477,7 +587,7 @@ dbg.puts("fail a");dbg.putc(antenna+'0');dbg.puts(" ");dbg.puts(u8toHEX_s(res));
 
     if (res == CHECK_OK || res == CHECK_ERROR_CRC) {
 
-        if (do_clock_reset) rxclock.Reset();
+        if (do_clock_reset) rxclock.Reset(short_frame_delay_10us(antenna));
 
         rx_status = (res == CHECK_OK) ? RX_STATUS_VALID : RX_STATUS_CRC1_VALID;
     }
@@ -540,6 +650,9 @@ RESTARTCONTROLLER
     bind.Init();
     fhss.Init(&Config.Fhss, &Config.Fhss2);
     fhss.Start();
+    IF_FHSS_ADAPTIVE(fhssadaptive.Init(fhss.Cnt(), fhss.SpareCnt());)
+    IF_RX_RESYNC(resync.Init(fhss.Cnt(), Config.frame_rate_ms);)
+    IF_RX_LISTEN_RANK(listenrank.Init(fhss.Cnt());)
 
     sx.SetRfFrequency(fhss.GetCurrFreq());
     sx2.SetRfFrequency(fhss.GetCurrFreq2());
@@ -552,6 +665,7 @@ RESTARTCONTROLLER
     connect_occured_once = false;
     link_rx1_status = link_rx2_status = RX_STATUS_NONE;
     link_task_init();
+    IF_FRAME_VARLEN(framevarlen.Init();)
     doPostReceive2_cnt = 0;
     doPostReceive2 = false;
     frame_missed = false;
@@ -565,6 +679,8 @@ RESTARTCONTROLLER
     mavlink.Init();
     sx_serial.Init();
     fan.SetPower(sx.RfPower_dbm());
+    IF_PROFILER(profiler.Init();)
+    IF_RC_TRACE(rctrace.Init();)
 
     tick_1hz = 0;
     tick_1hz_commensurate = 0;
@@ -574,7 +690,9 @@ INITCONTROLLER_END
     //-- SysTask handling
 
     if (doSysTask) {
+        IF_PROFILER(if (doSysTask > 1) profiler.SysTickMissed(doSysTask - 1);)
         doSysTask = 0;
+        PROFILER_START(PROFILER_STAGE_SYSTASK);
 
         if (connect_tmo_cnt) {
             connect_tmo_cnt--;
@@ -605,7 +723,11 @@ INITCONTROLLER_END
 
             dbg.puts(u16toBCD_s(stats.bytes_transmitted.GetBytesPerSec())); dbg.puts(", ");
             dbg.puts(u16toBCD_s(stats.bytes_received.GetBytesPerSec())); dbg.puts("; "); */
+            IF_PROFILER(profiler.Update1Hz();)
+            IF_RC_TRACE(rctrace.Update1Hz();)
         }
+
+        PROFILER_STOP(PROFILER_STAGE_SYSTASK);
     }
 
     //-- SX handling
@@ -614,6 +736,7 @@ INITCONTROLLER_END
     case LINK_STATE_RECEIVE:
         if (connect_state >= CONNECT_STATE_SYNC) { // we hop only if not in listen
             fhss.HopToNext();
+            IF_FHSS_ADAPTIVE(fhssadaptive.Hop();)
         }
         sx.SetRfFrequency(fhss.GetCurrFreq());
         sx2.SetRfFrequency(fhss.GetCurrFreq2());
@@ -626,7 +749,9 @@ INITCONTROLLER_END
         break;
 
     case LINK_STATE_TRANSMIT:
+        PROFILER_START(PROFILER_STAGE_DO_TRANSMIT);
         do_transmit(tdiversity.Antenna());
+        PROFILER_STOP(PROFILER_STAGE_DO_TRANSMIT);
         link_state = LINK_STATE_TRANSMIT_WAIT;
         irq_status = irq2_status = 0; // important, in low connection condition, RxDone isr could trigger
         break;
@@ -645,7 +770,9 @@ IF_SX(
             if (irq_status & SX_IRQ_RX_DONE) {
                 irq_status = 0;
                 bool do_clock_reset = (link_rx2_status == RX_STATUS_NONE);
+                PROFILER_START(PROFILER_STAGE_DO_RECEIVE);
                 link_rx1_status = do_receive(ANTENNA_1, do_clock_reset);
+                PROFILER_STOP(PROFILER_STAGE_DO_RECEIVE);
                 if (link_rx1_status == RX_STATUS_VALID) sx.HandleAFC();
                 DBG_MAIN_SLIM(dbg.puts("1!");)
             }
@@ -681,7 +808,9 @@ IF_SX2(
             if (irq2_status & SX2_IRQ_RX_DONE) {
                 irq2_status = 0;
                 bool do_clock_reset = (link_rx1_status == RX_STATUS_NONE);
+                PROFILER_START(PROFILER_STAGE_DO_RECEIVE);
                 link_rx2_status = do_receive(ANTENNA_2, do_clock_reset);
+                PROFILER_STOP(PROFILER_STAGE_DO_RECEIVE);
                 if (link_rx2_status == RX_STATUS_VALID) sx2.HandleAFC();
                 DBG_MAIN_SLIM(dbg.puts("2!");)
             }
@@ -710,6 +839,7 @@ IF_SX2(
 
     if (doPostReceive) {
         doPostReceive = false;
+        PROFILER_START(PROFILER_STAGE_LINK);
 
         bool frame_received, valid_frame_received, invalid_frame_received;
         if (USE_ANTENNA1 && USE_ANTENNA2) {
@@ -757,11 +887,23 @@ dbg.puts(s8toBCD_s(stats.last_rssi2));*/
             mavlink.FrameLost();
         }
 
+        // we are still on the frequency of this reception
+        IF_FHSS_ADAPTIVE(if (connected()) fhssadaptive.Put(fhss.CurrI(),
+                (valid_frame_received) ? RX_STATUS_VALID : (invalid_frame_received) ? RX_STATUS_INVALID : RX_STATUS_NONE);)
+#ifdef USE_FEATURE_RX_LISTEN_RANK
+        if (!bind.IsInBind() && ((connect_state >= CONNECT_STATE_SYNC) || frame_received)) {
+            listenrank.Put(fhss.CurrI(),
+                (valid_frame_received) ? RX_STATUS_VALID : (invalid_frame_received) ? RX_STATUS_INVALID : RX_STATUS_NONE,
+                stats.GetLastRssi());
+        }
+#endif
+
         if (valid_frame_received) { // valid frame received
             switch (connect_state) {
             case CONNECT_STATE_LISTEN:
                 connect_state = CONNECT_STATE_SYNC;
                 connect_sync_cnt = 0;
+                IF_RX_RESYNC(resync.Stop();)
                 break;
             case CONNECT_STATE_SYNC:
                 connect_sync_cnt++;
@@ -781,11 +923,26 @@ dbg.puts(s8toBCD_s(stats.last_rssi2));*/
             link_state = LINK_STATE_RECEIVE;
         }
 
+        bool resyncing = false;
+#ifdef USE_FEATURE_RX_RESYNC
+        // we just disconnected, so keep hopping with the rxclock for a while
+        if ((connect_state == CONNECT_STATE_LISTEN) && resync.Active()) {
+            uint8_t hops = resync.Tick();
+            for (uint8_t n = 0; n < hops; n++) fhss.HopToNext();
+            link_state = LINK_STATE_RECEIVE; // switch back to RX
+            resyncing = true;
+        }
+#endif
+
         // when in listen, slowly loop through frequencies
-        if (connect_state == CONNECT_STATE_LISTEN) {
+        if ((connect_state == CONNECT_STATE_LISTEN) && !resyncing) {
             connect_listen_cnt++;
             if (connect_listen_cnt >= CONNECT_LISTEN_HOP_CNT) {
+#ifdef USE_FEATURE_RX_LISTEN_RANK
+                fhss.HopTo(listenrank.Next(fhss.CurrI())); // go to the best ranked slot
+#else
                 fhss.HopToNext();
+#endif
                 connect_listen_cnt = 0;
                 link_state = LINK_STATE_RECEIVE; // switch back to RX
             }
@@ -799,6 +956,16 @@ dbg.puts(s8toBCD_s(stats.last_rssi2));*/
             connect_state = CONNECT_STATE_LISTEN;
             connect_listen_cnt = 0;
             link_state = LINK_STATE_RECEIVE; // switch back to RX
+#ifdef USE_FEATURE_RX_LISTEN_RANK
+            listenrank.Restart();
+            connect_listen_cnt = CONNECT_LISTEN_HOP_CNT; // so that listen goes to the best ranked slot right away
+#endif
+#ifdef USE_FEATURE_RX_RESYNC
+            if (!bind.IsInBind()) {
+                resync.Start();
+                fhss.HopToNext(); // LINK_STATE_RECEIVE doesn't hop in listen, so do it here
+            }
+#endif
         }
 
         // we didn't receive a valid frame
@@ -821,9 +988,19 @@ dbg.puts(s8toBCD_s(stats.last_rssi2));*/
 
         if (!connected()) tarq.Disconnected();
 
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+        if (!connected()) fhssadaptive.Clear();
+        if (fhssadaptive.Changed()) fhss.SetSpareMap(fhssadaptive.Map()); // becomes effective with the next hop
+#endif
+
         DECc(tick_1hz_commensurate, Config.frame_rate_hz);
         if (!tick_1hz_commensurate) {
+            stats.arq_cnt = tarq.cnt;
             stats.Update1Hz();
+#ifdef USE_FEATURE_ARQ_STATS
+            // the Tx gets the counts of our transmit ARQ with the next fresh frame
+            doArqStatsSend = connected();
+#endif
         }
         stats.Next();
         if (!connected()) stats.Clear();
@@ -831,6 +1008,7 @@ dbg.puts(s8toBCD_s(stats.last_rssi2));*/
         if (connect_state == CONNECT_STATE_LISTEN) {
             link_task_reset();
             link_task_set(LINK_TASK_RX_SEND_RX_SETUPDATA);
+            IF_FRAME_VARLEN(framevarlen.Init();) // we connect with full frames
         }
 
         powerup.Do();
@@ -844,6 +1022,7 @@ dbg.puts(s8toBCD_s(stats.last_rssi2));*/
             rxclock.Reset();
             fhss.SetToBind(Config.frame_rate_ms);
             leds.SetToBind();
+            IF_RX_RESYNC(resync.Stop();)
             connect_state = CONNECT_STATE_LISTEN;
             link_state = LINK_STATE_RECEIVE;
             break;
@@ -854,6 +1033,7 @@ dbg.puts(s8toBCD_s(stats.last_rssi2));*/
         }
 
         doPostReceive2_cnt = 5; // postpone this few loops, to allow link_state changes to be handled
+        PROFILER_STOP(PROFILER_STAGE_LINK);
     }//end of if(doPostReceive)
 
     if (link_state != link_state_before) return; // link state has changed, so process immediately
@@ -870,6 +1050,7 @@ dbg.puts(s8toBCD_s(stats.last_rssi2));*/
         out.SetChannelOrder(Setup.Rx.ChannelOrder);
         if (connected()) {
             out.SendRcData(&rcData, frame_missed, false, stats.GetLastRssi(), stats.GetLQ_rc());
+            RC_TRACE(RC_TRACE_OUT);
             out.SendLinkStatistics();
             mavlink.SendRcData(out.GetRcDataPtr(), frame_missed, false);
         } else {
@@ -886,7 +1067,9 @@ dbg.puts(s8toBCD_s(stats.last_rssi2));*/
 
     //-- Do MAVLink
 
+    PROFILER_START(PROFILER_STAGE_MAVLINK_DO);
     mavlink.Do();
+    PROFILER_STOP(PROFILER_STAGE_MAVLINK_DO);
 
     //-- Store parameters
 
@@ -0,0 +1,94 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// Rx Resync
+//*******************************************************
+// After a disconnect the rx goes to listen, and sits on one channel until the tx comes by,
+// which takes up to a fhss cycle, and 1.5 cycles more if that channel happens to be bad.
+// However, the rxclock keeps running with the frame period, and the tx keeps hopping, so
+// for a while after the loss the rx still knows where the tx is. We therefore keep hopping
+// for a grace period, on the predicted channels, and every third fhss cycle on the channels
+// next to them in the sequence, in case the clocks have drifted by a frame. Only then the
+// rx falls back to the slow listen.
+// This is rx only, the tx doesn't change.
+//*******************************************************
+#ifndef RESYNC_H
+#define RESYNC_H
+#pragma once
+
+
+#include <stdint.h>
+
+
+#ifdef USE_FEATURE_RX_RESYNC
+
+#define IF_RX_RESYNC(x)           x
+
+
+#define RX_RESYNC_TMO_MS          5000 // grace period, counts from the disconnect, i.e. adds to CONNECT_TMO_MS
+
+
+class tRxResync
+{
+  public:
+    void Init(uint8_t _cnt, uint16_t frame_rate_ms)
+    {
+        cnt = _cnt;
+        frame_cnt_max = RX_RESYNC_TMO_MS / frame_rate_ms;
+        active = false;
+    }
+
+    // called when the connection is lost
+    void Start(void)
+    {
+        active = true;
+        frame_cnt = 0;
+        ofs = 0;
+    }
+
+    void Stop(void) { active = false; }
+
+    bool Active(void) { return active; }
+
+    // called each frame period while in listen
+    // returns the number of hops to do, is 1 normally, 0 or 2 when the offset changes
+    uint8_t Tick(void)
+    {
+        if (!active) return 0;
+
+        frame_cnt++;
+        if (frame_cnt >= frame_cnt_max) { // give up, fall back to slow listen
+            active = false;
+            return 0;
+        }
+
+        uint8_t hops = 1;
+        if ((frame_cnt % cnt) == 0) { // a cycle is done, select the offset for the next cycle
+            uint16_t cycle = frame_cnt / cnt;
+            int8_t ofs_next = 0;
+            if ((cycle % 3) == 2) ofs_next = ((cycle / 3) & 0x01) ? -1 : 1;
+            hops += ofs_next - ofs;
+            ofs = ofs_next;
+        }
+        return hops;
+    }
+
+  private:
+    uint8_t cnt;
+    uint16_t frame_cnt_max;
+    uint16_t frame_cnt;
+    int8_t ofs; // the offset to the predicted index, -1, 0, +1
+    bool active;
+};
+
+
+#else
+
+#define IF_RX_RESYNC(x)
+
+#endif // USE_FEATURE_RX_RESYNC
+
+#endif // RESYNC_H
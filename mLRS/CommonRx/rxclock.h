@@ -37,7 +37,7 @@ class tRxClock
   public:
     void Init(uint16_t period_ms);
     void SetPeriod(uint16_t period_ms);
-    void Reset(void);
+    void Reset(uint16_t delay_10us = 0);
 
     void init_isr_off(void);
     void enable_isr(void);
@@ -60,12 +60,13 @@ void tRxClock::SetPeriod(uint16_t period_ms)
 }
 
 
-void tRxClock::Reset(void)
+// delay_10us shifts the clock to later, is used for short frames, which are received earlier than full frames
+void tRxClock::Reset(uint16_t delay_10us)
 {
     if (!CLOCK_PERIOD_10US) while (1) {}
 
     __disable_irq();
-    uint32_t CNT = CLOCK_TIMx->CNT; // works for both 16 and 32 bit timer
+    uint32_t CNT = CLOCK_TIMx->CNT + delay_10us; // works for both 16 and 32 bit timer
     CLOCK_TIMx->CCR1 = CNT + CLOCK_PERIOD_10US;
     CLOCK_TIMx->CCR3 = CNT + CLOCK_SHIFT_10US;
     LL_TIM_ClearFlag_CC1(CLOCK_TIMx); // important to do
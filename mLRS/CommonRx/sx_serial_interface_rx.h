@@ -35,6 +35,15 @@ class tRxSxSerial : public tSerialBase
         return serial.getc(); // get from serial
     }
 
+    // reads directly into buf, e.g. rxFrame.payload
+    uint16_t getbuf(uint8_t* buf, uint16_t len) override
+    {
+        if (SERIAL_LINK_MODE_IS_MAVLINK(Setup.Rx.SerialLinkMode)) {
+            return mavlink.getbuf(buf, len); // get from serial via MAVLink parser
+        }
+        return serial.getbuf(buf, len); // get from serial
+    }
+
     void putbuf(uint8_t* buf, uint16_t len) override
     {
         if (SERIAL_LINK_MODE_IS_MAVLINK(Setup.Rx.SerialLinkMode)) {
@@ -21,6 +21,12 @@ extern volatile uint32_t millis32(void);
 extern bool connected(void);
 extern tStats stats;
 extern tConfigId config_id;
+#ifdef USE_FEATURE_PROFILER
+extern tProfiler profiler;
+#endif
+#ifdef USE_FEATURE_RC_TRACE
+extern tRcTrace rctrace;
+#endif
 
 
 //-------------------------------------------------------
@@ -295,6 +301,9 @@ class tTxCli
     void print_param_opt_list(uint8_t idx);
     void print_device_version(void);
     void print_frequencies(void);
+    void print_profiler(void);
+    void print_rc_trace(void);
+    void put_u32(uint32_t v);
     void stream(void);
 
     bool is_cmd(const char* cmd);
@@ -598,6 +607,21 @@ void tTxCli::stream(void)
             puts(u16toBCD_s(stats.bytes_transmitted.GetBytesPerSec()));
             puts(", ");
             puts(u16toBCD_s(stats.bytes_received.GetBytesPerSec()));
+            puts("; ");
+
+            // goodput, the Rx' ARQ first attempts, retransmissions, retries exhausted, and our ARQ
+            // duplicates and parser resets of the last second
+            puts(u16toBCD_s(stats.GetGoodput()));
+            puts(", ");
+            puts(u16toBCD_s(stats.arq_cnt_per_sec.first_attempt));
+            puts(",");
+            puts(u16toBCD_s(stats.arq_cnt_per_sec.retransmitted));
+            puts(",");
+            puts(u16toBCD_s(stats.arq_cnt_per_sec.retry_exhausted));
+            puts(",");
+            puts(u16toBCD_s(stats.arq_cnt_per_sec.duplicates));
+            puts(",");
+            puts(u16toBCD_s(stats.arq_cnt_per_sec.frame_lost));
             putsn(";");
         }
     }
@@ -622,6 +646,19 @@ void tTxCli::print_device_version(void)
     } else {
         putsn("receiver not connected");
     }
+
+#ifdef USE_FEATURE_FRAME_VARLEN
+    if (connected() && SetupMetaData.rx_available) {
+        puts("  frames: ");
+        if (framevarlen.Active()) {
+            putsn("short frames");
+        } else if (!SetupMetaData.rx_frame_varlen) {
+            putsn("full length, Rx has no USE_FEATURE_FRAME_VARLEN");
+        } else {
+            putsn("full length");
+        }
+    }
+#endif
 }
 
 
@@ -649,6 +686,57 @@ char s[32];
 }
 
 
+void tTxCli::print_profiler(void)
+{
+#ifdef USE_FEATURE_PROFILER
+    // values of the last second, in us
+    for (uint8_t n = 0; n < PROFILER_STAGE_NUM; n++) {
+        puts("  ");
+        puts(profiler_stage_name[n]);
+        puts("  cnt: "); put_u32(profiler.Cnt(n));
+        puts("  min: "); put_u32(profiler.Min_us(n) + 0.5f);
+        puts("  avg: "); put_u32(profiler.Avg_us(n) + 0.5f);
+        puts("  max: "); put_u32(profiler.Max_us(n) + 0.5f);
+        putsn(" us");
+    }
+    puts("  systicks missed: "); put_u32(profiler.SysTickMissed());
+    putsn("");
+#endif
+}
+
+
+void tTxCli::put_u32(uint32_t v)
+{
+char s[32];
+
+    u32toBCDstr(v, s);
+    remove_leading_zeros(s);
+    puts(s);
+}
+
+
+void tTxCli::print_rc_trace(void)
+{
+#ifdef USE_FEATURE_RC_TRACE
+    // values of the last second, in us
+    for (uint8_t n = 0; n < RC_TRACE_POINT_NUM; n++) {
+        puts("  ");
+        puts((n == 0) ? "total" : rc_trace_point_name[n]);
+        puts("  cnt: "); put_u32(rctrace.Cnt(n));
+        puts("  min: "); put_u32(rctrace.Min_us(n));
+        puts("  avg: "); put_u32(rctrace.Avg_us(n));
+        puts("  max: "); put_u32(rctrace.Max_us(n));
+        putsn(" us");
+    }
+    puts("  total p50: "); put_u32(rctrace.Percentile_ms(50));
+    puts(" ms  p99: "); put_u32(rctrace.Percentile_ms(99));
+    putsn(" ms");
+    puts("  time over air: "); put_u32(sx.TimeOverAir_us());
+    putsn(" us");
+#endif
+}
+
+
 void tTxCli::print_help(void)
 {
     putsn("  help, h, ?  -> this help page");
@@ -668,6 +756,12 @@ void tTxCli::print_help(void)
     putsn("  reload      -> reload all parameter settings");
     putsn("  stats       -> starts streaming statistics");
     putsn("  listfreqs   -> lists frequencies used in fhss scheme");
+#ifdef USE_FEATURE_PROFILER
+    putsn("  prof        -> print main loop profiling");
+#endif
+#ifdef USE_FEATURE_RC_TRACE
+    putsn("  rctrace     -> print rc data latency trace");
+#endif
 
     putsn("  systemboot  -> call system bootloader");
 
@@ -797,6 +891,16 @@ bool rx_param_changed;
         } else
         if (is_cmd("listfreqs")) {
           print_frequencies();
+#ifdef USE_FEATURE_PROFILER
+        } else
+        if (is_cmd("prof")) {
+            print_profiler();
+#endif
+#ifdef USE_FEATURE_RC_TRACE
+        } else
+        if (is_cmd("rctrace")) {
+            print_rc_trace();
+#endif
 
         //-- System Bootloader
         } else
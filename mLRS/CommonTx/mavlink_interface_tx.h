@@ -14,13 +14,20 @@
 #include "../Common/mavlink/fmav_extension.h"
 #include "../Common/protocols/ardupilot_protocol.h"
 #ifdef USE_FEATURE_MAVLINKX
+#ifdef USE_FEATURE_MAVLINKX_DELTA
+  #define MAVLINKX_DELTA
+#endif
+#ifdef USE_FEATURE_MAVLINKX_CONTEXT
+  #define MAVLINKX_CONTEXT
+#endif
 #include "../Common/thirdparty/mavlinkx.h"
-#include "../Common/libs/fifo.h"
+#include "../Common/mavlink_scheduler.h"
 #define FASTMAVLINK_ROUTER_LINKS_MAX  4
 #define FASTMAVLINK_ROUTER_COMPONENTS_MAX  12
 #define FASTMAVLINK_ROUTER_LINK_PROPERTY_DEFAULT  FASTMAVLINK_ROUTER_LINK_PROPERTY_FLAG_ALWAYS_SEND_HEARTBEAT
 #include "../Common/mavlink/out/lib/fastmavlink_router.h"
 #endif
+#include "../Common/mavlink_debug.h"
 
 
 extern bool link_task_free(void);
@@ -46,13 +53,17 @@ class tTxMavlink
     void putc(char c);
     bool available(void);
     uint8_t getc(void);
+    uint16_t getbuf(uint8_t* buf, uint16_t len);
     void flush(void);
 
   private:
-    void send_msg_fifo_link_out(fmav_message_t* msg);
+    void send_msg_link_out(fmav_message_t* msg);
     void handle_msg_serial_out(fmav_message_t* msg);
     void generate_radio_status(void);
     void send_msg_serial_out(void);
+#ifdef USE_MAVLINK_DEBUG
+    tMavlinkDebug debug;
+#endif
 
     uint16_t task_pending_mask;
     uint32_t task_pending_delay_ms;
@@ -72,7 +83,7 @@ class tTxMavlink
     uint8_t buf_ser_in[MAVLINK_BUF_SIZE]; // buffer for ser in parser
     fmav_status_t status_ser2_in;
     uint8_t buf_ser2_in[MAVLINK_BUF_SIZE];
-    tFifo<char,512> fifo_link_out; // needs to be at least 82 + 280
+    tMavlinkScheduler link_out; // bulk needs to be at least 82 + 280
 #endif
 
     fmav_message_t msg_buf; // temporary working buffer, to not burden stack
@@ -144,15 +155,24 @@ void tTxMavlink::Init(tSerialBase* _serialport, tSerialBase* _mbridge, tSerialBa
 #ifdef USE_FEATURE_MAVLINKX
     fmavX_init();
     fmavX_config_compression((Config.Mode == MODE_19HZ) ? 1 : 0); // use compression only in 19 Hz mode
+#ifdef USE_FEATURE_MAVLINKX_DELTA
+    fmavX_config_delta((Config.Mode == MODE_19HZ) ? 1 : 0);
+#endif
+#ifdef USE_FEATURE_MAVLINKX_CONTEXT
+    fmavX_config_context(1);
+#endif
 
     status_ser_in = {};
     status_ser2_in = {};
-    fifo_link_out.Init();
+    link_out.Init();
 
     fmav_router_init();
 #endif
 
     radio_status_tlast_ms = millis32() + 1000;
+#ifdef USE_MAVLINK_DEBUG
+    debug.Init(0);
+#endif
 
     vehicle_sysid = 0;
     vehicle_is_armed = UINT8_MAX;
@@ -198,7 +218,8 @@ void tTxMavlink::Do(void)
         //Init();
         radio_status_tlast_ms = tnow_ms;
 #ifdef USE_FEATURE_MAVLINKX
-        fifo_link_out.Flush();
+        link_out.Flush();
+        fmavX_state_reset(); // the references may be gone on the other side too
 #endif
         msg_seq_initialized = false;
     }
@@ -210,13 +231,13 @@ void tTxMavlink::Do(void)
     fmav_result_t result;
 if (!do_router()) {
     // without router, parse ser in -> link out
-    if (fifo_link_out.HasSpace(290)) { // we have space for a full MAVLink message, so can safely parse
+    if (link_out.HasSpace(290)) { // we have space for a full MAVLink message, so can safely parse
         while (ser->available()) {
             char c = ser->getc();
             fmav_parse_and_check_to_frame_buf(&result, buf_ser_in, &status_ser_in, c);
             if (result.res == FASTMAVLINK_PARSE_RESULT_OK) {
                 fmav_frame_buf_to_msg(&msg_buf, &result, buf_ser_in); // requires RESULT_OK
-                send_msg_fifo_link_out(&msg_buf);
+                send_msg_link_out(&msg_buf);
 #ifdef USE_FEATURE_MAVLINK_COMPONENT
                 component_handle_msg(&msg_buf);
 #endif
@@ -225,7 +246,7 @@ if (!do_router()) {
     }
 } else {
     // with router, parse ser in, ser2 in -> link out
-    if (fifo_link_out.HasSpace(290)) { // we have space for a full MAVLink message, so can safely parse
+    if (link_out.HasSpace(290)) { // we have space for a full MAVLink message, so can safely parse
         // link 0 = sx_serial
         // link 1 = ser
         // link 2 = ser2
@@ -246,7 +267,7 @@ if (!do_router()) {
                 if (result.res == FASTMAVLINK_PARSE_RESULT_OK) {
                     fmav_frame_buf_to_msg(&msg_buf, &result, buf_ser_in); // requires RESULT_OK
                     if (fmav_router_send_to_link(0)) {
-                        send_msg_fifo_link_out(&msg_buf);
+                        send_msg_link_out(&msg_buf);
                     }
 #ifdef USE_FEATURE_MAVLINK_COMPONENT
                     component_handle_msg(&msg_buf);
@@ -267,7 +288,7 @@ if (!do_router()) {
                 if (result.res == FASTMAVLINK_PARSE_RESULT_OK) {
                     fmav_frame_buf_to_msg(&msg_buf, &result, buf_ser2_in); // requires RESULT_OK
                     if (fmav_router_send_to_link(0)) {
-                        send_msg_fifo_link_out(&msg_buf);
+                        send_msg_link_out(&msg_buf);
                     }
 #ifdef USE_FEATURE_MAVLINK_COMPONENT
                     component_handle_msg(&msg_buf);
@@ -297,6 +318,13 @@ if (!do_router()) {
         return; // only one per loop
     }
 
+#ifdef USE_MAVLINK_DEBUG
+    if (debug.Generate(&msg_buf, RADIO_STATUS_SYSTEM_ID, tnow_ms)) {
+        send_msg_serial_out();
+        return; // only one per loop
+    }
+#endif
+
 #ifdef USE_FEATURE_MAVLINK_COMPONENT
     component_do();
 #endif
@@ -368,17 +396,25 @@ for (uint16_t i = 0; i < len; i++) if (_buf[i] != buf_link_in[i]) while(1) {}
 }
 
 
-void tTxMavlink::send_msg_fifo_link_out(fmav_message_t* msg)
+void tTxMavlink::send_msg_link_out(fmav_message_t* msg)
 {
 #ifdef USE_FEATURE_MAVLINKX
     uint16_t len;
+    uint8_t flags = 0;
+    if (msg->magic == FASTMAVLINK_MAGIC_V2 && (msg->incompat_flags & FASTMAVLINK_INCOMPAT_FLAGS_SIGNED)) {
+        flags |= SCHED_MSG_SIGNED; // must not be reordered
+    }
     if (Setup.Rx.SerialLinkMode == SERIAL_LINK_MODE_MAVLINK_X) {
+        if (link_out.WillReplace(msg->msgid, msg->sysid, msg->compid, flags)) {
+            fmavX_next_replaces(); // the replaced one never reaches the other side
+        }
         len = fmavX_msg_to_frame_bufX(_buf, msg);
+        if (fmavX_last_is_reference()) flags |= SCHED_MSG_KEEP; // must not be coalesced away
     } else {
         len = fmav_msg_to_frame_buf(_buf, msg);
     }
 
-    fifo_link_out.PutBuf(_buf, len);
+    link_out.PutMsg(_buf, len, msg->msgid, msg->sysid, msg->compid, flags);
 #endif
 }
 
@@ -403,7 +439,7 @@ bool tTxMavlink::available(void)
     if (!ser) return false; // should not happen
 
 #ifdef USE_FEATURE_MAVLINKX
-    return fifo_link_out.Available();
+    return link_out.Available();
 #else
     return ser->available();
 #endif
@@ -415,19 +451,31 @@ uint8_t tTxMavlink::getc(void)
     if (!ser) return 0; // should not happen
 
 #ifdef USE_FEATURE_MAVLINKX
-    return fifo_link_out.Get();
+    return link_out.Get();
 #else
     return ser->getc();
 #endif
 }
 
 
+uint16_t tTxMavlink::getbuf(uint8_t* buf, uint16_t len)
+{
+    if (!ser) return 0; // should not happen
+
+#ifdef USE_FEATURE_MAVLINKX
+    return link_out.GetBuf(buf, len);
+#else
+    return ser->getbuf(buf, len);
+#endif
+}
+
+
 void tTxMavlink::flush(void)
 {
     if (!ser) return; // should not happen
 
 #ifdef USE_FEATURE_MAVLINKX
-    fifo_link_out.Flush();
+    link_out.Flush();
     if (ser2) ser2->flush();
 #endif
     ser->flush();
@@ -892,12 +940,12 @@ mavlink (without router):
                                      putc()       <~~receive~~
   Do:
     ser->available()  --->  parse&check  --->  msg_to_buf(X)
-    ser->getc()             buf_serial_in      fifo_link_out.PutBuf()
+    ser->getc()             buf_serial_in      link_out.PutMsg()
                             status_serial_in
 
   read serialport, send fifo_link_in:
-    available():  fifo_link_out.Available()
-    getc()        fifo_link_out.Get()
+    available():  link_out.Available()
+    getc()        link_out.Get()
 
   read link, send serialport:
     putc():       parse&check(X)  --->  but_to_msg(), msgtobuf(), ser->putbuf()
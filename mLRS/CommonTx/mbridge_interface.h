@@ -82,6 +82,7 @@ class tMBridge : public tPin5BridgeBase, public tSerialBase
     void putbuf(uint8_t* buf, uint16_t len) { tx_fifo.PutBuf(buf, len); }
     bool available(void) { return rx_fifo.Available(); }
     char getc(void) { return rx_fifo.Get(); }
+    uint16_t getbuf(uint8_t* buf, uint16_t len) { return rx_fifo.GetBuf(buf, len); }
     void flush(void) { rx_fifo.Flush(); }
 
     // backend
@@ -556,6 +557,16 @@ tMBridgeLinkStats lstats = {};
 
     lstats.vehicle_state = mavlink_vehicle_state(); // 3 = invalid
 
+#ifdef USE_FEATURE_ARQ_STATS
+    // the Rx' counts only come with FRAME_CMD_RX_ARQ_STATS
+    lstats.arq_stats = 1;
+    lstats.arq_first_attempt = (stats.arq_cnt_per_sec.first_attempt > 255) ? 255 : stats.arq_cnt_per_sec.first_attempt;
+    lstats.arq_retransmitted = (stats.arq_cnt_per_sec.retransmitted > 255) ? 255 : stats.arq_cnt_per_sec.retransmitted;
+    lstats.arq_retry_exhausted = (stats.arq_cnt_per_sec.retry_exhausted > 7) ? 7 : stats.arq_cnt_per_sec.retry_exhausted;
+#endif
+    lstats.arq_frame_lost = (stats.arq_cnt_per_sec.frame_lost > 7) ? 7 : stats.arq_cnt_per_sec.frame_lost;
+    lstats.arq_duplicates = (stats.arq_cnt_per_sec.duplicates > 63) ? 63 : stats.arq_cnt_per_sec.duplicates;
+
     lstats.link_state_connected = connected();
     lstats.link_state_binding = bind.IsInBind();
 
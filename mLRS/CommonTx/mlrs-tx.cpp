@@ -61,6 +61,25 @@
 #endif
 #include "../Common/hal/esp-timer.h"
 
+#elif defined HOST_SIM
+
+#include "../Common/hal/host-glue.h"
+#include "../modules/stm32ll-lib/src/stdstm32.h"
+#include "../Common/host-lib/host-peripherals.h"
+#include "../Common/host-lib/host-mcu.h"
+#include "../Common/host-lib/host-stack.h"
+#include "../Common/hal/hal.h"
+#include "../Common/host-lib/host-delay.h" // these are dependent on hal
+#include "../Common/host-lib/host-eeprom.h"
+#include "../Common/host-lib/host-spi.h"
+#if defined USE_SERIAL && !defined DEVICE_HAS_SERIAL_ON_USB
+#include "../Common/host-lib/host-uartb.h"
+#endif
+#if defined USE_COM && !defined DEVICE_HAS_COM_ON_USB
+#include "../Common/host-lib/host-uartc.h"
+#endif
+#include "../Common/hal/host-timer.h"
+
 #else
 
 #include "../Common/hal/glue.h"
@@ -112,9 +131,21 @@
 #include "../Common/channel_order.h"
 #include "../Common/diversity.h"
 #include "../Common/arq.h"
+#include "../Common/profiler.h"
+#include "../Common/rc_trace.h"
+#include "../Common/fhss_adaptive.h"
 //#include "../Common/test.h" // un-comment if you want to compile for board test
 
 #include "config_id.h"
+#ifdef USE_FEATURE_PROFILER
+tProfiler profiler;
+#endif
+#ifdef USE_FEATURE_RC_TRACE
+tRcTrace rctrace;
+#endif
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+tFhssAdaptive fhssadaptive;
+#endif
 #include "cli.h"
 #include "mbridge_interface.h" // this includes uart.h as it needs callbacks, declares tMBridge mbridge
 #include "crsf_interface_tx.h" // this includes uart.h as it needs callbacks, declares tTxCrsf crsf
@@ -193,7 +224,9 @@ tWhileTransmit whileTransmit;
 void tWhileTransmit::handle_once(void)
 {
     cli.Set(Setup.Tx[Config.ConfigId].CliLineEnd);
+    PROFILER_START(PROFILER_STAGE_CLI_DO);
     cli.Do();
+    PROFILER_STOP(PROFILER_STAGE_CLI_DO);
 
 #ifdef USE_DISPLAY
     uint32_t tnow_ms = millis32();
@@ -212,7 +245,9 @@ void tWhileTransmit::handle_once(void)
     static uint32_t draw_tlast_ms = 0;
     if (allow_draw && (tnow_ms - draw_tlast_ms >= 50)) { // effectively slows down (drawing takes time, ca 30 ms on G4, slower on other mcu)
         draw_tlast_ms = tnow_ms;
+        PROFILER_START(PROFILER_STAGE_DISP_DRAW);
         disp.Draw();
+        PROFILER_STOP(PROFILER_STAGE_DISP_DRAW);
     }
 #endif
 }
@@ -364,6 +399,12 @@ bool link_task_free(void)
 
 bool link_task_set(uint8_t task)
 {
+    // the fhss sync is a background task, it gives way, an unconfirmed switch is dropped and retried soon
+    if (link_task == LINK_TASK_TX_FHSS_SYNC) {
+        IF_FHSS_ADAPTIVE(fhssadaptive.Cancel();)
+        link_task = LINK_TASK_NONE;
+    }
+
     if (link_task != LINK_TASK_NONE) return false; // a task is running
 
     link_task = task;
@@ -418,6 +459,7 @@ tCmdFrameHeader* head = (tCmdFrameHeader*)(frame->payload);
     case FRAME_CMD_RX_SETUPDATA:
         // received rx setup data
         unpack_rxcmdframe_rxsetupdata(frame);
+        IF_FRAME_VARLEN(framevarlen.Agreed(SetupMetaData.rx_frame_varlen);) // short frames start after our next frame
         link_task_reset();
 #ifdef DEVICE_HAS_JRPIN5
         switch (mbridge.cmd_in_process) {
@@ -426,6 +468,27 @@ tCmdFrameHeader* head = (tCmdFrameHeader*)(frame->payload);
         mbridge.Unlock();
 #endif
         break;
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+    case FRAME_CMD_RX_FHSS: {
+        // received the spare channel map pending on the Rx, or in use if we asked for it, and its link quality per slot
+        // we confirm it if it's ours, and are done when the Rx has the confirmation, both ends then switch at the same hop
+        if (link_task != LINK_TASK_TX_FHSS_SYNC) break;
+        tRxCmdFrameFhss* fhss_cmd = (tRxCmdFrameFhss*)frame->payload;
+        fhssadaptive.SetReceivedQuality(fhss_cmd->valid_cnt_u4, fhss_cmd->window_full_mask);
+        if (fhssadaptive.Response(fhss_cmd->spare_map, fhss_cmd->confirmed, fhss_cmd->in_use)) link_task_reset();
+        break; }
+#endif
+#ifdef USE_FEATURE_ARQ_STATS
+    case FRAME_CMD_RX_ARQ_STATS: {
+        // received the counts of the Rx' transmit ARQ in its last second, it's not a response
+        tRxCmdFrameArqStats* arq_cmd = (tRxCmdFrameArqStats*)frame->payload;
+        stats.arq_cnt.first_attempt += arq_cmd->first_attempt;
+        stats.arq_cnt.retransmitted += arq_cmd->retransmitted;
+        stats.arq_cnt.retry_exhausted += arq_cmd->retry_exhausted;
+        stats.arq_retry_cnt = arq_cmd->retry_cnt;
+        stats.arq_retry_success = arq_cmd->retry_success;
+        break; }
+#endif
     }
 }
 
@@ -434,10 +497,10 @@ void pack_txcmdframe(tTxFrame* frame, tFrameStats* frame_stats, tRcData* rc)
 {
     switch (link_task) {
     case LINK_TASK_TX_GET_RX_SETUPDATA:
-        pack_txcmdframe_cmd(frame, frame_stats, rc, FRAME_CMD_GET_RX_SETUPDATA);
+        pack_txcmdframe_getrxsetupdata(frame, frame_stats, rc, FRAME_CMD_GET_RX_SETUPDATA);
         break;
     case LINK_TASK_TX_GET_RX_SETUPDATA_WRELOAD:
-        pack_txcmdframe_cmd(frame, frame_stats, rc, FRAME_CMD_GET_RX_SETUPDATA_WRELOAD);
+        pack_txcmdframe_getrxsetupdata(frame, frame_stats, rc, FRAME_CMD_GET_RX_SETUPDATA_WRELOAD);
         break;
     case LINK_TASK_TX_SET_RX_PARAMS:
         pack_txcmdframe_setrxparams(frame, frame_stats, rc);
@@ -446,6 +509,11 @@ void pack_txcmdframe(tTxFrame* frame, tFrameStats* frame_stats, tRcData* rc)
         pack_txcmdframe_cmd(frame, frame_stats, rc, FRAME_CMD_STORE_RX_PARAMS);
         transmit_frame_type = TRANSMIT_FRAME_TYPE_NORMAL;
         break;
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+    case LINK_TASK_TX_FHSS_SYNC:
+        pack_txcmdframe_setfhss(frame, frame_stats, rc, fhssadaptive.ProposedMap(), fhssadaptive.SwitchCnt(), fhssadaptive.Confirmed());
+        break;
+#endif
     }
 }
 
@@ -463,17 +531,14 @@ void pack_txcmdframe(tTxFrame* frame, tFrameStats* frame_stats, tRcData* rc)
 
 void prepare_transmit_frame(uint8_t antenna)
 {
-uint8_t payload[FRAME_TX_PAYLOAD_LEN];
 uint8_t payload_len = 0;
 
+    PROFILER_START(PROFILER_STAGE_PACK);
+
     if (transmit_frame_type == TRANSMIT_FRAME_TYPE_NORMAL) {
-        // read data from serial port
+        // read data from serial port, directly into the frame
         if (connected()) {
-            for (uint8_t i = 0; i < FRAME_TX_PAYLOAD_LEN; i++) {
-                if (!sx_serial.available()) break;
-                uint8_t c = sx_serial.getc();
-                payload[payload_len++] = c;
-            }
+            payload_len = sx_serial.getbuf(txFrame.payload, FRAME_TX_SERIAL_LEN);
 
             stats.bytes_transmitted.Add(payload_len);
             stats.serial_data_transmitted.Inc();
@@ -490,33 +555,23 @@ uint8_t payload_len = 0;
     frame_stats.antenna = stats.last_antenna;
     frame_stats.transmit_antenna = antenna;
     frame_stats.rssi = stats.GetLastRssi();
-    frame_stats.LQ_rc = UINT8_MAX; // Tx has no valid value
+    frame_stats.LQ_rc = rarq.AckWindow(); // Tx has no valid value, so it's UINT8_MAX, or the ack window of the selective repeat ARQ
     frame_stats.LQ_serial = stats.GetLQ_serial();
+    frame_stats.arq_window = rarq.Window(); // with the selective repeat ARQ, flags that LQ_rc holds the ack window
 
     if (transmit_frame_type == TRANSMIT_FRAME_TYPE_NORMAL) {
-        pack_txframe(&txFrame, &frame_stats, &rcData, payload, payload_len);
+        pack_txframe_payload_inplace(&txFrame, &frame_stats, &rcData, payload_len);
+        RC_TRACE(RC_TRACE_PACK);
     } else {
         pack_txcmdframe(&txFrame, &frame_stats, &rcData);
     }
+
+    PROFILER_STOP(PROFILER_STAGE_PACK);
 }
 
 
-void process_received_frame(bool do_payload, tRxFrame* frame)
+void process_received_payload(tRxFrame* frame)
 {
-    bool accept_payload = rarq.AcceptPayload();
-
-    stats.received_antenna = frame->status.antenna;
-    stats.received_transmit_antenna = frame->status.transmit_antenna;
-    stats.received_rssi = rssi_i8_from_u7(frame->status.rssi_u7);
-    stats.received_LQ_rc = frame->status.LQ_rc;
-    stats.received_LQ_serial = frame->status.LQ_serial;
-
-    if (!do_payload) {
-        return;
-    }
-
-    if (!accept_payload) return; // frame has no fresh payload
-
     // handle cmd frame
     if (frame->status.frame_type == FRAME_TYPE_TX_RX_CMD) {
         process_received_rxcmdframe(frame);
@@ -534,6 +589,30 @@ void process_received_frame(bool do_payload, tRxFrame* frame)
 }
 
 
+void process_received_frame(bool do_payload, tRxFrame* frame)
+{
+    stats.received_antenna = frame->status.antenna;
+    stats.received_transmit_antenna = frame->status.transmit_antenna;
+    stats.received_rssi = rssi_i8_from_u7(frame->status.rssi_u7);
+    stats.received_LQ_rc = frame->status.LQ_rc;
+    stats.received_LQ_serial = frame->status.LQ_serial;
+
+    if (!do_payload) {
+        return;
+    }
+
+    // get the fresh payloads in order, with the selective repeat ARQ these can be several or none
+    tRxFrame* payload_frame;
+    while ((payload_frame = rarq.GetPayload(frame))) {
+        // check this before received data may be passed to parsers
+        if (rarq.FrameLost()) {
+            mavlink.FrameLost();
+        }
+        process_received_payload(payload_frame);
+    }
+}
+
+
 //-- receive/transmit handling api
 
 void handle_receive(uint8_t antenna) // RX_STATUS_INVALID, RX_STATUS_VALID
@@ -560,14 +639,10 @@ tRxFrame* frame;
 
     // handle receive ARQ, must come before process_received_frame()
     if (rx_status == RX_STATUS_VALID) {
-        rarq.Received(frame->status.seq_no);
+        rarq.Received(frame->status.seq_no, frame->status.arq_window);
     } else {
         rarq.FrameMissed();
     }
-    // check this before received data may be passed to parsers
-    if (rarq.FrameLost()) {
-        mavlink.FrameLost();
-    }
 
     if (rx_status > RX_STATUS_INVALID) { // RX_STATUS_VALID
 
@@ -605,7 +680,8 @@ void do_transmit(uint8_t antenna) // we send a TX frame to receiver
 
     prepare_transmit_frame(antenna);
 
-    sxSendFrame(antenna, &txFrame, FRAME_TX_RX_LEN, SEND_FRAME_TMO_MS); // 10 ms tmo
+    sxSendFrame(antenna, &txFrame, txframe_len(&txFrame), SEND_FRAME_TMO_MS); // 10 ms tmo
+    IF_FRAME_VARLEN(framevarlen.Transmitted();)
 }
 
 
@@ -697,6 +773,7 @@ RESTARTCONTROLLER
     bind.Init();
     fhss.Init(&Config.Fhss, &Config.Fhss2);
     fhss.Start();
+    IF_FHSS_ADAPTIVE(fhssadaptive.Init(fhss.Cnt(), fhss.SpareCnt());)
 
     sx.SetRfFrequency(fhss.GetCurrFreq());
     sx2.SetRfFrequency(fhss.GetCurrFreq2());
@@ -710,6 +787,7 @@ RESTARTCONTROLLER
     connect_occured_once = false;
     link_rx1_status = link_rx2_status = RX_STATUS_NONE;
     link_task_init();
+    IF_FRAME_VARLEN(framevarlen.Init();)
     link_task_set(LINK_TASK_TX_GET_RX_SETUPDATA); // we start with wanting to get rx setup data
 
     stats.Init(Config.LQAveragingPeriod, Config.frame_rate_hz, Config.frame_rate_ms);
@@ -738,6 +816,9 @@ RESTARTCONTROLLER
 
     config_id.Init();
 
+    IF_PROFILER(profiler.Init();)
+    IF_RC_TRACE(rctrace.Init();)
+
     tick_1hz = 0;
     tick_1hz_commensurate = 0;
     doSysTask = 0; // helps in avoiding too short first loop
@@ -748,7 +829,9 @@ INITCONTROLLER_END
     if (doSysTask) {
         // when we do long tasks, like display transfer, we miss ticks, so we need to catch up
         // the commands below must not be sensitive to strict ms timing
+        IF_PROFILER(if (doSysTask > 1) profiler.SysTickMissed(1);) // each catch-up is one missed tick
         doSysTask--; // doSysTask = 0;
+        PROFILER_START(PROFILER_STAGE_SYSTASK);
 
         if (connect_tmo_cnt) {
             connect_tmo_cnt--;
@@ -792,7 +875,11 @@ INITCONTROLLER_END
 
             dbg.puts(u16toBCD_s(stats.bytes_transmitted.GetBytesPerSec())); dbg.puts(", ");
             dbg.puts(u16toBCD_s(stats.bytes_received.GetBytesPerSec())); dbg.puts("; "); */
+            IF_PROFILER(profiler.Update1Hz();)
+            IF_RC_TRACE(rctrace.Update1Hz();)
         }
+
+        PROFILER_STOP(PROFILER_STAGE_SYSTASK);
     }
 
     //-- SX handling
@@ -804,9 +891,12 @@ INITCONTROLLER_END
 
     case LINK_STATE_TRANSMIT:
         fhss.HopToNext();
+        IF_FHSS_ADAPTIVE(fhssadaptive.Hop();)
         sx.SetRfFrequency(fhss.GetCurrFreq());
         sx2.SetRfFrequency(fhss.GetCurrFreq2());
+        PROFILER_START(PROFILER_STAGE_DO_TRANSMIT);
         do_transmit(tdiversity.Antenna());
+        PROFILER_STOP(PROFILER_STAGE_DO_TRANSMIT);
         link_state = LINK_STATE_TRANSMIT_WAIT;
         irq_status = irq2_status = 0;
         DBG_MAIN_SLIM(dbg.puts("\n>");)
@@ -834,7 +924,9 @@ IF_SX(
         if (link_state == LINK_STATE_RECEIVE_WAIT) {
             if (irq_status & SX_IRQ_RX_DONE) {
                 irq_status = 0;
+                PROFILER_START(PROFILER_STAGE_DO_RECEIVE);
                 link_rx1_status = do_receive(ANTENNA_1);
+                PROFILER_STOP(PROFILER_STAGE_DO_RECEIVE);
                 DBG_MAIN_SLIM(dbg.puts("1<");)
             }
         }
@@ -867,7 +959,9 @@ IF_SX2(
         if (link_state == LINK_STATE_RECEIVE_WAIT) {
             if (irq2_status & SX2_IRQ_RX_DONE) {
                 irq2_status = 0;
+                PROFILER_START(PROFILER_STAGE_DO_RECEIVE);
                 link_rx2_status = do_receive(ANTENNA_2);
+                PROFILER_STOP(PROFILER_STAGE_DO_RECEIVE);
                 DBG_MAIN_SLIM(dbg.puts("2<");)
             }
         }
@@ -894,6 +988,7 @@ IF_SX2(
 
     if (doPreTransmit) {
         doPreTransmit = false;
+        PROFILER_START(PROFILER_STAGE_LINK);
 
         sx.SetToIdle();
         sx2.SetToIdle();
@@ -939,6 +1034,9 @@ IF_SX2(
 #endif
 
         stats.fhss_curr_i = fhss.CurrI();
+        // we are still on the frequency of this reception
+        IF_FHSS_ADAPTIVE(if (connected()) fhssadaptive.Put(fhss.CurrI(),
+                (valid_frame_received) ? RX_STATUS_VALID : (frame_received) ? RX_STATUS_INVALID : RX_STATUS_NONE);)
         stats.rx1_valid = (link_rx1_status > RX_STATUS_INVALID);
         stats.rx2_valid = (link_rx2_status > RX_STATUS_INVALID);
 
@@ -991,14 +1089,32 @@ IF_SX2(
 
         if (!connected()) rarq.Disconnected();
 
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+        if (!connected()) fhssadaptive.Clear();
+        if (link_task == LINK_TASK_TX_FHSS_SYNC && !fhssadaptive.SyncPending()) { // the Rx didn't respond in time
+            fhssadaptive.Cancel();
+            link_task_reset();
+        }
+        if (fhssadaptive.Changed()) fhss.SetSpareMap(fhssadaptive.Map()); // becomes effective with the next hop
+#endif
+
         if (connect_state == CONNECT_STATE_LISTEN) {
             link_task_reset(); // to ensure that the following set is enforced
             link_task_set(LINK_TASK_TX_GET_RX_SETUPDATA);
+            IF_FRAME_VARLEN(framevarlen.Init();) // we connect with full frames
         }
 
         DECc(tick_1hz_commensurate, Config.frame_rate_hz);
         if (!tick_1hz_commensurate) {
+            stats.arq_cnt.duplicates = rarq.cnt.duplicates; // the others come with FRAME_CMD_RX_ARQ_STATS
+            stats.arq_cnt.frame_lost = rarq.cnt.frame_lost;
             stats.Update1Hz();
+#ifdef USE_FEATURE_FHSS_ADAPTIVE
+            if (connected() && fhssadaptive.Tick_1Hz() && link_task_free()) {
+                fhssadaptive.Propose(&fhss);
+                link_task_set(LINK_TASK_TX_FHSS_SYNC);
+            }
+#endif
         }
         stats.Next();
         if (!connected()) stats.Clear();
@@ -1027,6 +1143,7 @@ IF_SX2(
         }
 
 //dbg.puts((valid_frame_received) ? "\nvalid" : "\ninval");
+        PROFILER_STOP(PROFILER_STAGE_LINK);
     }//end of if(doPreTransmit)
 
     if (link_state != link_state_before) return; // link state has changed, so process immediately
@@ -1036,6 +1153,7 @@ IF_SX2(
 IF_MBRIDGE(
     // mBridge sends channels in regular 20 ms intervals, this we can use as sync
     if (mbridge.ChannelsUpdated(&rcData)) {
+        RC_TRACE(RC_TRACE_INPUT);
         // update channels, do only if we use mBridge also as channels source
         if (Setup.Tx[Config.ConfigId].ChannelsSource == CHANNEL_SOURCE_MBRIDGE) {
             channelOrder.Set(Setup.Tx[Config.ConfigId].ChannelOrder); //TODO: better than before, but still better place!?
@@ -1100,6 +1218,7 @@ IF_MBRIDGE_OR_CRSF( // to allow CRSF mBridge emulation
 );
 IF_CRSF(
     if (crsf.ChannelsUpdated(&rcData)) {
+        RC_TRACE(RC_TRACE_INPUT);
         // update channels
         channelOrder.Set(Setup.Tx[Config.ConfigId].ChannelOrder); //TODO: better than before, but still better place!?
         channelOrder.Apply(&rcData);
@@ -1141,6 +1260,7 @@ IF_CRSF(
 );
 IF_IN(
     if (in.Update(&rcData)) {
+        RC_TRACE(RC_TRACE_INPUT);
         // update channels
         channelOrder.Set(Setup.Tx[Config.ConfigId].ChannelOrder); //TODO: better than before, but still better place!?
         channelOrder.Apply(&rcData);
@@ -1149,7 +1269,9 @@ IF_IN(
 
     //-- Do MAVLink
 
+    PROFILER_START(PROFILER_STAGE_MAVLINK_DO);
     mavlink.Do();
+    PROFILER_STOP(PROFILER_STAGE_MAVLINK_DO);
 
     //-- Do WhileTransmit stuff
 
@@ -21,6 +21,7 @@ class tTxSxSerial : public tSerialBase
 
     bool available(void) override;
     char getc(void) override;
+    uint16_t getbuf(uint8_t* buf, uint16_t len) override;
     void putbuf(uint8_t* buf, uint16_t len) override;
     void flush(void) override;
 
@@ -72,6 +73,18 @@ char tTxSxSerial::getc(void)
 }
 
 
+// reads directly into buf, e.g. txFrame.payload, checks are done once and not per byte
+uint16_t tTxSxSerial::getbuf(uint8_t* buf, uint16_t len)
+{
+    if (!connected_and_rx_setup_available()) return 0;
+
+    if (SERIAL_LINK_MODE_IS_MAVLINK(Setup.Rx.SerialLinkMode)) {
+        return mavlink.getbuf(buf, len); // get from serial via MAVLink parser
+    }
+    return ser->getbuf(buf, len); // get from serial
+}
+
+
 void tTxSxSerial::putbuf(uint8_t* buf, uint16_t len)
 {
     if (!connected_and_rx_setup_available()) return;
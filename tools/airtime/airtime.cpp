@@ -0,0 +1,234 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// Time over air calculator
+//*******************************************************
+// host tool which calculates the time over air of our frames, for each mode, for
+// - full: the 91 bytes frame, fixed length as we have it, and with header resp. variable length
+//   as it's needed for USE_FEATURE_FRAME_VARLEN
+// - short: the frames without payload of USE_FEATURE_FRAME_VARLEN, 27 bytes Tx frame with the
+//   rc data, 9 bytes Rx frame
+// - the Tx frame with some payload, to see what intermediate frame lengths would give
+// and what share of the frame period is on air, for a full frame pair and for an idle
+// frame pair, i.e. both short. For LoRa it also gives the time over air of the short Tx frame
+// with the next higher SFs, which is the link margin one could get at the same air time.
+//
+// The formulas are those of the Semtech datasheets. They reproduce the TimeOverAir values of
+// the sx126x and sx127x configurations in Common/sx-drivers exactly. For the sx128x the LoRa
+// configurations use the long interleaving coding rates and FLRC has its own coding, which the
+// formulas don't cover exactly, so these are scaled to the TimeOverAir of the table.
+// The TimeOverAirVarlen and TimeOverAirShort values of the configurations are from here.
+//
+// build:
+//   g++ -O2 -std=gnu++14 airtime.cpp -o airtime
+//*******************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <math.h>
+
+
+#define FRAME_TX_RX_LEN         91
+#define FRAME_TX_PAYLOAD_LEN    64
+#define FRAME_RX_PAYLOAD_LEN    82
+#define FRAME_TX_SHORT_LEN      (FRAME_TX_RX_LEN - FRAME_TX_PAYLOAD_LEN) // 27
+#define FRAME_RX_SHORT_LEN      (FRAME_TX_RX_LEN - FRAME_RX_PAYLOAD_LEN) // 9
+
+
+typedef enum {
+    CHIP_SX126X = 0,
+    CHIP_SX127X,
+    CHIP_SX128X,
+} CHIP_ENUM;
+
+typedef enum {
+    MOD_LORA = 0,
+    MOD_GFSK,
+    MOD_FLRC,
+} MOD_ENUM;
+
+
+// copies of the configurations of Common/sx-drivers
+typedef struct {
+    const char* name;
+    uint8_t chip;
+    uint8_t mod;
+    uint8_t sf; // LoRa
+    uint32_t bw_hz; // LoRa
+    uint8_t cr; // LoRa, 1 = 4/5, for sx128x the LI rates are taken as the normal rates
+    uint16_t preamble; // LoRa in symbols, GFSK, FLRC in bits
+    uint32_t br_bps; // GFSK, FLRC
+    uint16_t syncword_bits; // GFSK, FLRC
+    uint32_t toa_table_us; // TimeOverAir of the configuration
+    int16_t sensitivity_dbm;
+} tConfig;
+
+
+const tConfig configs[] = {
+    { "sx128x LoRa SF5 BW800 CRLI4/5", CHIP_SX128X, MOD_LORA, 5, 812500, 1, 12, 0, 0, 7892, -105 },
+    { "sx128x LoRa SF6 BW800 CRLI4/5", CHIP_SX128X, MOD_LORA, 6, 812500, 1, 12, 0, 0, 13418, -108 },
+    { "sx128x LoRa SF7 BW800 CRLI4/5", CHIP_SX128X, MOD_LORA, 7, 812500, 1, 12, 0, 0, 23527, -112 },
+    { "sx128x FLRC 650 kbps CR1/2", CHIP_SX128X, MOD_FLRC, 0, 0, 0, 32, 650000, 32, 2383, -104 },
+    { "sx126x LoRa SF5 BW500 CR4/5", CHIP_SX126X, MOD_LORA, 5, 500000, 1, 12, 0, 0, 13200, -111 },
+    { "sx126x LoRa SF6 BW500 CR4/5", CHIP_SX126X, MOD_LORA, 6, 500000, 1, 12, 0, 0, 22560, -112 },
+    { "sx126x GFSK 100 kbps", CHIP_SX126X, MOD_GFSK, 0, 0, 0, 16, 100000, 16, 7600, -106 },
+    { "sx127x LoRa SF6 BW500 CR4/5", CHIP_SX127X, MOD_LORA, 6, 500000, 1, 12, 0, 0, 22300, -112 },
+};
+
+enum {
+    CONFIG_SX128X_SF5 = 0,
+    CONFIG_SX128X_SF6,
+    CONFIG_SX128X_SF7,
+    CONFIG_SX128X_FLRC,
+    CONFIG_SX126X_SF5,
+    CONFIG_SX126X_SF6,
+    CONFIG_SX126X_GFSK,
+    CONFIG_SX127X_SF6,
+};
+
+
+// the modes as in setup_configure_config()
+typedef struct {
+    const char* name;
+    uint16_t frame_rate_ms;
+    uint8_t config;
+} tMode;
+
+
+const tMode modes[] = {
+    { "50 Hz 2.4", 20, CONFIG_SX128X_SF5 },
+    { "31 Hz 2.4", 32, CONFIG_SX128X_SF6 },
+    { "19 Hz 2.4", 53, CONFIG_SX128X_SF7 },
+    { "111 Hz FLRC", 9, CONFIG_SX128X_FLRC },
+    { "31 Hz 900", 32, CONFIG_SX126X_SF5 },
+    { "19 Hz 900", 53, CONFIG_SX126X_SF6 },
+    { "50 Hz FSK", 20, CONFIG_SX126X_GFSK },
+    { "19 Hz sx127x", 53, CONFIG_SX127X_SF6 },
+};
+
+
+//-------------------------------------------------------
+// formulas
+//-------------------------------------------------------
+
+// number of symbols of a LoRa packet, without crc
+// sx126x, sx128x: datasheet 6.1.4 resp. 7.4.4, SF5 and SF6 have a longer preamble and no 8 bits offset
+// sx127x: datasheet 4.1.1.7, is the same as for SF >= 7 for all SF, SF6 is implicit header only
+double lora_symbols(const tConfig* c, uint8_t len, bool header)
+{
+    int32_t bits = 8 * (int32_t)len - 4 * c->sf + (header ? 20 : 0);
+    double n_pre;
+    if (c->chip != CHIP_SX127X && c->sf <= 6) {
+        n_pre = c->preamble + 6.25 + 8;
+    } else {
+        n_pre = c->preamble + 4.25 + 8;
+        bits += 8;
+    }
+    if (bits < 0) bits = 0;
+    int32_t blocks = (bits + 4 * c->sf - 1) / (4 * c->sf);
+    return n_pre + blocks * (c->cr + 4);
+}
+
+
+double toa_formula_us(const tConfig* c, uint8_t len, bool varlen)
+{
+    switch (c->mod) {
+    case MOD_LORA: {
+        double ts_us = (double)(1 << c->sf) * 1.0e6 / c->bw_hz;
+        return lora_symbols(c, len, varlen) * ts_us; }
+    case MOD_GFSK:
+        // the variable length packet has a length byte
+        return (c->preamble + c->syncword_bits + (varlen ? 8 : 0) + 8.0 * len) * 1.0e6 / c->br_bps;
+    case MOD_FLRC:
+        // preamble and sync word are not coded, the payload is coded with CR 1/2 and has 6 tail bits,
+        // the variable length packet has a 16 bits header
+        return (c->preamble + c->syncword_bits + (varlen ? 16 : 0) + 2.0 * (8.0 * len + 6)) * 1.0e6 / c->br_bps;
+    }
+    return 0.0;
+}
+
+
+// for those which the formula doesn't cover exactly, the formula is scaled to the table value
+bool is_scaled(const tConfig* c)
+{
+    return (c->chip == CHIP_SX128X);
+}
+
+
+double toa_us(const tConfig* c, uint8_t len, bool varlen)
+{
+    double toa = toa_formula_us(c, len, varlen);
+    if (is_scaled(c)) toa *= c->toa_table_us / toa_formula_us(c, FRAME_TX_RX_LEN, false);
+    return toa;
+}
+
+
+//-------------------------------------------------------
+// main
+//-------------------------------------------------------
+
+int main(void)
+{
+    bool failed = false;
+
+    printf("configurations, time over air in us\n");
+    printf("%-32s %7s %7s  %8s %7s  %7s %7s\n", "", "table", "formula", "full var", "+hdr", "tx 27", "rx 9");
+    for (uint8_t i = 0; i < sizeof(configs)/sizeof(configs[0]); i++) {
+        const tConfig* c = &configs[i];
+        double formula = toa_formula_us(c, FRAME_TX_RX_LEN, false);
+        double full = toa_us(c, FRAME_TX_RX_LEN, true);
+        bool header_ok = !(c->chip == CHIP_SX127X && c->sf == 6);
+        printf("%-32s %7u %7.0f%s %8.0f %7.0f  %7.0f %7.0f%s\n",
+               c->name, (unsigned)c->toa_table_us, formula, is_scaled(c) ? "*" : " ",
+               full, full - c->toa_table_us,
+               toa_us(c, FRAME_TX_SHORT_LEN, true), toa_us(c, FRAME_RX_SHORT_LEN, true),
+               header_ok ? "" : "  no header possible");
+        if (!is_scaled(c) && fabs(formula - c->toa_table_us) > 10.0) {
+            printf("  FAILED: formula doesn't reproduce the table\n");
+            failed = true;
+        }
+    }
+    printf("* scaled to the table\n\n");
+
+    printf("modes, share of the frame period on air, time over air of the tx frame vs tx payload length in us\n");
+    printf("%-13s %6s  %6s %6s %6s  %6s %6s %6s %6s %6s\n", "", "period", "fixed", "full", "idle", "pl 0", "16", "32", "48", "64");
+    for (uint8_t i = 0; i < sizeof(modes)/sizeof(modes[0]); i++) {
+        const tMode* m = &modes[i];
+        const tConfig* c = &configs[m->config];
+        double period_us = m->frame_rate_ms * 1000.0;
+        double fixed = 2.0 * c->toa_table_us;
+        double full = 2.0 * toa_us(c, FRAME_TX_RX_LEN, true);
+        double idle = toa_us(c, FRAME_TX_SHORT_LEN, true) + toa_us(c, FRAME_RX_SHORT_LEN, true);
+        printf("%-13s %4u ms  %5.1f%% %5.1f%% %5.1f%% ",
+               m->name, m->frame_rate_ms, 100.0 * fixed / period_us, 100.0 * full / period_us, 100.0 * idle / period_us);
+        for (uint8_t pl = 0; pl <= FRAME_TX_PAYLOAD_LEN; pl += 16) {
+            printf(" %6.0f", toa_us(c, FRAME_TX_SHORT_LEN + pl, true));
+        }
+        printf("\n");
+    }
+    printf("\n");
+
+    printf("LoRa, short tx frame with higher SF, time over air in us, relative to the full frame\n");
+    for (uint8_t i = 0; i < sizeof(configs)/sizeof(configs[0]); i++) {
+        tConfig c = configs[i];
+        if (c.mod != MOD_LORA || c.chip == CHIP_SX127X) continue;
+        double full = toa_us(&c, FRAME_TX_RX_LEN, true);
+        printf("%-32s", c.name);
+        for (uint8_t dsf = 0; dsf <= 2; dsf++) {
+            tConfig c2 = c;
+            c2.sf = c.sf + dsf;
+            // the scaling of the sx128x is that of the base SF
+            double toa = toa_formula_us(&c2, FRAME_TX_SHORT_LEN, true);
+            if (is_scaled(&c)) toa *= c.toa_table_us / toa_formula_us(&c, FRAME_TX_RX_LEN, false);
+            printf("  SF%u %6.0f %3.0f%%", c2.sf, toa, 100.0 * toa / full);
+        }
+        printf("\n");
+    }
+    printf("\n");
+
+    printf((failed) ? "FAILED\n" : "PASSED\n");
+    return (failed) ? 1 : 0;
+}
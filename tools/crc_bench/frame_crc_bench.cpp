@@ -0,0 +1,188 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// Frame CRC benchmark
+//*******************************************************
+// host benchmark and equivalence check of frame_crc_update() of Common/frame_crc.h
+// against the byte-wise fmav_crc_accumulate(), which was used for the frames before
+//
+// checks
+// - random buffers of all lengths 0 ... 300, from init and from random start values
+// - random frames, crc1 over header + rcdata1 and then crc continued over the rest, as in frames.h
+// reports ns/frame for the byte-wise and the table-driven crc, for a full frame of FRAME_TX_RX_LEN bytes
+//
+// build, slice-by-4:
+//   g++ -O2 frame_crc_bench.cpp -o frame_crc_bench
+// build, byte-wise table as used on F0, F1:
+//   g++ -O2 -DFRAME_CRC_BYTE_TABLE frame_crc_bench.cpp -o frame_crc_bench_byte
+// run:
+//   ./frame_crc_bench
+//
+// the ns are host numbers, they are useful for comparing, not as absolute numbers for the mcus
+// the hardware crc unit of the G4, WL can't be checked on host
+//*******************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "../../mLRS/Common/frame_crc.h"
+
+
+#define FRAME_TX_RX_LEN         91 // as in frame_types.h
+#define FRAME_TX_RX_HEADER_LEN  7
+#define FRAME_TX_RCDATA1_LEN    6
+
+#define BENCH_LOOPS_DEFAULT     1000000
+
+
+//-------------------------------------------------------
+// reference, as fmav_crc_accumulate() of fastmavlink
+//-------------------------------------------------------
+
+void ref_crc_accumulate(uint16_t* crc, uint8_t data)
+{
+    uint8_t tmp = data ^ (uint8_t)(*crc & 0xFF);
+    tmp ^= (tmp << 4);
+    *crc = (*crc >> 8) ^ (tmp << 8) ^ (tmp << 3) ^ (tmp >> 4);
+}
+
+
+void ref_crc_accumulate_buf(uint16_t* crc, const uint8_t* buf, uint16_t len)
+{
+    while (len--) ref_crc_accumulate(crc, *buf++);
+}
+
+
+//-------------------------------------------------------
+// equivalence
+//-------------------------------------------------------
+
+uint32_t check_cnt;
+uint32_t fail_cnt;
+
+
+void check(uint16_t start, const uint8_t* buf, uint16_t len)
+{
+    uint16_t crc_ref = start;
+    ref_crc_accumulate_buf(&crc_ref, buf, len);
+    uint16_t crc = frame_crc_update(start, buf, len);
+    check_cnt++;
+    if (crc == crc_ref) return;
+    fail_cnt++;
+    if (fail_cnt < 10) printf("  fail: start 0x%04X len %u: 0x%04X != 0x%04X\n", start, len, crc, crc_ref);
+}
+
+
+void do_equivalence(void)
+{
+uint8_t buf[300];
+
+    check_cnt = fail_cnt = 0;
+
+    // the standard check value of CRC-16/MCRF4XX
+    const uint8_t check_str[] = "123456789";
+    uint16_t crc = frame_crc_update(FRAME_CRC_INIT, check_str, 9);
+    check_cnt++;
+    if (crc != 0x6F91) { fail_cnt++; printf("  fail: check value 0x%04X != 0x6F91\n", crc); }
+
+    for (uint16_t len = 0; len <= sizeof(buf); len++) {
+        for (uint16_t n = 0; n < 100; n++) {
+            for (uint16_t i = 0; i < len; i++) buf[i] = rand();
+            check(FRAME_CRC_INIT, buf, len);
+            check(rand(), buf, len);
+        }
+    }
+
+    // frames, as in frames.h
+    for (uint32_t n = 0; n < 100000; n++) {
+        for (uint16_t i = 0; i < FRAME_TX_RX_LEN; i++) buf[i] = rand();
+
+        uint16_t crc_ref = FRAME_CRC_INIT;
+        ref_crc_accumulate_buf(&crc_ref, buf, FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN);
+        uint16_t crc1_ref = crc_ref;
+        ref_crc_accumulate_buf(&crc_ref, buf + FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN,
+                               FRAME_TX_RX_LEN - FRAME_TX_RX_HEADER_LEN - FRAME_TX_RCDATA1_LEN - 2);
+
+        uint16_t crc1 = frame_crc_update(FRAME_CRC_INIT, buf, FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN);
+        uint16_t crc = frame_crc_update(crc1, buf + FRAME_TX_RX_HEADER_LEN + FRAME_TX_RCDATA1_LEN,
+                                        FRAME_TX_RX_LEN - FRAME_TX_RX_HEADER_LEN - FRAME_TX_RCDATA1_LEN - 2);
+        check_cnt++;
+        if (crc1 != crc1_ref || crc != crc_ref) fail_cnt++;
+    }
+
+    printf("equivalence: %u checks, %u failed\n", check_cnt, fail_cnt);
+}
+
+
+//-------------------------------------------------------
+// timing
+//-------------------------------------------------------
+
+double ns_now(void)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+volatile uint16_t sink; // prevents the compiler from optimizing the loops away
+
+
+void do_timing(uint32_t loops)
+{
+uint8_t frame[FRAME_TX_RX_LEN];
+double t_start;
+
+    for (uint16_t i = 0; i < FRAME_TX_RX_LEN; i++) frame[i] = rand();
+
+    t_start = ns_now();
+    for (uint32_t l = 0; l < loops; l++) {
+        uint16_t crc = FRAME_CRC_INIT;
+        frame[0] = l;
+        ref_crc_accumulate_buf(&crc, frame, FRAME_TX_RX_LEN - 2);
+        sink += crc;
+    }
+    double t_ref = (ns_now() - t_start) / loops;
+
+    t_start = ns_now();
+    for (uint32_t l = 0; l < loops; l++) {
+        frame[0] = l;
+        sink += frame_crc_update(FRAME_CRC_INIT, frame, FRAME_TX_RX_LEN - 2);
+    }
+    double t_table = (ns_now() - t_start) / loops;
+
+    printf("\n");
+#if defined FRAME_CRC_BYTE_TABLE
+    printf("frame_crc_update():  byte-wise table\n");
+#else
+    printf("frame_crc_update():  slice-by-4\n");
+#endif
+    printf("byte-wise:           %.1f ns/frame\n", t_ref);
+    printf("frame_crc_update():  %.1f ns/frame, x%.2f\n", t_table, t_ref / t_table);
+}
+
+
+//-------------------------------------------------------
+// main
+//-------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+uint32_t loops = BENCH_LOOPS_DEFAULT;
+
+    if (argc > 2 && !strcmp(argv[1], "-l")) {
+        loops = atoi(argv[2]);
+        if (!loops) loops = 1;
+    }
+
+    srand(1);
+    do_equivalence();
+    do_timing(loops);
+
+    return (fail_cnt) ? 1 : 0;
+}
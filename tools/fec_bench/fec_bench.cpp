@@ -0,0 +1,312 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// FEC benchmark
+//*******************************************************
+// host benchmark and check of fec_encode(), fec_decode() of Common/fec.h
+//
+// checks
+// - the generator polynomial has the roots alpha^0 ... alpha^(FEC_PARITY_LEN-1)
+// - random frames with 0 ... FEC_PARITY_LEN/2 wrong bytes are repaired exactly
+// - for more wrong bytes, how many are rejected resp. miscorrected, a miscorrection must then
+//   be caught by the crc
+// reports ns/frame for encode, decode with 0, 1, 2, 4 wrong bytes and a failed decode, and
+// for comparison of frame_crc_update(), which has been timed on the mcus
+//
+// simulation of the goodput at the edge of range, with the real encode, decode and crc
+// - independent byte errors, which is about what FLRC and FSK give
+// - LoRa symbol errors, a wrong symbol hits SF bits which the interleaving spreads over SF/2
+//   bytes, so the errors come in bursts
+// a frame counts if its crc is ok, without FEC it carries FRAME_TX_PAYLOAD_LEN bytes of serial
+// data, with FEC FEC_PARITY_LEN bytes less
+//
+// build:
+//   g++ -O2 -std=gnu++14 fec_bench.cpp -o fec_bench
+// run:
+//   ./fec_bench
+//
+// the ns are host numbers, they are useful for comparing, not as absolute numbers for the mcus
+//*******************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+
+#include "../../mLRS/Common/frame_crc.h"
+#include "../../mLRS/Common/fec.h"
+
+
+#define FRAME_TX_RX_LEN         91 // as in frame_types.h
+#define FRAME_TX_PAYLOAD_LEN    64
+
+#define FEC_LEN                 (FRAME_TX_RX_LEN - 2) // the codeword is the frame without the crc
+
+#define BENCH_LOOPS_DEFAULT     200000
+#define CHECK_TRIALS            20000
+#define SIM_FRAMES              20000
+
+
+uint32_t fail_cnt = 0;
+
+
+uint32_t rand_u32(void)
+{
+    return ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+}
+
+
+void random_frame(uint8_t* frame)
+{
+    for (uint8_t k = 0; k < FEC_LEN - FEC_PARITY_LEN; k++) frame[k] = rand();
+    fec_encode(frame, FEC_LEN);
+    uint16_t crc = frame_crc_update(FRAME_CRC_INIT, frame, FEC_LEN);
+    memcpy(frame + FEC_LEN, &crc, 2);
+}
+
+
+bool frame_crc_ok(uint8_t* frame)
+{
+    uint16_t crc;
+    memcpy(&crc, frame + FEC_LEN, 2);
+    return (frame_crc_update(FRAME_CRC_INIT, frame, FEC_LEN) == crc);
+}
+
+
+// as check_txframe(), check_rxframe() with USE_FEATURE_FEC, repair on a copy
+bool frame_receive(uint8_t* frame)
+{
+    if (frame_crc_ok(frame)) return true;
+    uint8_t frame_fec[FRAME_TX_RX_LEN];
+    memcpy(frame_fec, frame, FRAME_TX_RX_LEN);
+    if (!fec_decode(frame_fec, FEC_LEN)) return false;
+    if (!frame_crc_ok(frame_fec)) return false;
+    memcpy(frame, frame_fec, FRAME_TX_RX_LEN);
+    return true;
+}
+
+
+// corrupts n distinct bytes of the codeword
+void inject_byte_errors(uint8_t* frame, uint8_t n)
+{
+bool hit[FEC_LEN] = {};
+
+    for (uint8_t i = 0; i < n; i++) {
+        uint8_t k;
+        do { k = rand() % FEC_LEN; } while (hit[k]);
+        hit[k] = true;
+        frame[k] ^= 1 + (rand() % 255);
+    }
+}
+
+
+//-------------------------------------------------------
+// checks
+//-------------------------------------------------------
+
+void do_checks(void)
+{
+    // the generator polynomial must vanish at alpha^i
+    for (uint8_t i = 0; i < FEC_PARITY_LEN; i++) {
+        uint8_t v = 0;
+        for (uint8_t j = 0; j <= FEC_PARITY_LEN; j++) v = fec_gf_mul(v, fec_gf.exp[i]) ^ fec_generator.g[j];
+        if (v) { fail_cnt++; printf("  fail: g(alpha^%u) = 0x%02X\n", i, v); }
+    }
+
+    printf("errors  trials  repaired  rejected  miscorrected  crc caught\n");
+    for (uint8_t n = 0; n <= FEC_PARITY_LEN / 2 + 3; n++) {
+        uint32_t repaired = 0, rejected = 0, miscorrected = 0, crc_caught = 0;
+        for (uint32_t t = 0; t < CHECK_TRIALS; t++) {
+            uint8_t frame[FRAME_TX_RX_LEN], frame_org[FRAME_TX_RX_LEN];
+            random_frame(frame_org);
+            memcpy(frame, frame_org, FRAME_TX_RX_LEN);
+            inject_byte_errors(frame, n);
+
+            if (!fec_decode(frame, FEC_LEN)) {
+                rejected++;
+            } else if (!memcmp(frame, frame_org, FRAME_TX_RX_LEN)) {
+                repaired++;
+            } else {
+                miscorrected++;
+                if (!frame_crc_ok(frame)) crc_caught++;
+            }
+        }
+        printf("%6u  %6u  %8u  %8u  %12u  %10u\n", n, CHECK_TRIALS, repaired, rejected, miscorrected, crc_caught);
+        if (n <= FEC_PARITY_LEN / 2 && repaired != CHECK_TRIALS) {
+            fail_cnt++;
+            printf("  fail: not all repaired\n");
+        }
+        if (crc_caught != miscorrected) {
+            fail_cnt++;
+            printf("  fail: miscorrection not caught by crc\n");
+        }
+    }
+    printf("\n");
+}
+
+
+//-------------------------------------------------------
+// timing
+//-------------------------------------------------------
+
+double ns_now(void)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+volatile uint16_t sink; // prevents the compiler from optimizing the loops away
+
+
+double time_decode(uint32_t loops, uint8_t nerr)
+{
+uint8_t frame_org[FRAME_TX_RX_LEN], frame[FRAME_TX_RX_LEN];
+
+    random_frame(frame_org);
+    memcpy(frame, frame_org, FRAME_TX_RX_LEN);
+    inject_byte_errors(frame, nerr);
+    uint8_t frame_err[FRAME_TX_RX_LEN];
+    memcpy(frame_err, frame, FRAME_TX_RX_LEN);
+
+    double t_copy = ns_now();
+    for (uint32_t l = 0; l < loops; l++) {
+        memcpy(frame, frame_err, FRAME_TX_RX_LEN);
+        sink += frame[l % FEC_LEN];
+    }
+    t_copy = ns_now() - t_copy;
+
+    double t_start = ns_now();
+    for (uint32_t l = 0; l < loops; l++) {
+        memcpy(frame, frame_err, FRAME_TX_RX_LEN);
+        sink += fec_decode(frame, FEC_LEN);
+    }
+    return (ns_now() - t_start - t_copy) / loops;
+}
+
+
+void do_timing(uint32_t loops)
+{
+uint8_t frame[FRAME_TX_RX_LEN];
+double t_start;
+
+    random_frame(frame);
+
+    t_start = ns_now();
+    for (uint32_t l = 0; l < loops; l++) {
+        frame[0] = l;
+        sink += frame_crc_update(FRAME_CRC_INIT, frame, FEC_LEN);
+    }
+    double t_crc = (ns_now() - t_start) / loops;
+
+    t_start = ns_now();
+    for (uint32_t l = 0; l < loops; l++) {
+        frame[0] = l;
+        fec_encode(frame, FEC_LEN);
+        sink += frame[FEC_LEN - 1];
+    }
+    double t_enc = (ns_now() - t_start) / loops;
+
+    printf("timing, codeword of %u bytes, %u parity bytes\n", FEC_LEN, FEC_PARITY_LEN);
+    printf("frame_crc_update():     %7.1f ns/frame\n", t_crc);
+    printf("fec_encode():           %7.1f ns/frame, x%.1f crc\n", t_enc, t_enc / t_crc);
+    const uint8_t nerr_list[] = { 0, 1, 2, FEC_PARITY_LEN / 2, FEC_PARITY_LEN / 2 + 1 };
+    for (uint8_t i = 0; i < sizeof(nerr_list); i++) {
+        double t_dec = time_decode(loops / 4, nerr_list[i]);
+        printf("fec_decode(), %u error%s %7.1f ns/frame, x%.1f crc%s\n",
+               nerr_list[i], (nerr_list[i] == 1) ? ": " : "s:", t_dec, t_dec / t_crc,
+               (nerr_list[i] > FEC_PARITY_LEN / 2) ? ", fails" : "");
+    }
+    printf("\n");
+}
+
+
+//-------------------------------------------------------
+// goodput simulation
+//-------------------------------------------------------
+
+// p is the byte error rate, resp. the symbol error rate for LoRa
+// burst_len = 0: independent byte errors, else a symbol error hits burst_len consecutive bytes
+void simulate(double p, uint8_t burst_len, double* fer_plain, double* fer_fec)
+{
+uint32_t ok_plain = 0, ok_fec = 0;
+
+    for (uint32_t f = 0; f < SIM_FRAMES; f++) {
+        uint8_t frame[FRAME_TX_RX_LEN];
+        random_frame(frame);
+
+        if (burst_len == 0) {
+            for (uint8_t k = 0; k < FRAME_TX_RX_LEN; k++) {
+                if ((double)rand() / RAND_MAX < p) frame[k] ^= 1 + (rand() % 255);
+            }
+        } else {
+            // the frame is FRAME_TX_RX_LEN/burst_len blocks of symbols, with diagonal interleaving a
+            // wrong symbol gives one wrong bit in each nibble of its block
+            for (uint8_t blk = 0; blk * burst_len < FRAME_TX_RX_LEN; blk++) {
+                for (uint8_t s = 0; s < 5; s++) { // 5 symbols per block at CR 4/5
+                    if ((double)rand() / RAND_MAX >= p) continue;
+                    uint8_t bit = 1 << (rand() % 4);
+                    for (uint8_t k = blk * burst_len; k < (blk + 1) * burst_len && k < FRAME_TX_RX_LEN; k++) {
+                        frame[k] ^= bit | (bit << 4);
+                    }
+                }
+            }
+        }
+
+        if (frame_crc_ok(frame)) ok_plain++;
+        if (frame_receive(frame)) ok_fec++;
+    }
+
+    *fer_plain = 1.0 - (double)ok_plain / SIM_FRAMES;
+    *fer_fec = 1.0 - (double)ok_fec / SIM_FRAMES;
+}
+
+
+void do_simulation(const char* name, uint8_t burst_len, const double* p_list, uint8_t p_num)
+{
+    printf("goodput, %s\n", name);
+    printf("%9s  %9s %9s  %12s %12s  %6s\n", "err rate", "FER", "FER FEC", "B/frame", "B/frame FEC", "gain");
+    for (uint8_t i = 0; i < p_num; i++) {
+        double fer_plain, fer_fec;
+        simulate(p_list[i], burst_len, &fer_plain, &fer_fec);
+        double gp_plain = FRAME_TX_PAYLOAD_LEN * (1.0 - fer_plain);
+        double gp_fec = (FRAME_TX_PAYLOAD_LEN - FEC_PARITY_LEN) * (1.0 - fer_fec);
+        printf("%9.4f  %8.1f%% %8.1f%%  %12.1f %12.1f  %+5.0f%%\n",
+               p_list[i], 100.0 * fer_plain, 100.0 * fer_fec, gp_plain, gp_fec,
+               (gp_plain > 0.0) ? 100.0 * (gp_fec / gp_plain - 1.0) : 0.0);
+    }
+    printf("\n");
+}
+
+
+//-------------------------------------------------------
+// main
+//-------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+uint32_t loops = BENCH_LOOPS_DEFAULT;
+
+    if (argc > 2 && !strcmp(argv[1], "-l")) {
+        loops = atoi(argv[2]);
+        if (!loops) loops = 4;
+    }
+
+    srand(1);
+    do_checks();
+    do_timing(loops);
+
+    const double p_byte[] = { 0.0001, 0.001, 0.003, 0.01, 0.02, 0.03, 0.05 };
+    do_simulation("independent byte errors (FLRC, FSK)", 0, p_byte, sizeof(p_byte)/sizeof(p_byte[0]));
+
+    const double p_symbol[] = { 0.0001, 0.001, 0.003, 0.01, 0.02, 0.03 };
+    do_simulation("LoRa SF5 symbol errors, 3 byte bursts", 3, p_symbol, sizeof(p_symbol)/sizeof(p_symbol[0]));
+    do_simulation("LoRa SF7 symbol errors, 4 byte bursts", 4, p_symbol, sizeof(p_symbol)/sizeof(p_symbol[0]));
+
+    printf((fail_cnt) ? "FAILED\n" : "PASSED\n");
+    return (fail_cnt) ? 1 : 0;
+}
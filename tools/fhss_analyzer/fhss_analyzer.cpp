@@ -0,0 +1,527 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// FHSS sequence analyzer
+//*******************************************************
+// host tool which analyzes the fhss sequences as generated by tFhssGenerator of
+// Common/fhss_generator.h, which is what tFhssBase::Init() uses
+//
+// without arguments, for each band, fhss num, ortho and except setting, it reports
+// - seqs: the number of different sequences, and different channel sets, over all 65536 seeds
+//   (the seed is the u16 crc of u32_from_bindphrase(), so there can't be more)
+//   hang: seeds for which the generation never ends
+// - usage: how uniformly the channels are used, min and max use of a channel relative to
+//   the mean, over the channels which are used at all
+// - spacing: mean and min distance of subsequent channels, including the wrap around
+//   from the last to the first, and the % of hops to a channel next to the previous
+// - collisions between two links with random bind phrases and this setting, as % of time
+//   async: the links hop independently, mean and 99th percentile
+//   adj: same, but the other link is on a channel next to ours
+//   aligned: the links hop in sync with the worst offset, as it happens when their
+//   frame rates are the same, mean and 99th percentile
+// then the mean collisions for two links with different ortho, and with different except
+//
+// with bind phrases as arguments, it reports the collisions between these links
+//   fhss_analyzer [-b band] [-m mode] bindphrase[:ortho] ...
+//   band: 2p4 (default), 915, 868, 866, 433, 70cm
+//   mode: 50 (default), 31, 19, as it determines the fhss num
+//   ortho: 0 = off (default), 1 = 1/3, 2 = 2/3, 3 = 3/3
+// e.g.
+//   ./fhss_analyzer -b 2p4 mlrs.0 mlrs.1 mlrs.2:1 mlrs.3:2
+//
+// build:
+//   g++ -O2 -std=gnu++14 fhss_analyzer.cpp -o fhss_analyzer
+//*******************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+#define FHSS_GENERATOR_DRAWS_MAX  2000 // a generation which ends takes much less
+
+#include "../../mLRS/Common/fhss_generator.h"
+
+
+#define PAIRS_NUM  50000
+
+
+typedef enum {
+    CONFIG_2P4_GHZ = 0,
+    CONFIG_915_MHZ_FCC,
+    CONFIG_868_MHZ,
+    CONFIG_866_MHZ_IN,
+    CONFIG_433_MHZ,
+    CONFIG_70_CM_HAM,
+    CONFIG_NUM,
+} CONFIG_ENUM;
+
+const char* config_name[CONFIG_NUM] = { "2p4", "915", "868", "866", "433", "70cm" };
+
+// as in fhss.h
+const uint8_t freq_list_len[CONFIG_NUM] = { 80, 43, 10, 4, 3, 33 };
+const uint8_t bind_list_2p4[] = { 46, 14, 68 };
+const uint8_t bind_list_915_fcc[] = { 19 };
+const uint8_t bind_list_868[] = { 0 };
+const uint8_t bind_list_866_in[] = { 0 };
+const uint8_t bind_list_433[] = { 0 };
+const uint8_t bind_list_70_cm_ham[] = { 10, 20 };
+const uint8_t* bind_list[CONFIG_NUM] = { bind_list_2p4, bind_list_915_fcc, bind_list_868, bind_list_866_in, bind_list_433, bind_list_70_cm_ham };
+const uint8_t bind_list_len[CONFIG_NUM] = { 3, 1, 1, 1, 1, 2 };
+
+// FHSS_NUM_BAND_xxx of common_conf.h, for the 50 Hz, 31 Hz, 19 Hz modes
+const uint8_t fhss_num[CONFIG_NUM][3] = { {24, 18, 12}, {25, 25, 25}, {6, 6, 6}, {3, 3, 3}, {2, 2, 2}, {18, 18, 12} };
+
+const char bindphrase_chars[] = "abcdefghijklmnopqrstuvwxyz0123456789_#-.";
+
+
+//-------------------------------------------------------
+// links
+//-------------------------------------------------------
+
+typedef struct {
+    uint8_t config_i;
+    uint8_t num;
+    uint8_t ortho;
+    uint8_t except;
+} tSetting;
+
+
+typedef struct {
+    uint16_t seed;
+    uint8_t cnt;
+    uint8_t ch_list[FHSS_MAX_NUM];
+    uint64_t mask[2]; // the channels in ch_list
+} tLink;
+
+
+// as tFhssBase::Init() does it
+void resolve_setting(tSetting* s, uint8_t* cnt)
+{
+    *cnt = s->num;
+    uint8_t cnt_max = freq_list_len[s->config_i] - bind_list_len[s->config_i];
+    if (*cnt > cnt_max) *cnt = cnt_max;
+
+    switch (s->config_i) {
+    case CONFIG_2P4_GHZ:
+        if (s->ortho >= 1 && s->ortho <= 3) {
+            if (s->except >= 1 && s->except <= 4) {
+                if (*cnt > 12) *cnt = 12;
+            } else {
+                if (*cnt > 18) *cnt = 18;
+                s->except = 0;
+            }
+        } else {
+            s->ortho = 0;
+            if (s->except > 4) s->except = 0;
+        }
+        break;
+    case CONFIG_915_MHZ_FCC:
+        if (s->ortho >= 1 && s->ortho <= 3) { if (*cnt > 12) *cnt = 12; } else { s->ortho = 0; }
+        s->except = 0;
+        break;
+    case CONFIG_70_CM_HAM:
+        if (s->ortho >= 1 && s->ortho <= 3) { if (*cnt > 8) *cnt = 8; } else { s->ortho = 0; }
+        s->except = 0;
+        break;
+    default:
+        s->ortho = 0;
+        s->except = 0;
+    }
+}
+
+
+// returns false if the generation doesn't end for this seed
+bool make_link(tLink* link, tSetting setting, uint16_t seed)
+{
+    uint8_t cnt;
+    resolve_setting(&setting, &cnt);
+
+    uint8_t c = setting.config_i;
+    uint8_t len = freq_list_len[c];
+    tFhssExcept2p4 ex((c == CONFIG_2P4_GHZ) ? setting.except : 0);
+    tFhssGenerator gen;
+
+    if (c == CONFIG_868_MHZ || c == CONFIG_866_MHZ_IN || c == CONFIG_433_MHZ) {
+        bool too_close = (c != CONFIG_433_MHZ && c != CONFIG_866_MHZ_IN);
+        gen = tFhssGenerator(seed, cnt, len, 1, 0, bind_list[c], bind_list_len[c], nullptr, too_close);
+    } else if (setting.ortho >= 1 && setting.ortho <= 3) {
+        gen = tFhssGenerator(seed, cnt, len / 3, 3, setting.ortho - 1, bind_list[c], bind_list_len[c], ex.flag, true);
+    } else {
+        gen = tFhssGenerator(seed, cnt, len, 1, 0, bind_list[c], bind_list_len[c], ex.flag, true);
+    }
+    if (gen.Cnt() != cnt) return false;
+
+    link->seed = seed;
+    link->cnt = cnt;
+    link->mask[0] = link->mask[1] = 0;
+    for (uint8_t k = 0; k < cnt; k++) {
+        uint8_t ch = gen.Ch(k);
+        link->ch_list[k] = ch;
+        link->mask[ch >> 6] |= (uint64_t)1 << (ch & 0x3F);
+    }
+    return true;
+}
+
+
+uint16_t seed_from_bindphrase(const char* bindphrase) { return fhss_seed_from_bindphrase(bindphrase); }
+
+
+// as in common_types.cpp
+uint8_t except_from_bindphrase(const char* bindphrase)
+{
+    char c = bindphrase[5];
+    if (c >= '0' && c <= '9') return (c - '0') % 5;
+    const char* cptr = strchr(bindphrase_chars, c);
+    uint8_t n = (cptr) ? cptr - bindphrase_chars : 0;
+    return n % 5;
+}
+
+
+//-------------------------------------------------------
+// collisions
+//-------------------------------------------------------
+
+typedef struct {
+    float async;
+    float adj;
+    float aligned;
+} tCollision;
+
+
+uint8_t popcount(uint64_t v) { return __builtin_popcountll(v); }
+
+
+// in % of time
+tCollision collision(tLink* a, tLink* b)
+{
+    tCollision res;
+    float n2 = (float)a->cnt * b->cnt;
+
+    // same channel, each link is on each of its channels 1/cnt of the time
+    uint8_t same = popcount(a->mask[0] & b->mask[0]) + popcount(a->mask[1] & b->mask[1]);
+    res.async = 100.0f * same / n2;
+
+    // channel next to ours
+    uint64_t b_up[2] = { (b->mask[0] << 1), (b->mask[1] << 1) | (b->mask[0] >> 63) };
+    uint64_t b_dn[2] = { (b->mask[0] >> 1) | (b->mask[1] << 63), (b->mask[1] >> 1) };
+    uint8_t adj = popcount(a->mask[0] & b_up[0]) + popcount(a->mask[1] & b_up[1]) +
+                  popcount(a->mask[0] & b_dn[0]) + popcount(a->mask[1] & b_dn[1]);
+    res.adj = 100.0f * adj / n2;
+
+    // hopping in sync, worst offset, over the common period
+    uint16_t period = a->cnt;
+    while (period % b->cnt) period += a->cnt;
+    uint16_t worst = 0;
+    for (uint8_t d = 0; d < b->cnt; d++) {
+        uint16_t n = 0;
+        for (uint16_t i = 0; i < period; i++) {
+            if (a->ch_list[i % a->cnt] == b->ch_list[(i + d) % b->cnt]) n++;
+        }
+        if (n > worst) worst = n;
+    }
+    res.aligned = 100.0f * worst / period;
+
+    return res;
+}
+
+
+uint32_t rnd_state = 12345;
+
+uint32_t rnd(void)
+{
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+
+void random_bindphrase(char* bindphrase)
+{
+    for (uint8_t i = 0; i < 6; i++) bindphrase[i] = bindphrase_chars[rnd() % 40];
+    bindphrase[6] = '\0';
+}
+
+
+// a link with a random bind phrase, for 2.4 GHz the except is then also given by the bind phrase
+// if except is not UINT8_MAX it is used instead
+void random_link(tLink* link, tSetting setting, uint8_t except)
+{
+    char bindphrase[7];
+    do {
+        random_bindphrase(bindphrase);
+        setting.except = (except != UINT8_MAX) ? except : except_from_bindphrase(bindphrase);
+    } while (!make_link(link, setting, seed_from_bindphrase(bindphrase)));
+}
+
+
+float percentile(float* v, uint32_t n, float p)
+{
+    std::sort(v, v + n);
+    return v[(uint32_t)(p * (n - 1))];
+}
+
+
+//-------------------------------------------------------
+// statistics
+//-------------------------------------------------------
+
+tLink links[65536];
+uint64_t hashes[65536];
+uint64_t set_hashes[65536];
+float va[PAIRS_NUM], vj[PAIRS_NUM], vl[PAIRS_NUM];
+
+
+uint64_t hash_bytes(const uint8_t* buf, uint8_t len)
+{
+    uint64_t h = 14695981039346656037ULL; // FNV-1a
+    for (uint8_t i = 0; i < len; i++) { h ^= buf[i]; h *= 1099511628211ULL; }
+    return h;
+}
+
+
+tSetting analyzed[256];
+uint8_t analyzed_num = 0;
+
+
+void analyze_setting(tSetting setting)
+{
+    uint8_t cnt;
+    resolve_setting(&setting, &cnt);
+
+    // different settings can end up the same, e.g. cnt is limited for ortho
+    for (uint8_t i = 0; i < analyzed_num; i++) {
+        tSetting* a = &analyzed[i];
+        if (a->config_i == setting.config_i && a->num == cnt && a->ortho == setting.ortho && a->except == setting.except) return;
+    }
+    analyzed[analyzed_num++] = { setting.config_i, cnt, setting.ortho, setting.except };
+
+    uint32_t n = 0;
+    uint32_t hangs = 0;
+    uint32_t use[FHSS_FREQ_LIST_MAX_LEN] = {};
+    uint32_t hops = 0, hops_close = 0;
+    uint64_t spacing_sum = 0;
+    uint8_t spacing_min = UINT8_MAX;
+    uint8_t ch_inc = (setting.ortho) ? 3 : 1;
+
+    for (uint32_t seed = 0; seed < 65536; seed++) {
+        tLink* link = &links[n];
+        if (!make_link(link, setting, seed)) { hangs++; continue; }
+
+        hashes[n] = hash_bytes(link->ch_list, cnt);
+        set_hashes[n] = hash_bytes((uint8_t*)link->mask, sizeof(link->mask));
+
+        for (uint8_t k = 0; k < cnt; k++) {
+            use[link->ch_list[k]]++;
+            uint8_t ch_next = link->ch_list[(k + 1) % cnt];
+            uint8_t d = (ch_next > link->ch_list[k]) ? ch_next - link->ch_list[k] : link->ch_list[k] - ch_next;
+            spacing_sum += d;
+            if (d < spacing_min) spacing_min = d;
+            if (d <= ch_inc) hops_close++;
+            hops++;
+        }
+        n++;
+    }
+
+    std::sort(hashes, hashes + n);
+    std::sort(set_hashes, set_hashes + n);
+    uint32_t unique = (n) ? std::unique(hashes, hashes + n) - hashes : 0;
+    uint32_t unique_sets = (n) ? std::unique(set_hashes, set_hashes + n) - set_hashes : 0;
+
+    uint32_t use_min = UINT32_MAX, use_max = 0, used_chs = 0;
+    uint64_t use_sum = 0;
+    for (uint8_t ch = 0; ch < freq_list_len[setting.config_i]; ch++) {
+        if (!use[ch]) continue;
+        used_chs++;
+        use_sum += use[ch];
+        if (use[ch] < use_min) use_min = use[ch];
+        if (use[ch] > use_max) use_max = use[ch];
+    }
+    float use_mean = (used_chs) ? (float)use_sum / used_chs : 1.0f;
+
+    for (uint32_t i = 0; i < PAIRS_NUM; i++) {
+        tLink a, b;
+        random_link(&a, setting, (setting.config_i == CONFIG_2P4_GHZ) ? setting.except : UINT8_MAX);
+        random_link(&b, setting, (setting.config_i == CONFIG_2P4_GHZ) ? setting.except : UINT8_MAX);
+        tCollision c = collision(&a, &b);
+        va[i] = c.async; vj[i] = c.adj; vl[i] = c.aligned;
+    }
+    float va_mean = 0.0f, vj_mean = 0.0f, vl_mean = 0.0f;
+    for (uint32_t i = 0; i < PAIRS_NUM; i++) { va_mean += va[i]; vj_mean += vj[i]; vl_mean += vl[i]; }
+
+    printf("%-4s %2u  %u  %u  | %5u %5u %4u | %2u %4.2f %4.2f | %4.1f %2u %5.1f%% | %5.2f %5.2f  %5.2f %5.2f  %5.1f %5.1f\n",
+           config_name[setting.config_i], cnt, setting.ortho, setting.except,
+           unique, unique_sets, hangs,
+           used_chs, use_min / use_mean, use_max / use_mean,
+           (hops) ? (float)spacing_sum / hops : 0.0f, spacing_min, (hops) ? 100.0f * hops_close / hops : 0.0f,
+           va_mean / PAIRS_NUM, percentile(va, PAIRS_NUM, 0.99f),
+           vj_mean / PAIRS_NUM, percentile(vj, PAIRS_NUM, 0.99f),
+           vl_mean / PAIRS_NUM, percentile(vl, PAIRS_NUM, 0.99f));
+    fflush(stdout);
+}
+
+
+// mean collisions of links with setting a with links with setting b
+void analyze_cross(tSetting sa, tSetting sb)
+{
+    float async = 0.0f, adj = 0.0f;
+
+    for (uint32_t i = 0; i < PAIRS_NUM / 10; i++) {
+        tLink a, b;
+        random_link(&a, sa, sa.except);
+        random_link(&b, sb, sb.except);
+        tCollision c = collision(&a, &b);
+        async += c.async;
+        adj += c.adj;
+    }
+    printf(" %5.2f/%5.2f", async / (PAIRS_NUM / 10), adj / (PAIRS_NUM / 10));
+}
+
+
+void analyze_all(void)
+{
+    printf("band cnt o  e  |  seqs  sets hang | usage         | spacing          | async       adj          aligned\n");
+    printf("               |                 | chs min  max  | mean min close   | mean  p99   mean  p99    mean  p99\n");
+
+    for (uint8_t config_i = 0; config_i < CONFIG_NUM; config_i++) {
+        uint8_t last_num = 0;
+        for (uint8_t mode = 0; mode < 3; mode++) {
+            uint8_t num = fhss_num[config_i][mode];
+            if (num == last_num) continue;
+            last_num = num;
+            bool has_ortho = (config_i == CONFIG_2P4_GHZ || config_i == CONFIG_915_MHZ_FCC || config_i == CONFIG_70_CM_HAM);
+            for (uint8_t ortho = 0; ortho < ((has_ortho) ? 4 : 1); ortho++) {
+                for (uint8_t except = 0; except < ((config_i == CONFIG_2P4_GHZ) ? 5 : 1); except++) {
+                    analyze_setting({ config_i, num, ortho, except });
+                }
+            }
+        }
+    }
+
+    printf("\nmean async/adj collisions in %% between links with different ortho, except off, highest fhss num\n");
+    const uint8_t ortho_configs[3] = { CONFIG_2P4_GHZ, CONFIG_915_MHZ_FCC, CONFIG_70_CM_HAM };
+    for (uint8_t n = 0; n < 3; n++) {
+        uint8_t config_i = ortho_configs[n];
+        printf("%s\n", config_name[config_i]);
+        for (uint8_t oa = 0; oa < 4; oa++) {
+            printf("  ortho %u:", oa);
+            for (uint8_t ob = 0; ob < 4; ob++) {
+                analyze_cross({ config_i, fhss_num[config_i][0], oa, 0 }, { config_i, fhss_num[config_i][0], ob, 0 });
+            }
+            printf("\n");
+        }
+    }
+
+    printf("\nmean async/adj collisions in %% between links with different except, ortho off, fhss num 24\n");
+    printf("2p4\n");
+    for (uint8_t ea = 0; ea < 5; ea++) {
+        printf("  except %u:", ea);
+        for (uint8_t eb = 0; eb < 5; eb++) {
+            analyze_cross({ CONFIG_2P4_GHZ, 24, 0, ea }, { CONFIG_2P4_GHZ, 24, 0, eb });
+        }
+        printf("\n");
+    }
+}
+
+
+//-------------------------------------------------------
+// bind phrases
+//-------------------------------------------------------
+
+#define PHRASES_MAX  32
+
+
+int analyze_bindphrases(uint8_t config_i, uint8_t mode, int argc, char** argv)
+{
+    char bindphrase[PHRASES_MAX][7];
+    tSetting setting[PHRASES_MAX];
+    tLink link[PHRASES_MAX];
+    uint8_t n = 0;
+
+    for (int i = 0; i < argc && n < PHRASES_MAX; i++) {
+        const char* arg = argv[i];
+        if (strlen(arg) < 6 || strspn(arg, bindphrase_chars) < 6) {
+            printf("invalid bind phrase %s, must be 6 chars of %s\n", arg, bindphrase_chars);
+            return 1;
+        }
+        memcpy(bindphrase[n], arg, 6);
+        bindphrase[n][6] = '\0';
+
+        uint8_t ortho = (arg[6] == ':') ? atoi(arg + 7) : 0;
+        uint8_t except = (config_i == CONFIG_2P4_GHZ) ? except_from_bindphrase(bindphrase[n]) : 0;
+        setting[n] = { config_i, fhss_num[config_i][mode], ortho, except };
+
+        if (!make_link(&link[n], setting[n], seed_from_bindphrase(bindphrase[n]))) {
+            printf("%s: fhss generation does not end for this bind phrase, don't use it\n", bindphrase[n]);
+            return 1;
+        }
+        resolve_setting(&setting[n], &link[n].cnt);
+        n++;
+    }
+
+    for (uint8_t i = 0; i < n; i++) {
+        printf("%2u %s  seed 0x%04X  ortho %u  except %u  cnt %2u :", i, bindphrase[i], link[i].seed, setting[i].ortho, setting[i].except, link[i].cnt);
+        for (uint8_t k = 0; k < link[i].cnt; k++) printf(" %u", link[i].ch_list[k]);
+        printf("\n");
+    }
+
+    printf("\ncollisions in %%, async/aligned, aligned is for the worst offset when hopping in sync\n");
+    printf("   ");
+    for (uint8_t j = 0; j < n; j++) printf("  %10u", j);
+    printf("\n");
+    for (uint8_t i = 0; i < n; i++) {
+        printf("%2u ", i);
+        for (uint8_t j = 0; j < n; j++) {
+            if (i == j) { printf("  %10s", "-"); continue; }
+            tCollision c = collision(&link[i], &link[j]);
+            printf("  %4.1f/%5.1f", c.async, c.aligned);
+        }
+        printf("\n");
+    }
+
+    for (uint8_t i = 0; i < n; i++) {
+        for (uint8_t j = i + 1; j < n; j++) {
+            if (link[i].seed == link[j].seed && setting[i].ortho == setting[j].ortho) {
+                printf("WARNING: %s and %s have the same seed, the links can't be told apart\n", bindphrase[i], bindphrase[j]);
+            }
+        }
+    }
+    return 0;
+}
+
+
+//-------------------------------------------------------
+// main
+//-------------------------------------------------------
+
+int main(int argc, char** argv)
+{
+    uint8_t config_i = CONFIG_2P4_GHZ;
+    uint8_t mode = 0;
+
+    int i = 1;
+    for (; i < argc; i++) {
+        if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            i++;
+            config_i = CONFIG_NUM;
+            for (uint8_t c = 0; c < CONFIG_NUM; c++) if (!strcmp(argv[i], config_name[c])) config_i = c;
+            if (config_i == CONFIG_NUM) { printf("unknown band %s\n", argv[i]); return 1; }
+        } else if (!strcmp(argv[i], "-m") && i + 1 < argc) {
+            i++;
+            int m = atoi(argv[i]);
+            mode = (m == 19) ? 2 : (m == 31) ? 1 : 0;
+        } else {
+            break;
+        }
+    }
+
+    if (i < argc) return analyze_bindphrases(config_i, mode, argc - i, argv + i);
+
+    analyze_all();
+    return 0;
+}
@@ -0,0 +1,454 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// FHSS generator benchmark
+//*******************************************************
+// host benchmark and equivalence check of tFhssGenerator of Common/fhss_generator.h
+// against the rank scan over the used flags, which tFhssBase::generate() and
+// generate_ortho_except() did before, copied below
+//
+// checks
+// - all 65536 seeds, for all bands, with their fhss nums, bind channels, ortho and except
+//   settings as tFhssBase::Init() does them, the channel lists and the final prng state must be identical
+// - the 2.4 GHz except channel ranges of fhss_generator.h against the frequency ranges of fhss.cpp
+// - a compile time generated sequence, by static_assert, and against a recorded sequence
+// reports us/sequence for the old and the new generator
+//
+// build:
+//   g++ -O2 -std=gnu++14 fhss_bench.cpp -o fhss_bench
+// run:
+//   ./fhss_bench
+//
+// the us are host numbers, they are useful for comparing, not as absolute numbers for the mcus
+//*******************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+
+#include "../../mLRS/Common/fhss_generator.h"
+
+
+// as in sx12xx-lib, 2.4 GHz is set with the 52 MHz xtal
+#define SX1280_FREQ_GHZ_TO_REG(f_GHz)  (uint32_t)((double)(f_GHz) * 1.0E9 * (double)(1 << 18) / 52.0E6 + 0.5)
+
+
+typedef enum {
+    CONFIG_2P4_GHZ = 0,
+    CONFIG_915_MHZ_FCC,
+    CONFIG_868_MHZ,
+    CONFIG_866_MHZ_IN,
+    CONFIG_433_MHZ,
+    CONFIG_70_CM_HAM,
+    CONFIG_NUM,
+} CONFIG_ENUM;
+
+const char* config_name[CONFIG_NUM] = { "2.4 GHz", "915 MHz FCC", "868 MHz", "866 MHz IN", "433 MHz", "70 cm HAM" };
+
+// as in fhss.h
+const uint8_t freq_list_len[CONFIG_NUM] = { 80, 43, 10, 4, 3, 33 };
+const uint8_t bind_list_2p4[] = { 46, 14, 68 };
+const uint8_t bind_list_915_fcc[] = { 19 };
+const uint8_t bind_list_868[] = { 0 };
+const uint8_t bind_list_866_in[] = { 0 };
+const uint8_t bind_list_433[] = { 0 };
+const uint8_t bind_list_70_cm_ham[] = { 10, 20 };
+const uint8_t* bind_list[CONFIG_NUM] = { bind_list_2p4, bind_list_915_fcc, bind_list_868, bind_list_866_in, bind_list_433, bind_list_70_cm_ham };
+const uint8_t bind_list_len[CONFIG_NUM] = { 3, 1, 1, 1, 1, 2 };
+
+// FHSS_NUM_BAND_xxx of common_conf.h, for the 50 Hz, 31 Hz, 19 Hz modes
+const uint8_t fhss_num[CONFIG_NUM][3] = { {24, 18, 12}, {25, 25, 25}, {6, 6, 6}, {3, 3, 3}, {2, 2, 2}, {18, 18, 12} };
+
+uint32_t freq_list_2p4[80];
+
+#define DRAWS_MAX  2000 // a generation which ends takes much less
+
+
+//-------------------------------------------------------
+// the earlier generator, as it was in fhss.cpp
+//-------------------------------------------------------
+
+class tFhssRef
+{
+  public:
+    uint8_t config_i;
+    uint8_t FREQ_LIST_LEN;
+    const uint8_t* fhss_bind_channel_list;
+    uint8_t BIND_CHANNEL_LIST_LEN;
+    uint8_t cnt;
+    uint8_t _except;
+    uint32_t _seed;
+    uint8_t ch_list[FHSS_MAX_NUM];
+    uint32_t draws; // not in fhss.cpp, to detect that no channel can be picked anymore
+
+    bool is_bind_channel(uint8_t ch)
+    {
+        for (uint8_t bi = 0; bi < BIND_CHANNEL_LIST_LEN; bi++) {
+            if (ch == fhss_bind_channel_list[bi]) return true;
+        }
+        return false;
+    }
+
+    bool is_except_channel(uint8_t ch)
+    {
+        if (config_i != CONFIG_2P4_GHZ) return false;
+        uint32_t freq = freq_list_2p4[ch];
+        switch (_except) {
+        case 1: return (SX1280_FREQ_GHZ_TO_REG(2.401) <= freq && freq <= SX1280_FREQ_GHZ_TO_REG(2.423));
+        case 2: return (SX1280_FREQ_GHZ_TO_REG(2.426) <= freq && freq <= SX1280_FREQ_GHZ_TO_REG(2.448));
+        case 3: return (SX1280_FREQ_GHZ_TO_REG(2.451) <= freq && freq <= SX1280_FREQ_GHZ_TO_REG(2.473));
+        case 4: return (SX1280_FREQ_GHZ_TO_REG(2.461) <= freq && freq <= SX1280_FREQ_GHZ_TO_REG(2.483));
+        }
+        return false;
+    }
+
+    uint16_t prng(void)
+    {
+        const uint32_t a = 214013;
+        const uint32_t c = 2531011;
+        const uint32_t m = 2147483648;
+
+        _seed = (a * _seed + c) % m;
+        draws++;
+
+        return _seed >> 16;
+    }
+
+    void generate(uint32_t seed)
+    {
+        _seed = seed;
+        draws = 0;
+
+        bool used_flag[FHSS_FREQ_LIST_MAX_LEN];
+        for (uint8_t ch = 0; ch < FHSS_FREQ_LIST_MAX_LEN; ch++) used_flag[ch] = false;
+
+        uint8_t k = 0;
+        while (k < cnt) {
+            if (draws > DRAWS_MAX) return;
+
+            uint8_t rn = prng() % (FREQ_LIST_LEN - k); // get a random number in the remaining range
+
+            uint8_t i = 0;
+            uint8_t ch;
+            for (ch = 0; ch < FREQ_LIST_LEN; ch++) {
+                if (used_flag[ch]) continue;
+                if (i == rn) break; // ch is our next index
+                i++;
+            }
+
+            if (ch >= FREQ_LIST_LEN) { // argh, must not happen !
+                ch = 0;
+            }
+
+            // do not pick a bind channel
+            if (is_bind_channel(ch)) continue;
+
+            // ensure it is not too close to the previous
+            // do only if we have plenty of channels at our disposal
+            bool is_too_close = false;
+            if ((config_i != CONFIG_433_MHZ && config_i != CONFIG_866_MHZ_IN) && (k > 0)) {
+                int8_t last_ch = ch_list[k - 1];
+                if (last_ch == 0) { // special treatment for this case
+                    if (ch < 2) is_too_close = true;
+                } else {
+                    if ((ch >= last_ch - 1) && (ch <= last_ch + 1)) is_too_close = true;
+                }
+            }
+            if (is_too_close) continue;
+
+            // we got a new ch, so register it
+            ch_list[k] = ch;
+            used_flag[ch] = true;
+
+            k++;
+        }
+    }
+
+    void generate_ortho_except(uint32_t seed, uint8_t ortho, uint8_t except)
+    {
+        _seed = seed;
+        _except = except;
+        draws = 0;
+
+        bool used_flag[FHSS_FREQ_LIST_MAX_LEN];
+        for (uint8_t ch = 0; ch < FHSS_FREQ_LIST_MAX_LEN; ch++) used_flag[ch] = false;
+
+        uint8_t freq_len = FREQ_LIST_LEN;
+        uint8_t ch_ofs = 0;
+        uint8_t ch_inc = 1;
+
+        if (ortho >= 1 && ortho <= 3) {
+            ch_ofs = ortho - 1; // 0, 1, 2
+            ch_inc = 3;
+            freq_len = FREQ_LIST_LEN / 3; // we use only 1/3 of the available channels
+        }
+
+        uint8_t k = 0;
+        uint8_t last_ch_eff = 0;
+
+        while (k < cnt) {
+            if (draws > DRAWS_MAX) return;
+
+            uint8_t rn = prng() % (freq_len - k); // get a random number in the remaining range
+
+            uint8_t i = 0;
+            uint8_t ch_eff;
+            for (ch_eff = 0; ch_eff < freq_len; ch_eff++) {
+                if (used_flag[ch_eff]) continue;
+                if (i == rn) break; // ch_eff is our next index
+                i++;
+            }
+
+            if (ch_eff >= freq_len) { // argh, must not happen !
+                ch_eff = freq_len;
+            }
+
+            uint8_t ch = ch_eff * ch_inc + ch_ofs; // that's the true channel
+
+            // do not pick a bind channel
+            if (is_bind_channel(ch)) continue;
+
+            // do not pick a channel in an excepted wifi band
+            if (is_except_channel(ch)) continue;
+
+            // ensure it is not too close to the previous
+            bool is_too_close = false;
+            if (k > 0) {
+                if (last_ch_eff == 0) { // special treatment for this case
+                    if (ch_eff <= 1) is_too_close = true;
+                } else {
+                    if ((ch_eff >= last_ch_eff - 1) && (ch_eff <= last_ch_eff + 1)) is_too_close = true;
+                }
+            }
+            if (is_too_close) continue;
+
+            last_ch_eff = ch_eff;
+
+            // we got a new ch, so register it
+            ch_list[k] = ch;
+            used_flag[ch_eff] = true;
+
+            k++;
+        }
+    }
+};
+
+
+//-------------------------------------------------------
+// the cases, as tFhssBase::Init() sets them up
+//-------------------------------------------------------
+
+typedef struct {
+    uint8_t config_i;
+    uint8_t cnt;
+    uint8_t ortho;
+    uint8_t except;
+} tCase;
+
+tCase cases[256];
+uint8_t cases_num = 0;
+
+
+void add_case(uint8_t config_i, uint8_t num, uint8_t ortho, uint8_t except)
+{
+    uint8_t cnt = num;
+    uint8_t cnt_max = freq_list_len[config_i] - bind_list_len[config_i];
+    if (cnt > cnt_max) cnt = cnt_max;
+
+    switch (config_i) {
+    case CONFIG_2P4_GHZ:
+        if (ortho >= 1 && ortho <= 3) {
+            if (except >= 1 && except <= 4) {
+                if (cnt > 12) cnt = 12;
+            } else {
+                if (cnt > 18) cnt = 18;
+                except = 0;
+            }
+        } else {
+            ortho = 0;
+            if (except > 4) except = 0;
+        }
+        break;
+    case CONFIG_915_MHZ_FCC:
+        if (ortho >= 1 && ortho <= 3) { if (cnt > 12) cnt = 12; } else { ortho = 0; }
+        except = 0;
+        break;
+    case CONFIG_70_CM_HAM:
+        if (ortho >= 1 && ortho <= 3) { if (cnt > 8) cnt = 8; } else { ortho = 0; }
+        except = 0;
+        break;
+    default:
+        ortho = 0;
+        except = 0;
+    }
+
+    for (uint8_t n = 0; n < cases_num; n++) {
+        if (cases[n].config_i == config_i && cases[n].cnt == cnt && cases[n].ortho == ortho && cases[n].except == except) return;
+    }
+    cases[cases_num++] = { config_i, cnt, ortho, except };
+}
+
+
+bool uses_generate(uint8_t config_i)
+{
+    return (config_i == CONFIG_868_MHZ || config_i == CONFIG_866_MHZ_IN || config_i == CONFIG_433_MHZ);
+}
+
+
+void run_ref(tFhssRef* ref, tCase* c, uint32_t seed)
+{
+    ref->config_i = c->config_i;
+    ref->FREQ_LIST_LEN = freq_list_len[c->config_i];
+    ref->fhss_bind_channel_list = bind_list[c->config_i];
+    ref->BIND_CHANNEL_LIST_LEN = bind_list_len[c->config_i];
+    ref->cnt = c->cnt;
+    ref->_except = 0;
+    if (uses_generate(c->config_i)) {
+        ref->generate(seed);
+    } else {
+        ref->generate_ortho_except(seed, c->ortho, c->except);
+    }
+}
+
+
+// this is what fhss.cpp does
+tFhssGenerator run_gen(tCase* c, uint32_t seed, const bool* except_flag)
+{
+    uint8_t len = freq_list_len[c->config_i];
+
+    if (uses_generate(c->config_i)) {
+        bool too_close = (c->config_i != CONFIG_433_MHZ && c->config_i != CONFIG_866_MHZ_IN);
+        return tFhssGenerator(seed, c->cnt, len, 1, 0, bind_list[c->config_i], bind_list_len[c->config_i], nullptr, too_close);
+    }
+    if (c->ortho >= 1 && c->ortho <= 3) {
+        return tFhssGenerator(seed, c->cnt, len / 3, 3, c->ortho - 1, bind_list[c->config_i], bind_list_len[c->config_i], except_flag, true);
+    }
+    return tFhssGenerator(seed, c->cnt, len, 1, 0, bind_list[c->config_i], bind_list_len[c->config_i], except_flag, true);
+}
+
+
+// for some seeds no channel can be picked anymore before cnt is reached, e.g. since the
+// remaining channels are all next to the previous, and the generation never ends
+// this is so for the earlier generator too, we record these seeds and skip them
+bool is_hang_seed[65536];
+
+
+//-------------------------------------------------------
+// compile time generation
+//-------------------------------------------------------
+
+constexpr uint8_t bind_list_2p4_c[] = { 46, 14, 68 };
+constexpr tFhssExcept2p4 except_none_c(0);
+
+constexpr tFhssGenerator gen_mlrs0(fhss_seed_from_bindphrase("mlrs.0"), 24, 80, 1, 0, bind_list_2p4_c, 3, except_none_c.flag, true);
+
+static_assert(gen_mlrs0.Cnt() == 24, "compile time generation failed");
+static_assert(gen_mlrs0.Ch(0) == 71 && gen_mlrs0.Ch(23) == 47, "compile time generation differs from the recorded sequence");
+
+// the sequence of "mlrs.0", recorded with an independent Python port of fhss.cpp
+const uint8_t mlrs0_recorded[24] = { 71, 58, 20, 37, 45, 59, 21, 42, 61, 19, 56, 40, 64, 25, 34, 4, 49, 24, 39, 70, 66, 52, 63, 47 };
+
+
+//-------------------------------------------------------
+// main
+//-------------------------------------------------------
+
+int main(void)
+{
+    bool ok = true;
+
+    for (uint8_t ch = 0; ch < 80; ch++) freq_list_2p4[ch] = SX1280_FREQ_GHZ_TO_REG(2.401 + 0.001 * ch);
+
+    // except channel ranges
+    tFhssRef ref;
+    ref.config_i = CONFIG_2P4_GHZ;
+    for (uint8_t except = 0; except < 5; except++) {
+        tFhssExcept2p4 ex(except);
+        ref._except = except;
+        for (uint8_t ch = 0; ch < 80; ch++) {
+            if (ex.flag[ch] != ref.is_except_channel(ch)) {
+                printf("FAIL except %u ch %u\n", except, ch);
+                ok = false;
+            }
+        }
+    }
+    printf("except ranges: %s\n", (ok) ? "ok" : "FAIL");
+
+    // compile time generation
+    bool ok_c = true;
+    for (uint8_t k = 0; k < 24; k++) if (gen_mlrs0.Ch(k) != mlrs0_recorded[k]) ok_c = false;
+    printf("compile time 'mlrs.0': seed 0x%04X %s\n", fhss_seed_from_bindphrase("mlrs.0"), (ok_c) ? "ok" : "FAIL");
+    if (!ok_c) ok = false;
+
+    // all cases
+    for (uint8_t config_i = 0; config_i < CONFIG_NUM; config_i++) {
+        for (uint8_t mode = 0; mode < 3; mode++) {
+            for (uint8_t ortho = 0; ortho < 4; ortho++) {
+                for (uint8_t except = 0; except < 5; except++) {
+                    add_case(config_i, fhss_num[config_i][mode], ortho, except);
+                }
+            }
+        }
+    }
+
+    uint32_t fail_cnt = 0;
+    uint32_t hang_cnt = 0;
+    uint32_t seq_cnt = 0;
+    double t_ref_total = 0.0;
+    double t_gen_total = 0.0;
+
+    for (uint8_t n = 0; n < cases_num; n++) {
+        tCase* c = &cases[n];
+        tFhssExcept2p4 ex((c->config_i == CONFIG_2P4_GHZ) ? c->except : 0);
+        uint32_t fails = 0;
+        uint32_t hangs = 0;
+        uint32_t hang_seed = 0;
+
+        for (uint32_t seed = 0; seed < 65536; seed++) {
+            run_ref(&ref, c, seed);
+            is_hang_seed[seed] = (ref.draws > DRAWS_MAX);
+            if (is_hang_seed[seed]) { // both would hang, can't be compared
+                if (!hangs) hang_seed = seed;
+                hangs++;
+                continue;
+            }
+            tFhssGenerator gen = run_gen(c, seed, ex.flag);
+            bool equal = (gen.Cnt() == c->cnt) && (gen.Seed() == ref._seed);
+            for (uint8_t k = 0; k < c->cnt; k++) if (gen.Ch(k) != ref.ch_list[k]) equal = false;
+            if (!equal) fails++;
+        }
+
+        // timing
+        volatile uint8_t sink = 0;
+        auto t0 = std::chrono::high_resolution_clock::now();
+        for (uint32_t seed = 0; seed < 1024; seed++) { if (is_hang_seed[seed]) continue; run_ref(&ref, c, seed); sink += ref.ch_list[0]; }
+        auto t1 = std::chrono::high_resolution_clock::now();
+        for (uint32_t seed = 0; seed < 1024; seed++) { if (is_hang_seed[seed]) continue; tFhssGenerator gen = run_gen(c, seed, ex.flag); sink += gen.Ch(0); }
+        auto t2 = std::chrono::high_resolution_clock::now();
+        double t_ref = std::chrono::duration<double, std::micro>(t1 - t0).count() / 1024.0;
+        double t_gen = std::chrono::duration<double, std::micro>(t2 - t1).count() / 1024.0;
+        t_ref_total += t_ref;
+        t_gen_total += t_gen;
+
+        printf("%-12s cnt %2u ortho %u except %u: %s  old %6.3f us  new %6.3f us",
+               config_name[c->config_i], c->cnt, c->ortho, c->except, (fails) ? "FAIL" : "ok", t_ref, t_gen);
+        if (hangs) printf("  %u seeds hang, e.g. %u", hangs, hang_seed);
+        printf("\n");
+        fflush(stdout);
+        fail_cnt += fails;
+        hang_cnt += hangs;
+        seq_cnt += 65536 - hangs;
+    }
+
+    printf("\n%u sequences, %u differ, %u seeds hang in both\n", seq_cnt, fail_cnt, hang_cnt);
+    printf("sum over cases: old %.3f us  new %.3f us\n", t_ref_total, t_gen_total);
+    if (fail_cnt) ok = false;
+
+    printf("%s\n", (ok) ? "PASSED" : "FAILED");
+    return (ok) ? 0 : 1;
+}
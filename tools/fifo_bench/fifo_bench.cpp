@@ -0,0 +1,289 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// FIFO benchmark
+//*******************************************************
+// host benchmark and check of tFifo of Common/libs/fifo.h
+//
+// checks
+// - PutBuf()/GetBuf() with random lengths across the wrap-around, against a reference sequence
+// - spans, Peek(), Skip(), full and empty fifo
+// - single-producer/single-consumer, producer and consumer in two threads, the consumer checks
+//   that it gets the sequence of the producer without loss or duplicates
+// reports ns/byte for moving telemetry through a tFifo<char,512>, as fifo_link_out, with
+// - Put()/Get() per byte
+// - PutBuf()/GetBuf(), in chunks of a MAVLink frame and of a frame payload
+// - WriteSpan()/ReadSpan()
+//
+// build:
+//   g++ -O2 -pthread fifo_bench.cpp -o fifo_bench
+// run:
+//   ./fifo_bench
+//
+// the ns are host numbers, they are useful for comparing, not as absolute numbers for the mcus
+//*******************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+
+#include "../../mLRS/Common/libs/fifo.h"
+
+
+#define BENCH_LOOPS_DEFAULT     100000
+#define SPSC_BYTES              10000000
+
+#define PUT_CHUNK_LEN           280 // a full MAVLink v2 frame
+#define GET_CHUNK_LEN           82 // FRAME_RX_PAYLOAD_LEN
+
+
+uint32_t check_cnt;
+uint32_t fail_cnt;
+
+
+void check(bool ok, const char* s)
+{
+    check_cnt++;
+    if (ok) return;
+    fail_cnt++;
+    if (fail_cnt < 10) printf("  fail: %s\n", s);
+}
+
+
+//-------------------------------------------------------
+// checks
+//-------------------------------------------------------
+
+void do_checks(void)
+{
+tFifo<char,512> fifo;
+char buf[600];
+uint8_t put_seq = 0, get_seq = 0;
+uint32_t fill = 0;
+
+    check_cnt = fail_cnt = 0;
+
+    // empty
+    char c = 'x';
+    check(!fifo.Get(&c) && c == 'x', "Get() on empty");
+    check(!fifo.Peek(&c), "Peek() on empty");
+    check(fifo.Available() == 0 && fifo.Free() == 511, "empty Available(), Free()");
+
+    // full
+    for (uint16_t i = 0; i < 511; i++) buf[i] = i;
+    check(fifo.PutBuf(buf, 600) == 511, "PutBuf() on full");
+    check(!fifo.Put(0) && !fifo.HasSpace(1) && fifo.Available() == 511, "Put() on full");
+    check(fifo.Peek(&c, 510) && c == (char)(510 & 0xFF), "Peek() at offset");
+    check(fifo.Skip(600) == 511 && fifo.Available() == 0, "Skip()");
+
+    // random chunks, crosses the wrap-around many times
+    fifo.Init();
+    for (uint32_t n = 0; n < 1000000; n++) {
+        uint16_t len = rand() % 300;
+        if (rand() & 1) {
+            for (uint16_t i = 0; i < len; i++) buf[i] = put_seq + i;
+            uint16_t put = fifo.PutBuf(buf, len);
+            check(put == ((len < 511 - fill) ? len : 511 - fill), "PutBuf() len");
+            put_seq += put;
+            fill += put;
+        } else {
+            uint16_t got = fifo.GetBuf(buf, len);
+            check(got == ((len < fill) ? len : fill), "GetBuf() len");
+            for (uint16_t i = 0; i < got; i++) check(buf[i] == (char)get_seq++, "GetBuf() data");
+            fill -= got;
+        }
+        check(fifo.Available() == fill && fifo.Free() == 511 - fill, "Available(), Free()");
+    }
+
+    // spans
+    fifo.Init();
+    put_seq = get_seq = 0;
+    fill = 0;
+    for (uint32_t n = 0; n < 1000000; n++) {
+        char* ptr;
+        uint16_t len = rand() % 300;
+        if (rand() & 1) {
+            uint16_t span = fifo.WriteSpan(&ptr);
+            check(span <= 511 - fill && (span > 0 || fill == 511), "WriteSpan() len");
+            if (len > span) len = span;
+            for (uint16_t i = 0; i < len; i++) ptr[i] = put_seq++;
+            fifo.CommitWrite(len);
+            fill += len;
+        } else {
+            uint16_t span = fifo.ReadSpan(&ptr);
+            check(span <= fill && (span > 0 || fill == 0), "ReadSpan() len");
+            if (len > span) len = span;
+            for (uint16_t i = 0; i < len; i++) check(ptr[i] == (char)get_seq++, "ReadSpan() data");
+            fifo.CommitRead(len);
+            fill -= len;
+        }
+        check(fifo.Available() == fill, "span Available()");
+    }
+
+    printf("checks: %u checks, %u failed\n", check_cnt, fail_cnt);
+}
+
+
+//-------------------------------------------------------
+// single-producer/single-consumer
+//-------------------------------------------------------
+
+tFifo<char,512> spsc_fifo;
+uint32_t spsc_fail_cnt;
+
+
+void spsc_producer(void)
+{
+char buf[PUT_CHUNK_LEN];
+uint8_t seq = 0;
+uint32_t bytes = 0;
+
+    while (bytes < SPSC_BYTES) {
+        uint16_t len = 1 + rand() % PUT_CHUNK_LEN;
+        for (uint16_t i = 0; i < len; i++) buf[i] = seq + i;
+        uint16_t put = spsc_fifo.PutBuf(buf, len);
+        if (!put) std::this_thread::yield(); // fifo full
+        seq += put;
+        bytes += put;
+    }
+}
+
+
+void spsc_consumer(void)
+{
+char buf[GET_CHUNK_LEN];
+uint8_t seq = 0;
+uint32_t bytes = 0;
+
+    while (bytes < SPSC_BYTES) {
+        uint16_t got = spsc_fifo.GetBuf(buf, GET_CHUNK_LEN);
+        if (!got) std::this_thread::yield(); // fifo empty
+        for (uint16_t i = 0; i < got; i++) {
+            if (buf[i] != (char)seq++) spsc_fail_cnt++;
+        }
+        bytes += got;
+    }
+}
+
+
+void do_spsc(void)
+{
+    spsc_fifo.Init();
+    spsc_fail_cnt = 0;
+
+    std::thread producer(spsc_producer);
+    std::thread consumer(spsc_consumer);
+    producer.join();
+    consumer.join();
+
+    printf("spsc: %u bytes, %u failed\n", SPSC_BYTES, spsc_fail_cnt);
+    fail_cnt += spsc_fail_cnt;
+}
+
+
+//-------------------------------------------------------
+// timing
+//-------------------------------------------------------
+
+double ns_now(void)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+volatile uint32_t sink; // prevents the compiler from optimizing the loops away
+
+
+void do_timing(uint32_t loops)
+{
+tFifo<char,512> fifo;
+char buf_in[PUT_CHUNK_LEN];
+char buf_out[GET_CHUNK_LEN];
+double t_start;
+uint64_t bytes;
+
+    for (uint16_t i = 0; i < PUT_CHUNK_LEN; i++) buf_in[i] = rand();
+
+    // put a MAVLink frame, get it in chunks of a frame payload, as fifo_link_out is used
+
+    // byte by byte
+    bytes = 0;
+    t_start = ns_now();
+    for (uint32_t l = 0; l < loops; l++) {
+        for (uint16_t i = 0; i < PUT_CHUNK_LEN; i++) fifo.Put(buf_in[i]);
+        while (fifo.Available()) {
+            uint16_t len = 0;
+            while (len < GET_CHUNK_LEN && fifo.Available()) buf_out[len++] = fifo.Get();
+            sink += buf_out[len - 1];
+        }
+        bytes += PUT_CHUNK_LEN;
+    }
+    double t_byte = (ns_now() - t_start) / bytes;
+
+    // bulk
+    bytes = 0;
+    t_start = ns_now();
+    for (uint32_t l = 0; l < loops; l++) {
+        fifo.PutBuf(buf_in, PUT_CHUNK_LEN);
+        uint16_t len;
+        while ((len = fifo.GetBuf(buf_out, GET_CHUNK_LEN))) sink += buf_out[len - 1];
+        bytes += PUT_CHUNK_LEN;
+    }
+    double t_bulk = (ns_now() - t_start) / bytes;
+
+    // spans, data is read in place
+    bytes = 0;
+    t_start = ns_now();
+    for (uint32_t l = 0; l < loops; l++) {
+        char* ptr;
+        uint16_t pos = 0;
+        while (pos < PUT_CHUNK_LEN) {
+            uint16_t len = fifo.WriteSpan(&ptr);
+            if (len > PUT_CHUNK_LEN - pos) len = PUT_CHUNK_LEN - pos;
+            memcpy(ptr, &buf_in[pos], len);
+            fifo.CommitWrite(len);
+            pos += len;
+        }
+        uint16_t len;
+        while ((len = fifo.ReadSpan(&ptr))) {
+            if (len > GET_CHUNK_LEN) len = GET_CHUNK_LEN;
+            sink += ptr[len - 1];
+            fifo.CommitRead(len);
+        }
+        bytes += PUT_CHUNK_LEN;
+    }
+    double t_span = (ns_now() - t_start) / bytes;
+
+    printf("\n");
+    printf("Put()/Get():         %.2f ns/byte\n", t_byte);
+    printf("PutBuf()/GetBuf():   %.2f ns/byte, x%.1f\n", t_bulk, t_byte / t_bulk);
+    printf("spans:               %.2f ns/byte, x%.1f\n", t_span, t_byte / t_span);
+}
+
+
+//-------------------------------------------------------
+// main
+//-------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+uint32_t loops = BENCH_LOOPS_DEFAULT;
+
+    if (argc > 2 && !strcmp(argv[1], "-l")) {
+        loops = atoi(argv[2]);
+        if (!loops) loops = 1;
+    }
+
+    srand(1);
+    do_checks();
+    do_spsc();
+    do_timing(loops);
+
+    return (fail_cnt) ? 1 : 0;
+}
@@ -0,0 +1,220 @@
+#!/usr/bin/env python
+'''
+*******************************************************
+ Copyright (c) MLRS project
+ GPL3
+ https://www.gnu.org/licenses/gpl-3.0.de.html
+ OlliW @ www.olliw.eu
+*******************************************************
+ channels.py
+ rf channel models for the host link simulation
+ a channel model decides for each frame what the receiver gets, i.e. RX_STATUS_VALID,
+ RX_STATUS_CRC1_VALID, RX_STATUS_INVALID, or RX_STATUS_NONE (nothing detected)
+ models can be stacked with CombinedChannel, the worst outcome wins
+ OutageChannel models complete link outages, linksim.py reports the reconnect times for them
+ version 15.10.2026
+********************************************************
+'''
+import random
+import math
+
+
+RX_STATUS_NONE = 0
+RX_STATUS_INVALID = 1
+RX_STATUS_CRC1_VALID = 2
+RX_STATUS_VALID = 3
+
+# the except settings of fhss.h, and the frequency ranges they avoid, as in fhss.cpp
+FHSS_EXCEPT_2P4_GHZ_WIFIBAND_1 = 1
+FHSS_EXCEPT_2P4_GHZ_WIFIBAND_6 = 2
+FHSS_EXCEPT_2P4_GHZ_WIFIBAND_11 = 3
+FHSS_EXCEPT_2P4_GHZ_WIFIBAND_13 = 4
+
+FHSS_EXCEPT_RANGES_KHZ = {
+    FHSS_EXCEPT_2P4_GHZ_WIFIBAND_1:  (2401000, 2423000),
+    FHSS_EXCEPT_2P4_GHZ_WIFIBAND_6:  (2426000, 2448000),
+    FHSS_EXCEPT_2P4_GHZ_WIFIBAND_11: (2451000, 2473000),
+    FHSS_EXCEPT_2P4_GHZ_WIFIBAND_13: (2461000, 2483000),
+}
+
+
+#-------------------------------------------------------
+# channel model interface
+#-------------------------------------------------------
+
+class ChannelModel:
+    # t_us: time the frame is sent
+    # freq_khz: frequency the frame is sent on
+    # direction: 'up' = Tx -> Rx, 'down' = Rx -> Tx
+    def Status(self, t_us, freq_khz, direction):
+        return RX_STATUS_VALID
+
+    # helper, splits a lost frame into crc1 valid and invalid
+    def lost_status(self, rng, crc1_frac):
+        return RX_STATUS_CRC1_VALID if rng.random() < crc1_frac else RX_STATUS_INVALID
+
+
+class PerfectChannel(ChannelModel):
+    pass
+
+
+class IidChannel(ChannelModel):
+    # each frame is lost independently with probability per
+    # a fraction crc1_frac of the lost frames still passes crc1, i.e. is RX_STATUS_CRC1_VALID
+    def __init__(self, per = 0.0, crc1_frac = 0.0, rng = None):
+        self.per = per
+        self.crc1_frac = crc1_frac
+        self.rng = rng if rng else random.Random()
+
+    def Status(self, t_us, freq_khz, direction):
+        if self.rng.random() >= self.per: return RX_STATUS_VALID
+        return self.lost_status(self.rng, self.crc1_frac)
+
+
+class GilbertElliottChannel(ChannelModel):
+    # two-state markov chain, stepped once per frame and direction
+    # good state: loss probability per_good, bad state: loss probability per_bad
+    # mean burst length is 1/p_bg frames, mean fraction of time in bad state is p_gb/(p_gb + p_bg)
+    def __init__(self, p_gb = 0.01, p_bg = 0.2, per_good = 0.0, per_bad = 0.9, crc1_frac = 0.0, rng = None):
+        self.p_gb = p_gb
+        self.p_bg = p_bg
+        self.per_good = per_good
+        self.per_bad = per_bad
+        self.crc1_frac = crc1_frac
+        self.rng = rng if rng else random.Random()
+        self.bad = { 'up': False, 'down': False }
+
+    def Status(self, t_us, freq_khz, direction):
+        if self.bad[direction]:
+            if self.rng.random() < self.p_bg: self.bad[direction] = False
+        else:
+            if self.rng.random() < self.p_gb: self.bad[direction] = True
+        per = self.per_bad if self.bad[direction] else self.per_good
+        if self.rng.random() >= per: return RX_STATUS_VALID
+        return self.lost_status(self.rng, self.crc1_frac)
+
+
+class FrequencyFadingChannel(ChannelModel):
+    # frequency selective fading, as from multipath
+    # each frequency gets a slowly varying rayleigh fade, the fade of neighbouring frequencies
+    # is correlated over coherence_khz, the fade changes with coherence_time_s
+    # a frame is lost if the fade drops below the link margin, with a soft transition
+    def __init__(self, margin_db = 10.0, coherence_khz = 5000, coherence_time_s = 2.0, crc1_frac = 0.3, rng = None):
+        self.margin_db = margin_db
+        self.coherence_khz = coherence_khz
+        self.coherence_time_us = coherence_time_s * 1.0e6
+        self.crc1_frac = crc1_frac
+        self.rng = rng if rng else random.Random()
+        self.taps = {} # per coherence bin: (t_us, i, q)
+
+    def fade_db(self, t_us, freq_khz):
+        bin = int(freq_khz // self.coherence_khz)
+        if bin not in self.taps:
+            self.taps[bin] = (t_us, self.rng.gauss(0, 1), self.rng.gauss(0, 1))
+        t_last, i, q = self.taps[bin]
+        # first order Gauss-Markov process for the complex gain
+        rho = math.exp(-(t_us - t_last) / self.coherence_time_us)
+        s = math.sqrt(max(0.0, 1.0 - rho * rho))
+        i = rho * i + s * self.rng.gauss(0, 1)
+        q = rho * q + s * self.rng.gauss(0, 1)
+        self.taps[bin] = (t_us, i, q)
+        power = 0.5 * (i * i + q * q) # mean 1
+        return 10.0 * math.log10(max(power, 1.0e-9))
+
+    def Status(self, t_us, freq_khz, direction):
+        snr_db = self.margin_db + self.fade_db(t_us, freq_khz)
+        if snr_db > 1.0: return RX_STATUS_VALID
+        if snr_db < -3.0: return self.lost_status(self.rng, self.crc1_frac) if snr_db > -10.0 else RX_STATUS_NONE
+        per = (1.0 - snr_db) / 4.0 # linear in between
+        if self.rng.random() >= per: return RX_STATUS_VALID
+        return self.lost_status(self.rng, self.crc1_frac)
+
+
+class WifiInterferer(ChannelModel):
+    # a WiFi access point on one of the 2.4 GHz channels 1, 6, 11, 13
+    # blocks all frequencies within its 22 MHz wide band, the band edges are the same as those of the
+    # FHSS_EXCEPT_2P4_GHZ_WIFIBAND_x ranges in fhss.cpp, so that the except setting avoids it
+    # duty is the fraction of time the WiFi is on air, frames are hit with this probability
+    def __init__(self, wifi_band = FHSS_EXCEPT_2P4_GHZ_WIFIBAND_6, duty = 0.5, rng = None):
+        self.f_lo, self.f_hi = FHSS_EXCEPT_RANGES_KHZ[wifi_band]
+        self.duty = duty
+        self.rng = rng if rng else random.Random()
+
+    def Status(self, t_us, freq_khz, direction):
+        if freq_khz < self.f_lo or freq_khz > self.f_hi: return RX_STATUS_VALID
+        if self.rng.random() >= self.duty: return RX_STATUS_VALID
+        return RX_STATUS_INVALID
+
+
+class OutageChannel(ChannelModel):
+    # complete loss of the link, as from shadowing, e.g. when the aircraft is behind a building
+    # outages last uniformly 0.5 ... 1.5 times duration_s, and start every 0.5 ... 1.5 times interval_s
+    # the outages are recorded, for the reconnect times
+    def __init__(self, duration_s = 2.0, interval_s = 20.0, rng = None):
+        self.duration_us = duration_s * 1.0e6
+        self.interval_us = interval_s * 1.0e6
+        self.rng = rng if rng else random.Random()
+        self.outages = []
+        self.next_outage()
+
+    def next_outage(self):
+        t_start = self.outages[-1][1] if len(self.outages) else 0.0
+        t_start += self.rng.uniform(0.5, 1.5) * self.interval_us
+        self.outages.append((t_start, t_start + self.rng.uniform(0.5, 1.5) * self.duration_us))
+
+    def Status(self, t_us, freq_khz, direction):
+        if t_us >= self.outages[-1][1]: self.next_outage()
+        if t_us >= self.outages[-1][0]: return RX_STATUS_NONE
+        return RX_STATUS_VALID
+
+
+class CombinedChannel(ChannelModel):
+    def __init__(self, models):
+        self.models = models
+
+    def Status(self, t_us, freq_khz, direction):
+        status = RX_STATUS_VALID
+        for m in self.models:
+            s = m.Status(t_us, freq_khz, direction)
+            if s < status: status = s
+        return status
+
+
+WIFI_BANDS = {
+    '1': FHSS_EXCEPT_2P4_GHZ_WIFIBAND_1,
+    '6': FHSS_EXCEPT_2P4_GHZ_WIFIBAND_6,
+    '11': FHSS_EXCEPT_2P4_GHZ_WIFIBAND_11,
+    '13': FHSS_EXCEPT_2P4_GHZ_WIFIBAND_13,
+}
+
+
+def add_channel_args(parser):
+    parser.add_argument('--per', type = float, default = 0.0, help = 'iid frame error rate')
+    parser.add_argument('--crc1-frac', type = float, default = 0.0, help = 'fraction of lost frames which are crc1 valid')
+    parser.add_argument('--ge', type = float, nargs = 4, metavar = ('P_GB', 'P_BG', 'PER_GOOD', 'PER_BAD'),
+                        help = 'Gilbert-Elliott burst loss')
+    parser.add_argument('--fading', type = float, metavar = 'MARGIN_DB', help = 'per-frequency rayleigh fading with link margin')
+    parser.add_argument('--wifi', choices = list(WIFI_BANDS.keys()), nargs = '*', help = 'WiFi interferer on channels')
+    parser.add_argument('--wifi-duty', type = float, default = 0.5)
+    parser.add_argument('--outage', type = float, nargs = 2, metavar = ('DURATION_S', 'INTERVAL_S'),
+                        help = 'complete link outages, as from shadowing')
+
+
+def channel_from_args(args, rng):
+    models = []
+    if args.per > 0: models.append(IidChannel(args.per, args.crc1_frac, rng))
+    if args.ge: models.append(GilbertElliottChannel(args.ge[0], args.ge[1], args.ge[2], args.ge[3], args.crc1_frac, rng))
+    if args.fading is not None: models.append(FrequencyFadingChannel(args.fading, rng = rng))
+    if args.wifi:
+        for w in args.wifi: models.append(WifiInterferer(WIFI_BANDS[w], args.wifi_duty, rng))
+    if args.outage: models.append(OutageChannel(args.outage[0], args.outage[1], rng))
+    if not len(models): return PerfectChannel()
+    if len(models) == 1: return models[0]
+    return CombinedChannel(models)
+
+
+def outages_of(channel):
+    models = channel.models if isinstance(channel, CombinedChannel) else [channel]
+    for m in models:
+        if isinstance(m, OutageChannel): return m.outages
+    return []
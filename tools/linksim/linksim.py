@@ -0,0 +1,665 @@
+#!/usr/bin/env python
+'''
+*******************************************************
+ Copyright (c) MLRS project
+ GPL3
+ https://www.gnu.org/licenses/gpl-3.0.de.html
+ OlliW @ www.olliw.eu
+*******************************************************
+ linksim.py
+ host simulation of a Tx/Rx link
+ runs the firmware, i.e. the main loops of CommonTx/mlrs-tx.cpp and CommonRx/mlrs-rx.cpp, built for Linux
+ with the host hal of Common/hal/host/ and the sx chip models of Common/host-lib/, and is the air between them
+ - the Tx and the Rx run as two processes on the virtual time of Common/host-lib/host-sim.h, in lockstep, in
+   slices which are shorter than the shortest time over air
+ - the frames they transmit go through the channel models of channels.py
+ - serial data goes into the serial port of the Tx and comes out of the serial port of the Rx, and vice versa
+ - the LQ is taken from the cli "stats" of the Tx, the connect states are reported by the nodes
+ reports serial throughput, latency and LQ per mode
+ with MAVLink traffic also per serial link mode, with message latency and drops, see mavtraffic.py
+ with --traffic mixed the message latency per scheduler class, e.g. compare --link-out fifo and sched
+ with --fhss-adaptive bad fhss channels are swapped for spares, e.g. compare LQ with and without for --wifi 6
+ with --fhss-drop-confirm the confirmations of the map switch are lost, the frames with different maps are reported
+ with --outage the reconnect times are reported, e.g. compare with and without --rx-resync, --rx-listen-rank
+ the features are compile time options, the nodes are built for each set of features, into linksim/build
+ the build needs the submodules, and the fastmavlink library must have been generated, see
+ Common/mavlink/fmav_generate_c_library.py
+ version 15.10.2026
+********************************************************
+'''
+import argparse
+import random
+import collections
+import subprocess
+import struct
+import time
+import os
+
+import channels
+import mavtraffic
+from channels import RX_STATUS_NONE, RX_STATUS_INVALID, RX_STATUS_CRC1_VALID, RX_STATUS_VALID
+
+
+#-------------------------------------------------------
+# constants, as in common_conf.h, frame_types.h, setup_types.h
+#-------------------------------------------------------
+
+CONNECT_STATE_CONNECTED = 2
+
+FRAME_TYPE_TX_RX_CMD = 2
+FRAME_CMD_SET_FHSS = 37
+FRAME_CMD_RX_FHSS = 38
+
+FRAME_TX_CRC1_POS = 13 # sync word 2, status 5, rc data 6
+FRAME_TX_PAYLOAD_POS = 25 # crc1 2, rc data 10
+FRAME_RX_PAYLOAD_POS = 7
+
+BAUDRATES = [9600, 19200, 38400, 57600, 115200, 230400] # SETUP_TX_SERIAL_BAUDRATE, SETUP_RX_SERIAL_BAUDRATE
+
+BANDS = collections.OrderedDict([ # SETUP_FREQUENCY_BAND_ENUM
+    ('2p4', 0),
+    ('915fcc', 1),
+    ('868', 2),
+])
+
+# the devices of Common/hal/host/host-device_conf.h
+DEVICE_OF_BAND = { '2p4': '2400', '915fcc': '900', '868': '900' }
+
+# mode is the MODE_ENUM, band is the default band for the mode
+MODES = collections.OrderedDict([
+    ('50hz',      { 'mode': 0, 'band': '2p4' }),
+    ('31hz',      { 'mode': 1, 'band': '2p4' }),
+    ('19hz',      { 'mode': 2, 'band': '2p4' }),
+    ('flrc111hz', { 'mode': 3, 'band': '2p4' }),
+    ('fsk50hz',   { 'mode': 4, 'band': '915fcc' }),
+])
+
+# the slice must not be longer than the shortest time over air, which is that of the short Rx frame of
+# USE_FEATURE_FRAME_VARLEN, so that a frame is always handed over before the receiver gets to its end
+SLICE_US = {
+    ('50hz', '2400'): 1500,
+    ('31hz', '2400'): 3000,
+    ('19hz', '2400'): 5000,
+    ('flrc111hz', '2400'): 300,
+    ('31hz', '900'): 2500,
+    ('19hz', '900'): 5000,
+    ('fsk50hz', '900'): 1000,
+}
+
+RSSI = -60
+SNR = 10
+
+CLI_STATS_START_US = 500000 # the Tx must be up, the cli is asked for the stats then
+CLI_STATS_RETRY_US = 2000000
+
+
+#-------------------------------------------------------
+# build
+#-------------------------------------------------------
+# as the source filters of platformio.ini
+
+LINKSIM_DIR = os.path.dirname(os.path.abspath(__file__))
+MLRS_DIR = os.path.normpath(os.path.join(LINKSIM_DIR, '..', '..', 'mLRS'))
+BUILD_DIR = os.path.join(LINKSIM_DIR, 'build')
+
+COMMON_SOURCES = [
+    'Common/channel_order.cpp',
+    'Common/common_stats.cpp',
+    'Common/common_types.cpp',
+    'Common/diversity.cpp',
+    'Common/fhss.cpp',
+    'Common/link_types.cpp',
+    'Common/lq_counter.cpp',
+    'Common/libs/filters.cpp',
+    'modules/stm32ll-lib/src/stdstm32.c',
+]
+
+SOURCES = {
+    'tx': ['CommonTx/mlrs-tx.cpp', 'CommonTx/config_id.cpp', 'CommonTx/in.cpp', 'Common/while.cpp'] + COMMON_SOURCES,
+    'rx': ['CommonRx/mlrs-rx.cpp', 'CommonRx/out.cpp'] + COMMON_SOURCES,
+}
+
+SOURCE_DIRS = ['Common', 'CommonTx', 'CommonRx', 'modules']
+
+
+def sources_mtime():
+    t = 0
+    for d in SOURCE_DIRS:
+        for root, dirs, files in os.walk(os.path.join(MLRS_DIR, d)):
+            for f in files:
+                if f.endswith(('.h', '.c', '.cpp')): t = max(t, os.path.getmtime(os.path.join(root, f)))
+    return t
+
+
+# node is 'tx' or 'rx', features are the USE_FEATURE_xxx without the prefix
+# is rebuilt when a source is newer than the binary
+def build_node(node, device, features):
+    features = sorted(set(features))
+    defines = ['HOST_SIM', '%s_HOST_SIM_%s' % (node.upper(), device)] + ['USE_FEATURE_' + f for f in features]
+    out_dir = os.path.join(BUILD_DIR, '-'.join([node, device] + [f.lower() for f in features]))
+    exe = os.path.join(out_dir, 'mlrs-' + node)
+    if os.path.exists(exe) and os.path.getmtime(exe) >= sources_mtime(): return exe
+    os.makedirs(out_dir, exist_ok = True)
+    print('building %s' % os.path.relpath(exe, LINKSIM_DIR))
+    objs = []
+    for src in SOURCES[node]:
+        obj = os.path.join(out_dir, os.path.splitext(os.path.basename(src))[0] + '.o')
+        if src.endswith('.c'):
+            cmd = ['gcc', '-std=gnu11']
+        else:
+            cmd = ['g++', '-std=gnu++17']
+        cmd += ['-O2'] + ['-D' + d for d in defines] + ['-c', os.path.join(MLRS_DIR, src), '-o', obj]
+        subprocess.check_call(cmd)
+        objs.append(obj)
+    subprocess.check_call(['g++'] + objs + ['-o', exe, '-lm'])
+    return exe
+
+
+#-------------------------------------------------------
+# node process
+#-------------------------------------------------------
+# talks the pipe protocol of Common/host-lib/host-sim.h
+
+class Node:
+    def __init__(self, name, exe, args):
+        self.name = name
+        self.proc = subprocess.Popen([exe] + args, stdin = subprocess.PIPE, stdout = subprocess.PIPE,
+                                     universal_newlines = True)
+        self.lines_in = []
+        self.connect_state = 0
+        self.rx_dropped = {}
+        self.Wait() # the node reports D when it first waits, at time 0
+
+    def Frame(self, t_start_us, t_end_us, freq_hz, key, data):
+        self.lines_in.append('F %d %d %d %d %d %d %s' % (t_start_us, t_end_us, freq_hz, key, RSSI, SNR, data.hex()))
+
+    def Serial(self, port, t_us, data):
+        if not len(data): return
+        self.lines_in.append('S %s %d %s' % (port, t_us, data.hex()))
+
+    def Run(self, t_us):
+        self.lines_in.append('G %d' % t_us)
+        self.proc.stdin.write('\n'.join(self.lines_in) + '\n')
+        self.proc.stdin.flush()
+        self.lines_in = []
+
+    def Wait(self):
+        lines = []
+        while True:
+            line = self.proc.stdout.readline()
+            if not line: raise RuntimeError('%s node has quit' % self.name)
+            if line[0] == 'D': return lines
+            lines.append(line.split())
+
+    def Quit(self):
+        self.proc.stdin.write('Q\n')
+        self.proc.stdin.flush()
+        lines = [line.split() for line in self.proc.stdout]
+        self.proc.wait()
+        for l in lines:
+            if l[0] == 'E': self.rx_dropped[l[1]] = int(l[2])
+        return lines
+
+
+#-------------------------------------------------------
+# serial data
+#-------------------------------------------------------
+# the bytes go as records of 8 bytes, which carry the time they were written into the serial port, so that
+# the receiving side can find them in the byte stream, whatever was lost in between
+
+RECORD_LEN = 8
+RECORD_STX1 = 0xA5
+RECORD_STX2 = 0x5A
+
+
+def record_chk(t):
+    b = struct.pack('<I', t)
+    return (sum(b) & 0xFF, b[0] ^ b[1] ^ b[2] ^ b[3])
+
+
+class ByteSource:
+    # writes records with a constant rate
+    def __init__(self, rate_bytes_per_sec):
+        self.rate = rate_bytes_per_sec
+        self.acc = 0.0
+        self.bytes = 0
+
+    def Do(self, t_us, dt_us):
+        self.acc += dt_us * self.rate * 1.0e-6
+        n = int(self.acc // RECORD_LEN)
+        self.acc -= n * RECORD_LEN
+        t = (t_us // 100) & 0xFFFFFFFF # 0.1 ms
+        record = struct.pack('<BBI', RECORD_STX1, RECORD_STX2, t) + bytes(record_chk(t))
+        self.bytes += n * RECORD_LEN
+        return record * n
+
+
+class ByteSink:
+    # latencies are kept as histogram with 0.1 ms bins, from writing the record to getting its last byte
+    def __init__(self, baud):
+        self.byte_us = 10.0e6 / baud
+        self.buf = b''
+        self.bytes = 0
+        self.hist = collections.Counter()
+
+    # the bytes are back-to-back at the baudrate, the first is done at t_us
+    def Put(self, t_us, data):
+        buf = self.buf + data
+        ofs = len(self.buf)
+        i = 0
+        while i + RECORD_LEN <= len(buf):
+            if buf[i] != RECORD_STX1 or buf[i + 1] != RECORD_STX2:
+                i += 1
+                continue
+            t = struct.unpack_from('<I', buf, i + 2)[0]
+            if tuple(buf[i + 6:i + 8]) != record_chk(t):
+                i += 1
+                continue
+            t_done_us = t_us + (i + RECORD_LEN - 1 - ofs) * self.byte_us
+            self.bytes += RECORD_LEN
+            self.hist[int((t_done_us - t * 100) // 100)] += 1
+            i += RECORD_LEN
+        self.buf = buf[i:]
+
+    def percentile_ms(self, p):
+        n_total = sum(self.hist.values())
+        if not n_total: return 0.0
+        limit = p * 0.01 * n_total
+        n = 0
+        for b in sorted(self.hist.keys()):
+            n += self.hist[b]
+            if n >= limit: return b * 0.1
+        return 0.0
+
+
+#-------------------------------------------------------
+# Tx cli stats
+#-------------------------------------------------------
+
+class CliStats:
+    # the lines of the "stats" stream, LQ_serial(LQ_frames),rx LQ_serial, rssi,rx rssi, snr; ...
+    def __init__(self):
+        self.text = ''
+        self.cnt = 0
+
+    def Put(self, data):
+        self.text += data.decode('ascii', 'replace')
+        lines = self.text.split('\n')
+        self.text = lines[-1]
+        stats = []
+        for line in lines[:-1]:
+            try:
+                lq, rest = line.split('(', 1)
+                lq_frames, rest = rest.split('),', 1)
+                lq_rx = rest.split(',', 1)[0]
+                stats.append((int(lq), int(lq_frames), int(lq_rx)))
+            except ValueError:
+                continue
+        self.cnt += len(stats)
+        return stats
+
+
+#-------------------------------------------------------
+# frames
+#-------------------------------------------------------
+
+# too many bytes are hit for USE_FEATURE_FEC to repair them
+# invalid: the crc1 of the Tx frame fails, crc1 valid: only the rest of the Tx frame is hit
+# the Rx frame has no crc1, so it's always hit at its start
+def corrupt_frame(data, status, direction):
+    data = bytearray(data)
+    if status == RX_STATUS_CRC1_VALID and direction == 'up':
+        pos = range(max(FRAME_TX_CRC1_POS + 2, len(data) - 10), len(data) - 2)
+    else:
+        pos = range(FRAME_RX_PAYLOAD_POS, min(FRAME_TX_CRC1_POS + 2, len(data)))
+    for i in pos: data[i] ^= 0xFF
+    return bytes(data)
+
+
+# returns cmd, flags and map of the FRAME_CMD_SET_FHSS, FRAME_CMD_RX_FHSS frames
+def frame_fhss_cmd(data, node):
+    if len(data) < 3 or (data[2] >> 4) != FRAME_TYPE_TX_RX_CMD: return None
+    pos = FRAME_TX_PAYLOAD_POS if node == 'tx' else FRAME_RX_PAYLOAD_POS
+    if len(data) < pos + 10: return None
+    if data[pos] != FRAME_CMD_SET_FHSS and data[pos] != FRAME_CMD_RX_FHSS: return None
+    return data[pos], data[pos + 1], bytes(data[pos + 2:pos + 10])
+
+
+def frame_confirmed(cmd):
+    if cmd is None: return False
+    if cmd[0] == FRAME_CMD_SET_FHSS: return (cmd[1] & 0x80) != 0 # tTxCmdFrameFhss.confirmed
+    return (cmd[1] & 0x01) != 0 # tRxCmdFrameFhss.confirmed
+
+
+#-------------------------------------------------------
+# link
+#-------------------------------------------------------
+
+class Link:
+    # the frames a node transmits in a slice are handed to the other node before the next slice, since the
+    # slice is shorter than the time over air they come in time
+    def __init__(self, tx, rx, slice_us, channel, up_source, up_sink, down_source, down_sink, fhss_drop_confirm = None):
+        self.tx = tx
+        self.rx = rx
+        self.slice_us = slice_us
+        self.channel = channel
+        self.up_source = up_source
+        self.up_sink = up_sink
+        self.down_source = down_source
+        self.down_sink = down_sink
+        self.cli = CliStats()
+        self.t_cli_us = CLI_STATS_START_US
+        self.t_us = 0
+        self.t_connected_us = None
+        self.lq_tx_sum = 0
+        self.lq_rx_sum = 0
+        self.lq_n = 0
+        self.link_up = False
+        self.link_up_changes = [] # (t_us, up), up = both connected
+        self.frames_late = 0
+        self.fhss_drop_confirm = fhss_drop_confirm # 'tx', 'rx', 'both', drops the fhss frames with the confirmed flag
+        self.fhss_dropped = 0
+        self.fhss_switches = 0
+        self.fhss_mismatch = 0 # Rx frames on another frequency than the Tx frame of the slot
+        self.fhss_last_map = None
+        self.tx_freq_hz = None
+
+    def frame(self, node, l, t_slice_end_us):
+        t_start_us, t_end_us, freq_hz, key = int(l[1]), int(l[2]), int(l[3]), int(l[4])
+        data = bytes.fromhex(l[5]) if len(l) > 5 else b''
+        if t_end_us < t_slice_end_us:
+            self.frames_late += 1
+            return
+        direction = 'up' if node is self.tx else 'down'
+        cmd = frame_fhss_cmd(data, 'tx' if node is self.tx else 'rx')
+        if node is self.tx:
+            self.tx_freq_hz = freq_hz
+            if frame_confirmed(cmd):
+                if cmd[2] != self.fhss_last_map: self.fhss_switches += 1
+                self.fhss_last_map = cmd[2]
+        elif self.link_up and self.tx_freq_hz is not None and freq_hz != self.tx_freq_hz:
+            self.fhss_mismatch += 1
+        status = self.channel.Status(t_start_us, freq_hz * 1.0e-3, direction)
+        if frame_confirmed(cmd) and self.fhss_drop_confirm in (('tx', 'both') if node is self.tx else ('rx', 'both')):
+            self.fhss_dropped += 1
+            status = RX_STATUS_NONE
+        if status == RX_STATUS_NONE: return
+        if status != RX_STATUS_VALID: data = corrupt_frame(data, status, direction)
+        other = self.rx if node is self.tx else self.tx
+        other.Frame(t_start_us, t_end_us, freq_hz, key, data)
+
+    def serial(self, node, l):
+        port, t_us, data = l[1], int(l[2]), bytes.fromhex(l[3]) if len(l) > 3 else b''
+        if node is self.rx and port == 'b':
+            self.up_sink.Put(t_us, data)
+        elif node is self.tx and port == 'b':
+            self.down_sink.Put(t_us, data)
+        elif node is self.tx and port == 'c':
+            for lq, lq_frames, lq_rx in self.cli.Put(data):
+                if not self.link_up: continue
+                self.lq_tx_sum += lq
+                self.lq_rx_sum += lq_rx
+                self.lq_n += 1
+
+    def connect(self, node, l):
+        node.connect_state = int(l[2])
+        up = (self.tx.connect_state == CONNECT_STATE_CONNECTED and self.rx.connect_state == CONNECT_STATE_CONNECTED)
+        if up == self.link_up: return
+        t_us = int(l[1])
+        self.link_up = up
+        self.link_up_changes.append((t_us, up))
+        if up and self.t_connected_us is None: self.t_connected_us = t_us
+
+    def Run(self, seconds):
+        t_end_us = self.t_us + int(seconds * 1.0e6)
+        while self.t_us < t_end_us:
+            t_next_us = min(self.t_us + self.slice_us, t_end_us)
+            dt_us = t_next_us - self.t_us
+            self.tx.Serial('b', self.t_us, self.up_source.Do(self.t_us, dt_us))
+            self.rx.Serial('b', self.t_us, self.down_source.Do(self.t_us, dt_us))
+            if not self.cli.cnt and self.t_us >= self.t_cli_us:
+                self.tx.Serial('c', self.t_us, b'stats\r')
+                self.t_cli_us += CLI_STATS_RETRY_US
+            self.tx.Run(t_next_us)
+            self.rx.Run(t_next_us)
+            for node in (self.tx, self.rx):
+                for l in node.Wait():
+                    if l[0] == 'T': self.frame(node, l, t_next_us)
+                    elif l[0] == 'S': self.serial(node, l)
+                    elif l[0] == 'C': self.connect(node, l)
+            self.t_us = t_next_us
+
+    def Quit(self):
+        for node in (self.tx, self.rx):
+            for l in node.Quit():
+                if l[0] == 'S': self.serial(node, l)
+
+
+#-------------------------------------------------------
+# report
+#-------------------------------------------------------
+
+# for each outage which disconnected the link, the time from the end of the outage until both are connected again
+def reconnect_times_ms(link_up_changes, outages):
+    res = []
+    for t_start, t_end in outages:
+        t_down = None
+        for t, up in link_up_changes:
+            if t < t_start: continue
+            if t > t_end: break
+            if not up: t_down = t
+        if t_down is None: continue
+        for t, up in link_up_changes:
+            if t > t_end and up:
+                res.append((t - t_end) * 1.0e-3)
+                break
+    return sorted(res)
+
+
+def percentile(values, p):
+    if not len(values): return 0.0
+    return values[min(len(values) - 1, int(p * 0.01 * len(values)))]
+
+
+def features_from_args(args):
+    features = list(args.feature) if args.feature else []
+    if args.arq == 'sr': features.append('ARQ_SELECTIVE_REPEAT')
+    if args.arq_retry_auto: features.append('ARQ_RETRY_AUTO')
+    if args.link_out == 'sched': features += ['MAVLINK_SCHEDULER', 'SCHED_STATS']
+    if args.fhss_adaptive: features.append('FHSS_ADAPTIVE')
+    if args.rx_resync: features.append('RX_RESYNC')
+    if args.rx_listen_rank: features.append('RX_LISTEN_RANK')
+    return features
+
+
+def make_traffic(args, rng):
+    if args.traffic == 'bytes':
+        # 0 = saturate, the source then writes at the baudrate
+        up_source = ByteSource(args.rate_up if args.rate_up > 0 else args.tx_baud / 10)
+        down_source = ByteSource(args.rate_down if args.rate_down > 0 else args.rx_baud / 10)
+        return up_source, ByteSink(args.rx_baud), down_source, ByteSink(args.tx_baud), None
+    autopilot = mavtraffic.AutopilotHandler()
+    gcs = mavtraffic.GcsHandler()
+    up_sink = mavtraffic.MessageSink(args.rx_baud, autopilot)
+    down_sink = mavtraffic.MessageSink(args.tx_baud, gcs)
+    up_source = mavtraffic.gcs_source(rng, args.traffic, args.tx_baud, up_sink)
+    down_source = mavtraffic.autopilot_source(rng, args.traffic, args.rate_down, args.rx_baud, down_sink)
+    autopilot.source = down_source
+    return up_source, up_sink, down_source, down_sink, gcs
+
+
+def run_mode(name, args, slm = 'transparent'):
+    band = args.band if args.band else MODES[name]['band']
+    device = DEVICE_OF_BAND[band]
+    if (name, device) not in SLICE_US: raise ValueError('mode %s is not available for band %s' % (name, band))
+    rng = random.Random(args.seed)
+    channel = channels.channel_from_args(args, rng)
+    tx_baud = BAUDRATES.index(args.tx_baud)
+    rx_baud = BAUDRATES.index(args.rx_baud)
+    node_args = ['--bindphrase', args.bindphrase, '--band', str(BANDS[band]), '--mode', str(MODES[name]['mode']),
+                 '--ortho', str(args.ortho), '--serial-link-mode', str(mavtraffic.SERIAL_LINK_MODES[slm]), '--tx-baud', str(tx_baud), '--rx-baud', str(rx_baud)]
+    features = features_from_args(args)
+    tx = Node('tx', build_node('tx', device, features), node_args)
+    rx = Node('rx', build_node('rx', device, features), node_args + ['--ppm', str(args.rx_ppm)])
+
+    up_source, up_sink, down_source, down_sink, gcs = make_traffic(args, rng)
+    link = Link(tx, rx, SLICE_US[(name, device)], channel, up_source, up_sink, down_source, down_sink,
+                args.fhss_drop_confirm)
+    link.Run(args.seconds)
+    link.Quit()
+    if link.frames_late: print('warning: %d frames were too short for the slice of %d us' % (link.frames_late, link.slice_us))
+
+    t_conn_s = link.t_connected_us * 1.0e-6 if link.t_connected_us is not None else 0.0
+    t_run_s = args.seconds - t_conn_s
+    if t_run_s <= 0: t_run_s = args.seconds
+    # the bytes which the serial ports dropped since they were full didn't get into the link
+    up_in = up_source.bytes - tx.rx_dropped.get('b', 0)
+    down_in = down_source.bytes - rx.rx_dropped.get('b', 0)
+    r = {
+        'mode': name,
+        'connect_s': t_conn_s,
+        'up_Bps': up_sink.bytes / t_run_s,
+        'up_p50_ms': up_sink.percentile_ms(50),
+        'up_p99_ms': up_sink.percentile_ms(99),
+        'up_loss': 100.0 * (1.0 - up_sink.bytes / up_in) if up_in > 0 else 0.0,
+        'down_Bps': down_sink.bytes / t_run_s,
+        'down_p50_ms': down_sink.percentile_ms(50),
+        'down_p99_ms': down_sink.percentile_ms(99),
+        'down_loss': 100.0 * (1.0 - down_sink.bytes / down_in) if down_in > 0 else 0.0,
+        'lq_tx': link.lq_tx_sum / link.lq_n if link.lq_n else 0,
+        'lq_rx': link.lq_rx_sum / link.lq_n if link.lq_n else 0,
+    }
+    reconnect = reconnect_times_ms(link.link_up_changes, channels.outages_of(channel))
+    r['reconnects'] = len(reconnect)
+    r['reconnect_p50_ms'] = percentile(reconnect, 50)
+    r['reconnect_p90_ms'] = percentile(reconnect, 90)
+    r['reconnect_p99_ms'] = percentile(reconnect, 99)
+    r['reconnect_max_ms'] = reconnect[-1] if len(reconnect) else 0.0
+    r['fhss_switches'] = link.fhss_switches
+    r['fhss_dropped'] = link.fhss_dropped
+    r['fhss_mismatch'] = link.fhss_mismatch
+    if args.traffic == 'bytes': return r
+    # messages which are not delivered when a later one of their msgid is are dropped, this includes
+    # those lost in the serial ports and those coalesced by the scheduler
+    r['slm'] = slm
+    r['up_loss'] = 100.0 * up_sink.dropped / (up_sink.msgs + up_sink.dropped) if up_sink.msgs + up_sink.dropped else 0.0
+    r['down_loss'] = 100.0 * down_sink.dropped / (down_sink.msgs + down_sink.dropped) if down_sink.msgs + down_sink.dropped else 0.0
+    r['up_msgs'] = up_sink.msgs / t_run_s
+    r['down_msgs'] = down_sink.msgs / t_run_s
+    r['down_class'] = [(down_sink.msgs_class[c] / t_run_s, down_sink.percentile_ms(50, c), down_sink.percentile_ms(99, c))
+                       for c in range(len(mavtraffic.SCHED_CLASS_NAMES))]
+    r['down_coalesced'] = gcs.sched[0] / t_run_s if gcs.sched else 0.0
+    r['down_coalesced_Bps'] = gcs.sched[1] / t_run_s if gcs.sched else 0.0
+    return r
+
+
+# loss % are the bytes which got into the serial port of the sender but never came out at the receiver
+def print_report(results):
+    print('mode       connect   up B/s  p50 ms  p99 ms  loss %   down B/s  p50 ms  p99 ms  loss %   LQ tx  LQ rx')
+    for r in results:
+        print('%-10s %6.2f s  %7.0f  %6.1f  %6.1f  %6.2f   %8.0f  %6.1f  %6.1f  %6.2f   %5.1f  %5.1f' % (
+              r['mode'], r['connect_s'],
+              r['up_Bps'], r['up_p50_ms'], r['up_p99_ms'], r['up_loss'],
+              r['down_Bps'], r['down_p50_ms'], r['down_p99_ms'], r['down_loss'],
+              r['lq_tx'], r['lq_rx']))
+
+
+# for message traffic, B/s is the goodput in MAVLink frame bytes, latency is per message, from the serial port
+# of the sender to the serial port of the receiver, and drop % are the messages which were not delivered
+def print_report_msgs(results):
+    print('mode       link mode    connect  up msg/s  B/s  p50 ms  p99 ms  drop %   down msg/s   B/s  p50 ms  p99 ms  drop %   LQ tx  LQ rx')
+    for r in results:
+        print('%-10s %-11s %6.2f s  %8.1f %4.0f  %6.1f  %6.1f  %6.2f   %10.1f %5.0f  %6.1f  %6.1f  %6.2f   %5.1f  %5.1f' % (
+              r['mode'], r['slm'], r['connect_s'],
+              r['up_msgs'], r['up_Bps'], r['up_p50_ms'], r['up_p99_ms'], r['up_loss'],
+              r['down_msgs'], r['down_Bps'], r['down_p50_ms'], r['down_p99_ms'], r['down_loss'],
+              r['lq_tx'], r['lq_rx']))
+
+
+# downlink message latency per scheduler class, as for print_report_msgs(), also with --link-out fifo, to compare
+# coalesced are the nav messages which the Rx replaced by a newer one while queued, B/s is the airtime saved by it,
+# as reported by the Rx in its DEBUG_FLOAT_ARRAY "MLRS_SCHED", so only with --link-out sched and mavlinkx
+def print_report_classes(results, link_out):
+    print('downlink per class, link out %s' % link_out)
+    print('mode       link mode  ' + ''.join('  %-7s msg/s  p50 ms  p99 ms' % n for n in mavtraffic.SCHED_CLASS_NAMES) +
+          '  coalesced msg/s  B/s')
+    for r in results:
+        print('%-10s %-10s ' % (r['mode'], r['slm']) +
+              ''.join('  %13.1f  %6.1f  %6.1f' % rc for rc in r['down_class']) +
+              '  %15.1f %4.0f' % (r['down_coalesced'], r['down_coalesced_Bps']))
+
+
+# time from the end of an outage until both are connected again, for the outages which disconnected the link
+def print_report_reconnect(results):
+    print('reconnect after outage')
+    print('mode       outages  p50 ms  p90 ms  p99 ms  max ms')
+    for r in results:
+        print('%-10s %7d  %6.0f  %6.0f  %6.0f  %6.0f' % (
+              r['mode'], r['reconnects'], r['reconnect_p50_ms'], r['reconnect_p90_ms'], r['reconnect_p99_ms'], r['reconnect_max_ms']))
+
+
+# map switches of the Tx, the dropped confirmations, and the Rx frames which went on another frequency than the
+# Tx frame of the slot, i.e. Tx and Rx had different maps
+def print_report_fhss(results):
+    print('adaptive fhss')
+    print('mode       switches  dropped  mismatch')
+    for r in results:
+        print('%-10s %8d  %7d  %8d' % (r['mode'], r['fhss_switches'], r['fhss_dropped'], r['fhss_mismatch']))
+
+
+def main():
+    parser = argparse.ArgumentParser(description = 'mLRS host link simulation')
+    parser.add_argument('--mode', default = 'all', choices = ['all'] + list(MODES.keys()))
+    parser.add_argument('--seconds', type = float, default = 60.0, help = 'simulated time per mode')
+    parser.add_argument('--hours', type = float, default = 0.0, help = 'simulated time per mode, overrides --seconds')
+    parser.add_argument('--rate-up', type = float, default = 0, help = 'Tx serial input in bytes/s, 0 = saturate')
+    parser.add_argument('--rate-down', type = float, default = 0, help = 'Rx serial input in bytes/s, 0 = saturate')
+    parser.add_argument('--traffic', default = 'bytes', choices = ['bytes', 'telemetry', 'params', 'log', 'mixed'],
+                        help = 'bytes = plain byte stream, else MAVLink messages, for params, log, mixed --rate-down sets the bulk rate')
+    parser.add_argument('--serial-link-mode', default = 'all', choices = ['all'] + list(mavtraffic.SERIAL_LINK_MODES.keys()),
+                        help = 'serial link mode for MAVLink traffic')
+    parser.add_argument('--link-out', default = 'fifo', choices = ['sched', 'fifo'],
+                        help = 'link out queue, sched = USE_FEATURE_MAVLINK_SCHEDULER, with USE_FEATURE_SCHED_STATS, fifo = without')
+    parser.add_argument('--tx-baud', type = int, default = 115200, choices = BAUDRATES, help = 'Tx serial baudrate')
+    parser.add_argument('--rx-baud', type = int, default = 57600, choices = BAUDRATES, help = 'Rx serial baudrate')
+    parser.add_argument('--band', choices = list(BANDS.keys()), help = 'frequency band, default depends on mode')
+    parser.add_argument('--bindphrase', default = 'mlrs.0')
+    parser.add_argument('--ortho', type = int, default = 0, choices = [0, 1, 2, 3])
+    channels.add_channel_args(parser)
+    parser.add_argument('--arq', default = 'sw', choices = ['sw', 'sr'],
+                        help = 'sw = stop-and-wait, sr = selective repeat, USE_FEATURE_ARQ_SELECTIVE_REPEAT')
+    parser.add_argument('--arq-retry-auto', action = 'store_true', help = 'Rx chooses the ARQ retry count, USE_FEATURE_ARQ_RETRY_AUTO')
+    parser.add_argument('--fhss-adaptive', action = 'store_true', help = 'swap bad fhss channels for spares, USE_FEATURE_FHSS_ADAPTIVE')
+    parser.add_argument('--fhss-drop-confirm', choices = ['tx', 'rx', 'both'],
+                        help = 'drops the fhss sync frames with the confirmed flag, tx = the Tx\' confirmations, rx = the Rx\' reports of it')
+    parser.add_argument('--rx-listen-rank', action = 'store_true', help = 'Rx listens on the best ranked slots first, USE_FEATURE_RX_LISTEN_RANK')
+    parser.add_argument('--rx-resync', action = 'store_true', help = 'Rx keeps hopping after a disconnect, USE_FEATURE_RX_RESYNC')
+    parser.add_argument('--feature', action = 'append', metavar = 'NAME',
+                        help = 'builds with USE_FEATURE_NAME, e.g. --feature FRAME_VARLEN --feature FEC')
+    parser.add_argument('--rx-ppm', type = float, default = 0.0, help = 'clock error of the Rx crystal')
+    parser.add_argument('--seed', type = int, default = 1)
+    args = parser.parse_args()
+    if args.hours > 0: args.seconds = args.hours * 3600.0
+
+    names = list(MODES.keys()) if args.mode == 'all' else [args.mode]
+    if args.band:
+        names = [name for name in names if (name, DEVICE_OF_BAND[args.band]) in SLICE_US]
+    t_start = time.time()
+    if args.traffic == 'bytes':
+        results = [run_mode(name, args) for name in names]
+        print_report(results)
+    else:
+        slms = list(mavtraffic.SERIAL_LINK_MODES.keys()) if args.serial_link_mode == 'all' else [args.serial_link_mode]
+        results = [run_mode(name, args, slm) for name in names for slm in slms]
+        print_report_msgs(results)
+        if args.traffic == 'mixed': print_report_classes(results, args.link_out)
+        names = [(name, slm) for name in names for slm in slms]
+    if args.outage: print_report_reconnect(results)
+    if args.fhss_adaptive: print_report_fhss(results)
+    t_wall = time.time() - t_start
+    print('simulated %.0f s in %.1f s wall time (x%.0f)' % (args.seconds * len(names), t_wall,
+          args.seconds * len(names) / t_wall if t_wall > 0 else 0))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,357 @@
+#!/usr/bin/env python
+'''
+*******************************************************
+ Copyright (c) MLRS project
+ GPL3
+ https://www.gnu.org/licenses/gpl-3.0.de.html
+ OlliW @ www.olliw.eu
+*******************************************************
+ mavtraffic.py
+ MAVLink message traffic for the host link simulation
+ the GCS and the autopilot write MAVLink v2 frames into the serial ports of the nodes, and parse what comes
+ out of them, the nodes handle them with their tTxMavlink, tRxMavlink, i.e. as set by the serial link mode
+ - a message is tracked by its msgid, seq, sysid, compid and checksum, from the time its last byte went into
+   the serial port until its last byte came out of the other serial port
+ - the messages of one msgid are never reordered, so a message which isn't delivered when a later one of
+   its msgid is, is dropped, the messages which are not delivered at the end are in flight and don't count
+ - the messages which the nodes generate themselves, like RADIO_STATUS, are not tracked
+ - the autopilot reacts to the RADIO_STATUS of the Rx as ArduPilot does, the streams slow down with a low
+   txbuf, and bulk transfers are paused with txbuf <= 50
+ version 15.10.2026
+********************************************************
+'''
+import struct
+import collections
+
+
+SERIAL_LINK_MODES = collections.OrderedDict([ # SERIAL_LINK_MODE_ENUM
+    ('transparent', 0),
+    ('mavlink', 1),
+    ('mavlinkx', 2),
+])
+
+MAVLINK_STX_V2 = 0xFD
+MAVLINK_HEADER_LEN = 10
+MAVLINK_CHECKSUM_LEN = 2
+MAVLINK_SIGNATURE_LEN = 13
+MAVLINK_IFLAG_SIGNED = 0x01
+
+MSGID_HEARTBEAT = 0
+MSGID_SYS_STATUS = 1
+MSGID_PARAM_VALUE = 22
+MSGID_GPS_RAW_INT = 24
+MSGID_ATTITUDE = 30
+MSGID_GLOBAL_POSITION_INT = 33
+MSGID_RC_CHANNELS = 65
+MSGID_RC_CHANNELS_OVERRIDE = 70
+MSGID_VFR_HUD = 74
+MSGID_COMMAND_ACK = 77
+MSGID_RADIO_STATUS = 109
+MSGID_LOG_DATA = 120
+MSGID_AUTOPILOT_VERSION = 148
+MSGID_PROTOCOL_VERSION = 300
+MSGID_DEBUG_FLOAT_ARRAY = 350
+
+# the messages of the traffic, and those the nodes generate, others are not parsed
+CRC_EXTRA = {
+    MSGID_HEARTBEAT: 50,
+    MSGID_SYS_STATUS: 124,
+    MSGID_PARAM_VALUE: 220,
+    MSGID_GPS_RAW_INT: 24,
+    MSGID_ATTITUDE: 39,
+    MSGID_GLOBAL_POSITION_INT: 104,
+    MSGID_RC_CHANNELS: 118,
+    MSGID_RC_CHANNELS_OVERRIDE: 124,
+    MSGID_VFR_HUD: 20,
+    MSGID_COMMAND_ACK: 143,
+    MSGID_RADIO_STATUS: 185,
+    MSGID_LOG_DATA: 134,
+    MSGID_AUTOPILOT_VERSION: 178,
+    MSGID_PROTOCOL_VERSION: 217,
+    MSGID_DEBUG_FLOAT_ARRAY: 232,
+}
+
+GCS_SYSID, GCS_COMPID = 255, 190
+AUTOPILOT_SYSID, AUTOPILOT_COMPID = 1, 1
+
+# the classes of mavlink_sched_policy[] of Common/mavlink_scheduler.h, for the messages of the traffic
+SCHED_CLASS_NAMES = ['control', 'nav', 'bulk']
+SCHED_CLASS = {
+    MSGID_HEARTBEAT: 0,
+    MSGID_COMMAND_ACK: 0,
+    MSGID_SYS_STATUS: 1,
+    MSGID_GPS_RAW_INT: 1,
+    MSGID_ATTITUDE: 1,
+    MSGID_GLOBAL_POSITION_INT: 1,
+    MSGID_RC_CHANNELS: 1,
+    MSGID_VFR_HUD: 1,
+}
+
+
+def sched_class(msgid):
+    return SCHED_CLASS.get(msgid, 2)
+
+
+#-------------------------------------------------------
+# frames
+#-------------------------------------------------------
+
+def crc_x25(data, crc = 0xFFFF):
+    for c in data:
+        tmp = (c ^ crc) & 0xFF
+        tmp = (tmp ^ (tmp << 4)) & 0xFF
+        crc = ((crc >> 8) ^ (tmp << 8) ^ (tmp << 3) ^ (tmp >> 4)) & 0xFFFF
+    return crc
+
+
+def mavlink_frame(seq, sysid, compid, msgid, payload):
+    # v2 trailing zero truncation
+    n = len(payload)
+    while n > 1 and payload[n - 1] == 0: n -= 1
+    frame = struct.pack('<BBBBBBBHB', MAVLINK_STX_V2, n, 0, 0, seq, sysid, compid, msgid & 0xFFFF, msgid >> 16) + payload[:n]
+    crc = crc_x25(bytes([CRC_EXTRA[msgid]]), crc_x25(frame[1:]))
+    return frame + struct.pack('<H', crc)
+
+
+def payload_telemetry(rng, n):
+    # byte distribution as observed in the comments of mavlinkx.h, ca 25% 0, ca 4% 255, 10% 1..16
+    p = bytearray(n)
+    for i in range(n):
+        r = rng.random()
+        if r < 0.25: p[i] = 0
+        elif r < 0.29: p[i] = 255
+        elif r < 0.39: p[i] = rng.randrange(1, 17)
+        else: p[i] = rng.randrange(256)
+    return bytes(p)
+
+
+def payload_param_value(rng, index, count):
+    # PARAM_VALUE: float param_value, uint16 param_count, uint16 param_index, char[16] param_id, uint8 param_type
+    name = ''.join(rng.choice('ABCDEFGHIJKLMNOPQRSTUVWXYZ_') for _ in range(rng.randrange(5, 16)))
+    value = rng.choice([0.0, 1.0, float(rng.randrange(0, 1000)), rng.uniform(-10.0, 10.0)])
+    return struct.pack('<fHH16sB', value, count, index, name.encode('ascii'), 9) # MAV_PARAM_TYPE_REAL32
+
+
+def payload_log_data(rng, ofs, log_id):
+    # LOG_DATA: uint32 ofs, uint16 id, uint8 count, uint8[90] data, data is dataflash log, i.e. high entropy
+    data = bytes(rng.randrange(256) for _ in range(90))
+    return struct.pack('<IHB', ofs, log_id, 90) + data
+
+
+#-------------------------------------------------------
+# traffic sources
+#-------------------------------------------------------
+
+class MessageSource:
+    # streams: list of (msgid, period_us, payload function)
+    # bulk: payload function for a bulk transfer, which is sent at rate bytes/s, or saturating
+    # saturating means that the bulk keeps the serial line busy, as long as the RADIO_STATUS allows it
+    # the bytes go into the serial port at the baudrate, the sink is told when each message is completely in
+    def __init__(self, rng, sysid, compid, baud, sink, streams = None, bulk = None, bulk_msgid = 0, rate = 0):
+        self.rng = rng
+        self.sysid = sysid
+        self.compid = compid
+        self.byte_us = 10.0e6 / baud
+        self.sink = sink
+        self.streams = [[msgid, period_us, f, 0] for msgid, period_us, f in (streams if streams else [])]
+        self.bulk = bulk
+        self.bulk_msgid = bulk_msgid
+        self.rate = rate
+        self.bulk_cnt = 0
+        self.acc = 0.0
+        self.seq = 0
+        self.t_line_us = 0.0 # when the last byte written is in
+        self.bytes = 0
+        self.stream_slowdown_ms = 0
+        self.last_txbuf = 100
+
+    def put(self, msgid, payload, t_us):
+        frame = mavlink_frame(self.seq, self.sysid, self.compid, msgid, payload)
+        self.seq = (self.seq + 1) & 0xFF
+        self.t_line_us = max(self.t_line_us, t_us) + len(frame) * self.byte_us
+        self.sink.Sent(frame, self.t_line_us)
+        self.bytes += len(frame)
+        return frame
+
+    def Do(self, t_us, dt_us):
+        out = b''
+        for s in self.streams:
+            while s[3] <= t_us:
+                out += self.put(s[0], s[2](self.rng), t_us)
+                s[3] += s[1] + self.stream_slowdown_ms * 1000
+        if self.bulk is None: return out
+        if self.rate > 0:
+            self.acc += dt_us * self.rate * 1.0e-6
+        while True:
+            if self.rate > 0:
+                if self.acc <= 0: break
+            elif self.last_txbuf <= 50 or self.t_line_us >= t_us + dt_us:
+                break
+            frame = self.put(self.bulk_msgid, self.bulk(self.rng, self.bulk_cnt), t_us)
+            out += frame
+            self.bulk_cnt += 1
+            self.acc -= len(frame)
+        return out
+
+    # handle_radio_status() of ArduPilot's GCS_Common.cpp
+    def RadioStatus(self, txbuf):
+        self.last_txbuf = txbuf
+        if txbuf < 20 and self.stream_slowdown_ms < 2000:
+            self.stream_slowdown_ms += 60
+        elif txbuf < 50 and self.stream_slowdown_ms < 2000:
+            self.stream_slowdown_ms += 20
+        elif txbuf > 95 and self.stream_slowdown_ms > 10:
+            self.stream_slowdown_ms -= 40
+        elif txbuf > 90 and self.stream_slowdown_ms != 0:
+            self.stream_slowdown_ms -= 20
+
+
+def gcs_source(rng, traffic, baud, sink):
+    # the GCS sends its heartbeat, bulk transfers are all downlink
+    heartbeat = (MSGID_HEARTBEAT, 1000000, lambda rng: bytes([0, 0, 0, 0, 6, 8, 0, 0, 3]))
+    return MessageSource(rng, GCS_SYSID, GCS_COMPID, baud, sink, streams = [heartbeat])
+
+
+def autopilot_source(rng, traffic, rate, baud, sink):
+    # telemetry streams are those of ArduPilot's default SRx rates
+    streams = [
+        (MSGID_HEARTBEAT,           1000000, lambda rng: bytes([0, 0, 0, 0, 2, 3, 81, 4, 3])),
+        (MSGID_SYS_STATUS,          500000,  lambda rng: payload_telemetry(rng, 31)),
+        (MSGID_GPS_RAW_INT,         500000,  lambda rng: payload_telemetry(rng, 30)),
+        (MSGID_ATTITUDE,            100000,  lambda rng: payload_telemetry(rng, 28)),
+        (MSGID_GLOBAL_POSITION_INT, 200000,  lambda rng: payload_telemetry(rng, 28)),
+        (MSGID_RC_CHANNELS,         500000,  lambda rng: payload_telemetry(rng, 42)),
+        (MSGID_VFR_HUD,             200000,  lambda rng: payload_telemetry(rng, 20)),
+    ]
+    count = 1000
+    params = lambda rng, n: payload_param_value(rng, n % count, count)
+    if traffic == 'telemetry':
+        return MessageSource(rng, AUTOPILOT_SYSID, AUTOPILOT_COMPID, baud, sink, streams = streams)
+    if traffic == 'params':
+        return MessageSource(rng, AUTOPILOT_SYSID, AUTOPILOT_COMPID, baud, sink, streams = streams[:1],
+                             bulk = params, bulk_msgid = MSGID_PARAM_VALUE, rate = rate)
+    if traffic == 'log':
+        return MessageSource(rng, AUTOPILOT_SYSID, AUTOPILOT_COMPID, baud, sink, streams = streams[:1],
+                             bulk = lambda rng, n: payload_log_data(rng, 90 * n, 1), bulk_msgid = MSGID_LOG_DATA, rate = rate)
+    if traffic == 'mixed':
+        # all telemetry, a parameter download, and a COMMAND_ACK each second, as for a GCS which sends commands
+        ack = (MSGID_COMMAND_ACK, 1000000, lambda rng: bytes([rng.randrange(256), rng.randrange(2), 0]))
+        return MessageSource(rng, AUTOPILOT_SYSID, AUTOPILOT_COMPID, baud, sink, streams = streams + [ack],
+                             bulk = params, bulk_msgid = MSGID_PARAM_VALUE, rate = rate)
+    raise ValueError('unknown traffic ' + traffic)
+
+
+#-------------------------------------------------------
+# traffic sinks
+#-------------------------------------------------------
+
+def hist_percentile_ms(hist, p):
+    n_total = sum(hist.values())
+    if not n_total: return 0.0
+    limit = p * 0.01 * n_total
+    n = 0
+    for b in sorted(hist.keys()):
+        n += hist[b]
+        if n >= limit: return b * 0.1
+    return 0.0
+
+
+def frame_key(frame, payload_len):
+    # seq, sysid, compid, checksum
+    return bytes(frame[4:7]) + bytes(frame[MAVLINK_HEADER_LEN + payload_len:MAVLINK_HEADER_LEN + payload_len + 2])
+
+
+class MessageSink:
+    # the parser of the GCS or the autopilot, latencies are kept as histogram with 0.1 ms bins
+    # handler is called with msgid, payload for each message, tracked or not
+    def __init__(self, baud, handler = None):
+        self.byte_us = 10.0e6 / baud
+        self.handler = handler
+        self.buf = b''
+        self.pending = {} # msgid -> deque of (key, t_us, sched class)
+        self.msgs = 0
+        self.bytes = 0 # MAVLink frame bytes of the delivered messages
+        self.dropped = 0
+        self.hist = collections.Counter()
+        self.hist_class = [collections.Counter() for _ in SCHED_CLASS_NAMES]
+        self.msgs_class = [0 for _ in SCHED_CLASS_NAMES]
+
+    def Sent(self, frame, t_us):
+        msgid = frame[7] | (frame[8] << 8) | (frame[9] << 16)
+        key = frame_key(frame, frame[1])
+        self.pending.setdefault(msgid, collections.deque()).append((key, t_us, len(frame)))
+
+    def received(self, t_us, msgid, key):
+        q = self.pending.get(msgid)
+        if not q: return
+        for i, p in enumerate(q):
+            if p[0] == key: break
+        else:
+            return # not ours
+        for _ in range(i): q.popleft()
+        self.dropped += i
+        key, t_sent_us, frame_len = q.popleft()
+        self.msgs += 1
+        self.bytes += frame_len
+        b = int((t_us - t_sent_us) // 100)
+        self.hist[b] += 1
+        self.hist_class[sched_class(msgid)][b] += 1
+        self.msgs_class[sched_class(msgid)] += 1
+
+    # the bytes are back-to-back at the baudrate, the first is done at t_us
+    # a frame with bad checksum is skipped by its first byte only, as the parser hunts for the next stx
+    def Put(self, t_us, data):
+        buf = self.buf + data
+        ofs = len(self.buf)
+        i = 0
+        while i < len(buf):
+            if buf[i] != MAVLINK_STX_V2:
+                i += 1
+                continue
+            if i + MAVLINK_HEADER_LEN > len(buf): break
+            payload_len = buf[i + 1]
+            frame_len = MAVLINK_HEADER_LEN + payload_len + MAVLINK_CHECKSUM_LEN
+            if buf[i + 2] & MAVLINK_IFLAG_SIGNED: frame_len += MAVLINK_SIGNATURE_LEN
+            msgid = buf[i + 7] | (buf[i + 8] << 8) | (buf[i + 9] << 16)
+            if msgid not in CRC_EXTRA:
+                i += 1
+                continue
+            if i + frame_len > len(buf): break
+            frame = buf[i:i + frame_len]
+            crc = crc_x25(bytes([CRC_EXTRA[msgid]]), crc_x25(frame[1:MAVLINK_HEADER_LEN + payload_len]))
+            if crc != struct.unpack_from('<H', frame, MAVLINK_HEADER_LEN + payload_len)[0]:
+                i += 1
+                continue
+            t_done_us = t_us + (i + frame_len - 1 - ofs) * self.byte_us
+            self.received(t_done_us, msgid, frame_key(frame, payload_len))
+            if self.handler: self.handler(msgid, frame[MAVLINK_HEADER_LEN:MAVLINK_HEADER_LEN + payload_len])
+            i += frame_len
+        self.buf = buf[i:]
+
+    def percentile_ms(self, p, c = None):
+        return hist_percentile_ms(self.hist if c is None else self.hist_class[c], p)
+
+
+class AutopilotHandler:
+    # the autopilot takes the txbuf of the RADIO_STATUS the Rx sends
+    def __init__(self):
+        self.source = None
+
+    def __call__(self, msgid, payload):
+        if msgid != MSGID_RADIO_STATUS or self.source is None: return
+        # RADIO_STATUS: uint16 rxerrors, uint16 fixed, uint8 rssi, uint8 remrssi, uint8 txbuf, ...
+        payload = payload + bytes(9 - len(payload)) if len(payload) < 9 else payload
+        self.source.RadioStatus(payload[6])
+
+
+class GcsHandler:
+    # the GCS takes the scheduler counters of the Rx, DEBUG_FLOAT_ARRAY "MLRS_SCHED" of USE_FEATURE_SCHED_STATS
+    def __init__(self):
+        self.sched = None # coalesced cnt, coalesced bytes, bytes control, nav, bulk, coalescing
+
+    def __call__(self, msgid, payload):
+        if msgid != MSGID_DEBUG_FLOAT_ARRAY: return
+        # DEBUG_FLOAT_ARRAY: uint64 time_usec, uint16 array_id, char[10] name, float[58] data
+        payload = payload + bytes(max(0, 44 - len(payload)))
+        if payload[10:20].rstrip(b'\0') != b'MLRS_SCHED': return
+        self.sched = struct.unpack_from('<6f', payload, 20)
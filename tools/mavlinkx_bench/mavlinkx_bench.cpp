@@ -0,0 +1,383 @@
+//*******************************************************
+// Copyright (c) MLRS project
+// GPL3
+// https://www.gnu.org/licenses/gpl-3.0.de.html
+// OlliW @ www.olliw.eu
+//*******************************************************
+// MavlinkX benchmark
+//*******************************************************
+// host benchmark of the MavlinkX header substitution and payload compression
+// runs fmavX_msg_to_frame_bufX(), _fmavX_payload_compress(), _fmavX_payload_decompress()
+// over recorded telemetry, i.e. tlogs of ArduPilot, PX4, or raw MAVLink streams
+//
+// reports
+// - per msgid: count, payload bytes, compressed payload bytes, compression ratio
+// - total bytes on air for MAVLink, MavlinkX, and MavlinkX with compression
+// - ns/byte for compression, decompression and fmavX_msg_to_frame_bufX()
+// - decompression mismatches, should be 0
+// - total bytes on air for MavlinkX with delta compression, header context, and both, and the messages
+//   which get through it, without and with lost frames, the mismatches should be 0
+//
+// build (the fastmavlink library must have been generated, see Common/mavlink/fmav_generate_c_library.py):
+//   g++ -O2 -I../../mLRS/Common/mavlink mavlinkx_bench.cpp -o mavlinkx_bench
+// run:
+//   ./mavlinkx_bench flight1.tlog flight2.tlog
+//
+// the ns/byte are host numbers, they are useful for comparing, not as absolute numbers for the mcus
+// the flash cost of MAVLINKX_COMPRESSION and MAVLINKX_O3 is best measured by the size of the firmware builds
+//*******************************************************
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+#include "fmav.h"
+#define MAVLINKX_DELTA
+#define MAVLINKX_CONTEXT
+#include "../../mLRS/Common/thirdparty/mavlinkx.h"
+
+
+#define BENCH_LOOPS_DEFAULT   20
+#define BENCH_LOSS            0.05 // frame loss for the delta compression and header context runs
+
+
+typedef struct
+{
+    uint32_t cnt;
+    uint32_t payload_bytes;
+    uint32_t compressed_bytes;      // payload bytes after compression, if compression fails the raw len is counted
+    uint32_t compressed_cnt;        // number of payloads for which compression reduced the len
+    uint32_t frame_bytes;           // MAVLink frame bytes
+    uint32_t frameX_bytes;          // MavlinkX frame bytes, without compression
+    uint32_t frameXc_bytes;         // MavlinkX frame bytes, with compression
+} tMsgIdStats;
+
+
+std::vector<fmav_message_t> msgs;
+tMsgIdStats stats[256];
+tMsgIdStats stats_total;
+uint32_t decompress_mismatch_cnt;
+
+
+//-------------------------------------------------------
+// load tlog or raw MAVLink stream
+//-------------------------------------------------------
+// a tlog is a sequence of 8 bytes timestamp followed by a MAVLink frame
+// we simply feed all bytes into the parser, the timestamps are rejected by it as garbage
+
+bool load_file(const char* fname)
+{
+FILE* fp;
+uint8_t buf[FASTMAVLINK_FRAME_LEN_MAX];
+fmav_status_t status;
+fmav_result_t result;
+fmav_message_t msg;
+int c;
+uint32_t cnt = 0;
+
+    fp = fopen(fname, "rb");
+    if (!fp) {
+        printf("error: could not open %s\n", fname);
+        return false;
+    }
+
+    memset(&status, 0, sizeof(fmav_status_t));
+    fmav_parse_reset(&status);
+
+    while ((c = fgetc(fp)) != EOF) {
+        fmav_parse_and_check_to_frame_buf(&result, buf, &status, (uint8_t)c);
+        if (result.res != FASTMAVLINK_PARSE_RESULT_OK) continue;
+        fmav_frame_buf_to_msg(&msg, &result, buf); // requires RESULT_OK
+        msgs.push_back(msg);
+        cnt++;
+    }
+
+    fclose(fp);
+    printf("%s: %u messages\n", fname, cnt);
+    return true;
+}
+
+
+//-------------------------------------------------------
+// compression ratio
+//-------------------------------------------------------
+
+uint16_t frame_len(const fmav_message_t* const msg)
+{
+    uint16_t len = msg->len + FASTMAVLINK_CHECKSUM_LEN;
+    len += (msg->magic == FASTMAVLINK_MAGIC_V1) ? FASTMAVLINK_HEADER_V1_LEN : FASTMAVLINK_HEADER_V2_LEN;
+    if (msg->incompat_flags & FASTMAVLINK_INCOMPAT_FLAGS_SIGNED) len += FASTMAVLINK_SIGNATURE_LEN;
+    return len;
+}
+
+
+void add_stats(tMsgIdStats* const s, const fmav_message_t* const msg, uint8_t compressed_len, bool compressed,
+               uint16_t frameX_len, uint16_t frameXc_len)
+{
+    s->cnt++;
+    s->payload_bytes += msg->len;
+    s->compressed_bytes += compressed_len;
+    if (compressed) s->compressed_cnt++;
+    s->frame_bytes += frame_len(msg);
+    s->frameX_bytes += frameX_len;
+    s->frameXc_bytes += frameXc_len;
+}
+
+
+void do_ratio(void)
+{
+uint8_t bufX[MAVLINKX_FRAME_LEN_MAX + 16];
+uint8_t out[FASTMAVLINK_PAYLOAD_LEN_MAX + 16];
+uint8_t len_out;
+
+    memset(stats, 0, sizeof(stats));
+    memset(&stats_total, 0, sizeof(stats_total));
+    decompress_mismatch_cnt = 0;
+
+    for (auto& msg : msgs) {
+        bool compressed = _fmavX_payload_compress(out, &len_out, msg.payload, msg.len);
+        uint8_t compressed_len = (compressed) ? len_out : msg.len;
+
+        if (compressed) {
+            // round trip, the decompression works in place
+            uint8_t len_dec;
+            _fmavX_payload_decompress(out, &len_dec, len_out);
+            if (len_dec != msg.len || memcmp(out, msg.payload, msg.len)) decompress_mismatch_cnt++;
+        }
+
+        fmavX_config_compression(0);
+        uint16_t frameX_len = fmavX_msg_to_frame_bufX(bufX, &msg);
+        fmavX_config_compression(1);
+        uint16_t frameXc_len = fmavX_msg_to_frame_bufX(bufX, &msg);
+
+        add_stats(&stats[msg.msgid & 0xFF], &msg, compressed_len, compressed, frameX_len, frameXc_len);
+        add_stats(&stats_total, &msg, compressed_len, compressed, frameX_len, frameXc_len);
+    }
+}
+
+
+void print_ratio(void)
+{
+    // msgids > 255 are lumped together by their lower byte, they are rare in telemetry
+    printf("\n");
+    printf("msgid    cnt  payload  compr  ratio  compr%%\n");
+    for (uint16_t id = 0; id < 256; id++) {
+        tMsgIdStats* s = &stats[id];
+        if (!s->cnt) continue;
+        printf("%5u %6u %8u %6u %6.3f %6.1f\n",
+               id, s->cnt, s->payload_bytes, s->compressed_bytes,
+               (s->payload_bytes) ? (double)s->compressed_bytes / s->payload_bytes : 1.0,
+               100.0 * s->compressed_cnt / s->cnt);
+    }
+
+    tMsgIdStats* t = &stats_total;
+    if (!t->cnt) return;
+    printf("\n");
+    printf("messages:            %u\n", t->cnt);
+    printf("payload:             %u -> %u bytes, ratio %.3f\n",
+           t->payload_bytes, t->compressed_bytes, (double)t->compressed_bytes / t->payload_bytes);
+    printf("on air, MAVLink:     %u bytes\n", t->frame_bytes);
+    printf("on air, MavlinkX:    %u bytes, saved %d (%.1f%%)\n",
+           t->frameX_bytes, (int32_t)t->frame_bytes - (int32_t)t->frameX_bytes,
+           100.0 * ((double)t->frame_bytes - t->frameX_bytes) / t->frame_bytes);
+    printf("on air, compressed:  %u bytes, saved %d (%.1f%%)\n",
+           t->frameXc_bytes, (int32_t)t->frame_bytes - (int32_t)t->frameXc_bytes,
+           100.0 * ((double)t->frame_bytes - t->frameXc_bytes) / t->frame_bytes);
+    printf("decompress mismatch: %u\n", decompress_mismatch_cnt);
+}
+
+
+//-------------------------------------------------------
+// delta compression, header context
+//-------------------------------------------------------
+// the X frames go through the parser, as on the other side of the link
+// frames are dropped as a whole, as the mLRS link would do
+
+typedef struct
+{
+    uint32_t frameXs_bytes;         // MavlinkX frame bytes, with delta compression and/or header context
+    uint32_t sent_cnt;
+    uint32_t dropped_cnt;           // frames dropped on purpose
+    uint32_t received_cnt;          // frames out of the parser
+    uint32_t mismatch_cnt;          // received frames not equal to the original, should be 0
+} tStatefulStats;
+
+
+void do_stateful(tStatefulStats* const d, double loss, uint8_t delta, uint8_t context)
+{
+uint8_t bufX[MAVLINKX_FRAME_LEN_MAX + 16];
+uint8_t buf[FASTMAVLINK_FRAME_LEN_MAX + 16];
+uint8_t buf_orig[FASTMAVLINK_FRAME_LEN_MAX + 16];
+fmav_status_t status;
+fmav_result_t result;
+
+    memset(d, 0, sizeof(tStatefulStats));
+    memset(&status, 0, sizeof(fmav_status_t));
+    fmav_parse_reset(&status);
+    fmavX_init();
+    fmavX_config_compression(1);
+    fmavX_config_delta(delta);
+    fmavX_config_context(context);
+    srand(1);
+
+    for (auto& msg : msgs) {
+        uint16_t len = fmavX_msg_to_frame_bufX(bufX, &msg);
+        d->frameXs_bytes += len;
+        d->sent_cnt++;
+
+        if ((double)rand() / RAND_MAX < loss) { d->dropped_cnt++; continue; }
+
+        for (uint16_t i = 0; i < len; i++) {
+            if (!fmavX_parse_and_checkX_to_frame_buf(&result, buf, &status, bufX[i])) continue;
+            d->received_cnt++;
+            uint16_t len_orig = fmav_msg_to_frame_buf(buf_orig, &msg);
+            if (result.frame_len != len_orig || memcmp(buf, buf_orig, len_orig)) d->mismatch_cnt++;
+        }
+    }
+
+    fmavX_config_delta(0);
+    fmavX_config_context(0);
+}
+
+
+void print_stateful(void)
+{
+const char* name[3] = { "delta:  ", "context:", "both:   " };
+tStatefulStats d;
+
+    tMsgIdStats* t = &stats_total;
+    if (!t->cnt) return;
+
+    for (uint8_t n = 0; n < 3; n++) {
+        uint8_t delta = (n != 1);
+        uint8_t context = (n != 0);
+
+        do_stateful(&d, 0.0, delta, context);
+        printf("on air, %s     %u bytes, saved %d (%.1f%%)\n",
+               name[n], d.frameXs_bytes, (int32_t)t->frame_bytes - (int32_t)d.frameXs_bytes,
+               100.0 * ((double)t->frame_bytes - d.frameXs_bytes) / t->frame_bytes);
+        printf("  received:          %u of %u, mismatch %u\n", d.received_cnt, d.sent_cnt, d.mismatch_cnt);
+
+        do_stateful(&d, BENCH_LOSS, delta, context);
+        printf("  with %.0f%% loss:      %u of %u, lost by missing state %u, mismatch %u\n",
+               100.0 * BENCH_LOSS, d.received_cnt, d.sent_cnt - d.dropped_cnt,
+               d.sent_cnt - d.dropped_cnt - d.received_cnt, d.mismatch_cnt);
+    }
+}
+
+
+//-------------------------------------------------------
+// timing
+//-------------------------------------------------------
+
+double ns_now(void)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+volatile uint32_t sink; // prevents the compiler from optimizing the loops away
+
+
+void do_timing(uint16_t loops)
+{
+uint8_t bufX[MAVLINKX_FRAME_LEN_MAX + 16];
+uint8_t out[FASTMAVLINK_PAYLOAD_LEN_MAX + 16];
+uint8_t len_out;
+double t_start;
+uint64_t bytes;
+
+    // compress, per payload byte
+    bytes = 0;
+    t_start = ns_now();
+    for (uint16_t l = 0; l < loops; l++) {
+        for (auto& msg : msgs) {
+            sink += _fmavX_payload_compress(out, &len_out, msg.payload, msg.len);
+            bytes += msg.len;
+        }
+    }
+    double t_compress = (ns_now() - t_start) / bytes;
+
+    // decompress, per decompressed payload byte
+    // the compressed payloads are prepared first
+    std::vector<std::vector<uint8_t>> compressed;
+    for (auto& msg : msgs) {
+        if (!_fmavX_payload_compress(out, &len_out, msg.payload, msg.len)) continue;
+        compressed.push_back(std::vector<uint8_t>(out, out + len_out));
+    }
+    bytes = 0;
+    t_start = ns_now();
+    for (uint16_t l = 0; l < loops; l++) {
+        for (auto& c : compressed) {
+            uint8_t len_dec;
+            memcpy(out, c.data(), c.size());
+            _fmavX_payload_decompress(out, &len_dec, c.size());
+            sink += len_dec;
+            bytes += len_dec;
+        }
+    }
+    double t_decompress = (bytes) ? (ns_now() - t_start) / bytes : 0.0;
+
+    // msg to X frame, per MAVLink frame byte
+    double t_frameX[2];
+    for (uint8_t compression = 0; compression < 2; compression++) {
+        fmavX_config_compression(compression);
+        bytes = 0;
+        t_start = ns_now();
+        for (uint16_t l = 0; l < loops; l++) {
+            for (auto& msg : msgs) {
+                sink += fmavX_msg_to_frame_bufX(bufX, &msg);
+                bytes += frame_len(&msg);
+            }
+        }
+        t_frameX[compression] = (ns_now() - t_start) / bytes;
+    }
+
+    printf("\n");
+    printf("compress:            %.2f ns/byte\n", t_compress);
+    printf("decompress:          %.2f ns/byte\n", t_decompress);
+    printf("msg_to_frame_bufX:   %.2f ns/byte\n", t_frameX[0]);
+    printf("  with compression:  %.2f ns/byte\n", t_frameX[1]);
+}
+
+
+//-------------------------------------------------------
+// main
+//-------------------------------------------------------
+
+int main(int argc, char* argv[])
+{
+uint16_t loops = BENCH_LOOPS_DEFAULT;
+
+    if (argc < 2) {
+        printf("usage: mavlinkx_bench [-l loops] file.tlog [file.tlog ...]\n");
+        return 1;
+    }
+
+    fmav_init();
+    fmavX_init();
+
+    for (int n = 1; n < argc; n++) {
+        if (!strcmp(argv[n], "-l") && (n + 1 < argc)) {
+            loops = atoi(argv[++n]);
+            if (!loops) loops = 1;
+            continue;
+        }
+        if (!load_file(argv[n])) return 1;
+    }
+
+    if (!msgs.size()) {
+        printf("no messages\n");
+        return 1;
+    }
+
+    do_ratio();
+    print_ratio();
+    print_stateful();
+    do_timing(loops);
+
+    return 0;
+}